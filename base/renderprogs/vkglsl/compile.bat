@@ -5,4 +5,7 @@ for %%f in (*.vert) do (
 )
 for %%f in (*.frag) do (
 	%VULKAN_SDK%\bin\glslangValidator.exe -V %%f -o ..\spirv\%%~nf.fspv
+)
+for %%f in (*.comp) do (
+	%VULKAN_SDK%\bin\glslangValidator.exe -V %%f -o ..\spirv\%%~nf.cspv
 )
\ No newline at end of file
@@ -2,7 +2,7 @@ import os
 from glob import glob
 from subprocess import call
 
-for glsl_ext, sprv_ext in [ ('vert', 'vspv'), ('frag', 'fspv') ]:
+for glsl_ext, sprv_ext in [ ('vert', 'vspv'), ('frag', 'fspv'), ('comp', 'cspv') ]:
 	shaders = glob( '*.{0}'.format( glsl_ext ) )
 	for sh in shaders:
 		name = sh.split( '.' )[0]
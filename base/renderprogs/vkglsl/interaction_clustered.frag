@@ -0,0 +1,124 @@
+#version 450
+#pragma shader_stage( fragment )
+
+#extension GL_ARB_separate_shader_objects : enable
+
+// must match RenderCommon.h
+const int CLUSTER_TILES_X = 16;
+const int CLUSTER_TILES_Y = 8;
+const int CLUSTER_DEPTH_SLICES = 16;
+const int CLUSTER_COUNT = CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_DEPTH_SLICES;
+const int MAX_CLUSTERED_LIGHTS = 32;
+
+layout( binding = 1 ) uniform UBO {
+	vec4 rpDiffuseModifier;
+	vec4 rpSpecularModifier;
+	vec4 rpGlobalEyePos;
+	vec4 rpClusterGrid;
+	vec4 rpClusterDepth;
+	vec4 rpClusterSlices;
+};
+
+// lightClusters_t, every light is its origin, projection S T Q, falloff S and color
+layout( binding = 2 ) uniform UBO_clusters {
+	vec4 clusterLights[ MAX_CLUSTERED_LIGHTS * 6 ];
+	uvec4 clusterMasks[ CLUSTER_COUNT / 4 ];
+};
+
+layout( binding = 3 ) uniform sampler2D samp0;
+layout( binding = 4 ) uniform sampler2D samp1;
+layout( binding = 5 ) uniform sampler2D samp2;
+layout( binding = 6 ) uniform sampler2D samp3;
+layout( binding = 7 ) uniform sampler2D samp4;
+
+layout( location = 0 ) in vec4 in_Position;
+layout( location = 1 ) in vec4 in_TexCoord1;
+layout( location = 2 ) in vec4 in_TexCoord2;
+layout( location = 3 ) in vec4 in_TexCoord3;
+layout( location = 4 ) in vec4 in_Tangent;
+layout( location = 5 ) in vec4 in_Binormal;
+layout( location = 6 ) in vec4 in_Normal;
+layout( location = 7 ) in vec4 in_Color;
+
+layout( location = 0 ) out vec4 out_Color;
+
+const vec4 matrixCoCg1YtoRGB1X = vec4( 1.0, -1.0, 0.0, 1.0 );
+const vec4 matrixCoCg1YtoRGB1Y = vec4( 0.0, 1.0, -0.50196078, 1.0 );
+const vec4 matrixCoCg1YtoRGB1Z = vec4( -1.0, -1.0, 1.00392156, 1.0 );
+vec3 ConvertYCoCgToRGB( vec4 YCoCg ) {
+	vec3 rgbColor;
+	YCoCg.z = ( YCoCg.z * 31.875 ) + 1.0;
+	YCoCg.z = 1.0 / YCoCg.z;
+	YCoCg.xy *= YCoCg.z;
+	rgbColor.x = dot( YCoCg , matrixCoCg1YtoRGB1X );
+	rgbColor.y = dot( YCoCg , matrixCoCg1YtoRGB1Y );
+	rgbColor.z = dot( YCoCg , matrixCoCg1YtoRGB1Z );
+	return rgbColor ;
+}
+
+void main() {
+	vec4 bumpMap = texture( samp0, in_TexCoord1.xy );
+	vec4 YCoCG = texture( samp3, in_TexCoord2.xy );
+	vec4 specMap = texture( samp4, in_TexCoord3.xy );
+	vec3 diffuseMap = ConvertYCoCgToRGB( YCoCG );
+	vec3 localNormal;
+	localNormal.xy = bumpMap.wy - 0.5;
+	localNormal.z = sqrt( abs( dot( localNormal.xy, localNormal.xy ) - 0.25 ) );
+	localNormal = normalize( localNormal );
+	vec3 globalNormal = normalize( localNormal.x * in_Tangent.xyz + localNormal.y * in_Binormal.xyz + localNormal.z * in_Normal.xyz );
+	vec3 toView = normalize( rpGlobalEyePos.xyz - in_Position.xyz );
+	float specularPower = 10.0;
+	vec3 diffuseColor = diffuseMap * rpDiffuseModifier.xyz;
+	vec3 specularColor = specMap.xyz * rpSpecularModifier.xyz;
+
+	// the per-light passes only draw the triangles facing the light, only front sided
+	// surfaces are clustered, so the triangle plane faces the view
+	vec3 faceNormal = cross( dFdx( in_Position.xyz ), dFdy( in_Position.xyz ) );
+	if ( dot( faceNormal, rpGlobalEyePos.xyz - in_Position.xyz ) < 0.0 ) {
+		faceNormal = -faceNormal;
+	}
+
+	// find the cluster from the window position and the exponential depth slice, the
+	// lights are binned by the pixels of their scissor rect, so use the pixel and not its center
+	ivec2 tile = ivec2( ( floor( gl_FragCoord.xy ) - rpClusterGrid.xy ) * rpClusterGrid.zw );
+	tile = clamp( tile, ivec2( 0 ), ivec2( CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1 ) );
+	float viewDepth = dot( in_Position, rpClusterDepth );
+	int slice = min( int( log( max( viewDepth * rpClusterSlices.x, 1.0 ) ) * rpClusterSlices.y ), CLUSTER_DEPTH_SLICES - 1 );
+	int cluster = ( slice * CLUSTER_TILES_Y + tile.y ) * CLUSTER_TILES_X + tile.x;
+	uint lightMask = clusterMasks[ cluster >> 2 ][ cluster & 3 ];
+
+	vec3 color = vec3( 0.0 );
+	while ( lightMask != 0u ) {
+		int lightNum = findLSB( lightMask );
+		lightMask &= lightMask - 1u;
+
+		vec4 lightOrigin = clusterLights[ lightNum * 6 + 0 ];
+		vec4 lightProjectionS = clusterLights[ lightNum * 6 + 1 ];
+		vec4 lightProjectionT = clusterLights[ lightNum * 6 + 2 ];
+		vec4 lightProjectionQ = clusterLights[ lightNum * 6 + 3 ];
+		vec4 lightFalloffS = clusterLights[ lightNum * 6 + 4 ];
+		vec4 lightColor = clusterLights[ lightNum * 6 + 5 ];
+
+		if ( dot( faceNormal, lightOrigin.xyz - in_Position.xyz ) < 0.0 ) {
+			continue;
+		}
+
+		vec3 projection = vec3( dot( in_Position, lightProjectionS ), dot( in_Position, lightProjectionT ), dot( in_Position, lightProjectionQ ) );
+		if ( projection.z <= 0.0 ) {
+			continue;
+		}
+		vec4 lightFalloff = textureProj( samp1, vec3( dot( in_Position, lightFalloffS ), 0.5, 1.0 ) );
+		vec4 lightProj = textureProj( samp2, projection );
+
+		// the per-light passes clamp each light to zero when writing it, the sum has to clamp here
+		vec3 lightVector = normalize( lightOrigin.xyz - in_Position.xyz );
+		vec3 halfAngleVector = normalize( lightVector + toView );
+		float lDotN = max( dot( lightVector, globalNormal ), 0.0 );
+		float hDotN = max( dot( halfAngleVector, globalNormal ), 0.0 );
+		vec3 specularContribution = vec3( pow( hDotN, specularPower ) );
+		color += ( diffuseColor + specularColor * specularContribution ) * lDotN * lightProj.xyz * lightFalloff.xyz * lightColor.xyz;
+	}
+
+	out_Color.xyz = color * in_Color.xyz;
+	out_Color.w = 1.0;
+}
\ No newline at end of file
@@ -282,7 +282,39 @@ idConsoleLocal::DrawMemoryUsage
 ==================
 */
 float idConsoleLocal::DrawMemoryUsage( float y ) {
-	return y;
+	static const int MAX_MEMORY_TAGS = 16;
+
+	struct tagUsage_t {
+		int		tag;
+		int		bytes;
+		int		count;
+	};
+	class idSort_TagUsage : public idSort_Quick< tagUsage_t, idSort_TagUsage > {
+	public:
+		int Compare( const tagUsage_t & a, const tagUsage_t & b ) const { return b.bytes - a.bytes; }
+	};
+
+	idStaticList< tagUsage_t, TAG_NUM_TAGS > tags;
+	int totalBytes = 0;
+	for ( int i = 0; i < TAG_NUM_TAGS; i++ ) {
+		tagUsage_t usage;
+		usage.tag = i;
+		Mem_GetTagUsage( (memTag_t)i, usage.bytes, usage.count );
+		if ( usage.count > 0 ) {
+			tags.Append( usage );
+			totalBytes += usage.bytes;
+		}
+	}
+	idSort_TagUsage().Sort( tags.Ptr(), tags.Num() );
+
+	DrawTextRightAlign( LOCALSAFE_RIGHT, y, "heap: %d kB", totalBytes >> 10 );
+	for ( int i = 0; i < tags.Num() && i < MAX_MEMORY_TAGS; i++ ) {
+		const tagUsage_t & usage = tags[i];
+		DrawTextRightAlign( LOCALSAFE_RIGHT, y, "%s: %d kB (peak %d kB) %d", Mem_GetTagName( (memTag_t)usage.tag ),
+			usage.bytes >> 10, Mem_GetTagHighWater( (memTag_t)usage.tag ) >> 10, usage.count );
+	}
+
+	return y + SMALLCHAR_HEIGHT + 4;
 }
 
 //=========================================================================
@@ -346,6 +346,9 @@ void idCommonLocal::Frame() {
 		// This is the only place this is incremented
 		idLib::frameNumber++;
 
+		// sample the live heap memory for the per tag high water marks
+		Mem_UpdateTagHighWater();
+
 		// allow changing SIMD usage on the fly
 		if ( com_forceGenericSIMD.IsModified() ) {
 			idSIMD::InitProcessor( "doom", com_forceGenericSIMD.GetBool() );
@@ -0,0 +1,212 @@
+/*
+===========================================================================
+
+Doom 3 BFG Edition GPL Source Code
+Copyright (C) 1993-2012 id Software LLC, a ZeniMax Media company. 
+Copyright (C) 2016-2017 Dustin Land
+
+This file is part of the Doom 3 BFG Edition GPL Source Code ("Doom 3 BFG Edition Source Code").  
+
+Doom 3 BFG Edition Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 BFG Edition Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 BFG Edition Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 BFG Edition Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 BFG Edition Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+#pragma hdrstop
+#include "precompiled.h"
+
+static idFrameAllocator * currentFrameAllocator = NULL;
+
+// the scratch buffer of every thread stays allocated until the thread exits with the process
+static __declspec( thread ) byte *	threadScratch;
+static __declspec( thread ) int		threadScratchSize;
+
+/*
+========================
+idFrameAllocator::idFrameAllocator
+========================
+*/
+idFrameAllocator::idFrameAllocator() :
+	memory( NULL ),
+	size( 0 ),
+	alignment( 16 ),
+	chunkSize( DEFAULT_CHUNK_SIZE ),
+	generation( 0 ) {
+
+	memset( threadChunks, 0, sizeof( threadChunks ) );
+}
+
+/*
+========================
+idFrameAllocator::SetMemory
+========================
+*/
+void idFrameAllocator::SetMemory( byte * memory_, int size_, int alignment_, int chunkSize_ ) {
+	assert( idMath::IsPowerOfTwo( alignment_ ) );
+	assert( ( chunkSize_ & ( alignment_ - 1 ) ) == 0 );
+
+	memory = memory_;
+	size = size_;
+	alignment = alignment_;
+	chunkSize = chunkSize_;
+
+	Reset();
+}
+
+/*
+========================
+idFrameAllocator::Reset
+========================
+*/
+void idFrameAllocator::Reset() {
+	// invalidate all thread chunks
+	generation++;
+
+	const int bytesNeededForAlignment = ( alignment - (int)( (uintptr_t)memory & ( alignment - 1 ) ) ) & ( alignment - 1 );
+	allocated.SetValue( bytesNeededForAlignment );
+}
+
+/*
+========================
+idFrameAllocator::AllocShared
+========================
+*/
+byte * idFrameAllocator::AllocShared( int bytes ) {
+	// thread safe add, a failed allocation doesn't use up the space so smaller ones can still fit
+	int start = allocated.GetValue();
+	for ( ; ; ) {
+		if ( start + bytes > size ) {
+			return NULL;
+		}
+		const int previous = allocated.CompareExchange( start, start + bytes );
+		if ( previous == start ) {
+			break;
+		}
+		start = previous;
+	}
+	return memory + start;
+}
+
+/*
+========================
+idFrameAllocator::GetThreadChunk
+========================
+*/
+idFrameAllocator::threadChunk_t * idFrameAllocator::GetThreadChunk() {
+	int index = (int)(ptrdiff_t)threadChunkIndex;
+	if ( index == 0 ) {
+		// first allocation from this thread
+		index = numThreadChunks.Increment();
+		if ( index > MAX_THREAD_CHUNKS ) {
+			index = -1;
+		}
+		threadChunkIndex = (ptrdiff_t)index;
+	}
+	if ( index < 0 ) {
+		return NULL;
+	}
+	return &threadChunks[index - 1];
+}
+
+/*
+========================
+idFrameAllocator::Alloc
+========================
+*/
+void * idFrameAllocator::Alloc( int bytes ) {
+	bytes = ( bytes + alignment - 1 ) & ~( alignment - 1 );
+
+	// large allocations would waste too much of a chunk
+	if ( bytes > chunkSize / 4 ) {
+		return AllocShared( bytes );
+	}
+
+	threadChunk_t * chunk = GetThreadChunk();
+	if ( chunk == NULL ) {
+		return AllocShared( bytes );
+	}
+
+	if ( chunk->generation != generation || chunk->current + bytes > chunk->end ) {
+		byte * newChunk = AllocShared( chunkSize );
+		if ( newChunk == NULL ) {
+			// not enough left for a whole chunk, keep the current one for smaller allocations
+			return AllocShared( bytes );
+		}
+		chunk->generation = generation;
+		chunk->current = newChunk;
+		chunk->end = newChunk + chunkSize;
+	}
+
+	byte * ptr = chunk->current;
+	chunk->current += bytes;
+	return ptr;
+}
+
+/*
+========================
+idFrameAllocator::GetUnused
+========================
+*/
+int idFrameAllocator::GetUnused() const {
+	const int numChunks = Min( numThreadChunks.GetValue(), MAX_THREAD_CHUNKS );
+
+	int unused = 0;
+	for ( int i = 0; i < numChunks; i++ ) {
+		const threadChunk_t & chunk = threadChunks[i];
+		if ( chunk.generation == generation ) {
+			unused += (int)( chunk.end - chunk.current );
+		}
+	}
+	return unused;
+}
+
+/*
+==================
+Mem_SetFrameAllocator
+==================
+*/
+void Mem_SetFrameAllocator( idFrameAllocator * allocator ) {
+	currentFrameAllocator = allocator;
+}
+
+/*
+==================
+Mem_FrameAlloc
+==================
+*/
+void * Mem_FrameAlloc( const int size ) {
+	if ( currentFrameAllocator == NULL ) {
+		return NULL;
+	}
+	return currentFrameAllocator->Alloc( size );
+}
+
+/*
+==================
+Mem_ThreadScratch
+==================
+*/
+void * Mem_ThreadScratch( const int size ) {
+	if ( size > threadScratchSize ) {
+		// grow at least twice the size so a slowly growing size doesn't reallocate every time
+		const int newSize = ALIGN( Max( size, threadScratchSize * 2 ), 16 );
+		Mem_Free16( threadScratch );
+		threadScratch = (byte *)Mem_Alloc16( newSize, TAG_TEMP );
+		threadScratchSize = newSize;
+	}
+	return threadScratch;
+}
@@ -0,0 +1,98 @@
+/*
+===========================================================================
+
+Doom 3 BFG Edition GPL Source Code
+Copyright (C) 1993-2012 id Software LLC, a ZeniMax Media company. 
+Copyright (C) 2016-2017 Dustin Land
+
+This file is part of the Doom 3 BFG Edition GPL Source Code ("Doom 3 BFG Edition Source Code").  
+
+Doom 3 BFG Edition Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 BFG Edition Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 BFG Edition Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 BFG Edition Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 BFG Edition Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+#ifndef __FRAMEALLOCATOR_H__
+#define __FRAMEALLOCATOR_H__
+
+/*
+================================================
+idFrameAllocator is a linear allocator for temporary memory that is released all at
+once when the allocator is reset, typically once per frame. Every thread bumps through
+a chunk of its own, so threads only touch the shared allocation offset when they need
+a new chunk. The allocator does not own the memory it hands out.
+================================================
+*/
+class idFrameAllocator {
+public:
+	static const int	DEFAULT_CHUNK_SIZE	= 64 * 1024;
+	static const int	MAX_THREAD_CHUNKS	= 64;		// any other threads allocate from the shared offset
+
+						idFrameAllocator();
+
+	// alignment must be a power of two and chunkSize a multiple of the alignment
+	void				SetMemory( byte * memory, int size, int alignment, int chunkSize = DEFAULT_CHUNK_SIZE );
+
+	// Releases all allocations. No other thread may allocate while the allocator is reset.
+	void				Reset();
+
+	// Thread safe. Returns NULL when the allocator ran out of memory.
+	void *				Alloc( int bytes );
+
+	// number of bytes taken from the memory, including the unused parts of the thread chunks
+	int					GetAllocated() const { return allocated.GetValue(); }
+	int					GetSize() const { return size; }
+
+	// bytes left at the end of the current thread chunks, only exact while no thread allocates
+	int					GetUnused() const;
+
+private:
+	struct threadChunk_t {
+		int				generation;		// the chunk is only valid for the generation it was allocated in
+		byte *			current;
+		byte *			end;
+	};
+
+	byte *				memory;
+	int					size;
+	int					alignment;
+	int					chunkSize;
+	int					generation;
+	idSysInterlockedInteger	allocated;
+	idSysInterlockedInteger	numThreadChunks;
+	threadChunk_t		threadChunks[MAX_THREAD_CHUNKS];
+	ID_TLS				threadChunkIndex;	// one based index of the chunk of the calling thread, -1 if none is available
+
+	byte *				AllocShared( int bytes );
+	threadChunk_t *		GetThreadChunk();
+
+						idFrameAllocator( const idFrameAllocator & ) {}
+	void				operator=( const idFrameAllocator & ) {}
+};
+
+// Allocates temporary memory that stays valid until the frame allocator set with
+// Mem_SetFrameAllocator is reset. Returns NULL if no frame allocator is set or when
+// it ran out of memory. Thread safe, so it can be used from parallel jobs.
+void		Mem_SetFrameAllocator( idFrameAllocator * allocator );
+void *		Mem_FrameAlloc( const int size );
+
+// Returns a 16 byte aligned buffer of at least the given size that belongs to the calling
+// thread, for temporaries that are thrown away before the function returns. The buffer is
+// reused by the next call on the same thread, so it only grows from the heap a few times.
+void *		Mem_ThreadScratch( const int size );
+
+#endif // !__FRAMEALLOCATOR_H__
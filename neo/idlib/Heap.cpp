@@ -37,6 +37,553 @@ If you have questions concerning this license or the applicable additional terms
 
 #undef new
 
+/*
+================================================================================================
+
+	Pooled Heap
+
+Allocations up to HEAP_MAX_POOLED_SIZE are served from per size class free lists so idList
+growth, idStr and decl allocations don't go to the system allocator. Every allocation is
+preceded by a header with the size class and the memory tag, so Mem_Free16 doesn't need the
+size and the live memory can be accounted per memTag_t.
+
+Every thread caches a few free blocks of each size class and only takes the spin lock of a
+size class to move a batch of blocks between its cache and the shared free list. The spans
+the blocks are carved from are never returned to the system, freed blocks are reused by
+later allocations of the same size class.
+
+The first allocation can happen during static initialization, so everything in here is
+zero initialized data that is set up on demand and may not rely on constructors.
+================================================================================================
+*/
+
+static const int HEAP_ALIGNMENT				= 16;
+static const int HEAP_MAX_POOLED_SIZE		= 32 * 1024;	// larger allocations go to the system allocator
+static const int HEAP_MAX_SIZE_CLASSES		= 48;
+static const int HEAP_MIN_SPAN_SIZE			= 64 * 1024;
+static const int HEAP_BATCH_SIZE			= 16 * 1024;	// bytes moved between a thread cache and the shared free list at once
+static const int HEAP_MAX_BATCH_COUNT		= 64;
+static const int HEAP_MAX_THREAD_CACHES		= MEM_MAX_THREAD_INDEXES;	// any other threads use the shared free lists directly
+static const int HEAP_LARGE_ALLOC			= 0x7FFF;		// size class of allocations from the system allocator
+
+static const int HEAP_MAGIC_ALLOCATED		= 0x48414c43;
+static const int HEAP_MAGIC_FREE			= 0x48465245;
+
+enum heapInitState_t {
+	HEAP_UNINITIALIZED,
+	HEAP_INITIALIZING,
+	HEAP_INITIALIZED
+};
+
+struct heapHeader_t {
+	int					size;
+	short				sizeClass;
+	short				tag;
+	int					magic;
+	int					trackIndex;			// one based index of the tracking record, 0 if the allocation isn't tracked
+};
+
+compile_time_assert( sizeof( heapHeader_t ) == HEAP_ALIGNMENT );
+
+struct heapFreeBlock_t {
+	heapFreeBlock_t *	next;
+};
+
+struct heapSizeClass_t {
+	int					blockSize;			// without the header
+	int					batchCount;
+	interlockedInt_t	lock;
+	heapFreeBlock_t *	freeList;
+	int					numFree;
+	int					numSpans;
+	int					spanBytes;
+	int					numSharedAllocs;	// allocations and frees of threads without a cache
+	int					numSharedFrees;
+};
+
+struct heapThreadCache_t {
+	heapFreeBlock_t *	freeList[HEAP_MAX_SIZE_CLASSES];
+	int					numFree[HEAP_MAX_SIZE_CLASSES];
+	int					numAllocs[HEAP_MAX_SIZE_CLASSES];
+	int					numFrees[HEAP_MAX_SIZE_CLASSES];
+	// only written by the owning thread, so the counts of a single cache can be negative
+	int					tagBytes[TAG_NUM_TAGS];
+	int					tagCount[TAG_NUM_TAGS];
+};
+
+static interlockedInt_t		heapInitState;
+static heapSizeClass_t		heapSizeClasses[HEAP_MAX_SIZE_CLASSES];
+static int					heapNumSizeClasses;
+static byte					heapSizeClassForSize[HEAP_MAX_POOLED_SIZE / HEAP_ALIGNMENT + 1];
+static heapThreadCache_t	heapThreadCaches[HEAP_MAX_THREAD_CACHES];
+static interlockedInt_t		heapNumThreadCaches;
+static interlockedInt_t		heapSharedTagBytes[TAG_NUM_TAGS];
+static interlockedInt_t		heapSharedTagCount[TAG_NUM_TAGS];
+static interlockedInt_t		heapLargeAllocs;
+static interlockedInt_t		heapLargeBytes;
+static int					heapTagHighWater[TAG_NUM_TAGS];
+
+// one based index into heapThreadCaches, -1 if the thread didn't get a cache
+// this can't be an ID_TLS because the heap is used before static constructors run
+static __declspec( thread ) int	heapThreadCacheIndex;
+
+/*
+==================
+Mem_LockSizeClass
+==================
+*/
+static ID_INLINE void Mem_LockSizeClass( heapSizeClass_t & sizeClass ) {
+	while ( Sys_InterlockedCompareExchange( sizeClass.lock, 1, 0 ) != 0 ) {
+		Sys_Yield();
+	}
+}
+
+/*
+==================
+Mem_UnlockSizeClass
+==================
+*/
+static ID_INLINE void Mem_UnlockSizeClass( heapSizeClass_t & sizeClass ) {
+	Sys_InterlockedExchange( sizeClass.lock, 0 );
+}
+
+/*
+==================
+Mem_InitHeap
+
+Builds the size classes: 16 byte steps up to 128 bytes and four classes
+per power of two above that.
+==================
+*/
+static void Mem_InitHeap() {
+	if ( Sys_InterlockedCompareExchange( heapInitState, HEAP_INITIALIZING, HEAP_UNINITIALIZED ) != HEAP_UNINITIALIZED ) {
+		// another thread is setting up the heap
+		while ( *(volatile interlockedInt_t *)&heapInitState != HEAP_INITIALIZED ) {
+			Sys_Yield();
+		}
+		return;
+	}
+
+	int blockSize = HEAP_ALIGNMENT;
+	while ( blockSize <= HEAP_MAX_POOLED_SIZE ) {
+		assert( heapNumSizeClasses < HEAP_MAX_SIZE_CLASSES );
+		heapSizeClass_t & sizeClass = heapSizeClasses[heapNumSizeClasses++];
+		sizeClass.blockSize = blockSize;
+		sizeClass.batchCount = Max( 2, Min( HEAP_MAX_BATCH_COUNT, HEAP_BATCH_SIZE / ( blockSize + (int)sizeof( heapHeader_t ) ) ) );
+
+		int step = HEAP_ALIGNMENT;
+		if ( blockSize >= 128 ) {
+			step = 128;
+			while ( step * 2 <= blockSize ) {
+				step *= 2;
+			}
+			step /= 4;
+		}
+		blockSize += step;
+	}
+
+	int sizeClass = 0;
+	for ( int i = 0; i < (int)ARRAY_COUNT( heapSizeClassForSize ); i++ ) {
+		while ( heapSizeClasses[sizeClass].blockSize < i * HEAP_ALIGNMENT ) {
+			sizeClass++;
+		}
+		heapSizeClassForSize[i] = (byte)sizeClass;
+	}
+
+	Sys_InterlockedExchange( heapInitState, HEAP_INITIALIZED );
+}
+
+/*
+==================
+Mem_GetThreadCache
+==================
+*/
+static ID_INLINE heapThreadCache_t * Mem_GetThreadCache() {
+	if ( heapThreadCacheIndex == 0 ) {
+		int index = Sys_InterlockedIncrement( heapNumThreadCaches );
+		heapThreadCacheIndex = ( index <= HEAP_MAX_THREAD_CACHES ) ? index : -1;
+	}
+	return ( heapThreadCacheIndex > 0 ) ? &heapThreadCaches[heapThreadCacheIndex - 1] : NULL;
+}
+
+/*
+==================
+Mem_GetThreadIndex
+==================
+*/
+int Mem_GetThreadIndex() {
+	if ( heapThreadCacheIndex == 0 ) {
+		Mem_GetThreadCache();
+	}
+	return ( heapThreadCacheIndex > 0 ) ? heapThreadCacheIndex - 1 : -1;
+}
+
+/*
+==================
+Mem_CountTag
+==================
+*/
+static ID_INLINE void Mem_CountTag( heapThreadCache_t * cache, int tag, int bytes, int count ) {
+	assert( tag >= 0 && tag < TAG_NUM_TAGS );
+	if ( cache != NULL ) {
+		cache->tagBytes[tag] += bytes;
+		cache->tagCount[tag] += count;
+	} else {
+		Sys_InterlockedAdd( heapSharedTagBytes[tag], bytes );
+		Sys_InterlockedAdd( heapSharedTagCount[tag], count );
+	}
+}
+
+/*
+==================
+Mem_AllocSpan
+
+The size class must be locked.
+==================
+*/
+static bool Mem_AllocSpan( heapSizeClass_t & sizeClass ) {
+	const int stride = sizeClass.blockSize + sizeof( heapHeader_t );
+	const int numBlocks = Max( HEAP_MIN_SPAN_SIZE, 4 * stride ) / stride;
+	byte * span = (byte *)_aligned_malloc( numBlocks * stride, HEAP_ALIGNMENT );
+	if ( span == NULL ) {
+		return false;
+	}
+	for ( int i = numBlocks - 1; i >= 0; i-- ) {
+		heapHeader_t * header = (heapHeader_t *)( span + i * stride );
+		header->magic = HEAP_MAGIC_FREE;
+		heapFreeBlock_t * block = (heapFreeBlock_t *)( header + 1 );
+		block->next = sizeClass.freeList;
+		sizeClass.freeList = block;
+	}
+	sizeClass.numFree += numBlocks;
+	sizeClass.numSpans++;
+	sizeClass.spanBytes += numBlocks * stride;
+	return true;
+}
+
+/*
+==================
+Mem_FillThreadCache
+
+Moves a batch of blocks from the shared free list to the thread cache.
+==================
+*/
+static void Mem_FillThreadCache( heapThreadCache_t * cache, int sizeClassNum ) {
+	heapSizeClass_t & sizeClass = heapSizeClasses[sizeClassNum];
+
+	Mem_LockSizeClass( sizeClass );
+	if ( sizeClass.numFree < sizeClass.batchCount ) {
+		Mem_AllocSpan( sizeClass );
+	}
+	const int count = Min( sizeClass.batchCount, sizeClass.numFree );
+	for ( int i = 0; i < count; i++ ) {
+		heapFreeBlock_t * block = sizeClass.freeList;
+		sizeClass.freeList = block->next;
+		block->next = cache->freeList[sizeClassNum];
+		cache->freeList[sizeClassNum] = block;
+	}
+	sizeClass.numFree -= count;
+	Mem_UnlockSizeClass( sizeClass );
+
+	cache->numFree[sizeClassNum] += count;
+}
+
+/*
+==================
+Mem_FlushThreadCache
+
+Moves a batch of blocks from the thread cache back to the shared free list.
+==================
+*/
+static void Mem_FlushThreadCache( heapThreadCache_t * cache, int sizeClassNum ) {
+	heapSizeClass_t & sizeClass = heapSizeClasses[sizeClassNum];
+
+	const int count = Min( sizeClass.batchCount, cache->numFree[sizeClassNum] );
+	if ( count == 0 ) {
+		return;
+	}
+	heapFreeBlock_t * first = cache->freeList[sizeClassNum];
+	heapFreeBlock_t * last = first;
+	for ( int i = 1; i < count; i++ ) {
+		last = last->next;
+	}
+	cache->freeList[sizeClassNum] = last->next;
+	cache->numFree[sizeClassNum] -= count;
+
+	Mem_LockSizeClass( sizeClass );
+	last->next = sizeClass.freeList;
+	sizeClass.freeList = first;
+	sizeClass.numFree += count;
+	Mem_UnlockSizeClass( sizeClass );
+}
+
+/*
+==================
+Mem_AllocBlock
+==================
+*/
+static heapHeader_t * Mem_AllocBlock( heapThreadCache_t * cache, int sizeClassNum ) {
+	heapFreeBlock_t * block = NULL;
+	if ( cache != NULL ) {
+		if ( cache->freeList[sizeClassNum] == NULL ) {
+			Mem_FillThreadCache( cache, sizeClassNum );
+		}
+		block = cache->freeList[sizeClassNum];
+		if ( block == NULL ) {
+			return NULL;
+		}
+		cache->freeList[sizeClassNum] = block->next;
+		cache->numFree[sizeClassNum]--;
+		cache->numAllocs[sizeClassNum]++;
+	} else {
+		heapSizeClass_t & sizeClass = heapSizeClasses[sizeClassNum];
+		Mem_LockSizeClass( sizeClass );
+		if ( sizeClass.freeList == NULL ) {
+			Mem_AllocSpan( sizeClass );
+		}
+		block = sizeClass.freeList;
+		if ( block != NULL ) {
+			sizeClass.freeList = block->next;
+			sizeClass.numFree--;
+			sizeClass.numSharedAllocs++;
+		}
+		Mem_UnlockSizeClass( sizeClass );
+		if ( block == NULL ) {
+			return NULL;
+		}
+	}
+	return (heapHeader_t *)block - 1;
+}
+
+/*
+==================
+Mem_FreeBlock
+==================
+*/
+static void Mem_FreeBlock( heapThreadCache_t * cache, int sizeClassNum, heapHeader_t * header ) {
+	heapFreeBlock_t * block = (heapFreeBlock_t *)( header + 1 );
+	if ( cache != NULL ) {
+		block->next = cache->freeList[sizeClassNum];
+		cache->freeList[sizeClassNum] = block;
+		cache->numFrees[sizeClassNum]++;
+		if ( ++cache->numFree[sizeClassNum] > 2 * heapSizeClasses[sizeClassNum].batchCount ) {
+			Mem_FlushThreadCache( cache, sizeClassNum );
+		}
+	} else {
+		heapSizeClass_t & sizeClass = heapSizeClasses[sizeClassNum];
+		Mem_LockSizeClass( sizeClass );
+		block->next = sizeClass.freeList;
+		sizeClass.freeList = block;
+		sizeClass.numFree++;
+		sizeClass.numSharedFrees++;
+		Mem_UnlockSizeClass( sizeClass );
+	}
+}
+
+/*
+================================================================================================
+
+	Allocation Tracking
+
+While mem_track is enabled every allocation gets a record with its callstack and the
+number of snapshots taken before it, so mem_diffSnapshots can list the callstacks of the
+allocations that were made between two snapshots and are still alive.
+
+The records and callstacks are stored in chunks from the system allocator so tracking
+never recurses into the heap.
+================================================================================================
+*/
+
+static const int HEAP_TRACK_CHUNK_SIZE		= 64 * 1024;
+static const int HEAP_TRACK_MAX_CHUNKS		= 256;
+static const int HEAP_TRACK_CALLSTACK_DEPTH	= 12;
+static const int HEAP_TRACK_HASH_SIZE		= 64 * 1024;
+static const int HEAP_MAX_SNAPSHOTS			= 16;
+
+struct heapTrackRecord_t {
+	int					size;				// 0 if the record is free
+	int					tag;
+	int					generation;			// number of snapshots taken before the allocation
+	int					callstack;
+	int					nextFree;
+};
+
+struct heapTrackCallstack_t {
+	address_t			stack[HEAP_TRACK_CALLSTACK_DEPTH];
+	int					hashNext;
+};
+
+struct heapSnapshot_t {
+	bool				tracking;			// allocation tracking was enabled when the snapshot was taken
+	int					tagBytes[TAG_NUM_TAGS];
+	int					tagCount[TAG_NUM_TAGS];
+};
+
+static bool						heapTracking;
+static interlockedInt_t			heapTrackLock;
+static heapTrackRecord_t *		heapTrackRecords[HEAP_TRACK_MAX_CHUNKS];
+static int						heapTrackNumRecords;
+static int						heapTrackFreeRecord;
+static heapTrackCallstack_t *	heapTrackCallstacks[HEAP_TRACK_MAX_CHUNKS];
+static int						heapTrackNumCallstacks;
+static int *					heapTrackCallstackHash;
+static heapSnapshot_t			heapSnapshots[HEAP_MAX_SNAPSHOTS];
+static int						heapNumSnapshots;
+
+// set while the tracking data is being reported so the allocations of the report aren't tracked
+static __declspec( thread ) bool	heapTrackSuspended;
+
+/*
+==================
+Mem_LockTracking
+==================
+*/
+static void Mem_LockTracking() {
+	while ( Sys_InterlockedCompareExchange( heapTrackLock, 1, 0 ) != 0 ) {
+		Sys_Yield();
+	}
+}
+
+/*
+==================
+Mem_UnlockTracking
+==================
+*/
+static void Mem_UnlockTracking() {
+	Sys_InterlockedExchange( heapTrackLock, 0 );
+}
+
+/*
+==================
+Mem_GetTrackRecord
+==================
+*/
+static ID_INLINE heapTrackRecord_t & Mem_GetTrackRecord( int index ) {
+	return heapTrackRecords[index / HEAP_TRACK_CHUNK_SIZE][index % HEAP_TRACK_CHUNK_SIZE];
+}
+
+/*
+==================
+Mem_GetTrackCallstack
+==================
+*/
+static ID_INLINE heapTrackCallstack_t & Mem_GetTrackCallstack( int index ) {
+	return heapTrackCallstacks[index / HEAP_TRACK_CHUNK_SIZE][index % HEAP_TRACK_CHUNK_SIZE];
+}
+
+/*
+==================
+Mem_FindTrackCallstack
+
+Returns the index of the callstack, adding it if it's new. The tracking must be locked.
+==================
+*/
+static int Mem_FindTrackCallstack( const address_t stack[HEAP_TRACK_CALLSTACK_DEPTH] ) {
+	unsigned int hash = 0;
+	for ( int i = 0; i < HEAP_TRACK_CALLSTACK_DEPTH; i++ ) {
+		hash = hash * 31 + (unsigned int)stack[i];
+	}
+	hash &= HEAP_TRACK_HASH_SIZE - 1;
+
+	for ( int i = heapTrackCallstackHash[hash]; i >= 0; i = Mem_GetTrackCallstack( i ).hashNext ) {
+		if ( memcmp( Mem_GetTrackCallstack( i ).stack, stack, sizeof( Mem_GetTrackCallstack( i ).stack ) ) == 0 ) {
+			return i;
+		}
+	}
+
+	const int index = heapTrackNumCallstacks;
+	const int chunk = index / HEAP_TRACK_CHUNK_SIZE;
+	if ( chunk >= HEAP_TRACK_MAX_CHUNKS ) {
+		return -1;
+	}
+	if ( heapTrackCallstacks[chunk] == NULL ) {
+		heapTrackCallstacks[chunk] = (heapTrackCallstack_t *)_aligned_malloc( HEAP_TRACK_CHUNK_SIZE * sizeof( heapTrackCallstack_t ), HEAP_ALIGNMENT );
+		if ( heapTrackCallstacks[chunk] == NULL ) {
+			return -1;
+		}
+	}
+	heapTrackNumCallstacks++;
+
+	heapTrackCallstack_t & callstack = Mem_GetTrackCallstack( index );
+	memcpy( callstack.stack, stack, sizeof( callstack.stack ) );
+	callstack.hashNext = heapTrackCallstackHash[hash];
+	heapTrackCallstackHash[hash] = index;
+	return index;
+}
+
+/*
+==================
+Mem_TrackAlloc
+
+Returns the track index for the header of a new allocation.
+==================
+*/
+static int Mem_TrackAlloc( int size, int tag ) {
+	if ( heapTrackSuspended ) {
+		return 0;
+	}
+
+	address_t stack[HEAP_TRACK_CALLSTACK_DEPTH];
+	if ( idLib::sys != NULL ) {
+		idLib::sys->GetCallStack( stack, HEAP_TRACK_CALLSTACK_DEPTH );
+	} else {
+		memset( stack, 0, sizeof( stack ) );
+	}
+
+	Mem_LockTracking();
+
+	const int callstack = Mem_FindTrackCallstack( stack );
+	if ( callstack < 0 ) {
+		Mem_UnlockTracking();
+		return 0;
+	}
+
+	int index = heapTrackFreeRecord;
+	if ( index >= 0 ) {
+		heapTrackFreeRecord = Mem_GetTrackRecord( index ).nextFree;
+	} else {
+		index = heapTrackNumRecords;
+		const int chunk = index / HEAP_TRACK_CHUNK_SIZE;
+		if ( chunk >= HEAP_TRACK_MAX_CHUNKS ) {
+			Mem_UnlockTracking();
+			return 0;
+		}
+		if ( heapTrackRecords[chunk] == NULL ) {
+			heapTrackRecords[chunk] = (heapTrackRecord_t *)_aligned_malloc( HEAP_TRACK_CHUNK_SIZE * sizeof( heapTrackRecord_t ), HEAP_ALIGNMENT );
+			if ( heapTrackRecords[chunk] == NULL ) {
+				Mem_UnlockTracking();
+				return 0;
+			}
+		}
+		heapTrackNumRecords++;
+	}
+
+	heapTrackRecord_t & record = Mem_GetTrackRecord( index );
+	record.size = size;
+	record.tag = tag;
+	record.generation = heapNumSnapshots;
+	record.callstack = callstack;
+	record.nextFree = -1;
+
+	Mem_UnlockTracking();
+
+	return index + 1;
+}
+
+/*
+==================
+Mem_TrackFree
+==================
+*/
+static void Mem_TrackFree( int trackIndex ) {
+	Mem_LockTracking();
+	heapTrackRecord_t & record = Mem_GetTrackRecord( trackIndex - 1 );
+	record.size = 0;
+	record.nextFree = heapTrackFreeRecord;
+	heapTrackFreeRecord = trackIndex - 1;
+	Mem_UnlockTracking();
+}
+
 /*
 ==================
 Mem_Alloc16
@@ -46,8 +593,41 @@ void * Mem_Alloc16( const int size, const memTag_t tag ) {
 	if ( !size ) {
 		return NULL;
 	}
-	const int paddedSize = ( size + 15 ) & ~15;
-	return _aligned_malloc( paddedSize, 16 );
+	if ( heapInitState != HEAP_INITIALIZED ) {
+		Mem_InitHeap();
+	}
+
+	heapThreadCache_t * cache = Mem_GetThreadCache();
+
+	heapHeader_t * header;
+	int sizeClassNum;
+	if ( size > HEAP_MAX_POOLED_SIZE ) {
+		const int paddedSize = ( size + HEAP_ALIGNMENT - 1 ) & ~( HEAP_ALIGNMENT - 1 );
+		header = (heapHeader_t *)_aligned_malloc( sizeof( heapHeader_t ) + paddedSize, HEAP_ALIGNMENT );
+		if ( header == NULL ) {
+			return NULL;
+		}
+		sizeClassNum = HEAP_LARGE_ALLOC;
+		Sys_InterlockedIncrement( heapLargeAllocs );
+		Sys_InterlockedAdd( heapLargeBytes, size );
+	} else {
+		sizeClassNum = heapSizeClassForSize[( size + HEAP_ALIGNMENT - 1 ) / HEAP_ALIGNMENT];
+		header = Mem_AllocBlock( cache, sizeClassNum );
+		if ( header == NULL ) {
+			return NULL;
+		}
+		assert( header->magic == HEAP_MAGIC_FREE );
+	}
+
+	header->size = size;
+	header->sizeClass = (short)sizeClassNum;
+	header->tag = (short)tag;
+	header->magic = HEAP_MAGIC_ALLOCATED;
+	header->trackIndex = heapTracking ? Mem_TrackAlloc( size, tag ) : 0;
+
+	Mem_CountTag( cache, tag, size, 1 );
+
+	return header + 1;
 }
 
 /*
@@ -59,7 +639,26 @@ void Mem_Free16( void *ptr ) {
 	if ( ptr == NULL ) {
 		return;
 	}
-	_aligned_free( ptr );
+	heapHeader_t * header = (heapHeader_t *)ptr - 1;
+	assert( header->magic == HEAP_MAGIC_ALLOCATED );
+	header->magic = HEAP_MAGIC_FREE;
+
+	heapThreadCache_t * cache = Mem_GetThreadCache();
+
+	Mem_CountTag( cache, header->tag, -header->size, -1 );
+
+	if ( header->trackIndex != 0 ) {
+		Mem_TrackFree( header->trackIndex );
+	}
+
+	if ( header->sizeClass == HEAP_LARGE_ALLOC ) {
+		Sys_InterlockedDecrement( heapLargeAllocs );
+		Sys_InterlockedSub( heapLargeBytes, header->size );
+		_aligned_free( header );
+		return;
+	}
+
+	Mem_FreeBlock( cache, header->sizeClass, header );
 }
 
 /*
@@ -84,3 +683,285 @@ char *Mem_CopyString( const char *in ) {
 	return out;
 }
 
+/*
+==================
+Mem_GetTagName
+==================
+*/
+const char * Mem_GetTagName( const memTag_t tag ) {
+	static const char * tagNames[] = {
+#define MEM_TAG( x )	#x,
+#include "sys/sys_alloc_tags.h"
+	};
+	compile_time_assert( ARRAY_COUNT( tagNames ) == TAG_NUM_TAGS );
+
+	if ( tag < 0 || tag >= TAG_NUM_TAGS ) {
+		return "?";
+	}
+	return tagNames[tag];
+}
+
+/*
+==================
+Mem_GetTagUsage
+
+Sums the per thread counters, the result is only exact while no other thread allocates.
+==================
+*/
+void Mem_GetTagUsage( const memTag_t tag, int & bytes, int & count ) {
+	assert( tag >= 0 && tag < TAG_NUM_TAGS );
+	bytes = heapSharedTagBytes[tag];
+	count = heapSharedTagCount[tag];
+	const int numCaches = Min( (int)heapNumThreadCaches, HEAP_MAX_THREAD_CACHES );
+	for ( int i = 0; i < numCaches; i++ ) {
+		bytes += heapThreadCaches[i].tagBytes[tag];
+		count += heapThreadCaches[i].tagCount[tag];
+	}
+}
+
+/*
+==================
+Mem_UpdateTagHighWater
+==================
+*/
+void Mem_UpdateTagHighWater() {
+	for ( int i = 0; i < TAG_NUM_TAGS; i++ ) {
+		int bytes;
+		int count;
+		Mem_GetTagUsage( (memTag_t)i, bytes, count );
+		heapTagHighWater[i] = Max( heapTagHighWater[i], bytes );
+	}
+}
+
+/*
+==================
+Mem_GetTagHighWater
+==================
+*/
+int Mem_GetTagHighWater( const memTag_t tag ) {
+	assert( tag >= 0 && tag < TAG_NUM_TAGS );
+	return heapTagHighWater[tag];
+}
+
+/*
+==================
+Mem_ListPools_f
+==================
+*/
+CONSOLE_COMMAND( mem_listPools, "lists the size classes of the pooled heap", 0 ) {
+	if ( heapInitState != HEAP_INITIALIZED ) {
+		return;
+	}
+	const int numCaches = Min( (int)heapNumThreadCaches, HEAP_MAX_THREAD_CACHES );
+
+	int totalSpanBytes = 0;
+	int totalLiveBytes = 0;
+	idLib::Printf( "  size  spans   span kB      live    cached    shared      allocs       frees\n" );
+	for ( int i = 0; i < heapNumSizeClasses; i++ ) {
+		const heapSizeClass_t & sizeClass = heapSizeClasses[i];
+		int cached = 0;
+		int allocs = sizeClass.numSharedAllocs;
+		int frees = sizeClass.numSharedFrees;
+		for ( int j = 0; j < numCaches; j++ ) {
+			cached += heapThreadCaches[j].numFree[i];
+			allocs += heapThreadCaches[j].numAllocs[i];
+			frees += heapThreadCaches[j].numFrees[i];
+		}
+		if ( sizeClass.numSpans == 0 ) {
+			continue;
+		}
+		const int live = allocs - frees;
+		idLib::Printf( "%6d %6d %9d %9d %9d %9d %11d %11d\n", sizeClass.blockSize, sizeClass.numSpans, sizeClass.spanBytes >> 10,
+						live, cached, sizeClass.numFree, allocs, frees );
+		totalSpanBytes += sizeClass.spanBytes;
+		totalLiveBytes += live * sizeClass.blockSize;
+	}
+	idLib::Printf( "%d kB in spans, %d kB in live blocks, %d thread caches\n", totalSpanBytes >> 10, totalLiveBytes >> 10, numCaches );
+	idLib::Printf( "%d large allocations, %d kB\n", (int)heapLargeAllocs, (int)( heapLargeBytes >> 10 ) );
+}
+
+/*
+==================
+Mem_ListTags_f
+==================
+*/
+CONSOLE_COMMAND( mem_listTags, "lists the live heap memory per memory tag", 0 ) {
+	Mem_UpdateTagHighWater();
+
+	int totalBytes = 0;
+	int totalCount = 0;
+	idLib::Printf( "  live kB    peak kB      count  tag\n" );
+	for ( int i = 0; i < TAG_NUM_TAGS; i++ ) {
+		int bytes;
+		int count;
+		Mem_GetTagUsage( (memTag_t)i, bytes, count );
+		if ( count == 0 && heapTagHighWater[i] == 0 ) {
+			continue;
+		}
+		idLib::Printf( "%9d  %9d %10d  %s\n", bytes >> 10, heapTagHighWater[i] >> 10, count, Mem_GetTagName( (memTag_t)i ) );
+		totalBytes += bytes;
+		totalCount += count;
+	}
+	idLib::Printf( "%9d  %9s %10d  total\n", totalBytes >> 10, "", totalCount );
+}
+
+/*
+==================
+Mem_Track_f
+==================
+*/
+CONSOLE_COMMAND( mem_track, "enables recording the callstack of every heap allocation for mem_diffSnapshots", 0 ) {
+	const bool enable = ( args.Argc() > 1 ) ? ( atoi( args.Argv( 1 ) ) != 0 ) : !heapTracking;
+	if ( enable && heapTrackCallstackHash == NULL ) {
+		heapTrackCallstackHash = (int *)_aligned_malloc( HEAP_TRACK_HASH_SIZE * sizeof( int ), HEAP_ALIGNMENT );
+		if ( heapTrackCallstackHash == NULL ) {
+			idLib::Printf( "not enough memory for allocation tracking\n" );
+			return;
+		}
+		memset( heapTrackCallstackHash, -1, HEAP_TRACK_HASH_SIZE * sizeof( int ) );
+		heapTrackFreeRecord = -1;
+	}
+	heapTracking = enable;
+	idLib::Printf( "allocation tracking %s\n", heapTracking ? "enabled" : "disabled" );
+}
+
+/*
+==================
+Mem_Snapshot_f
+==================
+*/
+CONSOLE_COMMAND( mem_snapshot, "takes a snapshot of the live heap memory for mem_diffSnapshots", 0 ) {
+	heapSnapshot_t & snapshot = heapSnapshots[heapNumSnapshots % HEAP_MAX_SNAPSHOTS];
+	snapshot.tracking = heapTracking;
+	for ( int i = 0; i < TAG_NUM_TAGS; i++ ) {
+		Mem_GetTagUsage( (memTag_t)i, snapshot.tagBytes[i], snapshot.tagCount[i] );
+	}
+
+	// allocations from now on belong to the next generation
+	Mem_LockTracking();
+	heapNumSnapshots++;
+	Mem_UnlockTracking();
+
+	idLib::Printf( "took memory snapshot %d%s\n", heapNumSnapshots - 1, snapshot.tracking ? "" : ", enable mem_track to get callstacks" );
+}
+
+struct heapDiffTag_t {
+	int		tag;
+	int		bytes;
+	int		count;
+};
+
+class idSort_HeapDiffTag : public idSort_Quick< heapDiffTag_t, idSort_HeapDiffTag > {
+public:
+	int Compare( const heapDiffTag_t & a, const heapDiffTag_t & b ) const { return abs( b.bytes ) - abs( a.bytes ); }
+};
+
+struct heapDiffCallstack_t {
+	int		callstack;
+	int		tag;
+	int		bytes;
+	int		count;
+};
+
+class idSort_HeapDiffCallstack : public idSort_Quick< heapDiffCallstack_t, idSort_HeapDiffCallstack > {
+public:
+	int Compare( const heapDiffCallstack_t & a, const heapDiffCallstack_t & b ) const { return b.bytes - a.bytes; }
+};
+
+/*
+==================
+Mem_DiffSnapshots_f
+==================
+*/
+CONSOLE_COMMAND( mem_diffSnapshots, "lists the memory tags and callstacks that grew between two snapshots, usage: mem_diffSnapshots <from> [to] [numCallstacks]", 0 ) {
+	if ( args.Argc() < 2 ) {
+		idLib::Printf( "usage: mem_diffSnapshots <from> [to] [numCallstacks], without 'to' the current memory is used\n" );
+		return;
+	}
+	const int from = atoi( args.Argv( 1 ) );
+	const int to = ( args.Argc() > 2 ) ? atoi( args.Argv( 2 ) ) : -1;
+	const int numCallstacks = ( args.Argc() > 3 ) ? atoi( args.Argv( 3 ) ) : 20;
+
+	const int oldest = Max( 0, heapNumSnapshots - HEAP_MAX_SNAPSHOTS );
+	if ( from < oldest || from >= heapNumSnapshots || ( to >= 0 && ( to <= from || to >= heapNumSnapshots ) ) ) {
+		idLib::Printf( "snapshots %d to %d are available\n", oldest, heapNumSnapshots - 1 );
+		return;
+	}
+
+	heapTrackSuspended = true;
+
+	const heapSnapshot_t & fromSnapshot = heapSnapshots[from % HEAP_MAX_SNAPSHOTS];
+
+	// tags
+	idList< heapDiffTag_t, TAG_DEBUG > tags;
+	for ( int i = 0; i < TAG_NUM_TAGS; i++ ) {
+		heapDiffTag_t diff;
+		diff.tag = i;
+		if ( to >= 0 ) {
+			const heapSnapshot_t & toSnapshot = heapSnapshots[to % HEAP_MAX_SNAPSHOTS];
+			diff.bytes = toSnapshot.tagBytes[i];
+			diff.count = toSnapshot.tagCount[i];
+		} else {
+			Mem_GetTagUsage( (memTag_t)i, diff.bytes, diff.count );
+		}
+		diff.bytes -= fromSnapshot.tagBytes[i];
+		diff.count -= fromSnapshot.tagCount[i];
+		if ( diff.bytes != 0 || diff.count != 0 ) {
+			tags.Append( diff );
+		}
+	}
+	tags.SortWithTemplate( idSort_HeapDiffTag() );
+
+	int totalBytes = 0;
+	idLib::Printf( "   kB diff  count diff  tag\n" );
+	for ( int i = 0; i < tags.Num(); i++ ) {
+		idLib::Printf( "%+10d %+11d  %s\n", tags[i].bytes / 1024, tags[i].count, Mem_GetTagName( (memTag_t)tags[i].tag ) );
+		totalBytes += tags[i].bytes;
+	}
+	idLib::Printf( "%+10d kB total\n", totalBytes / 1024 );
+
+	// callstacks of the allocations made between the snapshots that are still alive
+	if ( !fromSnapshot.tracking ) {
+		idLib::Printf( "allocation tracking was disabled at snapshot %d, no callstacks available\n", from );
+		heapTrackSuspended = false;
+		return;
+	}
+
+	idList< heapDiffCallstack_t, TAG_DEBUG > callstacks;
+	idList< int, TAG_DEBUG > callstackIndex;
+
+	Mem_LockTracking();
+	callstackIndex.AssureSize( heapTrackNumCallstacks, -1 );
+	const int lastGeneration = ( to >= 0 ) ? to : heapNumSnapshots;
+	for ( int i = 0; i < heapTrackNumRecords; i++ ) {
+		const heapTrackRecord_t & record = Mem_GetTrackRecord( i );
+		if ( record.size == 0 || record.generation <= from || record.generation > lastGeneration ) {
+			continue;
+		}
+		if ( callstackIndex[record.callstack] < 0 ) {
+			heapDiffCallstack_t & diff = callstacks.Alloc();
+			diff.callstack = record.callstack;
+			diff.tag = record.tag;
+			diff.bytes = 0;
+			diff.count = 0;
+			callstackIndex[record.callstack] = callstacks.Num() - 1;
+		}
+		heapDiffCallstack_t & diff = callstacks[callstackIndex[record.callstack]];
+		diff.bytes += record.size;
+		diff.count++;
+	}
+	Mem_UnlockTracking();
+
+	callstacks.SortWithTemplate( idSort_HeapDiffCallstack() );
+
+	idLib::Printf( "live allocations made after snapshot %d by %d callstacks:\n", from, callstacks.Num() );
+	for ( int i = 0; i < callstacks.Num() && i < numCallstacks; i++ ) {
+		const heapDiffCallstack_t & diff = callstacks[i];
+		idLib::Printf( "%9d kB in %6d allocations, %s\n", diff.bytes >> 10, diff.count, Mem_GetTagName( (memTag_t)diff.tag ) );
+		if ( idLib::sys != NULL ) {
+			idLib::Printf( "    %s\n", idLib::sys->GetCallStackStr( Mem_GetTrackCallstack( diff.callstack ).stack, HEAP_TRACK_CALLSTACK_DEPTH ) );
+		}
+	}
+
+	heapTrackSuspended = false;
+}
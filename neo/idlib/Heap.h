@@ -59,6 +59,20 @@ ID_INLINE void		Mem_Free( void *ptr ) { Mem_Free16( ptr ); }
 void *		Mem_ClearedAlloc( const int size, const memTag_t tag );
 char *		Mem_CopyString( const char *in );
 
+// number of indexes handed out by Mem_GetThreadIndex
+static const int MEM_MAX_THREAD_INDEXES = 64;
+
+// Returns a small index that stays the same for the lifetime of the calling thread,
+// or -1 when more than MEM_MAX_THREAD_INDEXES threads used the heap.
+int			Mem_GetThreadIndex();
+
+const char *	Mem_GetTagName( const memTag_t tag );
+// live bytes and number of allocations of a tag
+void		Mem_GetTagUsage( const memTag_t tag, int & bytes, int & count );
+// samples the live memory of all tags for the high water marks, called once per frame
+void		Mem_UpdateTagHighWater();
+int			Mem_GetTagHighWater( const memTag_t tag );
+
 #pragma warning( disable: 4595 ) // non-member operator new or delete functions may not be declared inline
 
 ID_INLINE void *operator new( size_t s ) {
@@ -425,6 +439,453 @@ ID_INLINE void idBlockAlloc<_type_,_blockSize_,memTag>::FreeEmptyBlocks() {
 	}
 }
 
+/*
+================================================
+idConcurrentBlockAlloc is a block-based allocator for fixed-size objects that can be
+used from multiple threads at the same time, e.g. from parallel jobs.
+
+Every thread allocates from and frees to a cache of its own. Batches of free elements
+are exchanged between the threads through a lock-free list, so threads only
+synchronize once per batch. An element may be freed by another thread than the one
+that allocated it.
+
+Shutdown, SetFixedBlocks and FreeEmptyBlocks are not thread safe, no other thread may
+use the allocator while they run.
+
+All objects are properly constructed and destructed.
+================================================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag = TAG_BLOCKALLOC>
+class idConcurrentBlockAlloc {
+public:
+	ID_INLINE			idConcurrentBlockAlloc( bool clear = false );
+	ID_INLINE			~idConcurrentBlockAlloc();
+
+	// returns total size of allocated memory
+	size_t				Allocated() const { return total * sizeof( _type_ ); }
+
+	// returns total size of allocated memory including size of (*this)
+	size_t				Size() const { return sizeof( *this ) + Allocated(); }
+
+	ID_INLINE void		Shutdown();
+	ID_INLINE void		SetFixedBlocks( int numBlocks );
+	ID_INLINE void		FreeEmptyBlocks();
+
+	ID_INLINE _type_ *	Alloc();
+	ID_INLINE void		Free( _type_ *element );
+
+	int					GetTotalCount() const { return total; }
+	ID_INLINE int		GetAllocCount() const;
+	int					GetFreeCount() const { return total - GetAllocCount(); }
+
+private:
+	static const int	BATCH_SIZE = ( _blockSize_ < 32 ) ? _blockSize_ : 32;
+	static const int	OVERFLOW_CACHE = MEM_MAX_THREAD_INDEXES;	// shared by the threads without an index, protected by overflowLock
+
+	union element_t {
+		_type_ *		data;	// this is a hack to make sure the save game system marks _type_ as saveable
+		struct {
+			element_t *	next;		// next free element in the same cache or batch
+			element_t *	nextBatch;	// next batch in the shared list, only set on the first element of a batch
+		}				link;
+		byte			buffer[( CONST_MAX( sizeof( _type_ ), 2 * sizeof( element_t * ) ) + ( BLOCK_ALLOC_ALIGNMENT - 1 ) ) & ~( BLOCK_ALLOC_ALIGNMENT - 1 )];
+	};
+
+	class idBlock {
+	public:
+		element_t		elements[_blockSize_];
+		idBlock *		next;
+		element_t *		free;		// list with free elements in this block (temp used only by FreeEmptyBlocks)
+		int				freeCount;	// number of free elements in this block (temp used only by FreeEmptyBlocks)
+	};
+
+	struct cache_t {
+		element_t *		free;
+		int				freeCount;
+		int				allocCount;	// allocations minus frees by this thread, can be negative
+		byte			pad[CACHE_LINE_SIZE - sizeof( element_t * ) - 2 * sizeof( int )];
+	};
+
+	idBlock *			blocks;
+	element_t *			freeBatches;
+	interlockedInt_t	total;
+	interlockedInt_t	overflowLock;
+	bool				allowAllocs;
+	bool				clearAllocs;
+	cache_t				caches[MEM_MAX_THREAD_INDEXES + 1];
+
+	ID_INLINE cache_t &	LockCache();
+	ID_INLINE void		UnlockCache( const cache_t & cache );
+	ID_INLINE bool		AllocNewBlock( cache_t & cache );
+	ID_INLINE bool		PopBatch( cache_t & cache );
+	ID_INLINE void		PushBatch( cache_t & cache );
+	ID_INLINE void		PushBatches( element_t * first, element_t * last );
+};
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::idConcurrentBlockAlloc
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::idConcurrentBlockAlloc( bool clear ) :
+	blocks( NULL ),
+	freeBatches( NULL ),
+	total( 0 ),
+	overflowLock( 0 ),
+	allowAllocs( true ),
+	clearAllocs( clear )
+{
+	memset( caches, 0, sizeof( caches ) );
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::~idConcurrentBlockAlloc
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::~idConcurrentBlockAlloc() {
+	Shutdown();
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::LockCache
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE typename idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::cache_t & idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::LockCache() {
+	const int index = Mem_GetThreadIndex();
+	if ( index >= 0 ) {
+		return caches[index];
+	}
+	while ( Sys_InterlockedCompareExchange( overflowLock, 1, 0 ) != 0 ) {
+		Sys_Yield();
+	}
+	return caches[OVERFLOW_CACHE];
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::UnlockCache
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE void idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::UnlockCache( const cache_t & cache ) {
+	if ( &cache == &caches[OVERFLOW_CACHE] ) {
+		Sys_InterlockedExchange( overflowLock, 0 );
+	}
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::Alloc
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE _type_ * idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::Alloc() {
+#ifdef FORCE_DISCRETE_BLOCK_ALLOCS
+	// for debugging tools
+	return new _type_;
+#else
+	cache_t & cache = LockCache();
+	if ( cache.free == NULL && !PopBatch( cache ) ) {
+		if ( !allowAllocs || !AllocNewBlock( cache ) ) {
+			UnlockCache( cache );
+			return NULL;
+		}
+	}
+
+	element_t * element = cache.free;
+	cache.free = element->link.next;
+	cache.freeCount--;
+	cache.allocCount++;
+	UnlockCache( cache );
+
+	element->link.next = NULL;
+
+	_type_ * t = (_type_ *) element->buffer;
+	if ( clearAllocs ) {
+		memset( t, 0, sizeof( _type_ ) );
+	}
+	new ( t ) _type_;
+	return t;
+#endif
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::Free
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE void idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::Free( _type_ * t ) {
+#ifdef FORCE_DISCRETE_BLOCK_ALLOCS
+	// for debugging tools
+	delete t;
+#else
+	if ( t == NULL ) {
+		return;
+	}
+
+	t->~_type_();
+
+	element_t * element = (element_t *)( t );
+
+	cache_t & cache = LockCache();
+	element->link.next = cache.free;
+	cache.free = element;
+	cache.freeCount++;
+	cache.allocCount--;
+	// keep a batch around so alternating allocs and frees don't touch the shared list
+	if ( cache.freeCount >= 2 * BATCH_SIZE ) {
+		PushBatch( cache );
+	}
+	UnlockCache( cache );
+#endif
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::GetAllocCount
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE int idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::GetAllocCount() const {
+	int count = 0;
+	for ( int i = 0; i <= OVERFLOW_CACHE; i++ ) {
+		count += caches[i].allocCount;
+	}
+	return count;
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::PushBatches
+
+Lock-free push of a chain of batches. Pushing doesn't suffer from the ABA problem.
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE void idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::PushBatches( element_t * first, element_t * last ) {
+	for ( ; ; ) {
+		element_t * head = *(element_t * volatile *)&freeBatches;
+		last->link.nextBatch = head;
+		if ( Sys_InterlockedCompareExchangePointer( (void * &)freeBatches, head, first ) == head ) {
+			break;
+		}
+	}
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::PushBatch
+
+Moves a batch from the cache to the shared list.
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE void idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::PushBatch( cache_t & cache ) {
+	assert( cache.freeCount >= BATCH_SIZE );
+	element_t * first = cache.free;
+	element_t * last = first;
+	for ( int i = 1; i < BATCH_SIZE; i++ ) {
+		last = last->link.next;
+	}
+	cache.free = last->link.next;
+	cache.freeCount -= BATCH_SIZE;
+	last->link.next = NULL;
+	PushBatches( first, first );
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::PopBatch
+
+Moves a batch from the shared list to the empty cache. Instead of popping a single
+batch, which would be subject to the ABA problem, the whole list is taken and the
+remaining batches are pushed back.
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE bool idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::PopBatch( cache_t & cache ) {
+	assert( cache.free == NULL );
+	element_t * batch = (element_t *)Sys_InterlockedExchangePointer( (void * &)freeBatches, NULL );
+	if ( batch == NULL ) {
+		return false;
+	}
+	element_t * rest = batch->link.nextBatch;
+	if ( rest != NULL ) {
+		element_t * last = rest;
+		while ( last->link.nextBatch != NULL ) {
+			last = last->link.nextBatch;
+		}
+		PushBatches( rest, last );
+	}
+	cache.free = batch;
+	cache.freeCount = BATCH_SIZE;
+	return true;
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::AllocNewBlock
+
+Keeps one batch of the new block in the cache and shares the rest.
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE bool idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::AllocNewBlock( cache_t & cache ) {
+	idBlock * block = (idBlock *)Mem_Alloc( sizeof( idBlock ), memTag );
+	if ( block == NULL ) {
+		return false;
+	}
+	for ( ; ; ) {
+		idBlock * head = *(idBlock * volatile *)&blocks;
+		block->next = head;
+		if ( Sys_InterlockedCompareExchangePointer( (void * &)blocks, head, block ) == head ) {
+			break;
+		}
+	}
+	for ( int i = 0; i < _blockSize_; i++ ) {
+		block->elements[i].link.next = cache.free;
+		cache.free = &block->elements[i];
+		assert( ( ( (UINT_PTR)cache.free ) & ( BLOCK_ALLOC_ALIGNMENT - 1 ) ) == 0 );
+	}
+	cache.freeCount += _blockSize_;
+	Sys_InterlockedAdd( total, _blockSize_ );
+
+	while ( cache.freeCount >= 2 * BATCH_SIZE ) {
+		PushBatch( cache );
+	}
+	return true;
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::Shutdown
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE void idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::Shutdown() {
+	while( blocks != NULL ) {
+		idBlock * block = blocks;
+		blocks = blocks->next;
+		Mem_Free( block );
+	}
+	blocks = NULL;
+	freeBatches = NULL;
+	total = 0;
+	memset( caches, 0, sizeof( caches ) );
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::SetFixedBlocks
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE void idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::SetFixedBlocks( int numBlocks ) {
+	int currentNumBlocks = 0;
+	for ( idBlock * block = blocks; block != NULL; block = block->next ) {
+		currentNumBlocks++;
+	}
+	cache_t & cache = LockCache();
+	for ( int i = currentNumBlocks; i < numBlocks; i++ ) {
+		AllocNewBlock( cache );
+	}
+	UnlockCache( cache );
+	allowAllocs = false;
+}
+
+/*
+========================
+idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::FreeEmptyBlocks
+========================
+*/
+template<class _type_, int _blockSize_, memTag_t memTag>
+ID_INLINE void idConcurrentBlockAlloc<_type_,_blockSize_,memTag>::FreeEmptyBlocks() {
+	// first count how many free elements are in each block
+	// and build up a free chain per block
+	for ( idBlock * block = blocks; block != NULL; block = block->next ) {
+		block->free = NULL;
+		block->freeCount = 0;
+	}
+
+	// gather the free elements from the thread caches and the shared batches
+	element_t * free = NULL;
+	for ( int i = 0; i <= OVERFLOW_CACHE; i++ ) {
+		while ( caches[i].free != NULL ) {
+			element_t * element = caches[i].free;
+			caches[i].free = element->link.next;
+			element->link.next = free;
+			free = element;
+		}
+		caches[i].freeCount = 0;
+	}
+	for ( element_t * batch = freeBatches; batch != NULL; ) {
+		element_t * nextBatch = batch->link.nextBatch;
+		for ( element_t * element = batch; element != NULL; ) {
+			element_t * next = element->link.next;
+			element->link.next = free;
+			free = element;
+			element = next;
+		}
+		batch = nextBatch;
+	}
+	freeBatches = NULL;
+
+	for ( element_t * element = free; element != NULL; ) {
+		element_t * next = element->link.next;
+		for ( idBlock * block = blocks; block != NULL; block = block->next ) {
+			if ( element >= block->elements && element < block->elements + _blockSize_ ) {
+				element->link.next = block->free;
+				block->free = element;
+				block->freeCount++;
+				break;
+			}
+		}
+		// if this assert fires, we couldn't find the element in any block
+		assert( element->link.next != next );
+		element = next;
+	}
+	// now free all blocks whose free count == _blockSize_
+	idBlock * prevBlock = NULL;
+	for ( idBlock * block = blocks; block != NULL; ) {
+		idBlock * next = block->next;
+		if ( block->freeCount == _blockSize_ ) {
+			if ( prevBlock == NULL ) {
+				assert( blocks == block );
+				blocks = block->next;
+			} else {
+				assert( prevBlock->next == block );
+				prevBlock->next = block->next;
+			}
+			Mem_Free( block );
+			total -= _blockSize_;
+		} else {
+			prevBlock = block;
+		}
+		block = next;
+	}
+	// now rebuild the free chain in the cache of this thread and share the full batches
+	cache_t & cache = LockCache();
+	for ( idBlock * block = blocks; block != NULL; block = block->next ) {
+		for ( element_t * element = block->free; element != NULL; ) {
+			element_t * next = element->link.next;
+			element->link.next = cache.free;
+			cache.free = element;
+			cache.freeCount++;
+			element = next;
+		}
+	}
+	while ( cache.freeCount >= 2 * BATCH_SIZE ) {
+		PushBatch( cache );
+	}
+	UnlockCache( cache );
+}
+
 /*
 ==============================================================================
 
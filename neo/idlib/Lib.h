@@ -314,6 +314,7 @@ public:
 #include "MapFile.h"
 #include "Timer.h"
 #include "Thread.h"
+#include "FrameAllocator.h"
 #include "Swap.h"
 #include "Callback.h"
 #include "ParallelJobList.h"
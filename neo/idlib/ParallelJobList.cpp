@@ -128,29 +128,13 @@ idParallelJobList_Threads
 */
 
 static idCVar jobs_longJobMicroSec( "jobs_longJobMicroSec", "10000", CVAR_INTEGER, "print a warning for jobs that take more than this number of microseconds" );
+static idCVar jobs_helpWhileWaiting( "jobs_helpWhileWaiting", "1", CVAR_BOOL | CVAR_NOCHEAT, "execute pending jobs while waiting for a job list to finish" );
 
 
 const static int		MAX_THREADS	= 32;
-
-struct threadJobListState_t {
-								threadJobListState_t() :
-									jobList( NULL ),
-									version( 0xFFFFFFFF ),
-									signalIndex( 0 ),
-									lastJobIndex( 0 ),
-									nextJobIndex( -1 ) {}
-								threadJobListState_t( int _version ) :
-									jobList( NULL ),
-									version( _version ),
-									signalIndex( 0 ),
-									lastJobIndex( 0 ),
-									nextJobIndex( -1 ) {}
-	idParallelJobList_Threads *	jobList;
-	int							version;
-	int							signalIndex;
-	int							lastJobIndex;
-	int							nextJobIndex;
-};
+const static int		NON_JOB_THREAD_UNIT	= MAX_THREADS - 1;	// unit for jobs executed by threads other than the job threads
+const static int		JOB_WAIT_IDLE_SPINS	= 16;	// number of times a waiting thread looks for jobs to execute before going to sleep
+const static int		JOB_WAIT_SLEEP_MSEC	= 1;	// sleep at most this long so newly published jobs can still be picked up
 
 struct threadStats_t {
 	unsigned int	numExecutedJobs;
@@ -163,6 +147,189 @@ struct threadStats_t {
 	uint64			threadTotalTime[MAX_THREADS];
 };
 
+/*
+================================================================================================
+
+	Job trace
+
+================================================================================================
+*/
+
+static idCVar jobs_trace( "jobs_trace", "0", CVAR_BOOL | CVAR_NOCHEAT, "record every job, sync point and wait so it can be written out with jobs_dumpTrace" );
+
+enum jobTraceType_t {
+	JOB_TRACE_JOB,
+	JOB_TRACE_SYNC,
+	JOB_TRACE_WAIT
+};
+
+struct jobTraceEvent_t {
+	uint64			startTime;
+	uint64			endTime;
+	jobRun_t		function;		// only set for jobs
+	short			type;
+	short			listId;
+	int				index;			// job index for jobs, sync point index for sync points
+};
+
+const static int	MAX_JOB_TRACE_EVENTS = 4096;	// per unit
+
+compile_time_assert( CONST_ISPOWEROFTWO( MAX_JOB_TRACE_EVENTS ) );
+
+/*
+================================================
+idJobTrace keeps a ring buffer with the most recent events for each unit. The buffers
+are allocated on first use so there is no memory cost when tracing is disabled.
+Recording an event only takes an interlocked increment, so threads that share a
+unit, like the threads that wait for job lists, can record at the same time.
+================================================
+*/
+class idJobTrace {
+public:
+							~idJobTrace();
+
+	bool					IsEnabled() const { return jobs_trace.GetBool(); }
+	void					Record( unsigned int unit, jobTraceType_t type, jobListId_t listId, jobRun_t function, int index, uint64 startTime, uint64 endTime );
+	int						WriteChromeTrace( idFile * file );
+
+private:
+	struct unitTrace_t {
+		idSysInterlockedPointer< jobTraceEvent_t >	events;
+		idSysInterlockedInteger						numEvents;
+	};
+	unitTrace_t				units[MAX_THREADS];
+};
+
+static idJobTrace jobTrace;
+
+/*
+========================
+idJobTrace::~idJobTrace
+========================
+*/
+idJobTrace::~idJobTrace() {
+	for ( int i = 0; i < MAX_THREADS; i++ ) {
+		Mem_Free( units[i].events.Get() );
+	}
+}
+
+/*
+========================
+idJobTrace::Record
+========================
+*/
+void idJobTrace::Record( unsigned int unit, jobTraceType_t type, jobListId_t listId, jobRun_t function, int index, uint64 startTime, uint64 endTime ) {
+	assert( unit < MAX_THREADS );
+
+	jobTraceEvent_t * events = units[unit].events.Get();
+	if ( events == NULL ) {
+		jobTraceEvent_t * newEvents = (jobTraceEvent_t *)Mem_Alloc( MAX_JOB_TRACE_EVENTS * sizeof( jobTraceEvent_t ), TAG_JOBLIST );
+		events = units[unit].events.CompareExchange( NULL, newEvents );
+		if ( events == NULL ) {
+			events = newEvents;
+		} else {
+			// another thread allocated the buffer first
+			Mem_Free( newEvents );
+		}
+	}
+
+	jobTraceEvent_t & event = events[( units[unit].numEvents.Increment() - 1 ) & ( MAX_JOB_TRACE_EVENTS - 1 )];
+	event.startTime = startTime;
+	event.endTime = endTime;
+	event.function = function;
+	event.type = (short)type;
+	event.listId = (short)listId;
+	event.index = index;
+}
+
+/*
+========================
+idJobTrace::WriteChromeTrace
+
+Writes the recorded events in the Chrome trace event format, which can be
+loaded in chrome://tracing or any other viewer that supports the format.
+Returns the number of events written.
+========================
+*/
+int idJobTrace::WriteChromeTrace( idFile * file ) {
+	int numWritten = 0;
+
+	file->Printf( "{\"traceEvents\":[\n" );
+	for ( int unit = 0; unit < MAX_THREADS; unit++ ) {
+		const jobTraceEvent_t * events = units[unit].events.Get();
+		if ( events == NULL ) {
+			continue;
+		}
+
+		const char * threadName = ( unit == NON_JOB_THREAD_UNIT ) ? "waiting threads" : va( "JobListProcessor_%d", unit );
+		file->Printf( "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", numWritten > 0 ? ",\n" : "", unit, threadName );
+		numWritten++;
+
+		// the ring buffer may have wrapped around, in which case the oldest event is at the write position
+		const int numEvents = units[unit].numEvents.GetValue();
+		const int firstEvent = ( numEvents > MAX_JOB_TRACE_EVENTS ) ? numEvents - MAX_JOB_TRACE_EVENTS : 0;
+		for ( int i = firstEvent; i < numEvents; i++ ) {
+			const jobTraceEvent_t & event = events[i & ( MAX_JOB_TRACE_EVENTS - 1 )];
+			switch( event.type ) {
+				case JOB_TRACE_JOB: {
+					file->Printf( ",\n{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":0,\"tid\":%d,\"args\":{\"list\":%d,\"job\":%d}}",
+									GetJobName( event.function ), event.startTime, event.endTime - event.startTime, unit, event.listId, event.index );
+					break;
+				}
+				case JOB_TRACE_SYNC: {
+					file->Printf( ",\n{\"name\":\"sync\",\"cat\":\"sync\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":0,\"tid\":%d,\"args\":{\"list\":%d,\"sync\":%d}}",
+									event.startTime, unit, event.listId, event.index );
+					break;
+				}
+				case JOB_TRACE_WAIT: {
+					file->Printf( ",\n{\"name\":\"wait\",\"cat\":\"wait\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":0,\"tid\":%d,\"args\":{\"list\":%d}}",
+									event.startTime, event.endTime - event.startTime, unit, event.listId );
+					break;
+				}
+			}
+			numWritten++;
+		}
+	}
+	file->Printf( "\n]}\n" );
+
+	return numWritten;
+}
+
+/*
+========================
+jobs_dumpTrace
+========================
+*/
+CONSOLE_COMMAND( jobs_dumpTrace, "writes the job trace recorded with jobs_trace 1 to a Chrome trace event file", 0 ) {
+	idStr fileName = ( args.Argc() > 1 ) ? args.Argv( 1 ) : "jobs_trace";
+	fileName.DefaultFileExtension( ".json" );
+
+	idFile * file = fileSystem->OpenFileWrite( fileName );
+	if ( file == NULL ) {
+		idLib::Printf( "couldn't open %s for writing\n", fileName.c_str() );
+		return;
+	}
+	int numEvents = jobTrace.WriteChromeTrace( file );
+	delete file;
+
+	idLib::Printf( "wrote %d job trace events to %s\n", numEvents, fileName.c_str() );
+}
+
+/*
+================================================
+idParallelJobList_Threads
+
+The jobs of a list are split into blocks at every SYNC_SYNCHRONIZE point. A block
+is handed to the job scheduler as soon as all jobs before the matching SYNC_SIGNAL
+have completed. The scheduler spreads the jobs of a block over the job threads,
+which steal individual jobs from each other once they run out of work.
+
+A list with job dependencies has a single block with all jobs that have no
+predecessors. Any other job is handed to the scheduler by the job that completes
+its last predecessor. The scheduler then indexes the jobs in the order they
+became ready instead of the order in which they were added.
+================================================
+*/
 class idParallelJobList_Threads {
 public:
 							idParallelJobList_Threads( jobListId_t id, jobListPriority_t priority, unsigned int maxJobs, unsigned int maxSyncs );
@@ -171,8 +338,9 @@ public:
 	//------------------------
 	// These are called from the one thread that manages this list.
 	//------------------------
-	ID_INLINE void			AddJob( jobRun_t function, void * data );
+	ID_INLINE jobHandle_t	AddJob( jobRun_t function, void * data );
 	ID_INLINE void			InsertSyncPoint( jobSyncType_t syncType );
+	ID_INLINE void			AddDependency( jobHandle_t job, jobHandle_t predecessor );
 	void					Submit( idParallelJobList_Threads * waitForJobList_, int parallelism );
 	void					Wait();
 	bool					TryWait();
@@ -193,19 +361,23 @@ public:
 	jobListPriority_t		GetPriority() const { return listPriority; }
 	int						GetVersion() { return version.GetValue(); }
 
+	// number of job threads the blocks of this list are initially spread over
+	void					SetNumThreads( int num ) { numThreads = num; }
+	int						GetNumThreads() const { return numThreads; }
+
 	bool					WaitForOtherJobList();
 
+	// runs all jobs in order on the calling thread
+	void					RunAllJobs( unsigned int threadNum );
+
 	//------------------------
-	// This is thread safe and called from the job threads.
+	// These are thread safe and called from the job threads.
 	//------------------------
-	enum runResult_t {
-		RUN_OK			= 0,
-		RUN_PROGRESS	= BIT( 0 ),
-		RUN_DONE		= BIT( 1 ),
-		RUN_STALLED		= BIT( 2 )
-	};
 
-	int						RunJobs( unsigned int threadNum, threadJobListState_t & state, bool singleJob );
+	// hands any blocks of jobs with satisfied sync points over to the job scheduler
+	void					ReleaseBlocks( unsigned int threadNum );
+	// executes a single job, returns false if the job belongs to an old version of this list
+	bool					RunJob( unsigned int threadNum, int jobVersion, int slot );
 
 private:
 	static const int		NUM_DONE_GUARDS = 4;	// cycle through 4 guards so we can cyclicly chain job lists
@@ -213,11 +385,14 @@ private:
 	bool					threaded;
 	bool					done;
 	bool					hasSignal;
+	bool					hasDependencies;
+	bool					executeInline;
 	jobListId_t				listId;
 	jobListPriority_t		listPriority;
 	unsigned int			maxJobs;
 	unsigned int			maxSyncs;
 	unsigned int			numSyncs;
+	int						numThreads;
 	int						lastSignalJob;
 	idSysInterlockedInteger * waitForGuard;
 	idSysInterlockedInteger doneGuards[NUM_DONE_GUARDS];
@@ -227,29 +402,35 @@ private:
 		jobRun_t	function;
 		void *		data;
 		int			executed;
+		int			signalIndex;	// index of the signal this job counts towards
+		int			numPredecessors;
+		int			firstSuccessor;	// index of the first dependency with this job as predecessor
+	};
+	struct syncPoint_t {
+		int			firstJob;		// first job that waits for the signal
+		int			signalIndex;	// signal that needs to complete before firstJob can run
+	};
+	struct dependency_t {
+		int			job;			// job that waits for the predecessor
+		int			next;			// next dependency of the same predecessor
 	};
 	idList< job_t, TAG_JOBLIST >		jobList;
 	idList< idSysInterlockedInteger, TAG_JOBLIST >	signalJobCount;
-	idSysInterlockedInteger				currentJob;
-	idSysInterlockedInteger				fetchLock;
+	idList< syncPoint_t, TAG_JOBLIST >	syncPoints;
+	idList< dependency_t, TAG_JOBLIST >	successors;
+	idList< idSysInterlockedInteger, TAG_JOBLIST >	pendingPredecessors;
+	idList< int, TAG_JOBLIST >			readyJobs;
+	idSysInterlockedInteger				numReadyJobs;
+	int									numRootJobs;
+	idSysInterlockedInteger				nextBlock;
+	idSysInterlockedInteger				numPendingJobs;
 	idSysInterlockedInteger				numThreadsExecuting;
+	idSysSignal							doneSignal;		// raised when the last job of the list completes
 
 	threadStats_t						deferredThreadStats;
 	threadStats_t						threadStats;
-
-	int						RunJobsInternal( unsigned int threadNum, threadJobListState_t & state, bool singleJob );
-
-	static void				Nop( void * data ) {}
-
-	static int				JOB_SIGNAL;
-	static int				JOB_SYNCHRONIZE;
-	static int				JOB_LIST_DONE;
 };
 
-int idParallelJobList_Threads::JOB_SIGNAL;
-int idParallelJobList_Threads::JOB_SYNCHRONIZE;
-int idParallelJobList_Threads::JOB_LIST_DONE;
-
 /*
 ========================
 idParallelJobList_Threads::idParallelJobList_Threads
@@ -259,22 +440,29 @@ idParallelJobList_Threads::idParallelJobList_Threads( jobListId_t id, jobListPri
 	threaded( true ),
 	done( true ),
 	hasSignal( false ),
+	hasDependencies( false ),
+	executeInline( false ),
 	listId( id ),
 	listPriority( priority ),
 	numSyncs( 0 ),
+	numThreads( 0 ),
 	lastSignalJob( 0 ),
+	numRootJobs( 0 ),
 	waitForGuard( NULL ),
 	currentDoneGuard( 0 ),
-	jobList() {
+	jobList(),
+	doneSignal( true ) {
 
 	assert( listPriority != JOBLIST_PRIORITY_NONE );
 
 	this->maxJobs = maxJobs;
 	this->maxSyncs = maxSyncs;
-	jobList.AssureSize( maxJobs + maxSyncs * 2 + 1 );	// syncs go in as dummy jobs and one more to update the doneCount
+	jobList.AssureSize( maxJobs );
 	jobList.SetNum( 0 );
 	signalJobCount.AssureSize( maxSyncs + 1 );			// need one extra for submit
 	signalJobCount.SetNum( 0 );
+	syncPoints.AssureSize( maxSyncs + 1 );
+	syncPoints.SetNum( 0 );
 
 	memset( &deferredThreadStats, 0, sizeof( threadStats_t ) );
 	memset( &threadStats, 0, sizeof( threadStats_t ) );
@@ -294,7 +482,7 @@ idParallelJobList_Threads::~idParallelJobList_Threads() {
 idParallelJobList_Threads::AddJob
 ========================
 */
-ID_INLINE void idParallelJobList_Threads::AddJob( jobRun_t function, void * data ) {
+ID_INLINE jobHandle_t idParallelJobList_Threads::AddJob( jobRun_t function, void * data ) {
 	assert( done );
 #if defined( _DEBUG )
 	// make sure there isn't already a job with the same function and data in the list
@@ -309,10 +497,13 @@ ID_INLINE void idParallelJobList_Threads::AddJob( jobRun_t function, void * data
 		job.function = function;
 		job.data = data;
 		job.executed = 0;
+		job.signalIndex = 0;
+		job.numPredecessors = 0;
+		job.firstSuccessor = -1;
 	} else {
 		// debug output to show us what is overflowing
 		int currentJobCount[MAX_REGISTERED_JOBS] = {};
-		
+
 		for ( int i = 0; i < jobList.Num(); ++i ) {
 			const char * jobName = GetJobName( jobList[ i ].function );
 			for ( int j = 0; j < numRegisteredJobs; ++j ) {
@@ -331,6 +522,7 @@ ID_INLINE void idParallelJobList_Threads::AddJob( jobRun_t function, void * data
 		}
 		idLib::Error( "Can't add job '%s', too many jobs %d", GetJobName( function ), jobList.Num() );
 	}
+	return jobList.Num() - 1;
 }
 
 /*
@@ -348,18 +540,15 @@ ID_INLINE void idParallelJobList_Threads::InsertSyncPoint( jobSyncType_t syncTyp
 				signalJobCount.Alloc();
 				signalJobCount[signalJobCount.Num() - 1].SetValue( jobList.Num() - lastSignalJob );
 				lastSignalJob = jobList.Num();
-				job_t & job = jobList.Alloc();
-				job.function = Nop;
-				job.data = & JOB_SIGNAL;
 				hasSignal = true;
 			}
 			break;
 		}
 		case SYNC_SYNCHRONIZE: {
 			if ( hasSignal ) {
-				job_t & job = jobList.Alloc();
-				job.function = Nop;
-				job.data = & JOB_SYNCHRONIZE;
+				syncPoint_t & sync = syncPoints.Alloc();
+				sync.firstJob = jobList.Num();
+				sync.signalIndex = signalJobCount.Num() - 1;
 				hasSignal = false;
 				numSyncs++;
 			}
@@ -368,6 +557,24 @@ ID_INLINE void idParallelJobList_Threads::InsertSyncPoint( jobSyncType_t syncTyp
 	}
 }
 
+/*
+========================
+idParallelJobList_Threads::AddDependency
+========================
+*/
+ID_INLINE void idParallelJobList_Threads::AddDependency( jobHandle_t job, jobHandle_t predecessor ) {
+	assert( done );
+	// only depending on earlier jobs guarantees there are no cycles
+	assert( predecessor >= 0 && predecessor < job && job < jobList.Num() );
+
+	dependency_t & dependency = successors.Alloc();
+	dependency.job = job;
+	dependency.next = jobList[predecessor].firstSuccessor;
+	jobList[predecessor].firstSuccessor = successors.Num() - 1;
+	jobList[job].numPredecessors++;
+	hasDependencies = true;
+}
+
 /*
 ========================
 idParallelJobList_Threads::Submit
@@ -376,14 +583,13 @@ idParallelJobList_Threads::Submit
 void idParallelJobList_Threads::Submit( idParallelJobList_Threads * waitForJobList, int parallelism ) {
 	assert( done );
 	assert( numSyncs <= maxSyncs );
-	assert( (unsigned int) jobList.Num() <= maxJobs + numSyncs * 2 );
-	assert( fetchLock.GetValue() == 0 );
+	assert( (unsigned int) jobList.Num() <= maxJobs );
 
 	done = false;
-	currentJob.SetValue( 0 );
+	executeInline = false;
 
 	memset( &deferredThreadStats, 0, sizeof( deferredThreadStats ) );
-	deferredThreadStats.numExecutedJobs = jobList.Num() - numSyncs * 2;
+	deferredThreadStats.numExecutedJobs = jobList.Num();
 	deferredThreadStats.numExecutedSyncs = numSyncs;
 	deferredThreadStats.submitTime = Sys_Microseconds();
 	deferredThreadStats.startTime = 0;
@@ -406,9 +612,35 @@ void idParallelJobList_Threads::Submit( idParallelJobList_Threads * waitForJobLi
 	signalJobCount.Alloc();
 	signalJobCount[signalJobCount.Num() - 1].SetValue( jobList.Num() - lastSignalJob );
 
-	job_t & job = jobList.Alloc();
-	job.function = Nop;
-	job.data = & JOB_LIST_DONE;
+	// tag every job with the signal it counts towards
+	int signalIndex = 0;
+	int signalEnd = signalJobCount[0].GetValue();
+	for ( int i = 0; i < jobList.Num(); i++ ) {
+		while ( i >= signalEnd ) {
+			signalIndex++;
+			signalEnd += signalJobCount[signalIndex].GetValue();
+		}
+		jobList[i].signalIndex = signalIndex;
+	}
+
+	if ( hasDependencies ) {
+		assert( numSyncs == 0 );
+		// the jobs without predecessors are ready to run right away
+		pendingPredecessors.SetNum( jobList.Num() );
+		readyJobs.SetNum( jobList.Num() );
+		numRootJobs = 0;
+		for ( int i = 0; i < jobList.Num(); i++ ) {
+			pendingPredecessors[i].SetValue( jobList[i].numPredecessors );
+			if ( jobList[i].numPredecessors == 0 ) {
+				readyJobs[numRootJobs++] = i;
+			}
+		}
+		numReadyJobs.SetValue( numRootJobs );
+	}
+
+	numPendingJobs.SetValue( jobList.Num() );
+	nextBlock.SetValue( 0 );
+	doneSignal.Clear();
 
 	if ( threaded ) {
 		// hand over to the manager
@@ -416,8 +648,7 @@ void idParallelJobList_Threads::Submit( idParallelJobList_Threads * waitForJobLi
 		SubmitJobList( this, parallelism );
 	} else {
 		// run all the jobs right here
-		threadJobListState_t state( GetVersion() );
-		RunJobs( 0, state, false );
+		RunAllJobs( NON_JOB_THREAD_UNIT );
 	}
 }
 
@@ -436,9 +667,23 @@ void idParallelJobList_Threads::Wait() {
 		bool waited = false;
 		uint64 waitStart = Sys_Microseconds();
 
-		while ( signalJobCount[signalJobCount.Num() - 1].GetValue() > 0 ) {
-			Sys_Yield();
+		int numIdleSpins = 0;
+		while ( numPendingJobs.GetValue() > 0 ) {
 			waited = true;
+			// contribute to the work instead of spinning in place
+			if ( jobs_helpWhileWaiting.GetBool() ) {
+				bool HelpWithParallelJob( jobListPriority_t priority );
+				if ( HelpWithParallelJob( listPriority ) ) {
+					numIdleSpins = 0;
+					continue;
+				}
+			}
+			if ( ++numIdleSpins > JOB_WAIT_IDLE_SPINS ) {
+				// nothing left to execute so sleep until the last job completes
+				doneSignal.Wait( JOB_WAIT_SLEEP_MSEC );
+			} else {
+				Sys_Yield();
+			}
 		}
 		version.Increment();
 		while ( numThreadsExecuting.GetValue() > 0 ) {
@@ -448,11 +693,18 @@ void idParallelJobList_Threads::Wait() {
 
 		jobList.SetNum( 0 );
 		signalJobCount.SetNum( 0 );
+		syncPoints.SetNum( 0 );
+		successors.SetNum( 0 );
 		numSyncs = 0;
 		lastSignalJob = 0;
+		hasDependencies = false;
 
 		uint64 waitEnd = Sys_Microseconds();
 		deferredThreadStats.waitTime = waited ? ( waitEnd - waitStart ) : 0;
+
+		if ( waited && jobTrace.IsEnabled() ) {
+			jobTrace.Record( NON_JOB_THREAD_UNIT, JOB_TRACE_WAIT, listId, NULL, 0, waitStart, waitEnd );
+		}
 	}
 	memcpy( & threadStats, & deferredThreadStats, sizeof( threadStats ) );
 	done = true;
@@ -464,7 +716,11 @@ idParallelJobList_Threads::TryWait
 ========================
 */
 bool idParallelJobList_Threads::TryWait() {
-	if ( jobList.Num() == 0 || signalJobCount[signalJobCount.Num() - 1].GetValue() <= 0 ) {
+	if ( jobList.Num() > 0 && numPendingJobs.GetValue() > 0 && jobs_helpWhileWaiting.GetBool() ) {
+		bool HelpWithParallelJob( jobListPriority_t priority );
+		HelpWithParallelJob( listPriority );
+	}
+	if ( jobList.Num() == 0 || numPendingJobs.GetValue() <= 0 ) {
 		Wait();
 		return true;
 	}
@@ -538,151 +794,146 @@ volatile void * longJobData;
 
 /*
 ========================
-idParallelJobList_Threads::RunJobsInternal
+idParallelJobList_Threads::RunAllJobs
 ========================
 */
-int idParallelJobList_Threads::RunJobsInternal( unsigned int threadNum, threadJobListState_t & state, bool singleJob ) {
-	if ( state.version != version.GetValue() ) {
-		// trying to run an old version of this list that is already done
-		return RUN_DONE;
+void idParallelJobList_Threads::RunAllJobs( unsigned int threadNum ) {
+	// the jobs are executed in order so all sync points and dependencies are implicitly honored
+	executeInline = true;
+	nextBlock.SetValue( syncPoints.Num() + 1 );
+	if ( hasDependencies ) {
+		for ( int i = 0; i < jobList.Num(); i++ ) {
+			readyJobs[i] = i;
+		}
 	}
 
-	assert( threadNum < MAX_THREADS );
-
-	if ( deferredThreadStats.startTime == 0 ) {
-		deferredThreadStats.startTime = Sys_Microseconds();	// first time any thread is running jobs from this list
+	const int jobVersion = GetVersion();
+	for ( int i = 0; i < jobList.Num(); i++ ) {
+		RunJob( threadNum, jobVersion, i );
 	}
+}
 
-	int result = RUN_OK;
-
-	do {
+/*
+========================
+idParallelJobList_Threads::ReleaseBlocks
+========================
+*/
+void idParallelJobList_Threads::ReleaseBlocks( unsigned int threadNum ) {
+	const int numBlocks = syncPoints.Num() + 1;
 
-		// run through all signals and syncs before the last job that has been or is being executed
-		// this loop is really an optimization to minimize the time spent in the fetchLock section below
-		for ( ; state.lastJobIndex < (int) currentJob.GetValue() && state.lastJobIndex < jobList.Num(); state.lastJobIndex++ ) {
-			if ( jobList[state.lastJobIndex].data == & JOB_SIGNAL ) {
-				state.signalIndex++;
-				assert( state.signalIndex < signalJobCount.Num() );
-			} else if ( jobList[state.lastJobIndex].data == & JOB_SYNCHRONIZE ) {
-				assert( state.signalIndex > 0 );
-				if ( signalJobCount[state.signalIndex - 1].GetValue() > 0 ) {
-					// stalled on a synchronization point
-					return ( result | RUN_STALLED );
-				}
-			} else if ( jobList[state.lastJobIndex].data == & JOB_LIST_DONE ) {
-				if ( signalJobCount[signalJobCount.Num() - 1].GetValue() > 0 ) {
-					// stalled on a synchronization point
-					return ( result | RUN_STALLED );
-				}
-			}
+	for ( ; ; ) {
+		const int block = nextBlock.GetValue();
+		if ( block >= numBlocks ) {
+			return;
+		}
+		if ( block > 0 && signalJobCount[syncPoints[block - 1].signalIndex].GetValue() > 0 ) {
+			// stalled on a synchronization point, the job that completes the signal will release the block
+			return;
+		}
+		if ( nextBlock.CompareExchange( block, block + 1 ) != block ) {
+			// another thread released this block
+			continue;
 		}
 
-		// try to lock to fetch a new job
-		if ( fetchLock.Increment() == 1 ) {
-
-			// grab a new job
-			state.nextJobIndex = currentJob.Increment() - 1;
-
-			// run through any remaining signals and syncs (this should rarely iterate more than once)
-			for ( ; state.lastJobIndex <= state.nextJobIndex && state.lastJobIndex < jobList.Num(); state.lastJobIndex++ ) {
-				if ( jobList[state.lastJobIndex].data == & JOB_SIGNAL ) {
-					state.signalIndex++;
-					assert( state.signalIndex < signalJobCount.Num() );
-				} else if ( jobList[state.lastJobIndex].data == & JOB_SYNCHRONIZE ) {
-					assert( state.signalIndex > 0 );
-					if ( signalJobCount[state.signalIndex - 1].GetValue() > 0 ) {
-						// return this job to the list
-						currentJob.Decrement();
-						// release the fetch lock
-						fetchLock.Decrement();
-						// stalled on a synchronization point
-						return ( result | RUN_STALLED );
-					}
-				} else if ( jobList[state.lastJobIndex].data == & JOB_LIST_DONE ) {
-					if ( signalJobCount[signalJobCount.Num() - 1].GetValue() > 0 ) {
-						// return this job to the list
-						currentJob.Decrement();
-						// release the fetch lock
-						fetchLock.Decrement();
-						// stalled on a synchronization point
-						return ( result | RUN_STALLED );
-					}
-					// decrement the done count
-					doneGuards[currentDoneGuard].Decrement();
-				}
-			}
-			// release the fetch lock
-			fetchLock.Decrement();
-		} else {
-			// release the fetch lock
-			fetchLock.Decrement();
-			// another thread is fetching right now so consider stalled
-			return ( result | RUN_STALLED );
+		if ( block > 0 && jobTrace.IsEnabled() ) {
+			const uint64 syncTime = Sys_Microseconds();
+			jobTrace.Record( threadNum, JOB_TRACE_SYNC, listId, NULL, block - 1, syncTime, syncTime );
 		}
 
-		// if at the end of the job list we're done
-		if ( state.nextJobIndex >= jobList.Num() ) {
-			return ( result | RUN_DONE );
+		const int firstJob = ( block > 0 ) ? syncPoints[block - 1].firstJob : 0;
+		const int lastJob = ( block < syncPoints.Num() ) ? syncPoints[block].firstJob : ( hasDependencies ? numRootJobs : jobList.Num() );
+		if ( lastJob > firstJob ) {
+			void PublishJobs( idParallelJobList_Threads * jobList, int version, int firstJob, int lastJob, unsigned int threadNum );
+			PublishJobs( this, GetVersion(), firstJob, lastJob, threadNum );
 		}
+	}
+}
+
+/*
+========================
+idParallelJobList_Threads::RunJob
+========================
+*/
+bool idParallelJobList_Threads::RunJob( unsigned int threadNum, int jobVersion, int slot ) {
+	numThreadsExecuting.Increment();
+
+	if ( jobVersion != version.GetValue() ) {
+		// trying to run an old version of this list that is already done
+		numThreadsExecuting.Decrement();
+		return false;
+	}
+
+	assert( threadNum < MAX_THREADS );
+	assert( slot >= 0 && slot < jobList.Num() );
 
-		// execute the next job
-		{
-			uint64 jobStart = Sys_Microseconds();
+	const int jobIndex = hasDependencies ? readyJobs[slot] : slot;
 
-			jobList[state.nextJobIndex].function( jobList[state.nextJobIndex].data );
-			jobList[state.nextJobIndex].executed = 1;
+	uint64 jobStart = Sys_Microseconds();
 
-			uint64 jobEnd = Sys_Microseconds();
-			deferredThreadStats.threadExecTime[threadNum] += jobEnd - jobStart;
+	if ( deferredThreadStats.startTime == 0 ) {
+		deferredThreadStats.startTime = jobStart;	// first time any thread is running jobs from this list
+	}
+
+	job_t & job = jobList[jobIndex];
+	job.function( job.data );
+	job.executed = 1;
+
+	uint64 jobEnd = Sys_Microseconds();
+	deferredThreadStats.threadExecTime[threadNum] += jobEnd - jobStart;
+
+	if ( jobTrace.IsEnabled() ) {
+		jobTrace.Record( threadNum, JOB_TRACE_JOB, listId, job.function, jobIndex, jobStart, jobEnd );
+	}
 
 #ifndef _DEBUG
-			if ( jobs_longJobMicroSec.GetInteger() > 0 ) {
-				if ( jobEnd - jobStart > jobs_longJobMicroSec.GetInteger()
-					&& GetId() != JOBLIST_UTILITY ) {
-					longJobTime = ( jobEnd - jobStart ) * ( 1.0f / 1000.0f );
-					longJobFunc = jobList[state.nextJobIndex].function;
-					longJobData = jobList[state.nextJobIndex].data;
-					const char * jobName = GetJobName( jobList[state.nextJobIndex].function );
-					const char * jobListName = GetJobListName( GetId() );
-					idLib::Printf( "%1.1f milliseconds for a single '%s' job from job list %s on thread %d\n", longJobTime, jobName, jobListName, threadNum );
-				}
-			}
-#endif
+	if ( jobs_longJobMicroSec.GetInteger() > 0 ) {
+		if ( jobEnd - jobStart > jobs_longJobMicroSec.GetInteger()
+			&& GetId() != JOBLIST_UTILITY ) {
+			longJobTime = ( jobEnd - jobStart ) * ( 1.0f / 1000.0f );
+			longJobFunc = job.function;
+			longJobData = job.data;
+			const char * jobName = GetJobName( job.function );
+			const char * jobListName = GetJobListName( GetId() );
+			idLib::Printf( "%1.1f milliseconds for a single '%s' job from job list %s on thread %d\n", longJobTime, jobName, jobListName, threadNum );
 		}
+	}
+#endif
 
-		result |= RUN_PROGRESS;
-
-		// decrease the job count for the current signal
-		if ( signalJobCount[state.signalIndex].Decrement() == 0 ) {
-			// if this was the very last job of the job list
-			if ( state.signalIndex == signalJobCount.Num() - 1 ) {
-				deferredThreadStats.endTime = Sys_Microseconds();
-				return ( result | RUN_DONE );
+	// start any jobs that were only waiting for this job
+	if ( hasDependencies ) {
+		for ( int i = job.firstSuccessor; i != -1; i = successors[i].next ) {
+			const int successor = successors[i].job;
+			if ( pendingPredecessors[successor].Decrement() == 0 && !executeInline ) {
+				const int readySlot = numReadyJobs.Increment() - 1;
+				readyJobs[readySlot] = successor;
+				void PublishJobs( idParallelJobList_Threads * jobList, int version, int firstJob, int lastJob, unsigned int threadNum );
+				PublishJobs( this, jobVersion, readySlot, readySlot + 1, threadNum );
 			}
 		}
+	}
 
-	} while( ! singleJob );
+	// decrease the job count for the signal and release any blocks waiting on it
+	if ( signalJobCount[job.signalIndex].Decrement() == 0 ) {
+		ReleaseBlocks( threadNum );
+	}
 
-	return result;
-}
+	// if this was the very last job of the job list
+	if ( numPendingJobs.Decrement() == 0 ) {
+		deferredThreadStats.endTime = Sys_Microseconds();
+		doneGuards[currentDoneGuard].Decrement();
 
-/*
-========================
-idParallelJobList_Threads::RunJobs
-========================
-*/
-int idParallelJobList_Threads::RunJobs( unsigned int threadNum, threadJobListState_t & state, bool singleJob ) {
-	uint64 start = Sys_Microseconds();
+		// job lists that were submitted to wait for this one can start now
+		void ReleaseDeferredJobLists( unsigned int threadNum );
+		ReleaseDeferredJobLists( threadNum );
 
-	numThreadsExecuting.Increment();
+		doneSignal.Raise();
+	}
 
-	int result = RunJobsInternal( threadNum, state, singleJob );
+	deferredThreadStats.threadTotalTime[threadNum] += Sys_Microseconds() - jobStart;
 
 	numThreadsExecuting.Decrement();
 
-	deferredThreadStats.threadTotalTime[threadNum] += Sys_Microseconds() - start;
-
-	return result;
+	return true;
 }
 
 /*
@@ -732,9 +983,9 @@ idParallelJobList::~idParallelJobList() {
 idParallelJobList::AddJob
 ========================
 */
-void idParallelJobList::AddJob( jobRun_t function, void * data ) {
+jobHandle_t idParallelJobList::AddJob( jobRun_t function, void * data ) {
 	assert( IsRegisteredJob( function ) );
-	jobListThreads->AddJob( function, data );
+	return jobListThreads->AddJob( function, data );
 }
 
 /*
@@ -746,6 +997,26 @@ void idParallelJobList::InsertSyncPoint( jobSyncType_t syncType ) {
 	jobListThreads->InsertSyncPoint( syncType );
 }
 
+/*
+========================
+idParallelJobList::AddDependency
+========================
+*/
+void idParallelJobList::AddDependency( jobHandle_t job, jobHandle_t predecessor ) {
+	jobListThreads->AddDependency( job, predecessor );
+}
+
+/*
+========================
+idParallelJobList::AddContinuation
+========================
+*/
+jobHandle_t idParallelJobList::AddContinuation( jobHandle_t job, jobRun_t function, void * data ) {
+	jobHandle_t continuation = AddJob( function, data );
+	AddDependency( continuation, job );
+	return continuation;
+}
+
 /*
 ========================
 idParallelJobList::Wait
@@ -891,18 +1162,143 @@ jobListId_t idParallelJobList::GetId() const {
 /*
 ================================================================================================
 
-idJobThread
+idJobDeque
 
 ================================================================================================
 */
 
-const int JOB_THREAD_STACK_SIZE		= 256 * 1024;	// same size as the SPU local store
+const int NUM_JOB_PRIORITIES		= JOBLIST_PRIORITY_HIGH - JOBLIST_PRIORITY_NONE;
 
-struct threadJobList_t {
+// a contiguous range of jobs from a single block of a job list, for job lists with
+// dependencies the range is in the order in which the jobs became ready to run
+struct jobRange_t {
 	idParallelJobList_Threads *	jobList;
 	int							version;
+	int							firstJob;
+	int							lastJob;		// one past the last job in the range
+};
+
+/*
+================================================
+idJobDeque is a double ended queue with job ranges owned by a single job thread.
+The owner pushes and pops ranges at the back, while other job threads steal ranges
+from the front. Ranges are only pushed and popped once per executed job, so a
+light-weight spin lock is used instead of a mutex.
+================================================
+*/
+class idJobDeque {
+public:
+							idJobDeque() : head( 0 ), tail( 0 ) {}
+
+	bool					IsEmpty() const { return head == tail; }
+
+	bool					Push( const jobRange_t & range );
+	bool					Pop( jobRange_t & range );
+	bool					Steal( jobRange_t & range );
+
+private:
+	static const int		MAX_RANGES = MAX_JOBLISTS * 4;
+
+	jobRange_t				ranges[MAX_RANGES];
+	volatile unsigned int	head;		// index of the first range
+	volatile unsigned int	tail;		// index one past the last range
+	idSysInterlockedInteger	lock;
+
+	void					Lock();
+	void					Unlock();
 };
 
+compile_time_assert( CONST_ISPOWEROFTWO( MAX_JOBLISTS * 4 ) );
+
+/*
+========================
+idJobDeque::Lock
+========================
+*/
+ID_INLINE void idJobDeque::Lock() {
+	while ( lock.CompareExchange( 0, 1 ) != 0 ) {
+		Sys_Yield();
+	}
+}
+
+/*
+========================
+idJobDeque::Unlock
+========================
+*/
+ID_INLINE void idJobDeque::Unlock() {
+	SYS_MEMORYBARRIER;
+	lock.SetValue( 0 );
+}
+
+/*
+========================
+idJobDeque::Push
+========================
+*/
+bool idJobDeque::Push( const jobRange_t & range ) {
+	Lock();
+	if ( tail - head >= MAX_RANGES ) {
+		Unlock();
+		return false;
+	}
+	ranges[tail & ( MAX_RANGES - 1 )] = range;
+	tail++;
+	Unlock();
+	return true;
+}
+
+/*
+========================
+idJobDeque::Pop
+========================
+*/
+bool idJobDeque::Pop( jobRange_t & range ) {
+	if ( IsEmpty() ) {
+		return false;
+	}
+	Lock();
+	if ( head == tail ) {
+		Unlock();
+		return false;
+	}
+	tail--;
+	range = ranges[tail & ( MAX_RANGES - 1 )];
+	Unlock();
+	return true;
+}
+
+/*
+========================
+idJobDeque::Steal
+========================
+*/
+bool idJobDeque::Steal( jobRange_t & range ) {
+	if ( IsEmpty() ) {
+		return false;
+	}
+	Lock();
+	if ( head == tail ) {
+		Unlock();
+		return false;
+	}
+	range = ranges[head & ( MAX_RANGES - 1 )];
+	head++;
+	Unlock();
+	return true;
+}
+
+/*
+================================================================================================
+
+idJobThread
+
+================================================================================================
+*/
+
+const int JOB_THREAD_STACK_SIZE		= 256 * 1024;	// same size as the SPU local store
+const int JOB_THREAD_IDLE_SPINS		= 64;			// number of times an idle thread looks for work before going to sleep
+
 static idCVar jobs_prioritize( "jobs_prioritize", "1", CVAR_BOOL | CVAR_NOCHEAT, "prioritize job lists" );
 
 class idJobThread : public idSysThread {
@@ -912,14 +1308,10 @@ public:
 
 	void						Start( core_t core, unsigned int threadNum );
 
-	void						AddJobList( idParallelJobList_Threads * jobList );
+	idJobDeque &				GetDeque( jobListPriority_t priority ) { return deques[priority - JOBLIST_PRIORITY_LOW]; }
 
 private:
-	threadJobList_t				jobLists[MAX_JOBLISTS];	// cyclic buffer with job lists
-	unsigned int				firstJobList;			// index of the last job list the thread grabbed
-	unsigned int				lastJobList;			// index where the next job list to work on will be added
-	idSysMutex					addJobMutex;
-
+	idJobDeque					deques[NUM_JOB_PRIORITIES];	// one deque per job list priority
 	unsigned int				threadNum;
 
 	virtual int					Run();
@@ -931,8 +1323,6 @@ idJobThread::idJobThread
 ========================
 */
 idJobThread::idJobThread() :
-		firstJobList( 0 ),
-		lastJobList( 0 ),
 		threadNum( 0 ) {
 }
 
@@ -954,98 +1344,30 @@ void idJobThread::Start( core_t core, unsigned int threadNum ) {
 	StartWorkerThread( va( "JobListProcessor_%d", threadNum ), core, THREAD_NORMAL, JOB_THREAD_STACK_SIZE );
 }
 
-/*
-========================
-idJobThread::AddJobList
-========================
-*/
-void idJobThread::AddJobList( idParallelJobList_Threads * jobList ) {
-	// must lock because multiple threads may try to add new job lists at the same time
-	addJobMutex.Lock();
-	// wait until there is space available because in rare cases multiple versions of the same job lists may still be queued 
-	while( lastJobList - firstJobList >= MAX_JOBLISTS ) {
-		Sys_Yield();
-	}
-	assert( lastJobList - firstJobList < MAX_JOBLISTS );
-	jobLists[lastJobList & ( MAX_JOBLISTS - 1 )].jobList = jobList;
-	jobLists[lastJobList & ( MAX_JOBLISTS - 1 )].version = jobList->GetVersion();
-	lastJobList++;
-	addJobMutex.Unlock();
-}
-
 /*
 ========================
 idJobThread::Run
 ========================
 */
 int idJobThread::Run() {
-	threadJobListState_t threadJobListState[MAX_JOBLISTS];
-	int numJobLists = 0;
-	int lastStalledJobList = -1;
-
-	while ( !IsTerminating() ) {
-
-		// fetch any new job lists and add them to the local list
-		if ( numJobLists < MAX_JOBLISTS && firstJobList < lastJobList ) {
-			threadJobListState[numJobLists].jobList = jobLists[firstJobList & ( MAX_JOBLISTS - 1 )].jobList;
-			threadJobListState[numJobLists].version = jobLists[firstJobList & ( MAX_JOBLISTS - 1 )].version;
-			threadJobListState[numJobLists].signalIndex = 0;
-			threadJobListState[numJobLists].lastJobIndex = 0;
-			threadJobListState[numJobLists].nextJobIndex = -1;
-			numJobLists++;
-			firstJobList++;
-		}
-		if ( numJobLists == 0 ) {
-			break;
-		}
+	bool FindJobRange( unsigned int threadNum, jobRange_t & range );
+	void RunJobRange( unsigned int threadNum, jobRange_t & range );
 
-		int currentJobList = 0;
-		jobListPriority_t priority = JOBLIST_PRIORITY_NONE;
-		if ( lastStalledJobList < 0 ) {
-			// find the job list with the highest priority
-			for ( int i = 0; i < numJobLists; i++ ) {
-				if ( threadJobListState[i].jobList->GetPriority() > priority && !threadJobListState[i].jobList->WaitForOtherJobList() ) {
-					priority = threadJobListState[i].jobList->GetPriority();
-					currentJobList = i;
-				}
-			}
-		} else {
-			// try to hide the stall with a job from a list that has equal or higher priority
-			currentJobList = lastStalledJobList;
-			priority = threadJobListState[lastStalledJobList].jobList->GetPriority();
-			for ( int i = 0; i < numJobLists; i++ ) {
-				if ( i != lastStalledJobList && threadJobListState[i].jobList->GetPriority() >= priority && !threadJobListState[i].jobList->WaitForOtherJobList() ) {
-					priority = threadJobListState[i].jobList->GetPriority();
-					currentJobList = i;
-				}
-			}
-		}
-
-		// if the priority is high then try to run through the whole list to reduce the overhead
-		// otherwise run a single job and re-evaluate priorities for the next job
-		bool singleJob = ( priority == JOBLIST_PRIORITY_HIGH ) ? false : jobs_prioritize.GetBool();
+	int numIdleSpins = 0;
 
-		// try running one or more jobs from the current job list
-		int result = threadJobListState[currentJobList].jobList->RunJobs( threadNum, threadJobListState[currentJobList], singleJob );
-
-		if ( ( result & idParallelJobList_Threads::RUN_DONE ) != 0 ) {
-			// done with this job list so remove it from the local list
-			for ( int i = currentJobList; i < numJobLists - 1; i++ ) {
-				threadJobListState[i] = threadJobListState[i + 1];
-			}
-			numJobLists--;
-			lastStalledJobList = -1;
-		} else if ( ( result & idParallelJobList_Threads::RUN_STALLED ) != 0 ) {
-			// yield when stalled on the same job list again without making any progress
-			if ( currentJobList == lastStalledJobList ) {
-				if ( ( result & idParallelJobList_Threads::RUN_PROGRESS ) == 0 ) {
-					Sys_Yield();
-				}
+	while ( !IsTerminating() ) {
+		jobRange_t range;
+		if ( !FindJobRange( threadNum, range ) ) {
+			// jobs are typically published in bursts so spin a little before going to sleep,
+			// any job published after this thread stops looking will signal it again
+			if ( ++numIdleSpins > JOB_THREAD_IDLE_SPINS ) {
+				break;
 			}
-			lastStalledJobList = currentJobList;
-		} else {
-			lastStalledJobList = -1;
+			Sys_Yield();
+			continue;
 		}
+		numIdleSpins = 0;
+		RunJobRange( threadNum, range );
 	}
 	return 0;
 }
@@ -1066,10 +1388,10 @@ extern void Sys_CPUCount( int & logicalNum, int & coreNum, int & packageNum );
 // http://download.microsoft.com/download/5/7/7/577a5684-8a83-43ae-9272-ff260a9c20e2/Hyper-thread_Windows.doc
 //
 //											Physical	Logical (Cores + HT)
-// Windows XP Home Edition					1			2 
-// Windows XP Professional					2			4 
-// Windows Server 2003, Standard Edition	4			8 
-// Windows Server 2003, Enterprise Edition	8			16 
+// Windows XP Home Edition					1			2
+// Windows XP Professional					2			4
+// Windows Server 2003, Standard Edition	4			8
+// Windows Server 2003, Enterprise Edition	8			16
 // Windows Server 2003, Datacenter Edition	32			32
 //
 // Windows Vista							?			?
@@ -1081,8 +1403,9 @@ extern void Sys_CPUCount( int & logicalNum, int & coreNum, int & packageNum );
 //
 // Hyperthreading is not dead yet.  Intel's Core i7 Processor is quad-core with HT for 8 logicals.
 
-// DOOM3: We don't have that many jobs, so just set this fairly low so we don't spin up a ton of idle threads
-#define MAX_JOB_THREADS		2
+// DOOM3: We don't have that many jobs, so default to a low number of threads. Idle job threads
+// sleep until jobs are published, so allowing more threads does not cost anything when unused.
+#define MAX_JOB_THREADS		16
 #define NUM_JOB_THREADS		"2"
 #define JOB_THREAD_CORES	{	CORE_ANY, CORE_ANY, CORE_ANY, CORE_ANY,	\
 								CORE_ANY, CORE_ANY, CORE_ANY, CORE_ANY,	\
@@ -1093,6 +1416,7 @@ extern void Sys_CPUCount( int & logicalNum, int & coreNum, int & packageNum );
 								CORE_ANY, CORE_ANY, CORE_ANY, CORE_ANY,	\
 								CORE_ANY, CORE_ANY, CORE_ANY, CORE_ANY }
 
+compile_time_assert( MAX_JOB_THREADS <= NON_JOB_THREAD_UNIT );
 
 idCVar jobs_numThreads( "jobs_numThreads", NUM_JOB_THREADS, CVAR_INTEGER | CVAR_NOCHEAT, "number of threads used to crunch through jobs", 0, MAX_JOB_THREADS );
 
@@ -1116,13 +1440,32 @@ public:
 
 	void						Submit( idParallelJobList_Threads * jobList, int parallelism );
 
+	//------------------------
+	// Work-stealing scheduler, thread safe.
+	//------------------------
+	void						PublishJobs( idParallelJobList_Threads * jobList, int version, int firstJob, int lastJob, unsigned int threadNum );
+	void						ReleaseDeferredJobLists( unsigned int threadNum );
+	bool						FindJobRange( unsigned int threadNum, jobRange_t & range );
+	void						RunJobRange( unsigned int threadNum, jobRange_t & range );
+	bool						HelpWithJob( jobListPriority_t priority );
+
 private:
 	idJobThread						threads[MAX_JOB_THREADS];
-	unsigned int					maxThreads;
+	unsigned int					maxThreads;			// job threads that may get work, from jobs_numThreads
+	unsigned int					numStartedThreads;	// job threads are only started once they may get work
+	idSysInterlockedInteger			nextPublishThread;	// spreads jobs published from other threads over the job threads
 	int								numPhysicalCpuCores;
 	int								numLogicalCpuCores;
 	int								numCpuPackages;
 	idStaticList< idParallelJobList *, MAX_JOBLISTS >	jobLists;
+
+	// job lists that were submitted while the job list they wait for was still running
+	idStaticList< idParallelJobList_Threads *, MAX_JOBLISTS >	deferredJobLists;
+	idSysMutex						deferredMutex;
+
+	void						StartThreads( unsigned int numThreads );
+	void						PushJobRange( unsigned int threadNum, const jobRange_t & range, unsigned int runThreadNum );
+	bool						StealJobRange( unsigned int threadNum, jobListPriority_t priority, jobRange_t & range );
 };
 
 idParallelJobManagerLocal parallelJobManagerLocal;
@@ -1137,22 +1480,80 @@ void SubmitJobList( idParallelJobList_Threads * jobList, int parallelism ) {
 	parallelJobManagerLocal.Submit( jobList, parallelism );
 }
 
+/*
+========================
+PublishJobs
+========================
+*/
+void PublishJobs( idParallelJobList_Threads * jobList, int version, int firstJob, int lastJob, unsigned int threadNum ) {
+	parallelJobManagerLocal.PublishJobs( jobList, version, firstJob, lastJob, threadNum );
+}
+
+/*
+========================
+ReleaseDeferredJobLists
+========================
+*/
+void ReleaseDeferredJobLists( unsigned int threadNum ) {
+	parallelJobManagerLocal.ReleaseDeferredJobLists( threadNum );
+}
+
+/*
+========================
+FindJobRange
+========================
+*/
+bool FindJobRange( unsigned int threadNum, jobRange_t & range ) {
+	return parallelJobManagerLocal.FindJobRange( threadNum, range );
+}
+
+/*
+========================
+RunJobRange
+========================
+*/
+void RunJobRange( unsigned int threadNum, jobRange_t & range ) {
+	parallelJobManagerLocal.RunJobRange( threadNum, range );
+}
+
+/*
+========================
+HelpWithParallelJob
+========================
+*/
+bool HelpWithParallelJob( jobListPriority_t priority ) {
+	return parallelJobManagerLocal.HelpWithJob( priority );
+}
+
 /*
 ========================
 idParallelJobManagerLocal::Init
 ========================
 */
 void idParallelJobManagerLocal::Init() {
+	numStartedThreads = 0;
+	maxThreads = idMath::ClampInt( 0, MAX_JOB_THREADS, jobs_numThreads.GetInteger() );
+	jobs_numThreads.ClearModified();
+	StartThreads( maxThreads );
+
+	Sys_CPUCount( numPhysicalCpuCores, numLogicalCpuCores, numCpuPackages );
+}
+
+/*
+========================
+idParallelJobManagerLocal::StartThreads
+
+Threads are never stopped when jobs_numThreads is lowered, they just don't get any more work.
+========================
+*/
+void idParallelJobManagerLocal::StartThreads( unsigned int numThreads ) {
 	// on consoles this will have specific cores for the threads, but on PC they will all be CORE_ANY
 	core_t cores[] = JOB_THREAD_CORES;
 	assert( sizeof( cores ) / sizeof( cores[0] ) >= MAX_JOB_THREADS );
 
-	for ( int i = 0; i < MAX_JOB_THREADS; i++ ) {
-		threads[i].Start( cores[i], i );
+	for ( ; numStartedThreads < numThreads; numStartedThreads++ ) {
+		threads[numStartedThreads].Start( cores[numStartedThreads], numStartedThreads );
 	}
-	maxThreads = jobs_numThreads.GetInteger();
-
-	Sys_CPUCount( numPhysicalCpuCores, numLogicalCpuCores, numCpuPackages );
 }
 
 /*
@@ -1161,9 +1562,10 @@ idParallelJobManagerLocal::Shutdown
 ========================
 */
 void idParallelJobManagerLocal::Shutdown() {
-	for ( int i = 0; i < MAX_JOB_THREADS; i++ ) {
+	for ( unsigned int i = 0; i < numStartedThreads; i++ ) {
 		threads[i].StopThread();
 	}
+	numStartedThreads = 0;
 }
 
 /*
@@ -1191,8 +1593,9 @@ void idParallelJobManagerLocal::FreeJobList( idParallelJobList * jobList ) {
 	if ( jobList == NULL ) {
 		return;
 	}
-	// wait for all job threads to finish because job list deletion is not thread safe
-	for ( unsigned int i = 0; i < maxThreads; i++ ) {
+	// wait for all job threads to finish because job list deletion is not thread safe,
+	// any of the job threads may have stolen jobs from this list
+	for ( unsigned int i = 0; i < numStartedThreads; i++ ) {
 		threads[i].WaitForThread();
 	}
 	int index = jobLists.FindIndex( jobList );
@@ -1259,30 +1662,249 @@ void idParallelJobManagerLocal::Submit( idParallelJobList_Threads * jobList, int
 	if ( jobs_numThreads.IsModified() ) {
 		maxThreads = idMath::ClampInt( 0, MAX_JOB_THREADS, jobs_numThreads.GetInteger() );
 		jobs_numThreads.ClearModified();
+		StartThreads( maxThreads );
 	}
 
-	// determine the number of threads to use
+	// determine the number of threads to use, jobs_numThreads limits all of them
 	int numThreads = maxThreads;
 	if ( parallelism == JOBLIST_PARALLELISM_DEFAULT ) {
 		numThreads = maxThreads;
 	} else if ( parallelism == JOBLIST_PARALLELISM_MAX_CORES ) {
 		numThreads = numLogicalCpuCores;
 	} else if ( parallelism == JOBLIST_PARALLELISM_MAX_THREADS ) {
-		numThreads = MAX_JOB_THREADS;
-	} else if ( parallelism > MAX_JOB_THREADS ) {
-		numThreads = MAX_JOB_THREADS;
+		numThreads = maxThreads;
 	} else {
 		numThreads = parallelism;
 	}
+	numThreads = Min( numThreads, (int)maxThreads );
 
 	if ( numThreads <= 0 ) {
-		threadJobListState_t state( jobList->GetVersion() );
-		jobList->RunJobs( 0, state, false );
+		jobList->RunAllJobs( NON_JOB_THREAD_UNIT );
+		return;
+	}
+
+	jobList->SetNumThreads( numThreads );
+
+	if ( jobList->WaitForOtherJobList() ) {
+		deferredMutex.Lock();
+		deferredJobLists.Append( jobList );
+		deferredMutex.Unlock();
+		// the other job list may have finished before this one was added
+		ReleaseDeferredJobLists( NON_JOB_THREAD_UNIT );
 		return;
 	}
 
+	jobList->ReleaseBlocks( NON_JOB_THREAD_UNIT );
+}
+
+/*
+========================
+idParallelJobManagerLocal::ReleaseDeferredJobLists
+========================
+*/
+void idParallelJobManagerLocal::ReleaseDeferredJobLists( unsigned int threadNum ) {
+	idStaticList< idParallelJobList_Threads *, MAX_JOBLISTS > releasedJobLists;
+
+	deferredMutex.Lock();
+	for ( int i = 0; i < deferredJobLists.Num(); ) {
+		if ( !deferredJobLists[i]->WaitForOtherJobList() ) {
+			releasedJobLists.Append( deferredJobLists[i] );
+			deferredJobLists.RemoveIndexFast( i );
+		} else {
+			i++;
+		}
+	}
+	deferredMutex.Unlock();
+
+	// release outside of the lock because running out of deque space may execute jobs right here
+	for ( int i = 0; i < releasedJobLists.Num(); i++ ) {
+		releasedJobLists[i]->ReleaseBlocks( threadNum );
+	}
+}
+
+/*
+========================
+idParallelJobManagerLocal::PublishJobs
+
+Spreads a block of jobs evenly over the job threads that are assigned to the job list.
+Any job thread that runs out of work will steal jobs from the others. The first part
+goes to the publishing thread if it is one of them, so a job continuation stays on
+the same thread. Jobs published from other threads start at a rotating job thread.
+========================
+*/
+void idParallelJobManagerLocal::PublishJobs( idParallelJobList_Threads * jobList, int version, int firstJob, int lastJob, unsigned int threadNum ) {
+	const int numJobs = lastJob - firstJob;
+	const int numListThreads = Max( 1, Min( jobList->GetNumThreads(), (int)maxThreads ) );
+	const int numThreads = Max( 1, Min( numListThreads, numJobs ) );
+
+	int homeThread;
+	if ( threadNum < (unsigned int)numListThreads ) {
+		homeThread = threadNum;
+	} else {
+		homeThread = ( nextPublishThread.Increment() & 0x7FFFFFFF ) % numListThreads;
+	}
+
+	jobRange_t range;
+	range.jobList = jobList;
+	range.version = version;
+	range.lastJob = firstJob;
 	for ( int i = 0; i < numThreads; i++ ) {
-		threads[i].AddJobList( jobList );
-		threads[i].SignalWork();
+		range.firstJob = range.lastJob;
+		range.lastJob = firstJob + ( numJobs * ( i + 1 ) ) / numThreads;
+		PushJobRange( ( homeThread + i ) % numListThreads, range, threadNum );
+	}
+}
+
+/*
+========================
+idParallelJobManagerLocal::PushJobRange
+
+The thread that receives the range is signalled, and so are idle threads of the job list
+that can steal the other jobs of the range, one for every job after the first.
+========================
+*/
+void idParallelJobManagerLocal::PushJobRange( unsigned int threadNum, const jobRange_t & range, unsigned int runThreadNum ) {
+	// only the job threads that are assigned to the job list get work
+	const unsigned int numThreads = Min( (unsigned int)Max( 0, range.jobList->GetNumThreads() ), Min( maxThreads, numStartedThreads ) );
+	const jobListPriority_t priority = range.jobList->GetPriority();
+	for ( unsigned int i = 0; i < numThreads; i++ ) {
+		idJobThread & thread = threads[( threadNum + i ) % numThreads];
+		if ( thread.GetDeque( priority ).Push( range ) ) {
+			thread.SignalWork();
+			int numStealers = range.lastJob - range.firstJob - 1;
+			for ( unsigned int j = 1; j < numThreads && numStealers > 0; j++ ) {
+				idJobThread & idleThread = threads[( threadNum + i + j ) % numThreads];
+				if ( idleThread.IsWorkDone() ) {
+					idleThread.SignalWork();
+					numStealers--;
+				}
+			}
+			return;
+		}
+	}
+	// all deques are full so run the jobs right here
+	for ( int i = range.firstJob; i < range.lastJob; i++ ) {
+		range.jobList->RunJob( runThreadNum, range.version, i );
 	}
-}
\ No newline at end of file
+}
+
+/*
+========================
+idParallelJobManagerLocal::StealJobRange
+========================
+*/
+bool idParallelJobManagerLocal::StealJobRange( unsigned int threadNum, jobListPriority_t priority, jobRange_t & range ) {
+	// threads above jobs_numThreads only finish the work already in their own deques
+	const unsigned int numThreads = maxThreads;
+	if ( threadNum >= numThreads ) {
+		return false;
+	}
+	for ( unsigned int i = 1; i < numThreads; i++ ) {
+		idJobThread & victim = threads[( threadNum + i ) % numThreads];
+		if ( !victim.GetDeque( priority ).Steal( range ) ) {
+			continue;
+		}
+		// keep the first half and leave the second half for other threads to steal from this thread
+		const int numJobs = range.lastJob - range.firstJob;
+		if ( numJobs > 1 ) {
+			jobRange_t rest = range;
+			rest.firstJob = range.firstJob + numJobs / 2;
+			if ( threads[threadNum].GetDeque( priority ).Push( rest ) ) {
+				range.lastJob = rest.firstJob;
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+/*
+========================
+idParallelJobManagerLocal::FindJobRange
+========================
+*/
+bool idParallelJobManagerLocal::FindJobRange( unsigned int threadNum, jobRange_t & range ) {
+	if ( jobs_prioritize.GetBool() ) {
+		// run jobs from the job list with the highest priority, even if they have to be stolen
+		for ( int priority = JOBLIST_PRIORITY_HIGH; priority > JOBLIST_PRIORITY_NONE; priority-- ) {
+			if ( threads[threadNum].GetDeque( (jobListPriority_t) priority ).Pop( range ) ) {
+				return true;
+			}
+			if ( StealJobRange( threadNum, (jobListPriority_t) priority, range ) ) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// drain the local deques before stealing from other threads
+	for ( int priority = JOBLIST_PRIORITY_HIGH; priority > JOBLIST_PRIORITY_NONE; priority-- ) {
+		if ( threads[threadNum].GetDeque( (jobListPriority_t) priority ).Pop( range ) ) {
+			return true;
+		}
+	}
+	for ( int priority = JOBLIST_PRIORITY_HIGH; priority > JOBLIST_PRIORITY_NONE; priority-- ) {
+		if ( StealJobRange( threadNum, (jobListPriority_t) priority, range ) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+========================
+idParallelJobManagerLocal::RunJobRange
+========================
+*/
+void idParallelJobManagerLocal::RunJobRange( unsigned int threadNum, jobRange_t & range ) {
+	assert( range.lastJob > range.firstJob );
+
+	// leave the remainder of the range for other threads to steal while the first job executes
+	if ( range.lastJob - range.firstJob > 1 ) {
+		jobRange_t rest = range;
+		rest.firstJob++;
+		if ( !threads[threadNum].GetDeque( range.jobList->GetPriority() ).Push( rest ) ) {
+			for ( int i = range.firstJob; i < range.lastJob; i++ ) {
+				range.jobList->RunJob( threadNum, range.version, i );
+			}
+			return;
+		}
+	}
+
+	range.jobList->RunJob( threadNum, range.version, range.firstJob );
+}
+
+/*
+========================
+idParallelJobManagerLocal::HelpWithJob
+
+Called from a thread that waits for a job list to finish. Executes a single job from
+a job list with the given or a lower priority, and returns false if there is no such job.
+The waiting thread has no deque of its own so the remainder of the range is handed back.
+========================
+*/
+bool idParallelJobManagerLocal::HelpWithJob( jobListPriority_t priority ) {
+	// the waiting threads account their processing time to a unit of their own
+	const unsigned int helperThreadNum = NON_JOB_THREAD_UNIT;
+
+	// all started threads are checked, threads above jobs_numThreads may still have work left
+	for ( int p = priority; p > JOBLIST_PRIORITY_NONE; p-- ) {
+		for ( unsigned int i = 0; i < numStartedThreads; i++ ) {
+			idJobDeque & deque = threads[i].GetDeque( (jobListPriority_t) p );
+			jobRange_t range;
+			if ( !deque.Steal( range ) ) {
+				continue;
+			}
+			if ( range.lastJob - range.firstJob > 1 ) {
+				jobRange_t rest = range;
+				rest.firstJob++;
+				if ( !deque.Push( rest ) ) {
+					PushJobRange( i, rest, helperThreadNum );
+				}
+			}
+			range.jobList->RunJob( helperThreadNum, range.version, range.firstJob );
+			return true;
+		}
+	}
+	return false;
+}
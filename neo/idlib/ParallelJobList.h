@@ -32,6 +32,9 @@ class idColor;
 
 typedef void ( * jobRun_t )( void * );
 
+// handle to a job in a job list, used to make other jobs in the same list depend on it
+typedef int jobHandle_t;
+
 enum jobSyncType_t {
 	SYNC_NONE,
 	SYNC_SIGNAL,
@@ -58,8 +61,8 @@ enum jobListPriority_t {
 
 enum jobListParallelism_t {
 	JOBLIST_PARALLELISM_DEFAULT			= -1,	// use "jobs_numThreads" number of threads
-	JOBLIST_PARALLELISM_MAX_CORES		= -2,	// use a thread for each logical core (includes hyperthreads)
-	JOBLIST_PARALLELISM_MAX_THREADS		= -3	// use the maximum number of job threads, which can help if there is IO to overlap
+	JOBLIST_PARALLELISM_MAX_CORES		= -2,	// use a thread for each logical core (includes hyperthreads), up to "jobs_numThreads"
+	JOBLIST_PARALLELISM_MAX_THREADS		= -3	// use all "jobs_numThreads" job threads, which can help if there is IO to overlap
 };
 
 #define assert_spu_local_store( ptr )
@@ -74,20 +77,34 @@ order to outweigh any job switching overhead. On the other
 hand a job should consume no more than a couple of
 100,000 clock cycles to maintain a good load balance over
 multiple processing units.
+
+Besides sync points, jobs can explicitly depend on other jobs in
+the same list. A job with predecessors is started as soon as all
+its predecessors have completed, so independent chains of jobs
+overlap instead of serializing at a sync point. A job can only
+depend on jobs that were added to the list before it, and sync
+points and dependencies cannot be mixed in the same list.
 ================================================
 */
 class idParallelJobList {
 	friend class idParallelJobManagerLocal;
 public:
 
-	void					AddJob( jobRun_t function, void * data );
+	jobHandle_t				AddJob( jobRun_t function, void * data );
 	void					InsertSyncPoint( jobSyncType_t syncType );
 
+	// The job will not be started before the predecessor job has completed.
+	void					AddDependency( jobHandle_t job, jobHandle_t predecessor );
+	// Adds a job that is started as soon as the given job has completed.
+	jobHandle_t				AddContinuation( jobHandle_t job, jobRun_t function, void * data );
+
 	// Submit the jobs in this list.
 	void					Submit( idParallelJobList * waitForJobList = NULL, int parallelism = JOBLIST_PARALLELISM_DEFAULT );
-	// Wait for the jobs in this list to finish. Will spin in place if any jobs are not done.
+	// Wait for the jobs in this list to finish. Executes pending jobs from this or lower priority lists
+	// while any jobs are not done, and sleeps when there are no jobs left to execute.
 	void					Wait();
-	// Try to wait for the jobs in this list to finish but either way return immediately. Returns true if all jobs are done.
+	// Try to wait for the jobs in this list to finish but either way return quickly. Executes at most one
+	// pending job if the jobs are not done yet. Returns true if all jobs are done.
 	bool					TryWait();
 	// returns true if the job list has been submitted.
 	bool					IsSubmitted() const;
@@ -32,6 +32,7 @@ If you have questions concerning this license or the applicable additional terms
 
 #include "Simd_Generic.h"
 #include "Simd_SSE.h"
+#include "Simd_AVX.h"
 
 idSIMDProcessor	*	processor = NULL;			// pointer to SIMD processor
 idSIMDProcessor *	generic = NULL;				// pointer to generic SIMD implementation
@@ -67,7 +68,9 @@ void idSIMD::InitProcessor( const char *module, bool forceGeneric ) {
 	} else {
 
 		if ( processor == NULL ) {
-			if ( ( cpuid & CPUID_MMX ) && ( cpuid & CPUID_SSE ) ) {
+			if ( ( cpuid & CPUID_AVX2 ) && ( cpuid & CPUID_SSE ) ) {
+				processor = new (TAG_MATH) idSIMD_AVX2;
+			} else if ( ( cpuid & CPUID_MMX ) && ( cpuid & CPUID_SSE ) ) {
 				processor = new (TAG_MATH) idSIMD_SSE;
 			} else {
 				processor = generic;
@@ -125,6 +128,8 @@ void idSIMD::Shutdown() {
 idSIMDProcessor *p_simd;
 idSIMDProcessor *p_generic;
 long baseClocks = 0;
+double nanosecondsPerClock = 0.0;
+int numFailedTests = 0;
 
 
 #define TIME_TYPE int
@@ -171,15 +176,29 @@ void PrintClocks( char *string, int dataCount, int clocks, int otherClocks = 0 )
 		idLib::Printf(" ");
 	}
 	clocks -= baseClocks;
+	const float ns = (float)( clocks * nanosecondsPerClock / Max( dataCount, 1 ) );
 	if ( otherClocks && clocks ) {
 		otherClocks -= baseClocks;
 		float p = (float)otherClocks / (float)clocks;
-		idLib::Printf( "c = %4d, clcks = %5d, %.1fX\n", dataCount, clocks, p );
+		idLib::Printf( "c = %4d, clcks = %5d, %7.2f ns/e, %.1fX\n", dataCount, clocks, ns, p );
 	} else {
-		idLib::Printf( "c = %4d, clcks = %5d\n", dataCount, clocks );
+		idLib::Printf( "c = %4d, clcks = %5d, %7.2f ns/e\n", dataCount, clocks, ns );
 	}
 }
 
+/*
+============
+TestResult
+============
+*/
+const char * TestResult( bool passed ) {
+	if ( !passed ) {
+		numFailedTests++;
+		return S_COLOR_RED"X";
+	}
+	return "ok";
+}
+
 /*
 ============
 GetBaseClocks
@@ -195,6 +214,7 @@ void GetBaseClocks() {
 		GetBest( start, end, bestClocks );
 	}
 	baseClocks = bestClocks;
+	nanosecondsPerClock = 1e9 / idLib::sys->ClockTicksPerSecond();
 }
 
 /*
@@ -249,7 +269,7 @@ void TestMinMax() {
 		GetBest( start, end, bestClocksSIMD );
 	}
 
-	result = ( min == min2 && max == max2 ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( min == min2 && max == max2 );
 	PrintClocks( va( "   simd->MinMax( float[] ) %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 
 	bestClocksGeneric = 0;
@@ -269,7 +289,7 @@ void TestMinMax() {
 		GetBest( start, end, bestClocksSIMD );
 	}
 
-	result = ( v2min == v2min2 && v2max == v2max2 ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( v2min == v2min2 && v2max == v2max2 );
 	PrintClocks( va( "   simd->MinMax( idVec2[] ) %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 
 	bestClocksGeneric = 0;
@@ -289,7 +309,7 @@ void TestMinMax() {
 		GetBest( start, end, bestClocksSIMD );
 	}
 
-	result = ( vmin == vmin2 && vmax == vmax2 ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( vmin == vmin2 && vmax == vmax2 );
 	PrintClocks( va( "   simd->MinMax( idVec3[] ) %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 
 	bestClocksGeneric = 0;
@@ -309,7 +329,7 @@ void TestMinMax() {
 		GetBest( start, end, bestClocksSIMD );
 	}
 
-	result = ( vmin == vmin2 && vmax == vmax2 ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( vmin == vmin2 && vmax == vmax2 );
 	PrintClocks( va( "   simd->MinMax( idDrawVert[] ) %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 
 	bestClocksGeneric = 0;
@@ -329,7 +349,7 @@ void TestMinMax() {
 		GetBest( start, end, bestClocksSIMD );
 	}
 
-	result = ( vmin == vmin2 && vmax == vmax2 ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( vmin == vmin2 && vmax == vmax2 );
 	PrintClocks( va( "   simd->MinMax( idDrawVert[], indexes[] ) %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -377,7 +397,7 @@ void TestMemcpy() {
 			break;
 		}
 	}
-	result = ( i >= BIG_COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= BIG_COUNT );
 	PrintClocks( va( "   simd->Memcpy() %s", result), BIG_COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -420,7 +440,7 @@ void TestMemset() {
 			break;
 		}
 	}
-	result = ( i >= BIG_COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= BIG_COUNT );
 	PrintClocks( va( "   simd->Memset() %s", result), BIG_COUNT, bestClocksSIMD, bestClocksGeneric );
 
 	j = 0;
@@ -446,7 +466,7 @@ void TestMemset() {
 			break;
 		}
 	}
-	result = ( i >= BIG_COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= BIG_COUNT );
 	PrintClocks( va( "   simd->Memset( 0 ) %s", result), BIG_COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -520,7 +540,7 @@ void TestBlendJoints() {
 			break;
 		}
 	}
-	result = ( i >= COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= COUNT );
 	PrintClocks( va( "   simd->BlendJoints() %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -594,7 +614,7 @@ void TestBlendJointsFast() {
 			break;
 		}
 	}
-	result = ( i >= COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= COUNT );
 	PrintClocks( va( "   simd->BlendJointsFast() %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -646,7 +666,7 @@ void TestConvertJointQuatsToJointMats() {
 			break;
 		}
 	}
-	result = ( i >= COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= COUNT );
 	PrintClocks( va( "   simd->ConvertJointQuatsToJointMats() %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -703,7 +723,7 @@ void TestConvertJointMatsToJointQuats() {
 			break;
 		}
 	}
-	result = ( i >= COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= COUNT );
 	PrintClocks( va( "   simd->ConvertJointMatsToJointQuats() %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -765,7 +785,7 @@ void TestTransformJoints() {
 			break;
 		}
 	}
-	result = ( i >= COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= COUNT );
 	PrintClocks( va( "   simd->TransformJoints() %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
@@ -827,10 +847,255 @@ void TestUntransformJoints() {
 			break;
 		}
 	}
-	result = ( i >= COUNT ) ? "ok" : S_COLOR_RED"X";
+	result = TestResult( i >= COUNT );
 	PrintClocks( va( "   simd->UntransformJoints() %s", result ), COUNT, bestClocksSIMD, bestClocksGeneric );
 }
 
+/*
+============
+RefCullBoundsToMVPbits
+
+Straight C reference for the idRenderMatrix culling and projection tests.
+============
+*/
+static bool RefCullBoundsToMVPbits( const idRenderMatrix & mvp, const idBounds & bounds, byte * outBits ) {
+	int bits = 0;
+
+	for ( int i = 0; i < 8; i++ ) {
+		const idVec3 v( bounds[( i >> 0 ) & 1][0], bounds[( i >> 1 ) & 1][1], bounds[( i >> 2 ) & 1][2] );
+
+		idVec4 c;
+		for ( int j = 0; j < 4; j++ ) {
+			c[j] = v[0] * mvp[j][0] + v[1] * mvp[j][1] + v[2] * mvp[j][2] + mvp[j][3];
+		}
+
+#if defined( CLIP_SPACE_ZERO_TO_ONE )
+		const float minZ = 0.0f;
+#else
+		const float minZ = -c[3];
+#endif
+
+		if ( c[0] > -c[3] ) { bits |= ( 1 << 0 ); }
+		if ( c[0] <  c[3] ) { bits |= ( 1 << 1 ); }
+		if ( c[1] > -c[3] ) { bits |= ( 1 << 2 ); }
+		if ( c[1] <  c[3] ) { bits |= ( 1 << 3 ); }
+		if ( c[2] >  minZ ) { bits |= ( 1 << 4 ); }
+		if ( c[2] <  c[3] ) { bits |= ( 1 << 5 ); }
+	}
+
+	*outBits = (byte)( bits ^ 63 );
+	return ( bits != 63 );
+}
+
+/*
+============
+RefProjectedBounds
+============
+*/
+static void RefProjectedBounds( idBounds & projected, const idRenderMatrix & mvp, const idBounds & bounds ) {
+	projected[0].Set( idMath::INFINITY, idMath::INFINITY, idMath::INFINITY );
+	projected[1].Set( -idMath::INFINITY, -idMath::INFINITY, -idMath::INFINITY );
+
+	for ( int i = 0; i < 8; i++ ) {
+		const idVec3 v( bounds[( i >> 0 ) & 1][0], bounds[( i >> 1 ) & 1][1], bounds[( i >> 2 ) & 1][2] );
+
+		idVec4 c;
+		for ( int j = 0; j < 4; j++ ) {
+			c[j] = v[0] * mvp[j][0] + v[1] * mvp[j][1] + v[2] * mvp[j][2] + mvp[j][3];
+		}
+
+		if ( c[3] <= idMath::FLT_SMALLEST_NON_DENORMAL ) {
+			projected[0].Set( -idMath::INFINITY, -idMath::INFINITY, -idMath::INFINITY );
+			projected[1][0] = idMath::INFINITY;
+			projected[1][1] = idMath::INFINITY;
+			continue;
+		}
+
+		for ( int j = 0; j < 3; j++ ) {
+			const float t = c[j] / c[3];
+			projected[0][j] = Min( projected[0][j], t );
+			projected[1][j] = Max( projected[1][j], t );
+		}
+	}
+
+	for ( int i = 0; i < 2; i++ ) {
+		for ( int j = 0; j < 3; j++ ) {
+#if defined( CLIP_SPACE_ZERO_TO_ONE )
+			if ( j < 2 ) {
+				projected[i][j] = projected[i][j] * 0.5f + 0.5f;
+			}
+#else
+			projected[i][j] = projected[i][j] * 0.5f + 0.5f;
+#endif
+			projected[i][j] = idMath::ClampFloat( 0.0f, 1.0f, projected[i][j] );
+		}
+	}
+}
+
+/*
+============
+RefDepthBoundsForBounds
+============
+*/
+static void RefDepthBoundsForBounds( float & min, float & max, const idRenderMatrix & mvp, const idBounds & bounds ) {
+	min = idMath::INFINITY;
+	max = -idMath::INFINITY;
+
+	for ( int i = 0; i < 8; i++ ) {
+		const idVec3 v( bounds[( i >> 0 ) & 1][0], bounds[( i >> 1 ) & 1][1], bounds[( i >> 2 ) & 1][2] );
+
+		float tz = v[0] * mvp[2][0] + v[1] * mvp[2][1] + v[2] * mvp[2][2] + mvp[2][3];
+		const float tw = v[0] * mvp[3][0] + v[1] * mvp[3][1] + v[2] * mvp[3][2] + mvp[3][3];
+
+		tz = ( tw > idMath::FLT_SMALLEST_NON_DENORMAL ) ? tz / tw : -idMath::INFINITY;
+
+		min = Min( min, tz );
+		max = Max( max, tz );
+	}
+
+#if !defined( CLIP_SPACE_ZERO_TO_ONE )
+	min = min * 0.5f + 0.5f;
+	max = max * 0.5f + 0.5f;
+#endif
+	min = Max( min, 0.0f );
+	max = Min( max, 1.0f );
+}
+
+/*
+============
+TestRenderMatrix
+
+The idRenderMatrix culling and projection functions don't go through the
+idSIMDProcessor, the compiled implementation is checked against a straight C
+reference instead. The results are clamped to window space so a small absolute
+epsilon covers the reciprocal estimates.
+============
+*/
+void TestRenderMatrix() {
+	int i, j;
+	TIME_TYPE start, end, bestClocksRef, bestClocksSIMD;
+	idTempArray< idBounds > bounds( COUNT );
+	idTempArray< idBounds > projected1( COUNT );
+	idTempArray< idBounds > projected2( COUNT );
+	idTempArray< byte > bits1( COUNT );
+	idTempArray< byte > bits2( COUNT );
+	idTempArray< float > depth1( COUNT * 2 );
+	idTempArray< float > depth2( COUNT * 2 );
+	const char *result;
+
+	idRandom srnd( RANDOM_SEED );
+
+	idRenderMatrix viewMatrix;
+	idRenderMatrix projectionMatrix;
+	idRenderMatrix mvp;
+	idRenderMatrix::CreateViewMatrix( vec3_origin, mat3_identity, viewMatrix );
+	idRenderMatrix::CreateProjectionMatrixFov( 90.0f, 73.74f, 4.0f, 0.0f, 0.0f, 0.0f, projectionMatrix );
+	idRenderMatrix::Multiply( projectionMatrix, viewMatrix, mvp );
+
+	// a mix of bounds in front of, behind and straddling the near plane
+	for ( i = 0; i < COUNT; i++ ) {
+		idVec3 center;
+		center[0] = srnd.CRandomFloat() * 1024.0f;
+		center[1] = srnd.CRandomFloat() * 1024.0f;
+		center[2] = srnd.CRandomFloat() * 1024.0f;
+		idVec3 extents;
+		extents[0] = 1.0f + srnd.RandomFloat() * 64.0f;
+		extents[1] = 1.0f + srnd.RandomFloat() * 64.0f;
+		extents[2] = 1.0f + srnd.RandomFloat() * 64.0f;
+		bounds[i][0] = center - extents;
+		bounds[i][1] = center + extents;
+	}
+
+	idLib::Printf("====================================\n" );
+
+	bestClocksRef = 0;
+	for ( i = 0; i < NUMTESTS; i++ ) {
+		StartRecordTime( start );
+		for ( j = 0; j < COUNT; j++ ) {
+			RefCullBoundsToMVPbits( mvp, bounds[j], &bits1[j] );
+		}
+		StopRecordTime( end );
+		GetBest( start, end, bestClocksRef );
+	}
+	PrintClocks( "    ref->CullBoundsToMVPbits()", COUNT, bestClocksRef );
+
+	bestClocksSIMD = 0;
+	for ( i = 0; i < NUMTESTS; i++ ) {
+		StartRecordTime( start );
+		for ( j = 0; j < COUNT; j++ ) {
+			idRenderMatrix::CullBoundsToMVPbits( mvp, bounds[j], &bits2[j] );
+		}
+		StopRecordTime( end );
+		GetBest( start, end, bestClocksSIMD );
+	}
+
+	for ( i = 0; i < COUNT; i++ ) {
+		if ( bits1[i] != bits2[i] ) {
+			break;
+		}
+	}
+	result = TestResult( i >= COUNT );
+	PrintClocks( va( "   simd->CullBoundsToMVPbits() %s", result ), COUNT, bestClocksSIMD, bestClocksRef );
+
+	bestClocksRef = 0;
+	for ( i = 0; i < NUMTESTS; i++ ) {
+		StartRecordTime( start );
+		for ( j = 0; j < COUNT; j++ ) {
+			RefProjectedBounds( projected1[j], mvp, bounds[j] );
+		}
+		StopRecordTime( end );
+		GetBest( start, end, bestClocksRef );
+	}
+	PrintClocks( "    ref->ProjectedBounds()", COUNT, bestClocksRef );
+
+	bestClocksSIMD = 0;
+	for ( i = 0; i < NUMTESTS; i++ ) {
+		StartRecordTime( start );
+		for ( j = 0; j < COUNT; j++ ) {
+			idRenderMatrix::ProjectedBounds( projected2[j], mvp, bounds[j], true );
+		}
+		StopRecordTime( end );
+		GetBest( start, end, bestClocksSIMD );
+	}
+
+	for ( i = 0; i < COUNT; i++ ) {
+		if ( !projected1[i][0].Compare( projected2[i][0], 1e-3f ) || !projected1[i][1].Compare( projected2[i][1], 1e-3f ) ) {
+			break;
+		}
+	}
+	result = TestResult( i >= COUNT );
+	PrintClocks( va( "   simd->ProjectedBounds() %s", result ), COUNT, bestClocksSIMD, bestClocksRef );
+
+	bestClocksRef = 0;
+	for ( i = 0; i < NUMTESTS; i++ ) {
+		StartRecordTime( start );
+		for ( j = 0; j < COUNT; j++ ) {
+			RefDepthBoundsForBounds( depth1[j*2+0], depth1[j*2+1], mvp, bounds[j] );
+		}
+		StopRecordTime( end );
+		GetBest( start, end, bestClocksRef );
+	}
+	PrintClocks( "    ref->DepthBoundsForBounds()", COUNT, bestClocksRef );
+
+	bestClocksSIMD = 0;
+	for ( i = 0; i < NUMTESTS; i++ ) {
+		StartRecordTime( start );
+		for ( j = 0; j < COUNT; j++ ) {
+			idRenderMatrix::DepthBoundsForBounds( depth2[j*2+0], depth2[j*2+1], mvp, bounds[j], true );
+		}
+		StopRecordTime( end );
+		GetBest( start, end, bestClocksSIMD );
+	}
+
+	for ( i = 0; i < COUNT * 2; i++ ) {
+		if ( idMath::Fabs( depth1[i] - depth2[i] ) > 1e-3f ) {
+			break;
+		}
+	}
+	result = TestResult( i >= COUNT * 2 );
+	PrintClocks( va( "   simd->DepthBoundsForBounds() %s", result ), COUNT, bestClocksSIMD, bestClocksRef );
+}
+
 /*
 ============
 TestMath
@@ -1211,36 +1476,37 @@ void TestMath() {
 
 /*
 ============
-idSIMD::Test_f
+CreateTestProcessor
+
+Returns NULL if the CPU or the compiler doesn't support the requested implementation.
 ============
 */
-void idSIMD::Test_f( const idCmdArgs &args ) {
-
-	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL );
-
-	p_simd = processor;
-	p_generic = generic;
-
-	if ( idStr::Length( args.Argv( 1 ) ) != 0 ) {
-		cpuid_t cpuid = idLib::sys->GetProcessorId();
-		idStr argString = args.Args();
+static idSIMDProcessor * CreateTestProcessor( const char *name ) {
+	cpuid_t cpuid = idLib::sys->GetProcessorId();
 
-		argString.Replace( " ", "" );
-
-		if ( idStr::Icmp( argString, "SSE" ) == 0 ) {
-			if ( !( cpuid & CPUID_MMX ) || !( cpuid & CPUID_SSE ) ) {
-				idLib::Printf( "CPU does not support MMX & SSE\n" );
-				return;
-			}
-			p_simd = new (TAG_MATH) idSIMD_SSE;
-		} else {
-			idLib::Printf( "invalid argument, use: MMX, 3DNow, SSE, SSE2, SSE3, AltiVec\n" );
-			return;
+	if ( idStr::Icmp( name, "SSE" ) == 0 ) {
+		if ( !( cpuid & CPUID_MMX ) || !( cpuid & CPUID_SSE ) ) {
+			idLib::Printf( "CPU does not support MMX & SSE\n" );
+			return NULL;
+		}
+		return new (TAG_MATH) idSIMD_SSE;
+	} else if ( idStr::Icmp( name, "AVX2" ) == 0 ) {
+		if ( !( cpuid & CPUID_AVX2 ) ) {
+			idLib::Printf( "CPU does not support AVX2 & FMA3\n" );
+			return NULL;
 		}
+		return new (TAG_MATH) idSIMD_AVX2;
 	}
+	idLib::Printf( "invalid argument, use: SSE, AVX2, all\n" );
+	return NULL;
+}
 
-	idLib::common->SetRefreshOnPrint( true );
-
+/*
+============
+RunTests
+============
+*/
+static void RunTests() {
 	idLib::Printf( "using %s for SIMD processing\n", p_simd->GetName() );
 
 	GetBaseClocks();
@@ -1259,15 +1525,94 @@ void idSIMD::Test_f( const idCmdArgs &args ) {
 	TestTransformJoints();
 	TestUntransformJoints();
 
+	TestRenderMatrix();
+
 	idLib::Printf("====================================\n" );
+}
 
-	idLib::common->SetRefreshOnPrint( false );
+/*
+============
+idSIMD::Test
+
+Without a processor name the active implementation is compared against the generic
+one. "all" runs every implementation the CPU supports on the same inputs. Used by
+the testSIMD console command and the standalone SIMD test executable.
+============
+*/
+int idSIMD::Test( const char *processorName ) {
+	static const struct {
+		const char *	name;
+		int				cpuid;
+	} testProcessors[] = {
+		{ "SSE",	CPUID_SSE },
+		{ "AVX2",	CPUID_AVX2 }
+	};
+
+	idStr argString = processorName;
+	argString.Replace( " ", "" );
+
+	idStaticList< idSIMDProcessor *, ARRAY_COUNT( testProcessors ) > processors;
+
+	if ( argString.Length() == 0 ) {
+		processors.Append( processor );
+	} else if ( argString.Icmp( "all" ) == 0 ) {
+		cpuid_t cpuid = idLib::sys->GetProcessorId();
+		for ( int i = 0; i < ARRAY_COUNT( testProcessors ); i++ ) {
+			// skip the unsupported implementations quietly
+			if ( !( cpuid & testProcessors[i].cpuid ) ) {
+				continue;
+			}
+			idSIMDProcessor * p = CreateTestProcessor( testProcessors[i].name );
+			if ( p != NULL ) {
+				processors.Append( p );
+			}
+		}
+	} else {
+		idSIMDProcessor * p = CreateTestProcessor( argString );
+		if ( p == NULL ) {
+			return -1;
+		}
+		processors.Append( p );
+	}
+
+	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL );
+
+	p_generic = generic;
 
-	if ( p_simd != processor ) {
-		delete p_simd;
+	int totalFailedTests = 0;
+	for ( int i = 0; i < processors.Num(); i++ ) {
+		p_simd = processors[i];
+		numFailedTests = 0;
+		RunTests();
+		idLib::Printf( "%s: %s\n", p_simd->GetName(), ( numFailedTests == 0 ) ? "all tests passed" : va( S_COLOR_RED"%d tests failed", numFailedTests ) );
+		totalFailedTests += numFailedTests;
+		if ( p_simd != processor ) {
+			delete p_simd;
+		}
 	}
+
 	p_simd = NULL;
 	p_generic = NULL;
 
 	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_NORMAL );
+
+	return totalFailedTests;
+}
+
+/*
+============
+idSIMD::Test_f
+
+testSIMD [SSE|AVX2|all]
+============
+*/
+void idSIMD::Test_f( const idCmdArgs &args ) {
+	idLib::common->SetRefreshOnPrint( true );
+
+	const int failedTests = Test( args.Args() );
+	if ( failedTests > 0 ) {
+		idLib::Warning( "testSIMD: %d tests failed", failedTests );
+	}
+
+	idLib::common->SetRefreshOnPrint( false );
 }
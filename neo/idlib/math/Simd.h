@@ -45,6 +45,7 @@ public:
 	static void			Init();
 	static void			InitProcessor( const char *module, bool forceGeneric );
 	static void			Shutdown();
+	static int			Test( const char *processorName );	// returns the number of failed tests, -1 for an invalid processor
 	static void			Test_f( const class idCmdArgs &args );
 };
 
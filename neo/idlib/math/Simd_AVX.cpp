@@ -0,0 +1,798 @@
+/*
+===========================================================================
+
+Doom 3 BFG Edition GPL Source Code
+Copyright (C) 1993-2012 id Software LLC, a ZeniMax Media company. 
+Copyright (C) 2016-2017 Dustin Land
+
+This file is part of the Doom 3 BFG Edition GPL Source Code ("Doom 3 BFG Edition Source Code").  
+
+Doom 3 BFG Edition Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 BFG Edition Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 BFG Edition Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 BFG Edition Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 BFG Edition Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#pragma hdrstop
+#include "../precompiled.h"
+#include "Simd_Generic.h"
+#include "Simd_SSE.h"
+#include "Simd_AVX.h"
+
+//===============================================================
+//
+//	AVX2 & FMA3 implementation of idSIMDProcessor
+//
+//	This file is compiled without /arch:AVX2 so none of the inline
+//	functions instantiated here can leak VEX encoded code into the
+//	rest of the executable. The intrinsics below are always available
+//	to the compiler, and every function that touches the upper half of
+//	the YMM registers clears it with _mm256_zeroupper() before it
+//	returns to avoid the AVX <-> SSE transition penalty.
+//
+//===============================================================
+
+#include <immintrin.h>
+
+#define M_PI	3.14159265358979323846f
+
+#define _mm256_madd_ps( a, b, c )			_mm256_fmadd_ps( (a), (b), (c) )
+#define _mm256_nmsub_ps( a, b, c )			_mm256_fnmadd_ps( (a), (b), (c) )
+#define _mm256_splat_ps( x, i )				_mm256_permute_ps( (x), _MM_SHUFFLE( i, i, i, i ) )
+
+// copies larger than this bypass the cache with non-temporal stores
+static const int MEMCPY_STREAM_THRESHOLD	= 256 * 1024;
+
+/*
+============
+_mm256_loadpair_ps
+
+Loads two 16-byte aligned 4-float vectors into the low and high lane of a YMM register.
+============
+*/
+ID_FORCE_INLINE __m256 _mm256_loadpair_ps( const float * lo, const float * hi ) {
+	return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_load_ps( lo ) ), _mm_load_ps( hi ), 1 );
+}
+
+/*
+============
+_mm256_storepair_ps
+============
+*/
+ID_FORCE_INLINE void _mm256_storepair_ps( float * lo, float * hi, const __m256 & v ) {
+	_mm_store_ps( lo, _mm256_castps256_ps128( v ) );
+	_mm_store_ps( hi, _mm256_extractf128_ps( v, 1 ) );
+}
+
+/*
+============
+idSIMD_AVX2::GetName
+============
+*/
+const char * idSIMD_AVX2::GetName() const {
+	return "MMX & SSE & AVX2 & FMA3";
+}
+
+/*
+============
+idSIMD_AVX2::MinMax
+
+Two vertices are processed per YMM register. Loading 16 bytes from the vertex
+position also reads the packed texture coordinates, that lane is
+never used.
+============
+*/
+void VPCALL idSIMD_AVX2::MinMax( idVec3 &min, idVec3 &max, const idDrawVert *src, const int count ) {
+	assert_offsetof( idDrawVert, xyz, 0 );
+
+	__m256 vmin0 = _mm256_set1_ps( idMath::INFINITY );
+	__m256 vmax0 = _mm256_set1_ps( -idMath::INFINITY );
+	__m256 vmin1 = vmin0;
+	__m256 vmax1 = vmax0;
+
+	int i = 0;
+	for ( ; i + 3 < count; i += 4 ) {
+		const __m256 v0 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( src[i+0].xyz.ToFloatPtr() ) ), _mm_loadu_ps( src[i+1].xyz.ToFloatPtr() ), 1 );
+		const __m256 v1 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( src[i+2].xyz.ToFloatPtr() ) ), _mm_loadu_ps( src[i+3].xyz.ToFloatPtr() ), 1 );
+		vmin0 = _mm256_min_ps( vmin0, v0 );
+		vmax0 = _mm256_max_ps( vmax0, v0 );
+		vmin1 = _mm256_min_ps( vmin1, v1 );
+		vmax1 = _mm256_max_ps( vmax1, v1 );
+	}
+
+	vmin0 = _mm256_min_ps( vmin0, vmin1 );
+	vmax0 = _mm256_max_ps( vmax0, vmax1 );
+
+	__m128 rmin = _mm_min_ps( _mm256_castps256_ps128( vmin0 ), _mm256_extractf128_ps( vmin0, 1 ) );
+	__m128 rmax = _mm_max_ps( _mm256_castps256_ps128( vmax0 ), _mm256_extractf128_ps( vmax0, 1 ) );
+
+	for ( ; i < count; i++ ) {
+		const __m128 v = _mm_loadu_ps( src[i].xyz.ToFloatPtr() );
+		rmin = _mm_min_ps( rmin, v );
+		rmax = _mm_max_ps( rmax, v );
+	}
+
+	_mm256_zeroupper();
+
+	ALIGN16( float tmin[4] );
+	ALIGN16( float tmax[4] );
+	_mm_store_ps( tmin, rmin );
+	_mm_store_ps( tmax, rmax );
+	min.Set( tmin[0], tmin[1], tmin[2] );
+	max.Set( tmax[0], tmax[1], tmax[2] );
+}
+
+/*
+============
+idSIMD_AVX2::MinMax
+============
+*/
+void VPCALL idSIMD_AVX2::MinMax( idVec3 &min, idVec3 &max, const idDrawVert *src, const triIndex_t *indexes, const int count ) {
+	assert_offsetof( idDrawVert, xyz, 0 );
+
+	__m256 vmin0 = _mm256_set1_ps( idMath::INFINITY );
+	__m256 vmax0 = _mm256_set1_ps( -idMath::INFINITY );
+	__m256 vmin1 = vmin0;
+	__m256 vmax1 = vmax0;
+
+	int i = 0;
+	for ( ; i + 3 < count; i += 4 ) {
+		const __m256 v0 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( src[indexes[i+0]].xyz.ToFloatPtr() ) ), _mm_loadu_ps( src[indexes[i+1]].xyz.ToFloatPtr() ), 1 );
+		const __m256 v1 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( src[indexes[i+2]].xyz.ToFloatPtr() ) ), _mm_loadu_ps( src[indexes[i+3]].xyz.ToFloatPtr() ), 1 );
+		vmin0 = _mm256_min_ps( vmin0, v0 );
+		vmax0 = _mm256_max_ps( vmax0, v0 );
+		vmin1 = _mm256_min_ps( vmin1, v1 );
+		vmax1 = _mm256_max_ps( vmax1, v1 );
+	}
+
+	vmin0 = _mm256_min_ps( vmin0, vmin1 );
+	vmax0 = _mm256_max_ps( vmax0, vmax1 );
+
+	__m128 rmin = _mm_min_ps( _mm256_castps256_ps128( vmin0 ), _mm256_extractf128_ps( vmin0, 1 ) );
+	__m128 rmax = _mm_max_ps( _mm256_castps256_ps128( vmax0 ), _mm256_extractf128_ps( vmax0, 1 ) );
+
+	for ( ; i < count; i++ ) {
+		const __m128 v = _mm_loadu_ps( src[indexes[i]].xyz.ToFloatPtr() );
+		rmin = _mm_min_ps( rmin, v );
+		rmax = _mm_max_ps( rmax, v );
+	}
+
+	_mm256_zeroupper();
+
+	ALIGN16( float tmin[4] );
+	ALIGN16( float tmax[4] );
+	_mm_store_ps( tmin, rmin );
+	_mm_store_ps( tmax, rmax );
+	min.Set( tmin[0], tmin[1], tmin[2] );
+	max.Set( tmax[0], tmax[1], tmax[2] );
+}
+
+/*
+============
+idSIMD_AVX2::Memcpy
+
+Copies 128 bytes per iteration after aligning the destination to 32 bytes.
+Large copies use non-temporal stores so they don't evict the working set.
+============
+*/
+void VPCALL idSIMD_AVX2::Memcpy( void *dst, const void *src, const int count ) {
+	if ( count < 256 ) {
+		memcpy( dst, src, count );
+		return;
+	}
+
+	byte * d = (byte *)dst;
+	const byte * s = (const byte *)src;
+	int n = count;
+
+	const int head = (int)( ( 32 - ( (UINT_PTR)d & 31 ) ) & 31 );
+	if ( head > 0 ) {
+		memcpy( d, s, head );
+		d += head;
+		s += head;
+		n -= head;
+	}
+
+	if ( count >= MEMCPY_STREAM_THRESHOLD ) {
+		for ( ; n >= 128; n -= 128, d += 128, s += 128 ) {
+			_mm_prefetch( (const char *)s + 512, _MM_HINT_NTA );
+			const __m256i a = _mm256_loadu_si256( (const __m256i *)( s +  0 ) );
+			const __m256i b = _mm256_loadu_si256( (const __m256i *)( s + 32 ) );
+			const __m256i c = _mm256_loadu_si256( (const __m256i *)( s + 64 ) );
+			const __m256i e = _mm256_loadu_si256( (const __m256i *)( s + 96 ) );
+			_mm256_stream_si256( (__m256i *)( d +  0 ), a );
+			_mm256_stream_si256( (__m256i *)( d + 32 ), b );
+			_mm256_stream_si256( (__m256i *)( d + 64 ), c );
+			_mm256_stream_si256( (__m256i *)( d + 96 ), e );
+		}
+		_mm_sfence();
+	} else {
+		for ( ; n >= 128; n -= 128, d += 128, s += 128 ) {
+			const __m256i a = _mm256_loadu_si256( (const __m256i *)( s +  0 ) );
+			const __m256i b = _mm256_loadu_si256( (const __m256i *)( s + 32 ) );
+			const __m256i c = _mm256_loadu_si256( (const __m256i *)( s + 64 ) );
+			const __m256i e = _mm256_loadu_si256( (const __m256i *)( s + 96 ) );
+			_mm256_store_si256( (__m256i *)( d +  0 ), a );
+			_mm256_store_si256( (__m256i *)( d + 32 ), b );
+			_mm256_store_si256( (__m256i *)( d + 64 ), c );
+			_mm256_store_si256( (__m256i *)( d + 96 ), e );
+		}
+	}
+
+	for ( ; n >= 32; n -= 32, d += 32, s += 32 ) {
+		_mm256_store_si256( (__m256i *)d, _mm256_loadu_si256( (const __m256i *)s ) );
+	}
+
+	_mm256_zeroupper();
+
+	if ( n > 0 ) {
+		memcpy( d, s, n );
+	}
+}
+
+/*
+============
+idSIMD_AVX2::BlendJoints
+
+Eight joints are blended per iteration. Joints n and n+4 share a YMM register
+so the 4x4 transposes of the SSE version can be used unchanged within each lane.
+============
+*/
+void VPCALL idSIMD_AVX2::BlendJoints( idJointQuat *joints, const idJointQuat *blendJoints, const float lerp, const int *index, const int numJoints ) {
+
+	if ( lerp <= 0.0f ) {
+		return;
+	} else if ( lerp >= 1.0f ) {
+		for ( int i = 0; i < numJoints; i++ ) {
+			int j = index[i];
+			joints[j] = blendJoints[j];
+		}
+		return;
+	}
+
+	const __m256 vlerp = _mm256_set1_ps( lerp );
+
+	const __m256 vector_float_one		= _mm256_set1_ps( 1.0f );
+	const __m256 vector_float_sign_bit	= _mm256_castsi256_ps( _mm256_set1_epi32( 0x80000000 ) );
+	const __m256 vector_float_rsqrt_c0	= _mm256_set1_ps( -3.0f );
+	const __m256 vector_float_rsqrt_c1	= _mm256_set1_ps( -0.5f );
+	const __m256 vector_float_tiny		= _mm256_set1_ps( 1e-10f );
+	const __m256 vector_float_half_pi	= _mm256_set1_ps( M_PI*0.5f );
+
+	const __m256 vector_float_sin_c0	= _mm256_set1_ps( -2.39e-08f );
+	const __m256 vector_float_sin_c1	= _mm256_set1_ps(  2.7526e-06f );
+	const __m256 vector_float_sin_c2	= _mm256_set1_ps( -1.98409e-04f );
+	const __m256 vector_float_sin_c3	= _mm256_set1_ps(  8.3333315e-03f );
+	const __m256 vector_float_sin_c4	= _mm256_set1_ps( -1.666666664e-01f );
+
+	const __m256 vector_float_atan_c0	= _mm256_set1_ps(  0.0028662257f );
+	const __m256 vector_float_atan_c1	= _mm256_set1_ps( -0.0161657367f );
+	const __m256 vector_float_atan_c2	= _mm256_set1_ps(  0.0429096138f );
+	const __m256 vector_float_atan_c3	= _mm256_set1_ps( -0.0752896400f );
+	const __m256 vector_float_atan_c4	= _mm256_set1_ps(  0.1065626393f );
+	const __m256 vector_float_atan_c5	= _mm256_set1_ps( -0.1420889944f );
+	const __m256 vector_float_atan_c6	= _mm256_set1_ps(  0.1999355085f );
+	const __m256 vector_float_atan_c7	= _mm256_set1_ps( -0.3333314528f );
+
+	int i = 0;
+	for ( ; i < numJoints - 7; i += 8 ) {
+		const int n0 = index[i+0];
+		const int n1 = index[i+1];
+		const int n2 = index[i+2];
+		const int n3 = index[i+3];
+		const int n4 = index[i+4];
+		const int n5 = index[i+5];
+		const int n6 = index[i+6];
+		const int n7 = index[i+7];
+
+		__m256 jqa_0 = _mm256_loadpair_ps( joints[n0].q.ToFloatPtr(), joints[n4].q.ToFloatPtr() );
+		__m256 jqb_0 = _mm256_loadpair_ps( joints[n1].q.ToFloatPtr(), joints[n5].q.ToFloatPtr() );
+		__m256 jqc_0 = _mm256_loadpair_ps( joints[n2].q.ToFloatPtr(), joints[n6].q.ToFloatPtr() );
+		__m256 jqd_0 = _mm256_loadpair_ps( joints[n3].q.ToFloatPtr(), joints[n7].q.ToFloatPtr() );
+
+		__m256 jta_0 = _mm256_loadpair_ps( joints[n0].t.ToFloatPtr(), joints[n4].t.ToFloatPtr() );
+		__m256 jtb_0 = _mm256_loadpair_ps( joints[n1].t.ToFloatPtr(), joints[n5].t.ToFloatPtr() );
+		__m256 jtc_0 = _mm256_loadpair_ps( joints[n2].t.ToFloatPtr(), joints[n6].t.ToFloatPtr() );
+		__m256 jtd_0 = _mm256_loadpair_ps( joints[n3].t.ToFloatPtr(), joints[n7].t.ToFloatPtr() );
+
+		__m256 bqa_0 = _mm256_loadpair_ps( blendJoints[n0].q.ToFloatPtr(), blendJoints[n4].q.ToFloatPtr() );
+		__m256 bqb_0 = _mm256_loadpair_ps( blendJoints[n1].q.ToFloatPtr(), blendJoints[n5].q.ToFloatPtr() );
+		__m256 bqc_0 = _mm256_loadpair_ps( blendJoints[n2].q.ToFloatPtr(), blendJoints[n6].q.ToFloatPtr() );
+		__m256 bqd_0 = _mm256_loadpair_ps( blendJoints[n3].q.ToFloatPtr(), blendJoints[n7].q.ToFloatPtr() );
+
+		__m256 bta_0 = _mm256_loadpair_ps( blendJoints[n0].t.ToFloatPtr(), blendJoints[n4].t.ToFloatPtr() );
+		__m256 btb_0 = _mm256_loadpair_ps( blendJoints[n1].t.ToFloatPtr(), blendJoints[n5].t.ToFloatPtr() );
+		__m256 btc_0 = _mm256_loadpair_ps( blendJoints[n2].t.ToFloatPtr(), blendJoints[n6].t.ToFloatPtr() );
+		__m256 btd_0 = _mm256_loadpair_ps( blendJoints[n3].t.ToFloatPtr(), blendJoints[n7].t.ToFloatPtr() );
+
+		bta_0 = _mm256_sub_ps( bta_0, jta_0 );
+		btb_0 = _mm256_sub_ps( btb_0, jtb_0 );
+		btc_0 = _mm256_sub_ps( btc_0, jtc_0 );
+		btd_0 = _mm256_sub_ps( btd_0, jtd_0 );
+
+		jta_0 = _mm256_madd_ps( vlerp, bta_0, jta_0 );
+		jtb_0 = _mm256_madd_ps( vlerp, btb_0, jtb_0 );
+		jtc_0 = _mm256_madd_ps( vlerp, btc_0, jtc_0 );
+		jtd_0 = _mm256_madd_ps( vlerp, btd_0, jtd_0 );
+
+		_mm256_storepair_ps( joints[n0].t.ToFloatPtr(), joints[n4].t.ToFloatPtr(), jta_0 );
+		_mm256_storepair_ps( joints[n1].t.ToFloatPtr(), joints[n5].t.ToFloatPtr(), jtb_0 );
+		_mm256_storepair_ps( joints[n2].t.ToFloatPtr(), joints[n6].t.ToFloatPtr(), jtc_0 );
+		_mm256_storepair_ps( joints[n3].t.ToFloatPtr(), joints[n7].t.ToFloatPtr(), jtd_0 );
+
+		__m256 jqr_0 = _mm256_unpacklo_ps( jqa_0, jqc_0 );
+		__m256 jqs_0 = _mm256_unpackhi_ps( jqa_0, jqc_0 );
+		__m256 jqt_0 = _mm256_unpacklo_ps( jqb_0, jqd_0 );
+		__m256 jqu_0 = _mm256_unpackhi_ps( jqb_0, jqd_0 );
+
+		__m256 bqr_0 = _mm256_unpacklo_ps( bqa_0, bqc_0 );
+		__m256 bqs_0 = _mm256_unpackhi_ps( bqa_0, bqc_0 );
+		__m256 bqt_0 = _mm256_unpacklo_ps( bqb_0, bqd_0 );
+		__m256 bqu_0 = _mm256_unpackhi_ps( bqb_0, bqd_0 );
+
+		__m256 jqx_0 = _mm256_unpacklo_ps( jqr_0, jqt_0 );
+		__m256 jqy_0 = _mm256_unpackhi_ps( jqr_0, jqt_0 );
+		__m256 jqz_0 = _mm256_unpacklo_ps( jqs_0, jqu_0 );
+		__m256 jqw_0 = _mm256_unpackhi_ps( jqs_0, jqu_0 );
+
+		__m256 bqx_0 = _mm256_unpacklo_ps( bqr_0, bqt_0 );
+		__m256 bqy_0 = _mm256_unpackhi_ps( bqr_0, bqt_0 );
+		__m256 bqz_0 = _mm256_unpacklo_ps( bqs_0, bqu_0 );
+		__m256 bqw_0 = _mm256_unpackhi_ps( bqs_0, bqu_0 );
+
+		__m256 cosom_a_0 = _mm256_mul_ps( jqx_0, bqx_0 );
+		cosom_a_0 = _mm256_madd_ps( jqy_0, bqy_0, cosom_a_0 );
+		__m256 cosom_b_0 = _mm256_mul_ps( jqz_0, bqz_0 );
+		cosom_b_0 = _mm256_madd_ps( jqw_0, bqw_0, cosom_b_0 );
+		__m256 cosomg_0 = _mm256_add_ps( cosom_a_0, cosom_b_0 );
+
+		__m256 sign_0 = _mm256_and_ps( cosomg_0, vector_float_sign_bit );
+		__m256 cosom_0 = _mm256_xor_ps( cosomg_0, sign_0 );
+		__m256 ss_0 = _mm256_nmsub_ps( cosom_0, cosom_0, vector_float_one );
+
+		ss_0 = _mm256_max_ps( ss_0, vector_float_tiny );
+
+		__m256 rs_0 = _mm256_rsqrt_ps( ss_0 );
+		__m256 sq_0 = _mm256_mul_ps( rs_0, rs_0 );
+		__m256 sh_0 = _mm256_mul_ps( rs_0, vector_float_rsqrt_c1 );
+		__m256 sx_0 = _mm256_madd_ps( ss_0, sq_0, vector_float_rsqrt_c0 );
+		__m256 sinom_0 = _mm256_mul_ps( sh_0, sx_0 );						// sinom = sqrt( ss );
+
+		ss_0 = _mm256_mul_ps( ss_0, sinom_0 );
+
+		__m256 min_0 = _mm256_min_ps( ss_0, cosom_0 );
+		__m256 max_0 = _mm256_max_ps( ss_0, cosom_0 );
+		__m256 mask_0 = _mm256_cmp_ps( min_0, cosom_0, _CMP_EQ_OQ );
+		__m256 masksign_0 = _mm256_and_ps( mask_0, vector_float_sign_bit );
+		__m256 maskPI_0 = _mm256_and_ps( mask_0, vector_float_half_pi );
+
+		__m256 rcpa_0 = _mm256_rcp_ps( max_0 );
+		__m256 rcpb_0 = _mm256_mul_ps( max_0, rcpa_0 );
+		__m256 rcpd_0 = _mm256_add_ps( rcpa_0, rcpa_0 );
+		__m256 rcp_0 = _mm256_nmsub_ps( rcpb_0, rcpa_0, rcpd_0 );			// 1 / y or 1 / x
+		__m256 ata_0 = _mm256_mul_ps( min_0, rcp_0 );						// x / y or y / x
+
+		__m256 atb_0 = _mm256_xor_ps( ata_0, masksign_0 );					// -x / y or y / x
+		__m256 atc_0 = _mm256_mul_ps( atb_0, atb_0 );
+		__m256 atd_0 = _mm256_madd_ps( atc_0, vector_float_atan_c0, vector_float_atan_c1 );
+
+		atd_0 = _mm256_madd_ps( atd_0, atc_0, vector_float_atan_c2 );
+		atd_0 = _mm256_madd_ps( atd_0, atc_0, vector_float_atan_c3 );
+		atd_0 = _mm256_madd_ps( atd_0, atc_0, vector_float_atan_c4 );
+		atd_0 = _mm256_madd_ps( atd_0, atc_0, vector_float_atan_c5 );
+		atd_0 = _mm256_madd_ps( atd_0, atc_0, vector_float_atan_c6 );
+		atd_0 = _mm256_madd_ps( atd_0, atc_0, vector_float_atan_c7 );
+		atd_0 = _mm256_madd_ps( atd_0, atc_0, vector_float_one );
+
+		__m256 omega_a_0 = _mm256_madd_ps( atd_0, atb_0, maskPI_0 );
+		__m256 omega_b_0 = _mm256_mul_ps( vlerp, omega_a_0 );
+		omega_a_0 = _mm256_sub_ps( omega_a_0, omega_b_0 );
+
+		__m256 sinsa_0 = _mm256_mul_ps( omega_a_0, omega_a_0 );
+		__m256 sinsb_0 = _mm256_mul_ps( omega_b_0, omega_b_0 );
+		__m256 sina_0 = _mm256_madd_ps( sinsa_0, vector_float_sin_c0, vector_float_sin_c1 );
+		__m256 sinb_0 = _mm256_madd_ps( sinsb_0, vector_float_sin_c0, vector_float_sin_c1 );
+		sina_0 = _mm256_madd_ps( sina_0, sinsa_0, vector_float_sin_c2 );
+		sinb_0 = _mm256_madd_ps( sinb_0, sinsb_0, vector_float_sin_c2 );
+		sina_0 = _mm256_madd_ps( sina_0, sinsa_0, vector_float_sin_c3 );
+		sinb_0 = _mm256_madd_ps( sinb_0, sinsb_0, vector_float_sin_c3 );
+		sina_0 = _mm256_madd_ps( sina_0, sinsa_0, vector_float_sin_c4 );
+		sinb_0 = _mm256_madd_ps( sinb_0, sinsb_0, vector_float_sin_c4 );
+		sina_0 = _mm256_madd_ps( sina_0, sinsa_0, vector_float_one );
+		sinb_0 = _mm256_madd_ps( sinb_0, sinsb_0, vector_float_one );
+		sina_0 = _mm256_mul_ps( sina_0, omega_a_0 );
+		sinb_0 = _mm256_mul_ps( sinb_0, omega_b_0 );
+		__m256 scalea_0 = _mm256_mul_ps( sina_0, sinom_0 );
+		__m256 scaleb_0 = _mm256_mul_ps( sinb_0, sinom_0 );
+
+		scaleb_0 = _mm256_xor_ps( scaleb_0, sign_0 );
+
+		jqx_0 = _mm256_mul_ps( jqx_0, scalea_0 );
+		jqy_0 = _mm256_mul_ps( jqy_0, scalea_0 );
+		jqz_0 = _mm256_mul_ps( jqz_0, scalea_0 );
+		jqw_0 = _mm256_mul_ps( jqw_0, scalea_0 );
+
+		jqx_0 = _mm256_madd_ps( bqx_0, scaleb_0, jqx_0 );
+		jqy_0 = _mm256_madd_ps( bqy_0, scaleb_0, jqy_0 );
+		jqz_0 = _mm256_madd_ps( bqz_0, scaleb_0, jqz_0 );
+		jqw_0 = _mm256_madd_ps( bqw_0, scaleb_0, jqw_0 );
+
+		__m256 tp0_0 = _mm256_unpacklo_ps( jqx_0, jqz_0 );
+		__m256 tp1_0 = _mm256_unpackhi_ps( jqx_0, jqz_0 );
+		__m256 tp2_0 = _mm256_unpacklo_ps( jqy_0, jqw_0 );
+		__m256 tp3_0 = _mm256_unpackhi_ps( jqy_0, jqw_0 );
+
+		__m256 p0_0 = _mm256_unpacklo_ps( tp0_0, tp2_0 );
+		__m256 p1_0 = _mm256_unpackhi_ps( tp0_0, tp2_0 );
+		__m256 p2_0 = _mm256_unpacklo_ps( tp1_0, tp3_0 );
+		__m256 p3_0 = _mm256_unpackhi_ps( tp1_0, tp3_0 );
+
+		_mm256_storepair_ps( joints[n0].q.ToFloatPtr(), joints[n4].q.ToFloatPtr(), p0_0 );
+		_mm256_storepair_ps( joints[n1].q.ToFloatPtr(), joints[n5].q.ToFloatPtr(), p1_0 );
+		_mm256_storepair_ps( joints[n2].q.ToFloatPtr(), joints[n6].q.ToFloatPtr(), p2_0 );
+		_mm256_storepair_ps( joints[n3].q.ToFloatPtr(), joints[n7].q.ToFloatPtr(), p3_0 );
+	}
+
+	_mm256_zeroupper();
+
+	if ( i < numJoints ) {
+		idSIMD_SSE::BlendJoints( joints, blendJoints, lerp, index + i, numJoints - i );
+	}
+}
+
+/*
+============
+idSIMD_AVX2::BlendJointsFast
+============
+*/
+void VPCALL idSIMD_AVX2::BlendJointsFast( idJointQuat *joints, const idJointQuat *blendJoints, const float lerp, const int *index, const int numJoints ) {
+	assert_16_byte_aligned( joints );
+	assert_16_byte_aligned( blendJoints );
+	assert_16_byte_aligned( JOINTQUAT_Q_OFFSET );
+	assert_16_byte_aligned( JOINTQUAT_T_OFFSET );
+	assert_sizeof_16_byte_multiple( idJointQuat );
+
+	if ( lerp <= 0.0f ) {
+		return;
+	} else if ( lerp >= 1.0f ) {
+		for ( int i = 0; i < numJoints; i++ ) {
+			int j = index[i];
+			joints[j] = blendJoints[j];
+		}
+		return;
+	}
+
+	const __m256 vector_float_sign_bit	= _mm256_castsi256_ps( _mm256_set1_epi32( 0x80000000 ) );
+	const __m256 vector_float_rsqrt_c0	= _mm256_set1_ps( -3.0f );
+	const __m256 vector_float_rsqrt_c1	= _mm256_set1_ps( -0.5f );
+
+	const float scaledLerp = lerp / ( 1.0f - lerp );
+	const __m256 vlerp = _mm256_set1_ps( lerp );
+	const __m256 vscaledLerp = _mm256_set1_ps( scaledLerp );
+
+	int i = 0;
+	for ( ; i < numJoints - 7; i += 8 ) {
+		const int n0 = index[i+0];
+		const int n1 = index[i+1];
+		const int n2 = index[i+2];
+		const int n3 = index[i+3];
+		const int n4 = index[i+4];
+		const int n5 = index[i+5];
+		const int n6 = index[i+6];
+		const int n7 = index[i+7];
+
+		__m256 jqa_0 = _mm256_loadpair_ps( joints[n0].q.ToFloatPtr(), joints[n4].q.ToFloatPtr() );
+		__m256 jqb_0 = _mm256_loadpair_ps( joints[n1].q.ToFloatPtr(), joints[n5].q.ToFloatPtr() );
+		__m256 jqc_0 = _mm256_loadpair_ps( joints[n2].q.ToFloatPtr(), joints[n6].q.ToFloatPtr() );
+		__m256 jqd_0 = _mm256_loadpair_ps( joints[n3].q.ToFloatPtr(), joints[n7].q.ToFloatPtr() );
+
+		__m256 jta_0 = _mm256_loadpair_ps( joints[n0].t.ToFloatPtr(), joints[n4].t.ToFloatPtr() );
+		__m256 jtb_0 = _mm256_loadpair_ps( joints[n1].t.ToFloatPtr(), joints[n5].t.ToFloatPtr() );
+		__m256 jtc_0 = _mm256_loadpair_ps( joints[n2].t.ToFloatPtr(), joints[n6].t.ToFloatPtr() );
+		__m256 jtd_0 = _mm256_loadpair_ps( joints[n3].t.ToFloatPtr(), joints[n7].t.ToFloatPtr() );
+
+		__m256 bqa_0 = _mm256_loadpair_ps( blendJoints[n0].q.ToFloatPtr(), blendJoints[n4].q.ToFloatPtr() );
+		__m256 bqb_0 = _mm256_loadpair_ps( blendJoints[n1].q.ToFloatPtr(), blendJoints[n5].q.ToFloatPtr() );
+		__m256 bqc_0 = _mm256_loadpair_ps( blendJoints[n2].q.ToFloatPtr(), blendJoints[n6].q.ToFloatPtr() );
+		__m256 bqd_0 = _mm256_loadpair_ps( blendJoints[n3].q.ToFloatPtr(), blendJoints[n7].q.ToFloatPtr() );
+
+		__m256 bta_0 = _mm256_loadpair_ps( blendJoints[n0].t.ToFloatPtr(), blendJoints[n4].t.ToFloatPtr() );
+		__m256 btb_0 = _mm256_loadpair_ps( blendJoints[n1].t.ToFloatPtr(), blendJoints[n5].t.ToFloatPtr() );
+		__m256 btc_0 = _mm256_loadpair_ps( blendJoints[n2].t.ToFloatPtr(), blendJoints[n6].t.ToFloatPtr() );
+		__m256 btd_0 = _mm256_loadpair_ps( blendJoints[n3].t.ToFloatPtr(), blendJoints[n7].t.ToFloatPtr() );
+
+		bta_0 = _mm256_sub_ps( bta_0, jta_0 );
+		btb_0 = _mm256_sub_ps( btb_0, jtb_0 );
+		btc_0 = _mm256_sub_ps( btc_0, jtc_0 );
+		btd_0 = _mm256_sub_ps( btd_0, jtd_0 );
+
+		jta_0 = _mm256_madd_ps( vlerp, bta_0, jta_0 );
+		jtb_0 = _mm256_madd_ps( vlerp, btb_0, jtb_0 );
+		jtc_0 = _mm256_madd_ps( vlerp, btc_0, jtc_0 );
+		jtd_0 = _mm256_madd_ps( vlerp, btd_0, jtd_0 );
+
+		_mm256_storepair_ps( joints[n0].t.ToFloatPtr(), joints[n4].t.ToFloatPtr(), jta_0 );
+		_mm256_storepair_ps( joints[n1].t.ToFloatPtr(), joints[n5].t.ToFloatPtr(), jtb_0 );
+		_mm256_storepair_ps( joints[n2].t.ToFloatPtr(), joints[n6].t.ToFloatPtr(), jtc_0 );
+		_mm256_storepair_ps( joints[n3].t.ToFloatPtr(), joints[n7].t.ToFloatPtr(), jtd_0 );
+
+		__m256 jqr_0 = _mm256_unpacklo_ps( jqa_0, jqc_0 );
+		__m256 jqs_0 = _mm256_unpackhi_ps( jqa_0, jqc_0 );
+		__m256 jqt_0 = _mm256_unpacklo_ps( jqb_0, jqd_0 );
+		__m256 jqu_0 = _mm256_unpackhi_ps( jqb_0, jqd_0 );
+
+		__m256 bqr_0 = _mm256_unpacklo_ps( bqa_0, bqc_0 );
+		__m256 bqs_0 = _mm256_unpackhi_ps( bqa_0, bqc_0 );
+		__m256 bqt_0 = _mm256_unpacklo_ps( bqb_0, bqd_0 );
+		__m256 bqu_0 = _mm256_unpackhi_ps( bqb_0, bqd_0 );
+
+		__m256 jqx_0 = _mm256_unpacklo_ps( jqr_0, jqt_0 );
+		__m256 jqy_0 = _mm256_unpackhi_ps( jqr_0, jqt_0 );
+		__m256 jqz_0 = _mm256_unpacklo_ps( jqs_0, jqu_0 );
+		__m256 jqw_0 = _mm256_unpackhi_ps( jqs_0, jqu_0 );
+
+		__m256 bqx_0 = _mm256_unpacklo_ps( bqr_0, bqt_0 );
+		__m256 bqy_0 = _mm256_unpackhi_ps( bqr_0, bqt_0 );
+		__m256 bqz_0 = _mm256_unpacklo_ps( bqs_0, bqu_0 );
+		__m256 bqw_0 = _mm256_unpackhi_ps( bqs_0, bqu_0 );
+
+		__m256 cosom_a_0 = _mm256_mul_ps( jqx_0, bqx_0 );
+		cosom_a_0 = _mm256_madd_ps( jqy_0, bqy_0, cosom_a_0 );
+		__m256 cosom_b_0 = _mm256_mul_ps( jqz_0, bqz_0 );
+		cosom_b_0 = _mm256_madd_ps( jqw_0, bqw_0, cosom_b_0 );
+		__m256 cosom_0 = _mm256_add_ps( cosom_a_0, cosom_b_0 );
+
+		__m256 sign_0 = _mm256_and_ps( cosom_0, vector_float_sign_bit );
+
+		__m256 scale_0 = _mm256_xor_ps( vscaledLerp, sign_0 );
+
+		jqx_0 = _mm256_madd_ps( scale_0, bqx_0, jqx_0 );
+		jqy_0 = _mm256_madd_ps( scale_0, bqy_0, jqy_0 );
+		jqz_0 = _mm256_madd_ps( scale_0, bqz_0, jqz_0 );
+		jqw_0 = _mm256_madd_ps( scale_0, bqw_0, jqw_0 );
+
+		__m256 da_0 = _mm256_mul_ps( jqx_0, jqx_0 );
+		da_0 = _mm256_madd_ps( jqy_0, jqy_0, da_0 );
+		__m256 db_0 = _mm256_mul_ps( jqz_0, jqz_0 );
+		db_0 = _mm256_madd_ps( jqw_0, jqw_0, db_0 );
+		__m256 d_0 = _mm256_add_ps( da_0, db_0 );
+
+		__m256 rs_0 = _mm256_rsqrt_ps( d_0 );
+		__m256 sq_0 = _mm256_mul_ps( rs_0, rs_0 );
+		__m256 sh_0 = _mm256_mul_ps( rs_0, vector_float_rsqrt_c1 );
+		__m256 sx_0 = _mm256_madd_ps( d_0, sq_0, vector_float_rsqrt_c0 );
+		__m256 s_0 = _mm256_mul_ps( sh_0, sx_0 );
+
+		jqx_0 = _mm256_mul_ps( jqx_0, s_0 );
+		jqy_0 = _mm256_mul_ps( jqy_0, s_0 );
+		jqz_0 = _mm256_mul_ps( jqz_0, s_0 );
+		jqw_0 = _mm256_mul_ps( jqw_0, s_0 );
+
+		__m256 tp0_0 = _mm256_unpacklo_ps( jqx_0, jqz_0 );
+		__m256 tp1_0 = _mm256_unpackhi_ps( jqx_0, jqz_0 );
+		__m256 tp2_0 = _mm256_unpacklo_ps( jqy_0, jqw_0 );
+		__m256 tp3_0 = _mm256_unpackhi_ps( jqy_0, jqw_0 );
+
+		__m256 p0_0 = _mm256_unpacklo_ps( tp0_0, tp2_0 );
+		__m256 p1_0 = _mm256_unpackhi_ps( tp0_0, tp2_0 );
+		__m256 p2_0 = _mm256_unpacklo_ps( tp1_0, tp3_0 );
+		__m256 p3_0 = _mm256_unpackhi_ps( tp1_0, tp3_0 );
+
+		_mm256_storepair_ps( joints[n0].q.ToFloatPtr(), joints[n4].q.ToFloatPtr(), p0_0 );
+		_mm256_storepair_ps( joints[n1].q.ToFloatPtr(), joints[n5].q.ToFloatPtr(), p1_0 );
+		_mm256_storepair_ps( joints[n2].q.ToFloatPtr(), joints[n6].q.ToFloatPtr(), p2_0 );
+		_mm256_storepair_ps( joints[n3].q.ToFloatPtr(), joints[n7].q.ToFloatPtr(), p3_0 );
+	}
+
+	_mm256_zeroupper();
+
+	if ( i < numJoints ) {
+		idSIMD_SSE::BlendJointsFast( joints, blendJoints, lerp, index + i, numJoints - i );
+	}
+}
+
+/*
+============
+idSIMD_AVX2::ConvertJointQuatsToJointMats
+
+Each 128-bit lane of a YMM register holds one joint so the in-lane shuffles of
+the SSE version carry over directly. Two consecutive joint matrices are 96
+contiguous bytes which are written with three unaligned 32-byte stores.
+============
+*/
+void VPCALL idSIMD_AVX2::ConvertJointQuatsToJointMats( idJointMat *jointMats, const idJointQuat *jointQuats, const int numJoints ) {
+	assert( sizeof( idJointQuat ) == JOINTQUAT_SIZE );
+	assert( sizeof( idJointMat ) == JOINTMAT_SIZE );
+	assert( (int)(&((idJointQuat *)0)->t) == (int)(&((idJointQuat *)0)->q) + (int)sizeof( ((idJointQuat *)0)->q ) );
+
+	const float * jointQuatPtr = (float *)jointQuats;
+	float * jointMatPtr = (float *)jointMats;
+
+	const __m256 vector_float_first_sign_bit		= _mm256_castsi256_ps( _mm256_setr_epi32( 0x80000000, 0x00000000, 0x00000000, 0x00000000, 0x80000000, 0x00000000, 0x00000000, 0x00000000 ) );
+	const __m256 vector_float_last_three_sign_bits	= _mm256_castsi256_ps( _mm256_setr_epi32( 0x00000000, 0x80000000, 0x80000000, 0x80000000, 0x00000000, 0x80000000, 0x80000000, 0x80000000 ) );
+	const __m256 vector_float_first_pos_half		= _mm256_setr_ps(  0.5f,  0.0f,  0.0f,  0.0f,  0.5f,  0.0f,  0.0f,  0.0f );	// +.5 0 0 0
+	const __m256 vector_float_first_neg_half		= _mm256_setr_ps( -0.5f,  0.0f,  0.0f,  0.0f, -0.5f,  0.0f,  0.0f,  0.0f );	// -.5 0 0 0
+	const __m256 vector_float_quat2mat_mad1			= _mm256_setr_ps( -1.0f, -1.0f, +1.0f, -1.0f, -1.0f, -1.0f, +1.0f, -1.0f );	//  - - + -
+	const __m256 vector_float_quat2mat_mad2			= _mm256_setr_ps( -1.0f, +1.0f, -1.0f, -1.0f, -1.0f, +1.0f, -1.0f, -1.0f );	//  - + - -
+	const __m256 vector_float_quat2mat_mad3			= _mm256_setr_ps( +1.0f, -1.0f, -1.0f, +1.0f, +1.0f, -1.0f, -1.0f, +1.0f );	//  + - - +
+
+	int i = 0;
+	for ( ; i + 1 < numJoints; i += 2 ) {
+
+		__m256 q0 = _mm256_loadpair_ps( &jointQuatPtr[i*8+0*8+0], &jointQuatPtr[i*8+1*8+0] );
+		__m256 t0 = _mm256_loadpair_ps( &jointQuatPtr[i*8+0*8+4], &jointQuatPtr[i*8+1*8+4] );
+
+		__m256 d0 = _mm256_add_ps( q0, q0 );
+
+		__m256 sa0 = _mm256_permute_ps( q0, _MM_SHUFFLE( 1, 0, 0, 1 ) );							//   y,   x,   x,   y
+		__m256 sb0 = _mm256_permute_ps( d0, _MM_SHUFFLE( 2, 2, 1, 1 ) );							//  y2,  y2,  z2,  z2
+		__m256 sc0 = _mm256_permute_ps( q0, _MM_SHUFFLE( 3, 3, 3, 2 ) );							//   z,   w,   w,   w
+		__m256 sd0 = _mm256_permute_ps( d0, _MM_SHUFFLE( 0, 1, 2, 2 ) );							//  z2,  z2,  y2,  x2
+
+		sa0 = _mm256_xor_ps( sa0, vector_float_first_sign_bit );
+		sc0 = _mm256_xor_ps( sc0, vector_float_last_three_sign_bits );							// flip stupid inverse quaternions
+
+		__m256 ma0 = _mm256_madd_ps( sa0, sb0, vector_float_first_pos_half );					//  .5 - yy2,  xy2,  xz2,  yz2		//  .5 0 0 0
+		__m256 mb0 = _mm256_madd_ps( sc0, sd0, vector_float_first_neg_half );					// -.5 + zz2,  wz2,  wy2,  wx2		// -.5 0 0 0
+		__m256 mc0 = _mm256_nmsub_ps( q0, d0, vector_float_first_pos_half );					//  .5 - xx2, -yy2, -zz2, -ww2		//  .5 0 0 0
+
+		__m256 mf0 = _mm256_shuffle_ps( ma0, mc0, _MM_SHUFFLE( 0, 0, 1, 1 ) );					//       xy2,  xy2, .5 - xx2, .5 - xx2	// 01, 01, 10, 10
+		__m256 md0 = _mm256_shuffle_ps( mf0, ma0, _MM_SHUFFLE( 3, 2, 0, 2 ) );					//  .5 - xx2,  xy2,  xz2,  yz2			// 10, 01, 02, 03
+		__m256 me0 = _mm256_shuffle_ps( ma0, mb0, _MM_SHUFFLE( 3, 2, 1, 0 ) );					//  .5 - yy2,  xy2,  wy2,  wx2			// 00, 01, 12, 13
+
+		__m256 ra0 = _mm256_madd_ps( mb0, vector_float_quat2mat_mad1, ma0 );					// 1 - yy2 - zz2, xy2 - wz2, xz2 + wy2,					// - - + -
+		__m256 rb0 = _mm256_madd_ps( mb0, vector_float_quat2mat_mad2, md0 );					// 1 - xx2 - zz2, xy2 + wz2,          , yz2 - wx2		// - + - -
+		__m256 rc0 = _mm256_madd_ps( me0, vector_float_quat2mat_mad3, md0 );					// 1 - xx2 - yy2,          , xz2 - wy2, yz2 + wx2		// + - - +
+
+		__m256 ta0 = _mm256_shuffle_ps( ra0, t0, _MM_SHUFFLE( 0, 0, 2, 2 ) );
+		__m256 tb0 = _mm256_shuffle_ps( rb0, t0, _MM_SHUFFLE( 1, 1, 3, 3 ) );
+		__m256 tc0 = _mm256_shuffle_ps( rc0, t0, _MM_SHUFFLE( 2, 2, 0, 0 ) );
+
+		ra0 = _mm256_shuffle_ps( ra0, ta0, _MM_SHUFFLE( 2, 0, 1, 0 ) );						// 00 01 02 10
+		rb0 = _mm256_shuffle_ps( rb0, tb0, _MM_SHUFFLE( 2, 0, 0, 1 ) );						// 01 00 03 11
+		rc0 = _mm256_shuffle_ps( rc0, tc0, _MM_SHUFFLE( 2, 0, 3, 2 ) );						// 02 03 00 12
+
+		// ( ra0 rb0 ) ( rc0 ra1 ) ( rb1 rc1 )
+		_mm256_storeu_ps( &jointMatPtr[i*12+0*8], _mm256_permute2f128_ps( ra0, rb0, 0x20 ) );
+		_mm256_storeu_ps( &jointMatPtr[i*12+1*8], _mm256_blend_ps( rc0, ra0, 0xF0 ) );
+		_mm256_storeu_ps( &jointMatPtr[i*12+2*8], _mm256_permute2f128_ps( rb0, rc0, 0x31 ) );
+	}
+
+	_mm256_zeroupper();
+
+	if ( i < numJoints ) {
+		idSIMD_SSE::ConvertJointQuatsToJointMats( jointMats + i, jointQuats + i, numJoints - i );
+	}
+}
+
+/*
+============
+idSIMD_AVX2::TransformJoints
+
+The joint hierarchy is a serial dependency chain so this stays 128-bit wide.
+FMA shortens the chain and the VEX permutes keep the broadcasts in the float domain.
+============
+*/
+void VPCALL idSIMD_AVX2::TransformJoints( idJointMat *jointMats, const int *parents, const int firstJoint, const int lastJoint ) {
+	const __m128 vector_float_mask_keep_last	= __m128c( _mm_set_epi32( 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000 ) );
+
+	const float *__restrict firstMatrix = jointMats->ToFloatPtr() + ( firstJoint + firstJoint + firstJoint - 3 ) * 4;
+
+	__m128 pma = _mm_load_ps( firstMatrix + 0 );
+	__m128 pmb = _mm_load_ps( firstMatrix + 4 );
+	__m128 pmc = _mm_load_ps( firstMatrix + 8 );
+
+	for ( int joint = firstJoint; joint <= lastJoint; joint++ ) {
+		const int parent = parents[joint];
+		const float *__restrict parentMatrix = jointMats->ToFloatPtr() + ( parent + parent + parent ) * 4;
+		float *__restrict childMatrix = jointMats->ToFloatPtr() + ( joint + joint + joint ) * 4;
+
+		if ( parent != joint - 1 ) {
+			pma = _mm_load_ps( parentMatrix + 0 );
+			pmb = _mm_load_ps( parentMatrix + 4 );
+			pmc = _mm_load_ps( parentMatrix + 8 );
+		}
+
+		__m128 cma = _mm_load_ps( childMatrix + 0 );
+		__m128 cmb = _mm_load_ps( childMatrix + 4 );
+		__m128 cmc = _mm_load_ps( childMatrix + 8 );
+
+		__m128 ta = _mm_permute_ps( pma, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+		__m128 tb = _mm_permute_ps( pmb, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+		__m128 tc = _mm_permute_ps( pmc, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+
+		__m128 td = _mm_permute_ps( pma, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+		__m128 te = _mm_permute_ps( pmb, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+		__m128 tf = _mm_permute_ps( pmc, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+
+		__m128 tg = _mm_permute_ps( pma, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+		__m128 th = _mm_permute_ps( pmb, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+		__m128 ti = _mm_permute_ps( pmc, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+
+		pma = _mm_fmadd_ps( ta, cma, _mm_and_ps( pma, vector_float_mask_keep_last ) );
+		pmb = _mm_fmadd_ps( tb, cma, _mm_and_ps( pmb, vector_float_mask_keep_last ) );
+		pmc = _mm_fmadd_ps( tc, cma, _mm_and_ps( pmc, vector_float_mask_keep_last ) );
+
+		pma = _mm_fmadd_ps( td, cmb, pma );
+		pmb = _mm_fmadd_ps( te, cmb, pmb );
+		pmc = _mm_fmadd_ps( tf, cmb, pmc );
+
+		pma = _mm_fmadd_ps( tg, cmc, pma );
+		pmb = _mm_fmadd_ps( th, cmc, pmb );
+		pmc = _mm_fmadd_ps( ti, cmc, pmc );
+
+		_mm_store_ps( childMatrix + 0, pma );
+		_mm_store_ps( childMatrix + 4, pmb );
+		_mm_store_ps( childMatrix + 8, pmc );
+	}
+}
+
+/*
+============
+idSIMD_AVX2::UntransformJoints
+============
+*/
+void VPCALL idSIMD_AVX2::UntransformJoints( idJointMat *jointMats, const int *parents, const int firstJoint, const int lastJoint ) {
+	const __m128 vector_float_mask_keep_last	= __m128c( _mm_set_epi32( 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000 ) );
+
+	for ( int joint = lastJoint; joint >= firstJoint; joint-- ) {
+		assert( parents[joint] < joint );
+		const int parent = parents[joint];
+		const float *__restrict parentMatrix = jointMats->ToFloatPtr() + ( parent + parent + parent ) * 4;
+		float *__restrict childMatrix = jointMats->ToFloatPtr() + ( joint + joint + joint ) * 4;
+
+		__m128 pma = _mm_load_ps( parentMatrix + 0 );
+		__m128 pmb = _mm_load_ps( parentMatrix + 4 );
+		__m128 pmc = _mm_load_ps( parentMatrix + 8 );
+
+		__m128 cma = _mm_load_ps( childMatrix + 0 );
+		__m128 cmb = _mm_load_ps( childMatrix + 4 );
+		__m128 cmc = _mm_load_ps( childMatrix + 8 );
+
+		__m128 ta = _mm_permute_ps( pma, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+		__m128 tb = _mm_permute_ps( pma, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+		__m128 tc = _mm_permute_ps( pma, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+
+		__m128 td = _mm_permute_ps( pmb, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+		__m128 te = _mm_permute_ps( pmb, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+		__m128 tf = _mm_permute_ps( pmb, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+
+		__m128 tg = _mm_permute_ps( pmc, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+		__m128 th = _mm_permute_ps( pmc, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+		__m128 ti = _mm_permute_ps( pmc, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+
+		cma = _mm_sub_ps( cma, _mm_and_ps( pma, vector_float_mask_keep_last ) );
+		cmb = _mm_sub_ps( cmb, _mm_and_ps( pmb, vector_float_mask_keep_last ) );
+		cmc = _mm_sub_ps( cmc, _mm_and_ps( pmc, vector_float_mask_keep_last ) );
+
+		pma = _mm_mul_ps( ta, cma );
+		pmb = _mm_mul_ps( tb, cma );
+		pmc = _mm_mul_ps( tc, cma );
+
+		pma = _mm_fmadd_ps( td, cmb, pma );
+		pmb = _mm_fmadd_ps( te, cmb, pmb );
+		pmc = _mm_fmadd_ps( tf, cmb, pmc );
+
+		pma = _mm_fmadd_ps( tg, cmc, pma );
+		pmb = _mm_fmadd_ps( th, cmc, pmb );
+		pmc = _mm_fmadd_ps( ti, cmc, pmc );
+
+		_mm_store_ps( childMatrix + 0, pma );
+		_mm_store_ps( childMatrix + 4, pmb );
+		_mm_store_ps( childMatrix + 8, pmc );
+	}
+}
@@ -104,8 +104,8 @@ public:
 						idVertexBuffer();
 						~idVertexBuffer();
 
-	// Allocate or free the buffer.
-	bool				AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage );
+	// Allocate or free the buffer. 'storage' lets the compute skinning pass bind it as a storage buffer.
+	bool				AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage, bool storage = false );
 	void				FreeBufferObject();
 
 	// Make this buffer a reference to another buffer.
@@ -173,8 +173,8 @@ public:
 						idUniformBuffer();
 						~idUniformBuffer();
 
-	// Allocate or free the buffer.
-	bool				AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage );
+	// Allocate or free the buffer. 'storage' lets the compute skinning pass bind it as a storage buffer.
+	bool				AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage, bool storage = false );
 	void				FreeBufferObject();
 
 	// Make this buffer a reference to another buffer.
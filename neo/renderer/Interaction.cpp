@@ -521,13 +521,10 @@ idInteraction *idInteraction::AllocAndLink( idRenderEntity *edef, idRenderLight
 	}
 
 	// update the interaction table
-	if ( renderWorld->m_interactionTable != NULL ) {
-		int index = ldef->index * renderWorld->m_interactionTableWidth + edef->index;
-		if ( renderWorld->m_interactionTable[index] != NULL ) {
-			idLib::Error( "idInteraction::AllocAndLink: non NULL table entry" );
-		}
-		renderWorld->m_interactionTable[ index ] = interaction;
+	if ( renderWorld->m_interactionTable.Get( ldef->index, edef->index ) != NULL ) {
+		idLib::Error( "idInteraction::AllocAndLink: non NULL table entry" );
 	}
+	renderWorld->m_interactionTable.Set( ldef->index, edef->index, interaction );
 
 	return interaction;
 }
@@ -600,11 +597,11 @@ Removes links and puts it back on the free list.
 void idInteraction::UnlinkAndFree() {
 	// clear the table pointer
 	idRenderWorld *renderWorld = this->lightDef->world;
-	int index = this->lightDef->index * renderWorld->m_interactionTableWidth + this->entityDef->index;
-	if ( renderWorld->m_interactionTable[index] != this && renderWorld->m_interactionTable[index] != INTERACTION_EMPTY ) {
+	const idInteraction * tableEntry = renderWorld->m_interactionTable.Get( this->lightDef->index, this->entityDef->index );
+	if ( tableEntry != this && tableEntry != INTERACTION_EMPTY ) {
 		idLib::Error( "idInteraction::UnlinkAndFree: m_interactionTable wasn't set" );
 	}
-	renderWorld->m_interactionTable[index] = NULL;
+	renderWorld->m_interactionTable.Set( this->lightDef->index, this->entityDef->index, NULL );
 
 	Unlink();
 
@@ -652,9 +649,8 @@ void idInteraction::MakeEmpty() {
 	}
 
 	// store the special marker in the interaction table
-	const int interactionIndex = lightDef->index * entityDef->world->m_interactionTableWidth + entityDef->index;
-	assert( entityDef->world->m_interactionTable[ interactionIndex ] == this );
-	entityDef->world->m_interactionTable[ interactionIndex ] = INTERACTION_EMPTY;
+	assert( entityDef->world->m_interactionTable.Get( lightDef->index, entityDef->index ) == this );
+	entityDef->world->m_interactionTable.Set( lightDef->index, entityDef->index, INTERACTION_EMPTY );
 }
 
 /*
@@ -673,13 +669,31 @@ CreateStaticInteraction
 Called by idRenderWorld::GenerateAllInteractions
 ======================
 */
-const idMaterial *R_RemapShaderBySkin( const idMaterial *shader, const idDeclSkin *customSkin, const idMaterial *customShader );
 void idInteraction::CreateStaticInteraction() {
+	staticInteractionParms_t parms;
+	CreateStaticInteractionGeometry( parms );
+	FinishStaticInteraction( parms );
+}
+
+/*
+======================
+CreateStaticInteractionGeometry
+
+Only changes the interaction itself, the light and entity
+lists and the interaction table are left untouched.
+======================
+*/
+const idMaterial *R_RemapShaderBySkin( const idMaterial *shader, const idDeclSkin *customSkin, const idMaterial *customShader );
+void idInteraction::CreateStaticInteractionGeometry( staticInteractionParms_t & parms ) {
+	parms.interaction = this;
+	parms.lightTris = NULL;
+	parms.shadowTris = NULL;
+	parms.interactionGenerated = false;
+
 	// note that it is a static interaction
 	staticInteraction = true;
 	const idRenderModel *model = entityDef->parms.hModel;
 	if ( model == NULL || model->NumSurfaces() <= 0 || model->IsDynamicModel() != DM_STATIC ) {
-		MakeEmpty();
 		return;
 	}
 
@@ -687,7 +701,6 @@ void idInteraction::CreateStaticInteraction() {
 
 	// if it doesn't contact the light frustum, none of the surfaces will
 	if ( R_CullModelBoundsToLight( lightDef, bounds, entityDef->modelRenderMatrix ) ) {
-		MakeEmpty();
 		return;
 	}
 
@@ -697,7 +710,8 @@ void idInteraction::CreateStaticInteraction() {
 	numSurfaces = model->NumSurfaces();
 	surfaces = (surfaceInteraction_t *)R_ClearedStaticAlloc( sizeof( *surfaces ) * numSurfaces );
 
-	bool interactionGenerated = false;
+	parms.lightTris = (srfTriangles_t **)R_ClearedStaticAlloc( 2 * numSurfaces * sizeof( parms.lightTris[0] ) );
+	parms.shadowTris = parms.lightTris + numSurfaces;
 
 	// check each surface in the model
 	for ( int c = 0 ; c < model->NumSurfaces() ; c++ ) {
@@ -721,19 +735,12 @@ void idInteraction::CreateStaticInteraction() {
 			continue;
 		}
 
-		surfaceInteraction_t *sint = &surfaces[c];
-
 		// generate a set of indexes for the lit surfaces, culling away triangles that are
 		// not at least partially inside the light
 		if ( shader->ReceivesLighting() ) {
-			srfTriangles_t * lightTris = R_CreateInteractionLightTris( entityDef, tri, lightDef, shader );
-			if ( lightTris != NULL ) {
-				// make a static index cache
-				sint->numLightTrisIndexes = lightTris->numIndexes;
-				sint->lightTrisIndexCache = vertexCache.AllocStaticIndex( lightTris->indexes, ALIGN( lightTris->numIndexes * sizeof( lightTris->indexes[0] ), INDEX_CACHE_ALIGN ) );
-
-				interactionGenerated = true;
-				R_FreeStaticTriSurf( lightTris );
+			parms.lightTris[c] = R_CreateInteractionLightTris( entityDef, tri, lightDef, shader );
+			if ( parms.lightTris[c] != NULL ) {
+				parms.interactionGenerated = true;
 			}
 		}
 
@@ -744,13 +751,7 @@ void idInteraction::CreateStaticInteraction() {
 			if ( lightDef->parms.prelightModel == NULL || !model->IsStaticWorldModel() || r_skipPrelightShadows.GetBool() ) {
 				srfTriangles_t * shadowTris = R_CreateInteractionShadowVolume( entityDef, tri, lightDef );
 				if ( shadowTris != NULL ) {
-					// make a static index cache
-					sint->shadowIndexCache = vertexCache.AllocStaticIndex( shadowTris->indexes, ALIGN( shadowTris->numIndexes * sizeof( shadowTris->indexes[0] ), INDEX_CACHE_ALIGN ) );
-					sint->numShadowIndexes = shadowTris->numIndexes;
-#if defined( KEEP_INTERACTION_CPU_DATA )
-					sint->shadowIndexes = shadowTris->indexes;
-					shadowTris->indexes = NULL;
-#endif
+					surfaceInteraction_t *sint = &surfaces[c];
 					if ( shader->Coverage() != MC_OPAQUE ) {
 						// if any surface is a shadow-casting perforated or translucent surface, or the
 						// base surface is suppressed in the view (world weapon shadows) we can't use
@@ -759,15 +760,321 @@ void idInteraction::CreateStaticInteraction() {
 					} else {
 						sint->numShadowIndexesNoCaps = shadowTris->numShadowIndexesNoCaps;
 					}
-					R_FreeStaticTriSurf( shadowTris );
+					parms.shadowTris[c] = shadowTris;
 				}
-				interactionGenerated = true;
+				parms.interactionGenerated = true;
+			}
+		}
+	}
+}
+
+/*
+======================
+FinishStaticInteraction
+
+The index caches are allocated in the same order as when all
+interactions are created serially, so the static index buffer
+has the same layout no matter how many threads were used.
+======================
+*/
+void idInteraction::FinishStaticInteraction( staticInteractionParms_t & parms ) {
+	assert( parms.interaction == this );
+
+	if ( parms.lightTris != NULL ) {
+		for ( int c = 0; c < numSurfaces; c++ ) {
+			surfaceInteraction_t *sint = &surfaces[c];
+
+			srfTriangles_t * lightTris = parms.lightTris[c];
+			if ( lightTris != NULL ) {
+				// make a static index cache
+				sint->numLightTrisIndexes = lightTris->numIndexes;
+				sint->lightTrisIndexCache = vertexCache.AllocStaticIndex( lightTris->indexes, ALIGN( lightTris->numIndexes * sizeof( lightTris->indexes[0] ), INDEX_CACHE_ALIGN ) );
+				R_FreeStaticTriSurf( lightTris );
+			}
+
+			srfTriangles_t * shadowTris = parms.shadowTris[c];
+			if ( shadowTris != NULL ) {
+				// make a static index cache
+				sint->shadowIndexCache = vertexCache.AllocStaticIndex( shadowTris->indexes, ALIGN( shadowTris->numIndexes * sizeof( shadowTris->indexes[0] ), INDEX_CACHE_ALIGN ) );
+				sint->numShadowIndexes = shadowTris->numIndexes;
+#if defined( KEEP_INTERACTION_CPU_DATA )
+				sint->shadowIndexes = shadowTris->indexes;
+				shadowTris->indexes = NULL;
+#endif
+				R_FreeStaticTriSurf( shadowTris );
 			}
 		}
+
+		R_StaticFree( parms.lightTris );
+		parms.lightTris = NULL;
+		parms.shadowTris = NULL;
 	}
 
 	// if none of the surfaces generated anything, don't even bother checking?
-	if ( !interactionGenerated ) {
+	if ( !parms.interactionGenerated ) {
 		MakeEmpty();
 	}
+}
+
+/*
+======================
+CreateStaticInteractionJob
+======================
+*/
+void CreateStaticInteractionJob( staticInteractionParms_t * parms ) {
+	parms->interaction->CreateStaticInteractionGeometry( *parms );
+}
+
+REGISTER_PARALLEL_JOB( CreateStaticInteractionJob, "CreateStaticInteractionJob" );
+
+/*
+======================
+R_ChecksumString
+======================
+*/
+static void R_ChecksumString( unsigned long & checksum, const char * string ) {
+	CRC32_UpdateChecksum( checksum, string, idStr::Length( string ) + 1 );
+}
+
+/*
+======================
+StaticInteractionChecksum
+
+Covers everything that goes into the static interaction surfaces, so a cached
+version of the interaction can only be used if the checksum still matches.
+======================
+*/
+unsigned int idInteraction::StaticInteractionChecksum() const {
+	unsigned long checksum;
+	CRC32_InitChecksum( checksum );
+
+	// the light projection and shadow casting
+	CRC32_UpdateChecksum( checksum, &lightDef->baseLightProject, sizeof( lightDef->baseLightProject ) );
+	CRC32_UpdateChecksum( checksum, lightDef->globalLightOrigin.ToFloatPtr(), sizeof( lightDef->globalLightOrigin ) );
+	R_ChecksumString( checksum, lightDef->lightShader->GetName() );
+	R_ChecksumString( checksum, ( lightDef->parms.prelightModel != NULL ) ? lightDef->parms.prelightModel->Name() : "" );
+	const bool lightFlags[2] = { HasShadows(), lightDef->lightShader->LightEffectsBackSides() };
+	CRC32_UpdateChecksum( checksum, lightFlags, sizeof( lightFlags ) );
+
+	// the entity placement and skinning
+	const renderEntity_t & eParms = entityDef->parms;
+	CRC32_UpdateChecksum( checksum, entityDef->modelMatrix, sizeof( entityDef->modelMatrix ) );
+	R_ChecksumString( checksum, ( eParms.customSkin != NULL ) ? eParms.customSkin->GetName() : "" );
+	R_ChecksumString( checksum, ( eParms.customShader != NULL ) ? eParms.customShader->GetName() : "" );
+	const bool entityFlags[2] = { eParms.noSelfShadow, eParms.noShadow };
+	CRC32_UpdateChecksum( checksum, entityFlags, sizeof( entityFlags ) );
+
+	// the model geometry and the materials of its surfaces
+	const idRenderModel * model = eParms.hModel;
+	if ( model != NULL ) {
+		R_ChecksumString( checksum, model->Name() );
+		const int modelFlags[2] = { model->NumSurfaces(), model->IsDynamicModel() };
+		CRC32_UpdateChecksum( checksum, modelFlags, sizeof( modelFlags ) );
+		if ( model->IsDynamicModel() == DM_STATIC ) {
+			for ( int c = 0; c < model->NumSurfaces(); c++ ) {
+				const modelSurface_t * surf = model->Surface( c );
+				const srfTriangles_t * tri = surf->geometry;
+				if ( tri == NULL ) {
+					continue;
+				}
+				const int triCounts[3] = { tri->numVerts, tri->numIndexes, tri->numSilEdges };
+				CRC32_UpdateChecksum( checksum, triCounts, sizeof( triCounts ) );
+				CRC32_UpdateChecksum( checksum, &tri->bounds, sizeof( tri->bounds ) );
+
+				// the geometry itself only matters for the surfaces that touch the light,
+				// so the world geometry isn't checksummed again for every light
+				if ( !R_CullModelBoundsToLight( lightDef, tri->bounds, entityDef->modelRenderMatrix ) ) {
+					if ( tri->verts != NULL ) {
+						CRC32_UpdateChecksum( checksum, tri->verts, tri->numVerts * sizeof( tri->verts[0] ) );
+					}
+					if ( tri->indexes != NULL ) {
+						CRC32_UpdateChecksum( checksum, tri->indexes, tri->numIndexes * sizeof( tri->indexes[0] ) );
+					}
+					if ( tri->silEdges != NULL ) {
+						CRC32_UpdateChecksum( checksum, tri->silEdges, tri->numSilEdges * sizeof( tri->silEdges[0] ) );
+					}
+				}
+
+				const idMaterial * shader = R_RemapShaderBySkin( surf->shader, eParms.customSkin, eParms.customShader );
+				if ( shader == NULL ) {
+					continue;
+				}
+				R_ChecksumString( checksum, shader->GetName() );
+				const int materialFlags[4] = { shader->ReceivesLighting(), shader->ReceivesLightingOnBackSides(), shader->SurfaceCastsShadow(), shader->Coverage() };
+				CRC32_UpdateChecksum( checksum, materialFlags, sizeof( materialFlags ) );
+			}
+		}
+	}
+
+	CRC32_FinishChecksum( checksum );
+	return (unsigned int)checksum;
+}
+
+/*
+======================
+WriteStaticInteraction
+
+Writes the surfaces created by CreateStaticInteractionGeometry.
+======================
+*/
+void idInteraction::WriteStaticInteraction( idFile * file, const staticInteractionParms_t & parms ) const {
+	assert( parms.interaction == this );
+
+	file->WriteBool( parms.interactionGenerated );
+
+	const int numWritten = ( parms.lightTris != NULL ) ? numSurfaces : 0;
+	file->WriteBig( numWritten );
+
+	for ( int c = 0; c < numWritten; c++ ) {
+		const srfTriangles_t * lightTris = parms.lightTris[c];
+		if ( lightTris != NULL ) {
+			file->WriteBig( lightTris->numIndexes );
+			file->WriteBigArray( lightTris->indexes, lightTris->numIndexes );
+		} else {
+			file->WriteBig( -1 );
+		}
+
+		const srfTriangles_t * shadowTris = parms.shadowTris[c];
+		if ( shadowTris != NULL ) {
+			file->WriteBig( shadowTris->numIndexes );
+			file->WriteBig( surfaces[c].numShadowIndexesNoCaps );
+			file->WriteBigArray( shadowTris->indexes, shadowTris->numIndexes );
+		} else {
+			file->WriteBig( -1 );
+		}
+	}
+}
+
+/*
+======================
+R_ReadStaticInteractionIndexes
+
+Reads an index list of a cached interaction, which is rejected if it was
+cut short or references vertices the surface doesn't have.
+======================
+*/
+static bool R_ReadStaticInteractionIndexes( idFile * file, triIndex_t * indexes, int numIndexes, int numVerts ) {
+	if ( file->ReadBigArray( indexes, numIndexes ) != numIndexes * sizeof( indexes[0] ) ) {
+		return false;
+	}
+	for ( int i = 0; i < numIndexes; i++ ) {
+		if ( indexes[i] >= numVerts ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+======================
+ReadStaticInteraction
+
+Takes the place of CreateStaticInteractionGeometry for an interaction that
+was written by WriteStaticInteraction, the interaction still has to be finished.
+Returns false and leaves the interaction untouched if the record is truncated
+or doesn't fit the model geometry.
+======================
+*/
+bool idInteraction::ReadStaticInteraction( idFile * file, staticInteractionParms_t & parms ) {
+	parms.interaction = this;
+	parms.lightTris = NULL;
+	parms.shadowTris = NULL;
+	parms.interactionGenerated = false;
+
+	int numRead = 0;
+	if ( file->ReadBool( parms.interactionGenerated ) != 1 || file->ReadBig( numRead ) != sizeof( numRead ) ) {
+		return false;
+	}
+
+	const idRenderModel * model = entityDef->parms.hModel;
+	if ( numRead != 0 && ( model == NULL || numRead != model->NumSurfaces() ) ) {
+		return false;
+	}
+
+	// note that it is a static interaction
+	staticInteraction = true;
+
+	if ( numRead == 0 ) {
+		return true;
+	}
+
+	numSurfaces = numRead;
+	surfaces = (surfaceInteraction_t *)R_ClearedStaticAlloc( sizeof( *surfaces ) * numSurfaces );
+
+	parms.lightTris = (srfTriangles_t **)R_ClearedStaticAlloc( 2 * numSurfaces * sizeof( parms.lightTris[0] ) );
+	parms.shadowTris = parms.lightTris + numSurfaces;
+
+	for ( int c = 0; c < numSurfaces; c++ ) {
+		const srfTriangles_t * tri = model->Surface( c )->geometry;
+		const int numVerts = ( tri != NULL ) ? tri->numVerts : 0;
+		const int maxLightIndexes = ( tri != NULL ) ? tri->numIndexes : 0;
+		// R_CreateInteractionShadowVolume creates at most two caps and a quad per silhouette edge
+		const int maxShadowIndexes = ( tri != NULL ) ? tri->numIndexes * 2 + tri->numSilEdges * 6 : 0;
+
+		int numIndexes = 0;
+		if ( file->ReadBig( numIndexes ) != sizeof( numIndexes ) || numIndexes < -1 || numIndexes > maxLightIndexes ) {
+			FreeStaticInteractionRead( parms );
+			return false;
+		}
+		if ( numIndexes >= 0 ) {
+			srfTriangles_t * lightTris = R_AllocStaticTriSurf();
+			parms.lightTris[c] = lightTris;
+			R_AllocStaticTriSurfIndexes( lightTris, numIndexes );
+			lightTris->numIndexes = numIndexes;
+			if ( !R_ReadStaticInteractionIndexes( file, lightTris->indexes, numIndexes, numVerts ) ) {
+				FreeStaticInteractionRead( parms );
+				return false;
+			}
+		}
+
+		if ( file->ReadBig( numIndexes ) != sizeof( numIndexes ) || numIndexes < -1 || numIndexes > maxShadowIndexes ) {
+			FreeStaticInteractionRead( parms );
+			return false;
+		}
+		if ( numIndexes >= 0 ) {
+			int & numShadowIndexesNoCaps = surfaces[c].numShadowIndexesNoCaps;
+			if ( file->ReadBig( numShadowIndexesNoCaps ) != sizeof( numShadowIndexesNoCaps ) || numShadowIndexesNoCaps < 0 || numShadowIndexesNoCaps > numIndexes ) {
+				FreeStaticInteractionRead( parms );
+				return false;
+			}
+			srfTriangles_t * shadowTris = R_AllocStaticTriSurf();
+			parms.shadowTris[c] = shadowTris;
+			R_AllocStaticTriSurfIndexes( shadowTris, numIndexes );
+			shadowTris->numIndexes = numIndexes;
+			// the shadow volume references the doubled shadow verts of the surface
+			if ( !R_ReadStaticInteractionIndexes( file, shadowTris->indexes, numIndexes, numVerts * 2 ) ) {
+				FreeStaticInteractionRead( parms );
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+======================
+FreeStaticInteractionRead
+
+Throws away what ReadStaticInteraction read of a rejected record, so the
+interaction can be created the regular way.
+======================
+*/
+void idInteraction::FreeStaticInteractionRead( staticInteractionParms_t & parms ) {
+	if ( parms.lightTris != NULL ) {
+		for ( int c = 0; c < numSurfaces; c++ ) {
+			if ( parms.lightTris[c] != NULL ) {
+				R_FreeStaticTriSurf( parms.lightTris[c] );
+			}
+			if ( parms.shadowTris[c] != NULL ) {
+				R_FreeStaticTriSurf( parms.shadowTris[c] );
+			}
+		}
+		R_StaticFree( parms.lightTris );
+		parms.lightTris = NULL;
+		parms.shadowTris = NULL;
+	}
+	parms.interactionGenerated = false;
+
+	FreeSurfaces();
 }
\ No newline at end of file
@@ -83,6 +83,19 @@ struct surfaceInteraction_t {
 
 class idRenderEntity;
 class idRenderLight;
+class idInteraction;
+
+// The light tris and shadow volumes of a static interaction are created by
+// CreateStaticInteractionJob, which can run on any thread, and are turned into
+// static index caches on the main thread by FinishStaticInteraction.
+struct staticInteractionParms_t {
+	idInteraction *			interaction;
+	srfTriangles_t **		lightTris;				// for each model surface
+	srfTriangles_t **		shadowTris;				// for each model surface
+	bool					interactionGenerated;
+};
+
+void CreateStaticInteractionJob( staticInteractionParms_t * parms );
 
 class idInteraction {
 public:
@@ -138,9 +151,24 @@ public:
 	// called by GenerateAllInteractions
 	void					CreateStaticInteraction();
 
+	// creates the static interaction surfaces, thread safe
+	void					CreateStaticInteractionGeometry( staticInteractionParms_t & parms );
+
+	// allocates the static index caches and frees the geometry created by
+	// CreateStaticInteractionGeometry, must be called on the main thread
+	void					FinishStaticInteraction( staticInteractionParms_t & parms );
+
+	// static interactions cached in a generated file, the checksum tells if the cached version is still valid
+	unsigned int			StaticInteractionChecksum() const;
+	void					WriteStaticInteraction( idFile * file, const staticInteractionParms_t & parms ) const;
+	bool					ReadStaticInteraction( idFile * file, staticInteractionParms_t & parms );
+
 private:
 	// unlink from entity and light lists
 	void					Unlink();
+
+	// frees what ReadStaticInteraction read of a rejected record
+	void					FreeStaticInteractionRead( staticInteractionParms_t & parms );
 };
 
 #endif /* !__INTERACTION_H__ */
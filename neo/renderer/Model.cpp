@@ -478,6 +478,8 @@ bool idRenderModelStatic::LoadBinaryModel( idFile * file, const ID_TIME_T source
 			tri.indexCache = 0;
 			tri.ambientCache = 0;
 			tri.shadowCache = 0;
+			tri.skinnedAmbientCache = 0;
+			tri.skinnedShadowCache = 0;
 		}
 	}
 
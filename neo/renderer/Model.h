@@ -69,6 +69,8 @@ struct srfTriangles_t {
 	bool						referencedVerts;		// if true the 'verts' are referenced and should not be freed
 	bool						referencedIndexes;		// if true, indexes, silIndexes, mirrorVerts, and silEdges are
 														// pointers into the original surface, and should not be freed
+	bool						rigidSkinning;			// every vertex is fully weighted to a single joint, so the
+														// compute skinning pre-pass reproduces the skinned vertex programs
 
 	int							numVerts;				// number of vertices
 	idDrawVert *				verts;					// vertices, allocated with special allocator
@@ -115,6 +117,10 @@ struct srfTriangles_t {
 	vertCacheHandle_t			ambientCache;			// idDrawVert
 	vertCacheHandle_t			shadowCache;			// idVec4
 
+	// this frame's output of the compute skinning pre-pass for GPU skinned surfaces
+	vertCacheHandle_t			skinnedAmbientCache;	// idDrawVert
+	vertCacheHandle_t			skinnedShadowCache;		// idShadowVert
+
 	DISALLOW_COPY_AND_ASSIGN( srfTriangles_t );
 };
 
@@ -606,7 +606,7 @@ idRenderModelOverlay::CreateOverlayDrawSurf
 ====================
 */
 void R_SetupDrawSurfShader( drawSurf_t * drawSurf, const idMaterial * shader, const renderEntity_t * renderEntity );
-void R_SetupDrawSurfJoints( drawSurf_t * drawSurf, const srfTriangles_t * tri, const idMaterial * shader );
+void R_SetupDrawSurfJoints( drawSurf_t * drawSurf, srfTriangles_t * tri, const idMaterial * shader );
 drawSurf_t * idRenderModelOverlay::CreateOverlayDrawSurf( const viewEntity_t *space, const idRenderModel *baseModel, unsigned int index ) {
 	if ( index < 0 || index >= numOverlayMaterials ) {
 		return NULL;
@@ -174,6 +174,7 @@ private:
 	byte *						meshJoints;			// the joints used by this mesh
 	int							numMeshJoints;		// number of mesh joints
 	float						maxJointVertDist;	// maximum distance a vertex is separated from a joint
+	bool						rigidSkinning;		// every vertex is fully weighted to a single joint
 	deformInfo_t *				deformInfo;			// used to create srfTriangles_t from base frames and new vertexes
 	int							surfaceNum;			// number of the static surface created for this mesh
 };
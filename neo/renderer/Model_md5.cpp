@@ -92,6 +92,7 @@ idMD5Mesh::idMD5Mesh() {
 	meshJoints			= NULL;
 	numMeshJoints		= 0;
 	maxJointVertDist	= 0.0f;
+	rigidSkinning		= false;
 	deformInfo			= NULL;
 	surfaceNum			= 0;
 }
@@ -113,6 +114,24 @@ idMD5Mesh::~idMD5Mesh() {
 	}
 }
 
+/*
+====================
+R_DeformVertsAreRigid
+
+The compute skinning pre-pass only outputs the normal and tangent, and the
+unskinned vertex programs then rebuild the bitangent from them. That only
+matches the skinned vertex programs when a single joint transforms the vertex.
+====================
+*/
+static bool R_DeformVertsAreRigid( const deformInfo_t * deformInfo ) {
+	for ( int i = 0; i < deformInfo->numOutputVerts; i++ ) {
+		if ( deformInfo->verts[i].color2[0] != 255 ) {
+			return false;
+		}
+	}
+	return true;
+}
+
 /*
 ====================
 idMD5Mesh::ParseMesh
@@ -416,6 +435,8 @@ void idMD5Mesh::ParseMesh( idLexer &parser, int numJoints, const idJointMat *joi
 		}
 	}
 
+	rigidSkinning = R_DeformVertsAreRigid( deformInfo );
+
 	Mem_Free( basePose );
 }
 
@@ -513,6 +534,7 @@ void idMD5Mesh::UpdateSurface( const renderEntity_t *ent, const idJointMat *entJ
 		tri->referencedVerts = false;
 	}
 	tri->tangentsCalculated = true;
+	tri->rigidSkinning = rigidSkinning;
 
 	CalculateBounds( entJoints, tri->bounds );
 }
@@ -781,6 +803,8 @@ bool idRenderModelMD5::LoadBinaryModel( idFile * file, const ID_TIME_T sourceTim
 
 		Mem_Free( shadowVerts );
 
+		meshes[i].rigidSkinning = R_DeformVertsAreRigid( meshes[i].deformInfo );
+
 		file->ReadBig( meshes[i].surfaceNum );
 	}
 
@@ -1174,6 +1174,7 @@ void idRenderBackend::DrawView( const renderCommand_t & cmd ) {
 	// render the scene
 	{
 		renderLog.OpenBlock( "DrawViewInternal" );
+		GPU_BeginScope( "DrawView" );
 
 		//-------------------------------------------------
 		// guis can wind up referencing purged images that need to be loaded.
@@ -1256,7 +1257,9 @@ void idRenderBackend::DrawView( const renderCommand_t & cmd ) {
 		//-------------------------------------------------
 		{
 			uint64 start = Sys_Microseconds();
+			GPU_BeginScope( "FillDepthBuffer" );
 			FillDepthBufferFast( drawSurfs, numDrawSurfs );
+			GPU_EndScope();
 			m_pc.depthMicroSec += Sys_Microseconds() - start;
 		}
 
@@ -1265,7 +1268,11 @@ void idRenderBackend::DrawView( const renderCommand_t & cmd ) {
 		//-------------------------------------------------
 		{
 			uint64 start = Sys_Microseconds();
+			GPU_BeginScope( "DrawInteractions" );
+			BeginDeferredCommands();
 			DrawInteractions();
+			EndDeferredCommands();
+			GPU_EndScope();
 			m_pc.interactionMicroSec += Sys_Microseconds() - start;
 		}
 
@@ -1276,7 +1283,11 @@ void idRenderBackend::DrawView( const renderCommand_t & cmd ) {
 		if ( !r_skipShaderPasses.GetBool() ) {
 			uint64 start = Sys_Microseconds();
 			renderLog.OpenMainBlock( MRB_DRAW_SHADER_PASSES );
+			GPU_BeginScope( "DrawShaderPasses" );
+			BeginDeferredCommands();
 			processed = DrawShaderPasses( drawSurfs, numDrawSurfs );
+			EndDeferredCommands();
+			GPU_EndScope();
 			renderLog.CloseMainBlock();
 			m_pc.shaderPassMicroSec += Sys_Microseconds() - start;
 		}
@@ -1298,6 +1309,8 @@ void idRenderBackend::DrawView( const renderCommand_t & cmd ) {
 
 			RENDERLOG_PRINTF( "Resolve to %i x %i buffer\n", w, h );
 
+			GPU_BeginScope( "PostProcess" );
+
 			// resolve the screen
 			GL_CopyFrameBuffer( globalImages->m_currentRenderImage, x, y, w, h );
 			m_currentRenderCopied = true;
@@ -1323,8 +1336,12 @@ void idRenderBackend::DrawView( const renderCommand_t & cmd ) {
 
 			// render the remaining surfaces
 			renderLog.OpenMainBlock( MRB_DRAW_SHADER_PASSES_POST );
+			BeginDeferredCommands();
 			DrawShaderPasses( drawSurfs + processed, numDrawSurfs - processed );
+			EndDeferredCommands();
 			renderLog.CloseMainBlock();
+
+			GPU_EndScope();
 		}
 
 		//-------------------------------------------------
@@ -1332,6 +1349,7 @@ void idRenderBackend::DrawView( const renderCommand_t & cmd ) {
 		//-------------------------------------------------
 		DBG_RenderDebugTools( drawSurfs, numDrawSurfs );
 
+		GPU_EndScope();
 		renderLog.CloseBlock();
 	}
 }
@@ -1904,6 +1922,97 @@ void idRenderBackend::DrawSingleInteraction( drawInteraction_t * din ) {
 	DrawElementsWithCounters( din->surf );
 }
 
+/*
+=================
+idRenderBackend::RenderSurfaceInteractions
+
+Draws the interactions of all the bump / diffuse / specular stages of din->surf with
+the light parms that are currently set.
+=================
+*/
+void idRenderBackend::RenderSurfaceInteractions( drawInteraction_t * din, const idVec4 & diffuseColor, const idVec4 & specularColor ) {
+	const idMaterial * surfaceShader = din->surf->material;
+	const float * surfaceRegs = din->surf->shaderRegisters;
+
+	din->bumpImage = NULL;
+	din->specularImage = NULL;
+	din->diffuseImage = NULL;
+	din->diffuseColor[0] = din->diffuseColor[1] = din->diffuseColor[2] = din->diffuseColor[3] = 0;
+	din->specularColor[0] = din->specularColor[1] = din->specularColor[2] = din->specularColor[3] = 0;
+
+	// go through the individual surface stages
+	//
+	// This is somewhat arcane because of the old support for video cards that had to render
+	// interactions in multiple passes.
+	//
+	// We also have the very rare case of some materials that have conditional interactions
+	// for the "hell writing" that can be shined on them.
+	for ( int surfaceStageNum = 0; surfaceStageNum < surfaceShader->GetNumStages(); surfaceStageNum++ ) {
+		const shaderStage_t	*surfaceStage = surfaceShader->GetStage( surfaceStageNum );
+
+		switch( surfaceStage->lighting ) {
+			case SL_COVERAGE: {
+				// ignore any coverage stages since they should only be used for the depth fill pass
+				// for diffuse stages that use alpha test.
+				break;
+			}
+			case SL_AMBIENT: {
+				// ignore ambient stages while drawing interactions
+				break;
+			}
+			case SL_BUMP: {
+				// ignore stage that fails the condition
+				if ( !surfaceRegs[ surfaceStage->conditionRegister ] ) {
+					break;
+				}
+				// draw any previous interaction
+				if ( din->bumpImage != NULL ) {
+					DrawSingleInteraction( din );
+				}
+				din->bumpImage = surfaceStage->texture.image;
+				din->diffuseImage = NULL;
+				din->specularImage = NULL;
+				RB_SetupInteractionStage( surfaceStage, surfaceRegs, NULL,
+										din->bumpMatrix, NULL );
+				break;
+			}
+			case SL_DIFFUSE: {
+				// ignore stage that fails the condition
+				if ( !surfaceRegs[ surfaceStage->conditionRegister ] ) {
+					break;
+				}
+				// draw any previous interaction
+				if ( din->diffuseImage != NULL ) {
+					DrawSingleInteraction( din );
+				}
+				din->diffuseImage = surfaceStage->texture.image;
+				din->vertexColor = surfaceStage->vertexColor;
+				RB_SetupInteractionStage( surfaceStage, surfaceRegs, diffuseColor.ToFloatPtr(),
+										din->diffuseMatrix, din->diffuseColor.ToFloatPtr() );
+				break;
+			}
+			case SL_SPECULAR: {
+				// ignore stage that fails the condition
+				if ( !surfaceRegs[ surfaceStage->conditionRegister ] ) {
+					break;
+				}
+				// draw any previous interaction
+				if ( din->specularImage != NULL ) {
+					DrawSingleInteraction( din );
+				}
+				din->specularImage = surfaceStage->texture.image;
+				din->vertexColor = surfaceStage->vertexColor;
+				RB_SetupInteractionStage( surfaceStage, surfaceRegs, specularColor.ToFloatPtr(),
+										din->specularMatrix, din->specularColor.ToFloatPtr() );
+				break;
+			}
+		}
+	}
+
+	// draw the final interaction
+	DrawSingleInteraction( din );
+}
+
 /*
 =================
 RB_SetupForFastPathInteractions
@@ -2067,9 +2176,6 @@ void idRenderBackend::RenderInteractions( const drawSurf_t *surfList, const view
 				}
 			}
 
-			const idMaterial * surfaceShader = surf->material;
-			const float * surfaceRegs = surf->shaderRegisters;
-
 			inter.surf = surf;
 
 			// change the MVP matrix, view/light origin and light projection vectors if needed
@@ -2124,83 +2230,7 @@ void idRenderBackend::RenderInteractions( const drawSurf_t *surfList, const view
 			
 			renderLog.OpenBlock( surf->material->GetName() );
 
-			inter.bumpImage = NULL;
-			inter.specularImage = NULL;
-			inter.diffuseImage = NULL;
-			inter.diffuseColor[0] = inter.diffuseColor[1] = inter.diffuseColor[2] = inter.diffuseColor[3] = 0;
-			inter.specularColor[0] = inter.specularColor[1] = inter.specularColor[2] = inter.specularColor[3] = 0;
-
-			// go through the individual surface stages
-			//
-			// This is somewhat arcane because of the old support for video cards that had to render
-			// interactions in multiple passes.
-			//
-			// We also have the very rare case of some materials that have conditional interactions
-			// for the "hell writing" that can be shined on them.
-			for ( int surfaceStageNum = 0; surfaceStageNum < surfaceShader->GetNumStages(); surfaceStageNum++ ) {
-				const shaderStage_t	*surfaceStage = surfaceShader->GetStage( surfaceStageNum );
-
-				switch( surfaceStage->lighting ) {
-					case SL_COVERAGE: {
-						// ignore any coverage stages since they should only be used for the depth fill pass
-						// for diffuse stages that use alpha test.
-						break;
-					}
-					case SL_AMBIENT: {
-						// ignore ambient stages while drawing interactions
-						break;
-					}
-					case SL_BUMP: {
-						// ignore stage that fails the condition
-						if ( !surfaceRegs[ surfaceStage->conditionRegister ] ) {
-							break;
-						}
-						// draw any previous interaction
-						if ( inter.bumpImage != NULL ) {
-							DrawSingleInteraction( &inter );
-						}
-						inter.bumpImage = surfaceStage->texture.image;
-						inter.diffuseImage = NULL;
-						inter.specularImage = NULL;
-						RB_SetupInteractionStage( surfaceStage, surfaceRegs, NULL,
-												inter.bumpMatrix, NULL );
-						break;
-					}
-					case SL_DIFFUSE: {
-						// ignore stage that fails the condition
-						if ( !surfaceRegs[ surfaceStage->conditionRegister ] ) {
-							break;
-						}
-						// draw any previous interaction
-						if ( inter.diffuseImage != NULL ) {
-							DrawSingleInteraction( &inter );
-						}
-						inter.diffuseImage = surfaceStage->texture.image;
-						inter.vertexColor = surfaceStage->vertexColor;
-						RB_SetupInteractionStage( surfaceStage, surfaceRegs, diffuseColor.ToFloatPtr(),
-												inter.diffuseMatrix, inter.diffuseColor.ToFloatPtr() );
-						break;
-					}
-					case SL_SPECULAR: {
-						// ignore stage that fails the condition
-						if ( !surfaceRegs[ surfaceStage->conditionRegister ] ) {
-							break;
-						}
-						// draw any previous interaction
-						if ( inter.specularImage != NULL ) {
-							DrawSingleInteraction( &inter );
-						}
-						inter.specularImage = surfaceStage->texture.image;
-						inter.vertexColor = surfaceStage->vertexColor;
-						RB_SetupInteractionStage( surfaceStage, surfaceRegs, specularColor.ToFloatPtr(),
-												inter.specularMatrix, inter.specularColor.ToFloatPtr() );
-						break;
-					}
-				}
-			}
-
-			// draw the final interaction
-			DrawSingleInteraction( &inter );
+			RenderSurfaceInteractions( &inter, diffuseColor, specularColor );
 
 			renderLog.CloseBlock();
 		}
@@ -2211,6 +2241,94 @@ void idRenderBackend::RenderInteractions( const drawSurf_t *surfList, const view
 	}
 }
 
+/*
+=============
+idRenderBackend::RenderClusteredInteractions
+
+Draws each surface a single time for all the clustered lights of the view. The program
+looks up the lights of every fragment in the view's light clusters, which were binned by
+idRenderSystemLocal::AddClusteredLights, and applies the per-light colors itself.
+=============
+*/
+void idRenderBackend::RenderClusteredInteractions( const drawSurf_t * surfList ) {
+	if ( surfList == NULL ) {
+		return;
+	}
+
+	GL_State( 
+		GLS_SRCBLEND_ONE | 
+		GLS_DSTBLEND_ONE | 
+		GLS_DEPTHMASK | 
+		GLS_DEPTHFUNC_EQUAL | 
+		GLS_STENCIL_FUNC_ALWAYS );
+
+	renderProgManager.BindProgram( BUILTIN_INTERACTION_CLUSTERED );
+
+	// the clusters are found from the window position and the distance along the view
+	// direction, the depth slices must match R_ClusterDepthSlice
+	const idVec3 & viewOrigin = m_viewDef->renderView.vieworg;
+	const idVec3 & viewForward = m_viewDef->renderView.viewaxis[0];
+	const idVec4 globalEyePos( viewOrigin.x, viewOrigin.y, viewOrigin.z, 1.0f );
+	const idVec4 clusterGrid(
+		(float)m_viewDef->viewport.x1,
+		(float)m_viewDef->viewport.y1,
+		CLUSTER_TILES_X / (float)( m_viewDef->viewport.x2 + 1 - m_viewDef->viewport.x1 ),
+		CLUSTER_TILES_Y / (float)( m_viewDef->viewport.y2 + 1 - m_viewDef->viewport.y1 ) );
+	const idVec4 clusterDepth( viewForward.x, viewForward.y, viewForward.z, -( viewForward * viewOrigin ) );
+	const idVec4 clusterSlices(
+		1.0f / m_viewDef->clusterZNear,
+		CLUSTER_DEPTH_SLICES / idMath::Log( CLUSTER_DEPTH_FAR / m_viewDef->clusterZNear ),
+		(float)m_viewDef->numClusteredLights,
+		0.0f );
+
+	renderProgManager.SetRenderParm( RENDERPARM_GLOBALEYEPOS, globalEyePos.ToFloatPtr() );
+	renderProgManager.SetRenderParm( RENDERPARM_CLUSTER_GRID, clusterGrid.ToFloatPtr() );
+	renderProgManager.SetRenderParm( RENDERPARM_CLUSTER_DEPTH, clusterDepth.ToFloatPtr() );
+	renderProgManager.SetRenderParm( RENDERPARM_CLUSTER_SLICES, clusterSlices.ToFloatPtr() );
+
+	// all clustered lights share their light images
+	GL_BindTexture( INTERACTION_TEXUNIT_FALLOFF, m_viewDef->clusterFalloffImage );
+	GL_BindTexture( INTERACTION_TEXUNIT_PROJECTION, m_viewDef->clusterProjectionImage );
+
+	// the light colors are applied per light by the program, the 2x factor for specular stays here
+	const idVec4 diffuseColor( 1.0f, 1.0f, 1.0f, 1.0f );
+	const idVec4 specularColor( 2.0f, 2.0f, 2.0f, 2.0f );
+
+	drawInteraction_t inter = {};
+
+	m_currentSpace = NULL;
+
+	for ( const drawSurf_t * surf = surfList; surf != NULL; surf = surf->nextOnLight ) {
+		inter.surf = surf;
+
+		// the lights are in global space, so only the model matrix changes with the space
+		if ( surf->space != m_currentSpace ) {
+			m_currentSpace = surf->space;
+
+			RB_SetMVP( surf->space->mvp );
+
+			float modelMatrixTranspose[16];
+			R_MatrixTranspose( surf->space->modelMatrix, modelMatrixTranspose );
+			renderProgManager.SetRenderParms( RENDERPARM_MODELMATRIX_X, modelMatrixTranspose, 4 );
+		}
+
+		// change the scissor if needed
+		if ( !m_currentScissor.Equals( surf->scissorRect ) && r_useScissor.GetBool() ) {
+			GL_Scissor( m_viewDef->viewport.x1 + surf->scissorRect.x1, 
+						m_viewDef->viewport.y1 + surf->scissorRect.y1,
+						surf->scissorRect.x2 + 1 - surf->scissorRect.x1,
+						surf->scissorRect.y2 + 1 - surf->scissorRect.y1 );
+			m_currentScissor = surf->scissorRect;
+		}
+
+		renderLog.OpenBlock( surf->material->GetName() );
+
+		RenderSurfaceInteractions( &inter, diffuseColor, specularColor );
+
+		renderLog.CloseBlock();
+	}
+}
+
 /*
 ==============================================================================================
 
@@ -2233,6 +2351,15 @@ void idRenderBackend::DrawInteractions() {
 
 	const bool useLightDepthBounds = r_useLightDepthBounds.GetBool();
 
+	//
+	// the opaque surfaces lit by lights without shadows are drawn once for all of them
+	//
+	if ( m_viewDef->clusteredInteractions != NULL ) {
+		renderLog.OpenBlock( "Clustered Light Interactions" );
+		RenderClusteredInteractions( m_viewDef->clusteredInteractions );
+		renderLog.CloseBlock();
+	}
+
 	//
 	// for each light, perform shadowing and adding
 	//
@@ -2932,6 +3059,7 @@ void idRenderBackend::FogAllLights() {
 	}
 	renderLog.OpenMainBlock( MRB_FOG_ALL_LIGHTS );
 	renderLog.OpenBlock( "RB_FogAllLights" );
+	GPU_BeginScope( "FogAllLights" );
 
 	// force fog plane to recalculate
 	m_currentSpace = NULL;
@@ -2944,6 +3072,7 @@ void idRenderBackend::FogAllLights() {
 		}
 	}
 
+	GPU_EndScope();
 	renderLog.CloseBlock();
 	renderLog.CloseMainBlock();
 }
@@ -2974,6 +3103,8 @@ void idRenderBackend::StencilShadowPass( const drawSurf_t *drawSurfs, const view
 
 	RENDERLOG_PRINTF( "---------- RB_StencilShadowPass ----------\n" );
 
+	GPU_BeginScope( "StencilShadowPass" );
+
 	renderProgManager.BindProgram( BUILTIN_SHADOW );
 
 	uint64 glState = 0;
@@ -3102,6 +3233,8 @@ void idRenderBackend::StencilShadowPass( const drawSurf_t *drawSurfs, const view
 			GL_DepthBoundsTest( 0.0f, 0.0f );
 		}
 	}
+
+	GPU_EndScope();
 }
 
 /*
@@ -36,6 +36,7 @@ struct tmu_t {
 };
 
 const int MAX_MULTITEXTURE_UNITS =	8;
+const int MAX_RECORD_JOBS =			8;	// secondary command buffers recorded in parallel
 
 enum stencilFace_t {
 	STENCIL_FACE_FRONT,
@@ -52,6 +53,8 @@ struct backEndCounters_t {
 		c_shadowElements( 0 ),
 		c_shadowIndexes( 0 ),
 		c_copyFrameBuffer( 0 ),
+		c_skinningJobs( 0 ),
+		c_skinnedVerts( 0 ),
 		c_overDraw( 0 ),
 		totalMicroSec( 0 ),
 		shadowMicroSec( 0 ),
@@ -71,6 +74,9 @@ struct backEndCounters_t {
 
 	int		c_copyFrameBuffer;
 
+	int		c_skinningJobs;		// compute skinning dispatches
+	int		c_skinnedVerts;
+
 	float	c_overDraw;
 
 	uint64	totalMicroSec;		// total microseconds for backend run
@@ -143,18 +149,22 @@ struct GPUInfo_t {
 
 struct vulkanContext_t {
 	vertCacheHandle_t				jointCacheHandle;
+	vertCacheHandle_t				clusterCacheHandle;	// lightClusters_t of the view being drawn
 
 	GPUInfo_t						gpu;
 
 	VkDevice						device;
 	int								graphicsFamilyIdx;
 	int								presentFamilyIdx;
+	int								transferFamilyIdx;	// -1 without a dedicated transfer queue
 	VkQueue							graphicsQueue;
 	VkQueue							presentQueue;
+	VkQueue							transferQueue;
 
 	VkFormat						depthFormat;
 	VkRenderPass					renderPass;
 	VkRenderPass					renderPassResume;
+	VkRenderPass					renderPassContinue;	// loads and stores everything, for executing secondary command buffers
 	VkPipelineCache					pipelineCache;
 	VkSampleCountFlagBits			sampleCount;
 	bool							supersampling;
@@ -164,6 +174,89 @@ struct vulkanContext_t {
 
 extern vulkanContext_t vkcontext;
 
+/*
+================================================
+backendCommand_t
+
+Everything the backend records inside the render pass goes through a
+backendCommand_t. All state a command depends on is resolved when it is
+submitted, so a run of deferred commands can be replayed into secondary
+command buffers on the job threads without touching the backend.
+================================================
+*/
+enum backendCommandType_t {
+	// dynamic state, tracked so it can be restored at the start of a secondary command buffer
+	BC_VIEWPORT,
+	BC_SCISSOR,
+	BC_DEPTH_BOUNDS,
+	BC_DEPTH_BIAS,
+
+	BC_CLEAR,
+	BC_DRAW,
+	BC_TIMESTAMP
+};
+
+const int NUM_DYNAMIC_STATE_COMMANDS = BC_DEPTH_BIAS + 1;
+
+const int MAX_DYNAMIC_UNIFORM_BUFFERS = 3;	// vertex parms, joints, fragment parms, or light clusters in place of joints
+
+struct backendDrawCommand_t {
+	VkPipeline			pipeline;
+	VkPipelineLayout	pipelineLayout;
+	VkDescriptorSet		descriptorSet;
+	VkBuffer			indexBuffer;
+	VkDeviceSize		indexBufferOffset;
+	VkBuffer			vertexBuffer;
+	VkDeviceSize		vertexBufferOffset;
+	uint32				numIndexes;
+	uint32				firstIndex;
+	int32				baseVertex;
+	uint32				numDynamicOffsets;
+	uint32				dynamicOffsets[ MAX_DYNAMIC_UNIFORM_BUFFERS ];
+};
+
+struct backendCommand_t {
+	backendCommandType_t	type;
+	union {
+		VkViewport				viewport;
+		VkRect2D				scissor;
+		struct {
+			float				zmin;
+			float				zmax;
+		}						depthBounds;
+		struct {
+			float				scale;
+			float				bias;
+		}						depthBias;
+		struct {
+			VkClearAttachment	attachments[ 2 ];
+			uint32				numAttachments;
+			VkClearRect			rect;
+		}						clear;
+		backendDrawCommand_t	draw;
+		struct {
+			VkQueryPool			queryPool;
+			uint32				query;
+		}						timestamp;
+	};
+};
+
+/*
+================================================
+A named span of gpu work between two timestamp queries. The name must be a
+string literal, like the render log labels. The times are filled in when the
+queries are read back, NUM_FRAME_DATA frames after they were recorded.
+================================================
+*/
+struct gpuProfileScope_t {
+	const char *		name;
+	int					depth;
+	uint32				beginQuery;
+	uint32				endQuery;
+	float				startMicroSec;		// relative to the start of the frame
+	float				durationMicroSec;
+};
+
 /*
 ===========================================================================
 
@@ -186,6 +279,22 @@ public:
 
 	void				Restart();
 
+	// Commands submitted between these are recorded into secondary command buffers
+	// on the job threads and executed from the primary when the run ends.
+	void				BeginDeferredCommands();
+	void				EndDeferredCommands();
+
+	// Scopes nest and are only recorded while r_showGPUProfile is set or a capture is running.
+	void				GPU_BeginScope( const char * name );
+	void				GPU_EndScope();
+
+	// The most recently resolved frame.
+	const idList< gpuProfileScope_t, TAG_RENDER > &	GetGPUProfile() const { return m_gpuProfile; }
+	float				GetGPUProfileFrameMicroSec() const { return m_gpuProfileFrameMicroSec; }
+
+	// Writes the scopes of the next numFrames resolved frames to gpuprofile.csv and gpuprofile.json.
+	void				CaptureGPUProfile( int numFrames );
+
 private:
 	void				DrawElementsWithCounters( const drawSurf_t * surf );
 	void				DrawStencilShadowPass( const drawSurf_t * drawSurf, const bool renderZPass );
@@ -210,9 +319,11 @@ private:
 
 	void				DrawInteractions();
 	void				DrawSingleInteraction( drawInteraction_t * din );
+	void				RenderSurfaceInteractions( drawInteraction_t * din, const idVec4 & diffuseColor, const idVec4 & specularColor );
 	int					DrawShaderPasses( const drawSurf_t * const * const drawSurfs, const int numDrawSurfs );
 
 	void				RenderInteractions( const drawSurf_t * surfList, const viewLight_t * vLight, int depthFunc, bool performStencilTest, bool useLightDepthBounds );
+	void				RenderClusteredInteractions( const drawSurf_t * surfList );
 
 	void				StencilShadowPass( const drawSurf_t * drawSurfs, const viewLight_t * vLight );
 	void				StencilSelectLight( const viewLight_t * vLight );
@@ -242,6 +353,14 @@ private:
 	ID_INLINE void		GL_Color( float r, float g, float b ) { GL_Color( r, g, b, 1.0f ); }
 	void				GL_Color( float * color );
 
+	void				SubmitCommand( const backendCommand_t & cmd );
+	void				FlushDeferredCommands();
+	VkCommandBuffer		AllocSecondaryCommandBuffer( int slot );
+
+	void				CreateSkinningPipeline();
+	void				DestroySkinningPipeline();
+	void				DispatchSkinning( VkCommandBuffer commandBuffer );
+
 private:
 	void				Clear();
 
@@ -254,6 +373,8 @@ private:
 	void				CreateSemaphores();
 
 	void				CreateQueryPool();
+	void				ResolveGPUProfile();
+	void				WriteTimestamp( uint32 query );
 
 	void				CreateSurface();
 
@@ -372,6 +493,35 @@ private:
 	idArray< uint32, NUM_FRAME_DATA >			m_queryIndex;
 	idArray< idArray< uint64, NUM_TIMESTAMP_QUERIES >, NUM_FRAME_DATA >	m_queryResults;
 	idArray< VkQueryPool, NUM_FRAME_DATA >		m_queryPools;
+	bool										m_timestampsSupported;
+
+	idArray< idList< gpuProfileScope_t, TAG_RENDER >, NUM_FRAME_DATA >	m_gpuScopes;
+	idList< int, TAG_RENDER >					m_gpuScopeStack;	// open scopes, -1 when one was dropped
+	idList< gpuProfileScope_t, TAG_RENDER >		m_gpuProfile;
+	float										m_gpuProfileFrameMicroSec;
+	int											m_gpuProfileCaptureFrames;
+	int											m_gpuProfileCaptureFrameNum;
+	uint64										m_gpuProfileCaptureStart;
+	idFile *									m_gpuProfileCSV;
+	idFile *									m_gpuProfileTrace;
+	bool										m_gpuProfileTraceHasEvents;	// the next trace event needs a separator
+
+	bool										m_deferCommands;
+	idList< backendCommand_t, TAG_RENDER >		m_deferredCommands;
+	idArray< backendCommand_t, NUM_DYNAMIC_STATE_COMMANDS >	m_dynamicState;			// last submitted value of each dynamic state
+	idArray< bool, NUM_DYNAMIC_STATE_COMMANDS >				m_dynamicStateValid;
+	idArray< backendCommand_t, NUM_DYNAMIC_STATE_COMMANDS >	m_deferredDynamicState;	// dynamic state when the current run of deferred commands started
+	idArray< bool, NUM_DYNAMIC_STATE_COMMANDS >				m_deferredDynamicStateValid;
+
+	idParallelJobList *							m_recordJobList;
+	idArray< idArray< VkCommandPool, MAX_RECORD_JOBS >, NUM_FRAME_DATA >	m_secondaryCommandPools;
+	idList< VkCommandBuffer, TAG_RENDER >		m_secondaryCommandBuffers[ NUM_FRAME_DATA ][ MAX_RECORD_JOBS ];
+	idArray< int, MAX_RECORD_JOBS >				m_numSecondaryCommandBuffers;	// used this frame, per slot
+
+	VkDescriptorSetLayout						m_skinningDescriptorSetLayout;
+	VkPipelineLayout							m_skinningPipelineLayout;
+	VkPipeline									m_skinningPipeline;		// VK_NULL_HANDLE when compute skinning is unavailable
+	idArray< VkDescriptorPool, NUM_FRAME_DATA >	m_skinningDescriptorPools;
 };
 
 #endif
\ No newline at end of file
@@ -78,7 +78,7 @@ static const int MAX_DESC_SET_WRITES		= 32;
 static const int MAX_DESC_SET_UNIFORMS		= 48;
 static const int MAX_IMAGE_PARMS			= 16;
 static const int MAX_UBO_PARMS				= 2;
-static const int NUM_TIMESTAMP_QUERIES		= 16;
+static const int NUM_TIMESTAMP_QUERIES		= 512;
 #endif
 
 // vertCacheHandle_t packs size, offset, and frame number into 64 bits
@@ -407,6 +407,7 @@ public:
 	// axis aligned bounding box in world space, derived from refernceBounds and
 	// modelMatrix in idRenderWorld::CreateEntityRefs()
 	idBounds				globalReferenceBounds;
+	int						boundsTreeLeaf;			// node in the world entity bounds tree, -1 if not linked
 
 	// a viewEntity_t is created whenever a idRenderEntity is considered for inclusion
 	// in a given view, even if it turns out to not be visible
@@ -487,6 +488,10 @@ struct viewLight_t {
 	drawSurf_t *			globalInteractions;			// get shadows from everything
 	drawSurf_t *			translucentInteractions;	// translucent interactions don't get shadows
 
+	// opaque surfaces are lit by the view's clustered interaction pass instead of
+	// being linked to localInteractions / globalInteractions
+	bool					clustered;
+
 	// R_AddSingleLight will build a chain of parameters here to setup shadow volumes
 	preLightShadowVolumeParms_t *	preLightShadowVolumes;
 };
@@ -575,6 +580,43 @@ struct renderView_t {
 	const idMaterial		*globalMaterial;							// used to override everything draw
 };
 
+/*
+===========================================================================
+
+SURFACES
+
+lightClusters_t
+
+Lights that don't cast shadows can be drawn with a single interaction pass per surface.
+The view is split into screen tiles and exponential depth slices, and every cluster
+holds a bit mask of the clustered lights whose volume touches it.
+
+===========================================================================
+*/
+
+const int CLUSTER_TILES_X			= 16;
+const int CLUSTER_TILES_Y			= 8;
+const int CLUSTER_DEPTH_SLICES		= 16;
+const int CLUSTER_COUNT				= CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_DEPTH_SLICES;
+const int MAX_CLUSTERED_LIGHTS		= 32;			// one bit per light in the cluster masks
+const float CLUSTER_DEPTH_FAR		= 8192.0f;		// the last slice extends past this
+
+struct clusteredLight_t {
+	idVec4					origin;
+	idPlane					lightProject[4];	// global S, T, Q and falloff S
+	idVec4					color;				// diffuse color, specular is twice this
+};
+
+// uploaded with AllocJoint as a single uniform block, this layout must
+// match the clusters block in interaction_clustered.frag
+struct lightClusters_t {
+	clusteredLight_t		lights[MAX_CLUSTERED_LIGHTS];
+	uint32					masks[CLUSTER_COUNT];
+};
+
+// the minimum maxUniformBufferRange every Vulkan implementation supports
+compile_time_assert( sizeof( lightClusters_t ) <= 16 * 1024 );
+
 struct viewDef_t {
 	// specified in the call to DrawScene()
 	renderView_t		renderView;
@@ -628,6 +670,14 @@ struct viewDef_t {
 	// of 2D rendering, which we can optimize in certain ways.  A 2D view will
 	// not have any viewEntities
 
+	// setup by AddClusteredLights, lights that can't be clustered use the regular interaction passes
+	int					numClusteredLights;
+	vertCacheHandle_t	clusterCache;			// lightClusters_t
+	float				clusterZNear;
+	idImage *			clusterFalloffImage;	// shared by all clustered lights
+	idImage *			clusterProjectionImage;
+	drawSurf_t *		clusteredInteractions;	// each opaque surface lit by a clustered light, once
+
 	idPlane				frustum[6];				// positive sides face outward, [4] is the front clip plane
 
 	int					areaNum;				// -1 = not in a valid area
@@ -775,12 +825,11 @@ public:
 		highWaterUsed( 0 ),
 		renderCommandIndex( 0 ) {
 
-		frameMemoryAllocated.SetValue( 0 );
 		frameMemoryUsed.SetValue( 0 );
 		renderCommands.Zero();
 	}
 
-	idSysInterlockedInteger	frameMemoryAllocated;
+	idFrameAllocator		frameAllocator;		// each thread allocates from its own chunk of frameMemory
 	idSysInterlockedInteger	frameMemoryUsed;
 	byte *					frameMemory;
 
@@ -448,6 +448,21 @@ void R_ScreenshotFilename( int &lastNumber, const char *base, idStr &fileName )
 	}
 }
 
+/*
+================== 
+gpuProfileCapture
+
+gpuProfileCapture [numFrames]
+================== 
+*/ 
+CONSOLE_COMMAND( gpuProfileCapture, "writes the gpu time of each backend pass for the next frames to gpuprofile.csv and gpuprofile.json", NULL ) {
+	int numFrames = 60;
+	if ( args.Argc() > 1 ) {
+		numFrames = atoi( args.Argv( 1 ) );
+	}
+	tr.m_backend.CaptureGPUProfile( numFrames );
+}
+
 /*
 ================== 
 screenshot
@@ -967,6 +982,7 @@ CONSOLE_COMMAND( showInteractionMemory, "shows memory used by interactions", NUL
 	idLib::Printf( "%5i indexes in %5i shadow tris\n", shadowTriIndexes, shadowTris );
 	idLib::Printf( "%i maxInteractionsForEntity\n", maxInteractionsForEntity );
 	idLib::Printf( "%i maxInteractionsForLight\n", maxInteractionsForLight );
+	idLib::Printf( "%i light / entity pairs in the interaction table, %i kB\n", tr.primaryWorld->m_interactionTable.Num(), (int)( tr.primaryWorld->m_interactionTable.Allocated() >> 10 ) );
 }
 
 CONSOLE_COMMAND( vid_restart, "restarts renderSystem", NULL ) {
@@ -49,6 +49,7 @@ idRenderEntity::idRenderEntity() {
 	cachedDynamicModel		= NULL;
 	localReferenceBounds	= bounds_zero;
 	globalReferenceBounds	= bounds_zero;
+	boundsTreeLeaf			= -1;
 	viewCount				= 0;
 	viewEntity				= NULL;
 	decals					= NULL;
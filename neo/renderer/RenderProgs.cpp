@@ -108,6 +108,10 @@ const char * GLSLParmNames[ RENDERPARM_TOTAL ] = {
 	"rpEnableSkinning",
 	"rpAlphaTest",
 
+	"rpClusterGrid",
+	"rpClusterDepth",
+	"rpClusterSlices",
+
 	"rpUser0",
 	"rpUser1",
 	"rpUser2",
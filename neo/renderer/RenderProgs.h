@@ -134,6 +134,10 @@ enum renderParm_t {
 	RENDERPARM_ENABLE_SKINNING,
 	RENDERPARM_ALPHA_TEST,
 
+	RENDERPARM_CLUSTER_GRID,
+	RENDERPARM_CLUSTER_DEPTH,
+	RENDERPARM_CLUSTER_SLICES,
+
 	RENDERPARM_USER0,
 	RENDERPARM_USER1,
 	RENDERPARM_USER2,
@@ -180,6 +184,8 @@ enum rpBuiltIn_t {
 	BUILTIN_BINK,
 	BUILTIN_BINK_GUI,
 
+	BUILTIN_INTERACTION_CLUSTERED,
+
 	MAX_BUILTINS
 };
 
@@ -205,15 +211,24 @@ struct shader_t {
 	idList< int >			parmIndices;
 };
 
+static const int PIPELINE_HASH_SIZE = 64;
+static const int DESCRIPTOR_SET_CACHE_HASH_SIZE = 4096;
+
+struct backendDrawCommand_t;
+
 struct renderProg_t {
 	renderProg_t() :
 					usesJoints( false ),
 					optionalSkinning( false ),
+					usesLightClusters( false ),
 					vertexShaderIndex( -1 ),
 					fragmentShaderIndex( -1 ),
 					vertexLayoutType( LAYOUT_DRAW_VERT ),
 					pipelineLayout( VK_NULL_HANDLE ),
-					descriptorSetLayout( VK_NULL_HANDLE ) {}
+					descriptorSetLayout( VK_NULL_HANDLE ),
+					pipelineHash( PIPELINE_HASH_SIZE, PIPELINE_HASH_SIZE ) {
+		pipelineHash.SetGranularity( PIPELINE_HASH_SIZE );
+	}
 
 	struct pipelineState_t {
 		pipelineState_t() : 
@@ -226,10 +241,14 @@ struct renderProg_t {
 	};
 
 	VkPipeline GetPipeline( uint64 stateBits, VkShaderModule vertexShader, VkShaderModule fragmentShader );
+	VkPipeline FindPipeline( uint64 stateBits ) const;
+	void AddPipeline( uint64 stateBits, VkPipeline pipeline );
+	void ClearPipelines();
 
 	idStr						name;
 	bool						usesJoints;
 	bool						optionalSkinning;
+	bool						usesLightClusters;
 	int							vertexShaderIndex;
 	int							fragmentShaderIndex;
 	vertexLayoutType_t			vertexLayoutType;
@@ -237,6 +256,7 @@ struct renderProg_t {
 	VkDescriptorSetLayout		descriptorSetLayout;
 	idList< rpBinding_t >		bindings;
 	idList< pipelineState_t >	pipelines;
+	idHashIndex					pipelineHash;	// stateBits -> index into pipelines
 };
 
 /*
@@ -263,13 +283,33 @@ public:
 	int		FindShader( const char * name, rpStage_t stage );
 	void	BindProgram( int index );
 
-	void	CommitCurrent( uint64 stateBits, VkCommandBuffer commandBuffer );
+	// optional builtins are not loaded when their SPIR-V has not been compiled
+	bool	IsProgramAvailable( int index ) const { return m_renderProgs[ index ].vertexShaderIndex != -1; }
+
+	void	CommitCurrent( uint64 stateBits, backendDrawCommand_t & draw );
 	int		FindProgram( const char * name, int vIndex, int fIndex );
 
+	// Creates every recorded pipeline whose renderProg is already known, on the job threads.
+	// Called at init for the builtins and at the end of a level load for material programs.
+	void	PrewarmPipelines();
+
+	// pipeline lookups made by CommitCurrent since startup or Vulkan_ClearPipelines
+	int		GetPipelineHits() const { return m_pipelineHits; }
+	int		GetPipelineMisses() const { return m_pipelineMisses; }
+	void	ClearPipelineCounters() { m_pipelineHits = 0; m_pipelineMisses = 0; }
+
+	// descriptor sets shared with an earlier draw in the same frame, since startup
+	int		GetDescriptorSetHits() const { return m_descriptorSetHits; }
+	int		GetDescriptorSetMisses() const { return m_descriptorSetMisses; }
+
 private:
 	void	LoadShader( int index );
 	void	LoadShader( shader_t & shader );
 
+	void	LoadPipelineRecords();
+	void	SavePipelineRecords();
+	void	RecordPipeline( const renderProg_t & prog, uint64 stateBits );
+
 	void	AllocParmBlockBuffer( const idList< int > & parmIndices, idUniformBuffer & ubo );
 
 public:
@@ -290,6 +330,32 @@ private:
 	VkDescriptorSet		m_descriptorSets[ NUM_FRAME_DATA ][ MAX_DESC_SETS ];
 
 	idUniformBuffer *	m_parmBuffers[ NUM_FRAME_DATA ];
+
+	// every ( renderProg, vertexLayout, stateBits ) combination seen in play,
+	// persisted so the pipelines can be created before they are first drawn
+	struct pipelineRecord_t {
+		idStr				vertexShader;
+		idStr				fragmentShader;
+		vertexLayoutType_t	vertexLayoutType;
+		uint64				stateBits;
+	};
+	idList< pipelineRecord_t, TAG_RENDER >	m_pipelineRecords;
+	bool				m_pipelineRecordsModified;
+
+	int					m_pipelineHits;
+	int					m_pipelineMisses;
+
+	// descriptor sets written this frame, keyed on the layout and everything bound to it
+	struct descriptorSetCacheEntry_t {
+		int				firstKey;
+		int				numKeys;
+		VkDescriptorSet	descriptorSet;
+	};
+	idList< descriptorSetCacheEntry_t, TAG_RENDER >	m_descriptorSetCache;
+	idList< uint64, TAG_RENDER >					m_descriptorSetCacheKeys;
+	idHashIndex			m_descriptorSetCacheHash;
+	int					m_descriptorSetHits;
+	int					m_descriptorSetMisses;
 };
 
 extern idRenderProgManager renderProgManager;
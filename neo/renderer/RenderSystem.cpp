@@ -32,6 +32,7 @@ If you have questions concerning this license or the applicable additional terms
 #include "../framework/Common_local.h"
 #include "RenderSystem_local.h"
 #include "RenderBackend.h"
+#include "RenderProgs.h"
 #include "ResolutionScale.h"
 #include "Font.h"
 #include "GuiModel.h"
@@ -160,6 +161,7 @@ idCVar r_showAddModel( "r_showAddModel", "0", CVAR_RENDERER | CVAR_BOOL, "report
 idCVar r_showDepth( "r_showDepth", "0", CVAR_RENDERER | CVAR_BOOL, "display the contents of the depth buffer and the depth range" );
 idCVar r_showSurfaces( "r_showSurfaces", "0", CVAR_RENDERER | CVAR_BOOL, "report surface/light/shadow counts" );
 idCVar r_showPrimitives( "r_showPrimitives", "0", CVAR_RENDERER | CVAR_INTEGER, "report drawsurf/index/vertex counts" );
+idCVar r_showGPUProfile( "r_showGPUProfile", "0", CVAR_RENDERER | CVAR_BOOL, "draw the gpu time of each backend pass, a few frames late" );
 idCVar r_showEdges( "r_showEdges", "0", CVAR_RENDERER | CVAR_BOOL, "draw the sil edges" );
 idCVar r_showTexturePolarity( "r_showTexturePolarity", "0", CVAR_RENDERER | CVAR_BOOL, "shade triangles by texture area polarity" );
 idCVar r_showTangentSpace( "r_showTangentSpace", "0", CVAR_RENDERER | CVAR_INTEGER, "shade triangles by tangent space, 1 = use 1st tangent vector, 2 = use 2nd tangent vector, 3 = use normal vector", 0, 3, idCmdSystem::ArgCompletion_Integer<0,3> );
@@ -553,6 +555,7 @@ void idRenderSystemLocal::Init() {
 	}
 
 	m_frontEndJobList = parallelJobManager->AllocJobList( JOBLIST_RENDERER_FRONTEND, JOBLIST_PRIORITY_MEDIUM, 2048, 0, NULL );
+	m_portalCullJobList = parallelJobManager->AllocJobList( JOBLIST_RENDERER_FRONTEND, JOBLIST_PRIORITY_MEDIUM, 64, 0, NULL );
 
 	m_bInitialized = true;
 
@@ -598,6 +601,7 @@ void idRenderSystemLocal::Shutdown() {
 	m_guiModel = NULL;
 
 	parallelJobManager->FreeJobList( m_frontEndJobList );
+	parallelJobManager->FreeJobList( m_portalCullJobList );
 
 	m_backend.Shutdown();
 
@@ -717,6 +721,7 @@ void idRenderSystemLocal::Clear() {
 	}
 
 	m_frontEndJobList = NULL;
+	m_portalCullJobList = NULL;
 }
 
 /*
@@ -760,6 +765,9 @@ idRenderSystemLocal::EndLevelLoad
 void idRenderSystemLocal::EndLevelLoad() {
 	renderModelManager->EndLevelLoad();
 	globalImages->EndLevelLoad();
+
+	// Materials referenced by the level have created their renderProgs by now
+	renderProgManager.PrewarmPipelines();
 }
 
 /*
@@ -842,14 +850,12 @@ void * idRenderSystemLocal::FrameAlloc( int bytes, frameAllocType_t type ) {
 
 	bytes = ( bytes + FRAME_ALLOC_ALIGNMENT - 1 ) & ~ ( FRAME_ALLOC_ALIGNMENT - 1 );
 
-	// thread safe add
-	int end = m_frameData->frameMemoryAllocated.Add( bytes );
-	if ( end > MAX_FRAME_MEMORY ) {
-		idLib::Error( "idRenderSystemLocal::FrameAlloc ran out of memory. bytes = %d, end = %d, highWaterAllocated = %d\n", bytes, end, m_frameData->highWaterAllocated );
+	// thread safe, each thread bumps through its own chunk
+	byte * ptr = (byte *)m_frameData->frameAllocator.Alloc( bytes );
+	if ( ptr == NULL ) {
+		idLib::Error( "idRenderSystemLocal::FrameAlloc ran out of memory. bytes = %d, allocated = %d, highWaterAllocated = %d\n", bytes, m_frameData->frameAllocator.GetAllocated(), m_frameData->highWaterAllocated );
 	}
 
-	byte * ptr = m_frameData->frameMemory + end - bytes;
-
 	// cache line clear the memory
 	for ( int offset = 0; offset < bytes; offset += CACHE_LINE_SIZE ) {
 		ZeroCacheLine( ptr, offset );
@@ -875,8 +881,8 @@ idRenderSystemLocal::ToggleSmpFrame
 */
 void idRenderSystemLocal::ToggleSmpFrame() {
 	// update the highwater mark
-	if ( m_frameData->frameMemoryAllocated.GetValue() > m_frameData->highWaterAllocated ) {
-		m_frameData->highWaterAllocated = m_frameData->frameMemoryAllocated.GetValue();
+	if ( m_frameData->frameAllocator.GetAllocated() > m_frameData->highWaterAllocated ) {
+		m_frameData->highWaterAllocated = m_frameData->frameAllocator.GetAllocated();
 #if defined( TRACK_FRAME_ALLOCS )
 		m_frameData->highWaterUsed = m_frameData->frameMemoryUsed.GetValue();
 		for ( int i = 0; i < FRAME_ALLOC_MAX; i++ ) {
@@ -890,10 +896,12 @@ void idRenderSystemLocal::ToggleSmpFrame() {
 	m_frameData = &m_smpFrameData[ m_smpFrame % NUM_FRAME_DATA ];
 
 	// reset the memory allocation
-	const uint32 bytesNeededForAlignment = FRAME_ALLOC_ALIGNMENT - ( (uint32)m_frameData->frameMemory & ( FRAME_ALLOC_ALIGNMENT - 1 ) );
-	m_frameData->frameMemoryAllocated.SetValue( bytesNeededForAlignment );
+	m_frameData->frameAllocator.Reset();
 	m_frameData->frameMemoryUsed.SetValue( 0 );
 
+	// front end temporaries come from the same memory as FrameAlloc
+	Mem_SetFrameAllocator( &m_frameData->frameAllocator );
+
 #if defined( TRACK_FRAME_ALLOCS )
 	for ( int i = 0; i < FRAME_ALLOC_MAX; i++ ) {
 		frameAllocTypeCount[i].SetValue( 0 );
@@ -915,6 +923,7 @@ void idRenderSystemLocal::InitFrameData() {
 
 	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
 		m_smpFrameData[ i ].frameMemory = (byte *) Mem_Alloc16( MAX_FRAME_MEMORY, TAG_RENDER );
+		m_smpFrameData[ i ].frameAllocator.SetMemory( m_smpFrameData[ i ].frameMemory, MAX_FRAME_MEMORY, FRAME_ALLOC_ALIGNMENT );
 	}
 
 	// must be set before ToggleSmpFrame()
@@ -929,6 +938,7 @@ idRenderSystemLocal::ShutdownFrameData
 ============
 */
 void idRenderSystemLocal::ShutdownFrameData() {
+	Mem_SetFrameAllocator( NULL );
 	m_frameData = NULL;
 	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
 		Mem_Free16( m_smpFrameData[ i ].frameMemory );
@@ -1367,6 +1377,8 @@ void idRenderSystemLocal::SwapCommandBuffers_FinishCommandBuffers() {
 		return;
 	}
 
+	DrawGPUProfile();
+
 	// close any gui drawing
 	EmitFullscreenGui();
 
@@ -1680,9 +1692,11 @@ void idRenderSystemLocal::PrintPerformanceCounters() {
 	}
 
 	if ( r_showDynamic.GetBool() ) {
-		idLib::Printf( "callback:%i md5:%i dfrmVerts:%i dfrmTris:%i tangTris:%i guis:%i\n",
+		idLib::Printf( "callback:%i md5:%i skinJobs:%i skinVerts:%i dfrmVerts:%i dfrmTris:%i tangTris:%i guis:%i\n",
 			pc.c_entityDefCallbacks,
 			pc.c_generateMd5,
+			m_backend.m_pc.c_skinningJobs,
+			m_backend.m_pc.c_skinnedVerts,
 			pc.c_deformedVerts,
 			pc.c_deformedIndexes/3,
 			pc.c_tangentIndexes/3,
@@ -1707,9 +1721,63 @@ void idRenderSystemLocal::PrintPerformanceCounters() {
 			pc.c_lightUpdates, pc.c_lightReferences );
 	}
 	if ( r_showMemory.GetBool() ) {
-		idLib::Printf( "frameData: %i (%i)\n", m_frameData->frameMemoryAllocated.GetValue(), m_frameData->highWaterAllocated );
+		idLib::Printf( "frameData: %i (%i)\n", m_frameData->frameAllocator.GetAllocated(), m_frameData->highWaterAllocated );
 	}
 
 	memset( &pc, 0, sizeof( pc ) );
 	memset( &m_backend.m_pc, 0, sizeof( m_backend.m_pc ) );
 }
+
+/*
+=====================
+idRenderSystemLocal::DrawGPUProfile
+
+Draws the per pass gpu times of the last resolved frame. Scopes with the same
+name at the same depth, like the shadow passes of every light, are summed.
+=====================
+*/
+void idRenderSystemLocal::DrawGPUProfile() {
+	if ( !r_showGPUProfile.GetBool() ) {
+		return;
+	}
+
+	struct gpuProfileRow_t {
+		const char *	name;
+		int				depth;
+		int				count;
+		float			microSec;
+	};
+	idList< gpuProfileRow_t > rows;
+
+	const idList< gpuProfileScope_t, TAG_RENDER > & scopes = m_backend.GetGPUProfile();
+	for ( int i = 0; i < scopes.Num(); ++i ) {
+		const gpuProfileScope_t & scope = scopes[ i ];
+
+		int row = 0;
+		for ( ; row < rows.Num(); ++row ) {
+			if ( rows[ row ].depth == scope.depth && idStr::Cmp( rows[ row ].name, scope.name ) == 0 ) {
+				break;
+			}
+		}
+		if ( row == rows.Num() ) {
+			gpuProfileRow_t & newRow = rows.Alloc();
+			newRow.name = scope.name;
+			newRow.depth = scope.depth;
+			newRow.count = 0;
+			newRow.microSec = 0.0f;
+		}
+		rows[ row ].count++;
+		rows[ row ].microSec += scope.durationMicroSec;
+	}
+
+	int y = 64;
+	DrawSmallStringExt( 8, y, va( "GPU frame %24.2f ms", m_backend.GetGPUProfileFrameMicroSec() * 0.001f ), colorYellow, true );
+	y += SMALLCHAR_HEIGHT;
+
+	for ( int i = 0; i < rows.Num(); ++i ) {
+		const gpuProfileRow_t & row = rows[ i ];
+		const idStr name = va( "%*s%s", row.depth * 2, "", row.name );
+		DrawSmallStringExt( 8, y, va( "%-24s %4d %6.2f ms", name.c_str(), row.count, row.microSec * 0.001f ), colorWhite, true );
+		y += SMALLCHAR_HEIGHT;
+	}
+}
@@ -139,6 +139,7 @@ private:
 
 	// Lights
 	void					AddLights();
+	void					AddClusteredLights();
 
 	// Models
 	void					AddModels();
@@ -161,6 +162,7 @@ private:
 	void					ReadTiledPixels( int width, int height, byte * buffer, renderView_t * ref = NULL );
 
 	void					PrintPerformanceCounters();
+	void					DrawGPUProfile();
 
 public:
 	int						frameCount;			// incremented every frame
@@ -237,6 +239,7 @@ private:
 	class idGuiModel *		m_guiModel;
 
 	idParallelJobList *		m_frontEndJobList;
+	idParallelJobList *		m_portalCullJobList;	// m_frontEndJobList may still have shadow jobs running during the portal flood
 
 	idRenderBackend			m_backend;
 
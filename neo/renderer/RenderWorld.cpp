@@ -52,6 +52,20 @@ extern idCVar r_useNodeCommonChildren;
 extern idCVar r_debugArrowStep;
 extern idCVar r_znear;
 
+extern idCVar r_lightAllBackFaces;
+extern idCVar r_skipPrelightShadows;
+
+idCVar r_useParallelGenerateInteractions( "r_useParallelGenerateInteractions", "1", CVAR_RENDERER | CVAR_BOOL, "create the static interactions at map load in parallel with jobs" );
+idCVar r_useEntityBoundsTree( "r_useEntityBoundsTree", "1", CVAR_RENDERER | CVAR_BOOL, "find the entities hit by render world traces with the entity bounds tree instead of the area references" );
+idCVar r_useStaticInteractionCache( "r_useStaticInteractionCache", "1", CVAR_RENDERER | CVAR_BOOL, "read the static interactions from a generated file at map load when they are still valid" );
+
+// generated file with the static interaction surfaces of a map
+static const byte BINTERACTION_VERSION = 1;
+static const unsigned int BINTERACTION_MAGIC = ( 'I' << 24 ) | ( 'N' << 16 ) | ( 'T' << 8 ) | BINTERACTION_VERSION;
+
+// static interactions that are created before their surfaces are turned into static index caches
+static const int STATIC_INTERACTION_BATCH_SIZE = 256;
+
 /*
 ===============
 R_RemapShaderBySkin
@@ -182,10 +196,6 @@ idRenderWorld::idRenderWorld() {
 	m_doublePortals = NULL;
 	m_numInterAreaPortals = 0;
 
-	m_interactionTable = 0;
-	m_interactionTableWidth = 0;
-	m_interactionTableHeight = 0;
-
 	for ( int i = 0; i < m_decals.Num(); i++ ) {
 		m_decals[i].entityHandle = -1;
 		m_decals[i].lastStartTime = 0;
@@ -197,6 +207,10 @@ idRenderWorld::idRenderWorld() {
 		m_overlays[i].lastStartTime = 0;
 		m_overlays[i].overlays = new (TAG_MODEL) idRenderModelOverlay();
 	}
+
+	m_viewAreaVisits.SetGranularity( 256 );
+	m_viewAreaPlanes.SetGranularity( 1024 );
+	m_viewAreaReferences.SetGranularity( 1024 );
 }
 
 /*
@@ -225,30 +239,491 @@ idRenderWorld::~idRenderWorld() {
 
 /*
 ===================
-ResizeInteractionTable
+idInteractionTable::idInteractionTable
+===================
+*/
+idInteractionTable::idInteractionTable() {
+	rows.SetGranularity( 256 );
+}
+
+/*
+===================
+idInteractionTable::~idInteractionTable
+===================
+*/
+idInteractionTable::~idInteractionTable() {
+	Clear();
+}
+
+/*
+===================
+idInteractionTable::Set
+===================
+*/
+void idInteractionTable::Set( int lightIndex, int entityIndex, idInteraction * interaction ) {
+	assert( lightIndex >= 0 && entityIndex >= 0 );
+
+	if ( interaction == NULL ) {
+		if ( lightIndex < rows.Num() ) {
+			Remove( rows[lightIndex], entityIndex );
+		}
+		return;
+	}
+
+	// only the list of row headers is copied when lights are added
+	if ( lightIndex >= rows.Num() ) {
+		const row_t emptyRow = { NULL, 0, 0 };
+		rows.AssureSize( lightIndex + 1, emptyRow );
+	}
+
+	row_t & row = rows[lightIndex];
+	if ( row.entries == NULL ) {
+		ResizeRow( row, MIN_ROW_ENTRIES );
+	} else if ( ( row.num + 1 ) * 2 > row.mask + 1 ) {
+		ResizeRow( row, ( row.mask + 1 ) * 2 );
+	}
+
+	int i = Hash( entityIndex ) & row.mask;
+	while ( row.entries[i].interaction != NULL && row.entries[i].entityIndex != entityIndex ) {
+		i = ( i + 1 ) & row.mask;
+	}
+	if ( row.entries[i].interaction == NULL ) {
+		row.entries[i].entityIndex = entityIndex;
+		row.num++;
+	}
+	row.entries[i].interaction = interaction;
+}
+
+/*
+===================
+idInteractionTable::Remove
+
+Shifts the following entries of the probe sequence back so no tombstones are needed.
+===================
+*/
+void idInteractionTable::Remove( row_t & row, int entityIndex ) {
+	if ( row.entries == NULL ) {
+		return;
+	}
+
+	int i = Hash( entityIndex ) & row.mask;
+	while ( row.entries[i].entityIndex != entityIndex ) {
+		if ( row.entries[i].interaction == NULL ) {
+			return;
+		}
+		i = ( i + 1 ) & row.mask;
+	}
+	if ( row.entries[i].interaction == NULL ) {
+		return;
+	}
+
+	for ( int j = ( i + 1 ) & row.mask; row.entries[j].interaction != NULL; j = ( j + 1 ) & row.mask ) {
+		// the entry at j can move back to the hole at i if its home is not cyclically in ( i, j ]
+		const int home = Hash( row.entries[j].entityIndex ) & row.mask;
+		if ( ( i <= j ) ? ( home <= i || home > j ) : ( home <= i && home > j ) ) {
+			row.entries[i] = row.entries[j];
+			i = j;
+		}
+	}
+	row.entries[i].interaction = NULL;
+
+	// lights without any interactions don't keep any memory
+	if ( --row.num == 0 ) {
+		Mem_Free( row.entries );
+		row.entries = NULL;
+		row.mask = 0;
+	}
+}
+
+/*
+===================
+idInteractionTable::ResizeRow
 ===================
 */
-void idRenderWorld::ResizeInteractionTable() {
-	// we overflowed the interaction table, so make it larger
-	idLib::Printf( "idRenderWorld::ResizeInteractionTable: overflowed interactionTable, resizing\n" );
+void idInteractionTable::ResizeRow( row_t & row, int numEntries ) {
+	assert( idMath::IsPowerOfTwo( numEntries ) );
 
-	const int oldInteractionTableWidth = m_interactionTableWidth;
-	const int oldIinteractionTableHeight = m_interactionTableHeight;
-	idInteraction ** oldInteractionTable = m_interactionTable;
+	entry_t * oldEntries = row.entries;
+	const int oldNumEntries = ( oldEntries != NULL ) ? row.mask + 1 : 0;
 
-	// build the interaction table
-	// this will be dynamically resized if the entity / light counts grow too much
-	m_interactionTableWidth = m_entityDefs.Num() + 100;
-	m_interactionTableHeight = m_lightDefs.Num() + 100;
-	const int	size =  m_interactionTableWidth * m_interactionTableHeight * sizeof( *m_interactionTable );
-	m_interactionTable = (idInteraction **)R_ClearedStaticAlloc( size );
-	for ( int l = 0; l < oldIinteractionTableHeight; l++ ) {
-		for ( int e = 0; e < oldInteractionTableWidth; e++ ) {
-			m_interactionTable[ l * m_interactionTableWidth + e ] = oldInteractionTable[ l * oldInteractionTableWidth + e ];
+	row.entries = (entry_t *)Mem_ClearedAlloc( numEntries * sizeof( entry_t ), TAG_RENDER_INTERACTION );
+	row.mask = numEntries - 1;
+
+	for ( int i = 0; i < oldNumEntries; i++ ) {
+		if ( oldEntries[i].interaction == NULL ) {
+			continue;
+		}
+		int j = Hash( oldEntries[i].entityIndex ) & row.mask;
+		while ( row.entries[j].interaction != NULL ) {
+			j = ( j + 1 ) & row.mask;
+		}
+		row.entries[j] = oldEntries[i];
+	}
+
+	if ( oldEntries != NULL ) {
+		Mem_Free( oldEntries );
+	}
+}
+
+/*
+===================
+idInteractionTable::Clear
+===================
+*/
+void idInteractionTable::Clear() {
+	for ( int i = 0; i < rows.Num(); i++ ) {
+		if ( rows[i].entries != NULL ) {
+			Mem_Free( rows[i].entries );
 		}
 	}
+	rows.Clear();
+}
+
+/*
+===================
+idInteractionTable::Num
+===================
+*/
+int idInteractionTable::Num() const {
+	int num = 0;
+	for ( int i = 0; i < rows.Num(); i++ ) {
+		num += rows[i].num;
+	}
+	return num;
+}
 
-	R_StaticFree( oldInteractionTable );
+/*
+===================
+idInteractionTable::Allocated
+===================
+*/
+size_t idInteractionTable::Allocated() const {
+	size_t allocated = rows.Allocated();
+	for ( int i = 0; i < rows.Num(); i++ ) {
+		if ( rows[i].entries != NULL ) {
+			allocated += ( rows[i].mask + 1 ) * sizeof( entry_t );
+		}
+	}
+	return allocated;
+}
+
+// leaves are expanded by this much so small movements don't need a reinsert
+static const float ENTITY_TREE_LEAF_MARGIN = 16.0f;
+
+/*
+===================
+idEntityBoundsTree::idEntityBoundsTree
+===================
+*/
+idEntityBoundsTree::idEntityBoundsTree() {
+	nodes.SetGranularity( 1024 );
+	root = -1;
+	freeNodes = -1;
+	numLeafs = 0;
+}
+
+/*
+===================
+idEntityBoundsTree::~idEntityBoundsTree
+===================
+*/
+idEntityBoundsTree::~idEntityBoundsTree() {
+	Clear();
+}
+
+/*
+===================
+idEntityBoundsTree::Update
+
+Entities that stay inside their expanded leaf bounds are left in place, entities
+that moved out of them or shrunk a lot are removed and inserted again.
+===================
+*/
+void idEntityBoundsTree::Update( idRenderEntity * entity ) {
+	const idBounds & bounds = entity->globalReferenceBounds;
+
+	int leaf = entity->boundsTreeLeaf;
+	if ( leaf != -1 ) {
+		const idBounds & leafBounds = nodes[leaf].bounds;
+		const idBounds looseBounds = bounds.Expand( 4.0f * ENTITY_TREE_LEAF_MARGIN );
+		if ( leafBounds.ContainsPoint( bounds[0] ) && leafBounds.ContainsPoint( bounds[1] )
+				&& looseBounds.ContainsPoint( leafBounds[0] ) && looseBounds.ContainsPoint( leafBounds[1] ) ) {
+			return;
+		}
+		RemoveLeaf( leaf );
+	} else {
+		leaf = AllocNode();
+		nodes[leaf].entity = entity;
+		entity->boundsTreeLeaf = leaf;
+		numLeafs++;
+	}
+
+	nodes[leaf].bounds = bounds.Expand( ENTITY_TREE_LEAF_MARGIN );
+	InsertLeaf( leaf );
+}
+
+/*
+===================
+idEntityBoundsTree::Remove
+===================
+*/
+void idEntityBoundsTree::Remove( idRenderEntity * entity ) {
+	const int leaf = entity->boundsTreeLeaf;
+	if ( leaf == -1 ) {
+		return;
+	}
+	assert( nodes[leaf].entity == entity );
+
+	RemoveLeaf( leaf );
+	FreeNode( leaf );
+	entity->boundsTreeLeaf = -1;
+	numLeafs--;
+}
+
+/*
+===================
+idEntityBoundsTree::Clear
+===================
+*/
+void idEntityBoundsTree::Clear() {
+	for ( int i = 0; i < nodes.Num(); i++ ) {
+		if ( nodes[i].height == 0 && nodes[i].entity != NULL ) {
+			nodes[i].entity->boundsTreeLeaf = -1;
+		}
+	}
+	nodes.Clear();
+	root = -1;
+	freeNodes = -1;
+	numLeafs = 0;
+}
+
+/*
+===================
+idEntityBoundsTree::AllocNode
+===================
+*/
+int idEntityBoundsTree::AllocNode() {
+	int nodeNum = freeNodes;
+	if ( nodeNum != -1 ) {
+		freeNodes = nodes[nodeNum].parent;
+	} else {
+		nodeNum = nodes.Num();
+		nodes.Alloc();
+	}
+
+	node_t & node = nodes[nodeNum];
+	node.parent = -1;
+	node.children[0] = -1;
+	node.children[1] = -1;
+	node.height = 0;
+	node.entity = NULL;
+	return nodeNum;
+}
+
+/*
+===================
+idEntityBoundsTree::FreeNode
+===================
+*/
+void idEntityBoundsTree::FreeNode( int nodeNum ) {
+	node_t & node = nodes[nodeNum];
+	node.parent = freeNodes;
+	node.height = -1;
+	node.entity = NULL;
+	freeNodes = nodeNum;
+}
+
+/*
+===================
+idEntityBoundsTree::Cost
+
+Half the surface area, which is proportional to the chance of a random ray hitting the bounds.
+===================
+*/
+float idEntityBoundsTree::Cost( const idBounds & bounds ) {
+	const idVec3 size = bounds[1] - bounds[0];
+	return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+/*
+===================
+idEntityBoundsTree::InsertLeaf
+
+Walks down the tree towards the cheapest sibling for the leaf, where the cost of a
+sibling is the area of the new parent plus the area increase of all its ancestors.
+===================
+*/
+void idEntityBoundsTree::InsertLeaf( int leaf ) {
+	if ( root == -1 ) {
+		root = leaf;
+		nodes[leaf].parent = -1;
+		return;
+	}
+
+	const idBounds leafBounds = nodes[leaf].bounds;
+
+	int sibling = root;
+	while ( nodes[sibling].height > 0 ) {
+		const node_t & node = nodes[sibling];
+
+		const float area = Cost( node.bounds );
+		const float combinedArea = Cost( node.bounds + leafBounds );
+
+		// cost of creating a new parent for this node and the leaf
+		const float cost = 2.0f * combinedArea;
+
+		// minimum cost of pushing the leaf further down the tree
+		const float inheritanceCost = 2.0f * ( combinedArea - area );
+
+		float childCost[2];
+		for ( int i = 0; i < 2; i++ ) {
+			const node_t & child = nodes[node.children[i]];
+			if ( child.height == 0 ) {
+				childCost[i] = Cost( child.bounds + leafBounds ) + inheritanceCost;
+			} else {
+				childCost[i] = Cost( child.bounds + leafBounds ) - Cost( child.bounds ) + inheritanceCost;
+			}
+		}
+
+		if ( cost < childCost[0] && cost < childCost[1] ) {
+			break;
+		}
+
+		sibling = node.children[ ( childCost[0] < childCost[1] ) ? 0 : 1 ];
+	}
+
+	// the node list may be reallocated here
+	const int oldParent = nodes[sibling].parent;
+	const int newParent = AllocNode();
+
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].bounds = nodes[sibling].bounds + leafBounds;
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].children[0] = sibling;
+	nodes[newParent].children[1] = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if ( oldParent == -1 ) {
+		root = newParent;
+	} else if ( nodes[oldParent].children[0] == sibling ) {
+		nodes[oldParent].children[0] = newParent;
+	} else {
+		nodes[oldParent].children[1] = newParent;
+	}
+
+	RefitParents( newParent );
+}
+
+/*
+===================
+idEntityBoundsTree::RemoveLeaf
+
+Unlinks the leaf and frees its parent, the leaf node itself is kept.
+===================
+*/
+void idEntityBoundsTree::RemoveLeaf( int leaf ) {
+	if ( leaf == root ) {
+		root = -1;
+		return;
+	}
+
+	const int parent = nodes[leaf].parent;
+	const int grandParent = nodes[parent].parent;
+	const int sibling = ( nodes[parent].children[0] == leaf ) ? nodes[parent].children[1] : nodes[parent].children[0];
+
+	nodes[sibling].parent = grandParent;
+	FreeNode( parent );
+
+	if ( grandParent == -1 ) {
+		root = sibling;
+		return;
+	}
+
+	if ( nodes[grandParent].children[0] == parent ) {
+		nodes[grandParent].children[0] = sibling;
+	} else {
+		nodes[grandParent].children[1] = sibling;
+	}
+
+	RefitParents( grandParent );
+}
+
+/*
+===================
+idEntityBoundsTree::RefitParents
+
+Rebalances and recalculates the bounds and heights from the given node up to the root.
+===================
+*/
+void idEntityBoundsTree::RefitParents( int nodeNum ) {
+	while ( nodeNum != -1 ) {
+		nodeNum = Balance( nodeNum );
+
+		node_t & node = nodes[nodeNum];
+		const node_t & child0 = nodes[node.children[0]];
+		const node_t & child1 = nodes[node.children[1]];
+		node.height = 1 + Max( child0.height, child1.height );
+		node.bounds = child0.bounds + child1.bounds;
+
+		nodeNum = node.parent;
+	}
+}
+
+/*
+===================
+idEntityBoundsTree::Balance
+
+If one child of the node is more than one level higher than the other, it
+is rotated up into the place of the node. Returns the node that is now at
+the position of the given node.
+===================
+*/
+int idEntityBoundsTree::Balance( int a ) {
+	if ( nodes[a].height < 2 ) {
+		return a;
+	}
+
+	for ( int side = 0; side < 2; side++ ) {
+		const int b = nodes[a].children[side];		// the higher child that is rotated up
+		const int c = nodes[a].children[side ^ 1];	// the other child that stays with a
+		if ( nodes[b].height - nodes[c].height <= 1 ) {
+			continue;
+		}
+
+		const int f = nodes[b].children[0];
+		const int g = nodes[b].children[1];
+
+		// b takes the place of a
+		nodes[b].children[0] = a;
+		nodes[b].parent = nodes[a].parent;
+		nodes[a].parent = b;
+
+		if ( nodes[b].parent == -1 ) {
+			root = b;
+		} else if ( nodes[ nodes[b].parent ].children[0] == a ) {
+			nodes[ nodes[b].parent ].children[0] = b;
+		} else {
+			nodes[ nodes[b].parent ].children[1] = b;
+		}
+
+		// the higher grandchild stays with b, the other one moves to a
+		const int keep = ( nodes[f].height > nodes[g].height ) ? f : g;
+		const int move = ( keep == f ) ? g : f;
+
+		nodes[b].children[1] = keep;
+		nodes[a].children[side] = move;
+		nodes[move].parent = a;
+
+		nodes[a].bounds = nodes[c].bounds + nodes[move].bounds;
+		nodes[a].height = 1 + Max( nodes[c].height, nodes[move].height );
+		nodes[b].bounds = nodes[a].bounds + nodes[keep].bounds;
+		nodes[b].height = 1 + Max( nodes[a].height, nodes[keep].height );
+
+		return b;
+	}
+
+	return a;
 }
 
 /*
@@ -261,10 +736,6 @@ qhandle_t idRenderWorld::AddEntityDef( const renderEntity_t *re ){
 	int entityHandle = m_entityDefs.FindNull();
 	if ( entityHandle == -1 ) {
 		entityHandle = m_entityDefs.Append( NULL );
-
-		if ( m_interactionTable && m_entityDefs.Num() > m_interactionTableWidth ) {
-			ResizeInteractionTable();
-		}
 	}
 
 	UpdateEntityDef( entityHandle, re );
@@ -358,6 +829,7 @@ void idRenderWorld::UpdateEntityDef( qhandle_t entityHandle, const renderEntity_
 	// trigger entities don't need to get linked in and processed,
 	// they only exist for editor use
 	if ( def->parms.hModel != NULL && !def->parms.hModel->ModelHasDrawingSurfaces() ) {
+		m_entityBoundsTree.Remove( def );
 		return;
 	}
 
@@ -389,6 +861,7 @@ void idRenderWorld::FreeEntityDef( qhandle_t entityHandle ) {
 	}
 
 	FreeEntityDefDerivedData( def, false, false );
+	m_entityBoundsTree.Remove( def );
 
 	// if we are playing a demo, these will have been freed
 	// in FreeEntityDefDerivedData(), otherwise the gui
@@ -435,9 +908,6 @@ qhandle_t idRenderWorld::AddLightDef( const renderLight_t *rlight ) {
 
 	if ( lightHandle == -1 ) {
 		lightHandle = m_lightDefs.Append( NULL );
-		if ( m_interactionTable && m_lightDefs.Num() > m_interactionTableHeight ) {
-			ResizeInteractionTable();
-		}
 	}
 	UpdateLightDef( lightHandle, rlight );
 
@@ -1054,6 +1524,12 @@ bool idRenderWorld::ModelTrace( modelTrace_t &trace, qhandle_t entityHandle, con
 		return false;
 	}
 
+	// the model is inside the reference bounds of a linked entity, so don't
+	// instantiate a dynamic model for a trace that can't hit it anyway
+	if ( def->entityRefs != NULL && !def->globalReferenceBounds.Expand( radius ).LineIntersection( start, end ) ) {
+		return false;
+	}
+
 	renderEntity_t *refEnt = &def->parms;
 
 	idRenderModel *model = R_EntityDefDynamicModel( def );
@@ -1120,11 +1596,6 @@ bool idRenderWorld::ModelTrace( modelTrace_t &trace, qhandle_t entityHandle, con
 	return ( trace.fraction < 1.0f );
 }
 
-/*
-===================
-idRenderWorld::Trace
-===================
-*/
 // FIXME: _D3XP added those.
 const char * playerModelExcludeList[] = {
 	"models/md5/characters/player/d3xp_spplayer.md5mesh",
@@ -1138,7 +1609,118 @@ const char * playerMaterialExcludeList[] = {
 	NULL
 };
 
+/*
+===================
+R_TraceEntityDef
+
+Traces against all surfaces of the entity and updates the trace if something closer was hit.
+The trace bounds are shrunk to the hit point, so further entities can be rejected quickly.
+===================
+*/
+static void R_TraceEntityDef( modelTrace_t &trace, idBounds &traceBounds, idRenderEntity *def, const idVec3 &start, const idVec3 &end, const float radius, bool skipDynamic, bool skipPlayer ) {
+	idRenderModel * model = def->parms.hModel;
+	if ( model == NULL ) {
+		return;
+	}
+
+	if ( model->IsDynamicModel() != DM_STATIC ) {
+		if ( skipDynamic ) {
+			return;
+		}
+
+#if 1	/* _D3XP addition. could use a cleaner approach */
+		if ( skipPlayer ) {
+			for ( int k = 0; playerModelExcludeList[k] != NULL; k++ ) {
+				if ( idStr::Cmp( model->Name(), playerModelExcludeList[k] ) == 0 ) {
+					return;
+				}
+			}
+		}
+#endif
+
+		model = R_EntityDefDynamicModel( def );
+		if ( !model ) {
+			return;	// can happen with particle systems, which don't instantiate without a valid view
+		}
+	}
+
+	idBounds bounds;
+	bounds.FromTransformedBounds( model->Bounds( &def->parms ), def->parms.origin, def->parms.axis );
+
+	// if the model bounds do not overlap with the trace bounds
+	if ( !traceBounds.IntersectsBounds( bounds ) || !bounds.LineIntersection( start, trace.point ) ) {
+		return;
+	}
+
+	// check all model surfaces
+	for ( int j = 0; j < model->NumSurfaces(); j++ ) {
+		const modelSurface_t *surf = model->Surface( j );
+
+		const idMaterial * shader = R_RemapShaderBySkin( surf->shader, def->parms.customSkin, def->parms.customShader );
+
+		// if no geometry or no shader
+		if ( surf->geometry == NULL || shader == NULL ) {
+			continue;
+		}
+
+#if 1 /* _D3XP addition. could use a cleaner approach */
+		if ( skipPlayer ) {
+			bool exclude = false;
+			for ( int k = 0; playerMaterialExcludeList[k] != NULL; k++ ) {
+				if ( idStr::Cmp( shader->GetName(), playerMaterialExcludeList[k] ) == 0 ) {
+					exclude = true;
+					break;
+				}
+			}
+			if ( exclude ) {
+				continue;
+			}
+		}
+#endif
+
+		const srfTriangles_t * tri = surf->geometry;
+
+		bounds.FromTransformedBounds( tri->bounds, def->parms.origin, def->parms.axis );
+
+		// if triangle bounds do not overlap with the trace bounds
+		if ( !traceBounds.IntersectsBounds( bounds ) || !bounds.LineIntersection( start, trace.point ) ) {
+			continue;
+		}
+
+		// transform the points into local space
+		float modelMatrix[16];
+		idVec3 localStart, localEnd;
+		R_AxisToModelMatrix( def->parms.axis, def->parms.origin, modelMatrix );
+		R_GlobalPointToLocal( modelMatrix, start, localStart );
+		R_GlobalPointToLocal( modelMatrix, end, localEnd );
+
+		localTrace_t localTrace = R_LocalTrace( localStart, localEnd, radius, surf->geometry );
+
+		if ( localTrace.fraction < trace.fraction ) {
+			trace.fraction = localTrace.fraction;
+			R_LocalPointToGlobal( modelMatrix, localTrace.point, trace.point );
+			trace.normal = localTrace.normal * def->parms.axis;
+			trace.material = shader;
+			trace.entity = &def->parms;
+			trace.jointNumber = model->NearestJoint( j, localTrace.indexes[0], localTrace.indexes[1], localTrace.indexes[2] );
+
+			traceBounds.Clear();
+			traceBounds.AddPoint( start );
+			traceBounds.AddPoint( start + trace.fraction * (end - start) );
+		}
+	}
+}
+
+/*
+===================
+idRenderWorld::Trace
+===================
+*/
 bool idRenderWorld::Trace( modelTrace_t &trace, const idVec3 &start, const idVec3 &end, const float radius, bool skipDynamic, bool skipPlayer /*_D3XP*/ ) const {
+	if ( r_useEntityBoundsTree.GetBool() ) {
+		return ( TraceBatch( &trace, &start, &end, 1, radius, skipDynamic, skipPlayer ) > 0 );
+	}
+
 	trace.fraction = 1.0f;
 	trace.point = end;
 
@@ -1152,8 +1734,6 @@ bool idRenderWorld::Trace( modelTrace_t &trace, const idVec3 &start, const idVec
 	int areas[128];
 	int numAreas = BoundsInAreas( traceBounds, areas, 128 );
 
-	int numSurfaces = 0;
-
 	// check all areas for models
 	for ( int i = 0; i < numAreas; i++ ) {
 
@@ -1161,109 +1741,100 @@ bool idRenderWorld::Trace( modelTrace_t &trace, const idVec3 &start, const idVec
 
 		// check all models in this area
 		for ( areaReference_t * ref = area->entityRefs.areaNext; ref != &area->entityRefs; ref = ref->areaNext ) {
-			idRenderEntity * def = ref->entity;
+			R_TraceEntityDef( trace, traceBounds, ref->entity, start, end, radius, skipDynamic, skipPlayer );
+		}
+	}
+	return ( trace.fraction < 1.0f );
+}
 
-			idRenderModel * model = def->parms.hModel;
-			if ( model == NULL ) {
-				continue;
-			}
+/*
+===================
+idRenderWorld::TraceBatch
 
-			if ( model->IsDynamicModel() != DM_STATIC ) {
-				if ( skipDynamic ) {
-					continue;
-				}
+The rays are traced in packets, the entity bounds tree is walked once per packet
+with a mask of the rays that can still hit something below each node. Rays that
+hit something get shorter, so they drop out of the rest of the walk early.
+===================
+*/
+int idRenderWorld::TraceBatch( modelTrace_t *traces, const idVec3 *starts, const idVec3 *ends, const int numRays, const float radius, bool skipDynamic, bool skipPlayer ) const {
+	struct traceStack_t {
+		int				nodeNum;
+		unsigned int	rayMask;
+	};
+
+	const int TRACE_PACKET_SIZE = 32;
+
+	// depth first with the second child pushed, so the stack never gets deeper than the tree
+	traceStack_t * stack = (traceStack_t *)_alloca( ( m_entityBoundsTree.Height() + 2 ) * sizeof( traceStack_t ) );
+
+	int numHits = 0;
+	for ( int first = 0; first < numRays; first += TRACE_PACKET_SIZE ) {
+		const int numPacketRays = Min( TRACE_PACKET_SIZE, numRays - first );
+		modelTrace_t * packetTraces = traces + first;
+		const idVec3 * packetStarts = starts + first;
+		const idVec3 * packetEnds = ends + first;
+
+		// bounds for the whole trace of each ray
+		idBounds traceBounds[TRACE_PACKET_SIZE];
+		for ( int i = 0; i < numPacketRays; i++ ) {
+			packetTraces[i].fraction = 1.0f;
+			packetTraces[i].point = packetEnds[i];
+			traceBounds[i].Clear();
+			traceBounds[i].AddPoint( packetStarts[i] );
+			traceBounds[i].AddPoint( packetEnds[i] );
+		}
 
-#if 1	/* _D3XP addition. could use a cleaner approach */
-				if ( skipPlayer ) {
-					bool exclude = false;
-					for ( int k = 0; playerModelExcludeList[k] != NULL; k++ ) {
-						if ( idStr::Cmp( model->Name(), playerModelExcludeList[k] ) == 0 ) {
-							exclude = true;
-							break;
-						}
-					}
-					if ( exclude ) {
-						continue;
-					}
-				}
-#endif
+		int stackDepth = 0;
+		if ( m_entityBoundsTree.Root() != -1 ) {
+			stack[0].nodeNum = m_entityBoundsTree.Root();
+			stack[0].rayMask = (unsigned int)( BIT( numPacketRays ) - 1 );
+			stackDepth = 1;
+		}
+
+		while ( stackDepth > 0 ) {
+			stackDepth--;
+			const idEntityBoundsTree::node_t & node = m_entityBoundsTree.Node( stack[stackDepth].nodeNum );
+			const unsigned int parentMask = stack[stackDepth].rayMask;
 
-				model = R_EntityDefDynamicModel( def );
-				if ( !model ) {
-					continue;	// can happen with particle systems, which don't instantiate without a valid view
+			// only keep the rays that pass through the node bounds
+			unsigned int rayMask = 0;
+			for ( int i = 0; i < numPacketRays; i++ ) {
+				if ( ( parentMask & ( 1u << i ) ) == 0 ) {
+					continue;
+				}
+				if ( node.bounds.IntersectsBounds( traceBounds[i] ) && node.bounds.LineIntersection( packetStarts[i], packetTraces[i].point ) ) {
+					rayMask |= ( 1u << i );
 				}
 			}
-
-			idBounds bounds;
-			bounds.FromTransformedBounds( model->Bounds( &def->parms ), def->parms.origin, def->parms.axis );
-
-			// if the model bounds do not overlap with the trace bounds
-			if ( !traceBounds.IntersectsBounds( bounds ) || !bounds.LineIntersection( start, trace.point ) ) {
+			if ( rayMask == 0 ) {
 				continue;
 			}
 
-			// check all model surfaces
-			for ( int j = 0; j < model->NumSurfaces(); j++ ) {
-				const modelSurface_t *surf = model->Surface( j );
-
-				const idMaterial * shader = R_RemapShaderBySkin( surf->shader, def->parms.customSkin, def->parms.customShader );
-
-				// if no geometry or no shader
-				if ( surf->geometry == NULL || shader == NULL ) {
-					continue;
-				}
-
-#if 1 /* _D3XP addition. could use a cleaner approach */
-				if ( skipPlayer ) {
-					bool exclude = false;
-					for ( int k = 0; playerMaterialExcludeList[k] != NULL; k++ ) {
-						if ( idStr::Cmp( shader->GetName(), playerMaterialExcludeList[k] ) == 0 ) {
-							exclude = true;
-							break;
-						}
-					}
-					if ( exclude ) {
-						continue;
+			if ( node.height == 0 ) {
+				for ( int i = 0; i < numPacketRays; i++ ) {
+					if ( rayMask & ( 1u << i ) ) {
+						R_TraceEntityDef( packetTraces[i], traceBounds[i], node.entity, packetStarts[i], packetEnds[i], radius, skipDynamic, skipPlayer );
 					}
 				}
-#endif
-
-				const srfTriangles_t * tri = surf->geometry;
-
-				bounds.FromTransformedBounds( tri->bounds, def->parms.origin, def->parms.axis );
-
-				// if triangle bounds do not overlap with the trace bounds
-				if ( !traceBounds.IntersectsBounds( bounds ) || !bounds.LineIntersection( start, trace.point ) ) {
-					continue;
-				}
-
-				numSurfaces++;
-
-				// transform the points into local space
-				float modelMatrix[16];
-				idVec3 localStart, localEnd;
-				R_AxisToModelMatrix( def->parms.axis, def->parms.origin, modelMatrix );
-				R_GlobalPointToLocal( modelMatrix, start, localStart );
-				R_GlobalPointToLocal( modelMatrix, end, localEnd );
-
-				localTrace_t localTrace = R_LocalTrace( localStart, localEnd, radius, surf->geometry );
+				continue;
+			}
 
-				if ( localTrace.fraction < trace.fraction ) {
-					trace.fraction = localTrace.fraction;
-					R_LocalPointToGlobal( modelMatrix, localTrace.point, trace.point );
-					trace.normal = localTrace.normal * def->parms.axis;
-					trace.material = shader;
-					trace.entity = &def->parms;
-					trace.jointNumber = model->NearestJoint( j, localTrace.indexes[0], localTrace.indexes[1], localTrace.indexes[2] );
+			stack[stackDepth].nodeNum = node.children[1];
+			stack[stackDepth].rayMask = rayMask;
+			stackDepth++;
+			stack[stackDepth].nodeNum = node.children[0];
+			stack[stackDepth].rayMask = rayMask;
+			stackDepth++;
+		}
 
-					traceBounds.Clear();
-					traceBounds.AddPoint( start );
-					traceBounds.AddPoint( start + trace.fraction * (end - start) );
-				}
+		for ( int i = 0; i < numPacketRays; i++ ) {
+			if ( packetTraces[i].fraction < 1.0f ) {
+				numHits++;
 			}
 		}
 	}
-	return ( trace.fraction < 1.0f );
+
+	return numHits;
 }
 
 /*
@@ -1413,6 +1984,180 @@ void idRenderWorld::AddLightRefToArea( idRenderLight *light, portalArea_t *area
 	area->lightRefs.areaNext = lref;
 }
 
+/*
+===================
+R_StaticInteractionCacheFileName
+===================
+*/
+static void R_StaticInteractionCacheFileName( const char * mapName, idStrStatic< MAX_OSPATH > & fileName ) {
+	fileName = mapName;
+	fileName.Insert( "generated/", 0 );
+	fileName.SetFileExtension( "binteractions" );
+}
+
+/*
+===================
+R_OpenStaticInteractionCache
+
+Finds the cached record of every static interaction with a matching checksum, the
+records are read in batches by R_ReadStaticInteractionCache so the geometry of only
+a few interactions is in memory at once. Returns NULL if there is no valid cache file.
+===================
+*/
+static idFile * R_OpenStaticInteractionCache( const idRenderWorld * world, const idList< staticInteractionParms_t, TAG_RENDER_INTERACTION > & staticInteractions,
+											const idList< unsigned int, TAG_RENDER_INTERACTION > & checksums, idList< int, TAG_RENDER_INTERACTION > & cacheOffsets, int & numMatched ) {
+	idStrStatic< MAX_OSPATH > fileName;
+	R_StaticInteractionCacheFileName( world->m_mapName, fileName );
+
+	numMatched = 0;
+	idFile * file = fileSystem->OpenFileReadMemory( fileName );
+	if ( file == NULL ) {
+		return NULL;
+	}
+
+	unsigned int magic = 0;
+	idStr mapName;
+	ID_TIME_T mapTimeStamp = FILE_NOT_FOUND_TIMESTAMP;
+	bool lightAllBackFaces = false;
+	bool skipPrelightShadows = false;
+	int numRecords = 0;
+
+	file->ReadBig( magic );
+	if ( magic != BINTERACTION_MAGIC ) {
+		delete file;
+		return NULL;
+	}
+	file->ReadString( mapName );
+	file->ReadBig( mapTimeStamp );
+	file->ReadBool( lightAllBackFaces );
+	file->ReadBool( skipPrelightShadows );
+	file->ReadBig( numRecords );
+	if ( mapName.Icmp( world->m_mapName ) != 0 || mapTimeStamp != world->m_mapTimeStamp
+			|| lightAllBackFaces != r_lightAllBackFaces.GetBool() || skipPrelightShadows != r_skipPrelightShadows.GetBool() ) {
+		delete file;
+		return NULL;
+	}
+
+	// index the records by light / entity pair
+	struct cachedInteraction_t {
+		int				lightIndex;
+		int				entityIndex;
+		unsigned int	checksum;
+		int				offset;
+	};
+	idList< cachedInteraction_t, TAG_RENDER_INTERACTION > records;
+	idHashIndex recordHash( 1024, Max( numRecords, 1 ) );
+	records.SetNum( numRecords );
+	for ( int i = 0; i < numRecords; i++ ) {
+		cachedInteraction_t & record = records[i];
+		int size = 0;
+		file->ReadBig( record.lightIndex );
+		file->ReadBig( record.entityIndex );
+		file->ReadBig( record.checksum );
+		file->ReadBig( size );
+		record.offset = file->Tell();
+		file->Seek( size, FS_SEEK_CUR );
+		recordHash.Add( recordHash.GenerateKey( record.lightIndex, record.entityIndex ), i );
+	}
+
+	for ( int i = 0; i < staticInteractions.Num(); i++ ) {
+		const idInteraction * inter = staticInteractions[i].interaction;
+		const int lightIndex = inter->lightDef->index;
+		const int entityIndex = inter->entityDef->index;
+		const int key = recordHash.GenerateKey( lightIndex, entityIndex );
+		for ( int r = recordHash.First( key ); r != -1; r = recordHash.Next( r ) ) {
+			const cachedInteraction_t & record = records[r];
+			if ( record.lightIndex != lightIndex || record.entityIndex != entityIndex ) {
+				continue;
+			}
+			if ( record.checksum == checksums[i] ) {
+				cacheOffsets[i] = record.offset;
+				numMatched++;
+			}
+			break;
+		}
+	}
+
+	return file;
+}
+
+/*
+===================
+R_ReadStaticInteractionCache
+
+Reads the cached records of a batch of static interactions, an interaction
+that could not be read gets its cache offset cleared and has to be created.
+Returns the number of interactions that were read.
+===================
+*/
+static int R_ReadStaticInteractionCache( idFile * file, idList< staticInteractionParms_t, TAG_RENDER_INTERACTION > & staticInteractions,
+											idList< int, TAG_RENDER_INTERACTION > & cacheOffsets, int firstInteraction, int lastInteraction ) {
+	int numRead = 0;
+	for ( int i = firstInteraction; i < lastInteraction; i++ ) {
+		if ( cacheOffsets[i] < 0 ) {
+			continue;
+		}
+		file->Seek( cacheOffsets[i], FS_SEEK_SET );
+		if ( staticInteractions[i].interaction->ReadStaticInteraction( file, staticInteractions[i] ) ) {
+			numRead++;
+		} else {
+			cacheOffsets[i] = -1;
+		}
+	}
+	return numRead;
+}
+
+/*
+===================
+R_BeginStaticInteractionCache
+
+Writes the header of the cache file, the records follow batch by batch.
+===================
+*/
+static idFile * R_BeginStaticInteractionCache( const idRenderWorld * world, int numRecords ) {
+	idStrStatic< MAX_OSPATH > fileName;
+	R_StaticInteractionCacheFileName( world->m_mapName, fileName );
+
+	idFile * file = fileSystem->OpenFileWrite( fileName, "fs_basepath" );
+	if ( file == NULL ) {
+		return NULL;
+	}
+
+	file->WriteBig( BINTERACTION_MAGIC );
+	file->WriteString( world->m_mapName );
+	file->WriteBig( world->m_mapTimeStamp );
+	file->WriteBool( r_lightAllBackFaces.GetBool() );
+	file->WriteBool( r_skipPrelightShadows.GetBool() );
+	file->WriteBig( numRecords );
+	return file;
+}
+
+/*
+===================
+R_WriteStaticInteractionCache
+
+Writes the records of a batch of static interactions.
+===================
+*/
+static void R_WriteStaticInteractionCache( idFile * file, const idList< staticInteractionParms_t, TAG_RENDER_INTERACTION > & staticInteractions,
+											const idList< unsigned int, TAG_RENDER_INTERACTION > & checksums, int firstInteraction, int lastInteraction ) {
+	for ( int i = firstInteraction; i < lastInteraction; i++ ) {
+		const idInteraction * inter = staticInteractions[i].interaction;
+		file->WriteBig( inter->lightDef->index );
+		file->WriteBig( inter->entityDef->index );
+		file->WriteBig( checksums[i] );
+
+		// the size of the record is filled in afterwards so the reader can skip records
+		const int sizeOffset = file->Tell();
+		file->WriteBig( 0 );
+		inter->WriteStaticInteraction( file, staticInteractions[i] );
+		const int endOffset = file->Tell();
+		file->Seek( sizeOffset, FS_SEEK_SET );
+		file->WriteBig( endOffset - sizeOffset - (int)sizeof( int ) );
+		file->Seek( endOffset, FS_SEEK_SET );
+	}
+}
+
 /*
 ===================
 idRenderWorld::GenerateAllInteractions
@@ -1432,12 +2177,12 @@ void idRenderWorld::GenerateAllInteractions() {
 	// try and do any view specific optimizations
 	tr.m_viewDef = NULL;
 
-	// build the interaction table
-	// this will be dynamically resized if the entity / light counts grow too much
-	m_interactionTableWidth = m_entityDefs.Num() + 100;
-	m_interactionTableHeight = m_lightDefs.Num() + 100;
-	int	size =  m_interactionTableWidth * m_interactionTableHeight * sizeof( *m_interactionTable );
-	m_interactionTable = (idInteraction **)R_ClearedStaticAlloc( size );
+	// The interactions are allocated and linked serially, the light tris and shadow volumes
+	// are created with jobs, and the interactions are finished serially in the order in
+	// which they were allocated. The light and entity chains, the interaction table and
+	// the static index buffer end up the same as when everything is done serially.
+	idList< staticInteractionParms_t, TAG_RENDER_INTERACTION > staticInteractions;
+	staticInteractions.SetGranularity( 1024 );
 
 	// itterate through all lights
 	int	count = 0;
@@ -1478,18 +2223,98 @@ void idRenderWorld::GenerateAllInteractions() {
 				count++;
 
 				// the interaction may create geometry
-				inter->CreateStaticInteraction();
+				staticInteractions.Alloc().interaction = inter;
 			}
 		}
 
 		session->Pump();
 	}
 
+	// interactions that didn't change since the cache file was written don't need to be created again
+	idList< unsigned int, TAG_RENDER_INTERACTION > checksums;
+	idList< int, TAG_RENDER_INTERACTION > cacheOffsets;
+	checksums.SetNum( staticInteractions.Num() );
+	cacheOffsets.SetNum( staticInteractions.Num() );
+	for ( int i = 0; i < staticInteractions.Num(); i++ ) {
+		checksums[i] = staticInteractions[i].interaction->StaticInteractionChecksum();
+		cacheOffsets[i] = -1;
+	}
+
+	// the cache file is read into memory, so it can be written again while it is read
+	int numMatched = 0;
+	const bool useCache = r_useStaticInteractionCache.GetBool();
+	idFileLocal cacheFile( useCache ? R_OpenStaticInteractionCache( this, staticInteractions, checksums, cacheOffsets, numMatched ) : NULL );
+	idFileLocal writeCacheFile( ( useCache && numMatched < staticInteractions.Num() ) ? R_BeginStaticInteractionCache( this, staticInteractions.Num() ) : NULL );
+
+	idParallelJobList * jobList = NULL;
+	if ( r_useParallelGenerateInteractions.GetBool() ) {
+		jobList = parallelJobManager->AllocJobList( JOBLIST_UTILITY, JOBLIST_PRIORITY_MEDIUM, STATIC_INTERACTION_BATCH_SIZE, 0, NULL );
+	}
+
+	// The interactions are created and finished in batches, so only the light tris and
+	// shadow volumes of a single batch are kept around before they are turned into
+	// static index caches. The batches are finished in allocation order.
+	int numCached = 0;
+	bool cacheReadFailed = false;
+	for ( int firstInteraction = 0; firstInteraction < staticInteractions.Num(); firstInteraction += STATIC_INTERACTION_BATCH_SIZE ) {
+		const int lastInteraction = Min( firstInteraction + STATIC_INTERACTION_BATCH_SIZE, staticInteractions.Num() );
+
+		int numRead = 0;
+		if ( cacheFile != NULL ) {
+			int numBatchMatched = 0;
+			for ( int i = firstInteraction; i < lastInteraction; i++ ) {
+				numBatchMatched += ( cacheOffsets[i] >= 0 );
+			}
+			numRead = R_ReadStaticInteractionCache( cacheFile, staticInteractions, cacheOffsets, firstInteraction, lastInteraction );
+			numCached += numRead;
+			cacheReadFailed |= ( numRead < numBatchMatched );
+		}
+
+		if ( jobList != NULL && numRead < lastInteraction - firstInteraction ) {
+			for ( int i = firstInteraction; i < lastInteraction; i++ ) {
+				if ( cacheOffsets[i] < 0 ) {
+					jobList->AddJob( (jobRun_t)CreateStaticInteractionJob, &staticInteractions[i] );
+				}
+			}
+			jobList->Submit( NULL, JOBLIST_PARALLELISM_MAX_CORES );
+			jobList->Wait();
+		} else {
+			for ( int i = firstInteraction; i < lastInteraction; i++ ) {
+				if ( cacheOffsets[i] < 0 ) {
+					CreateStaticInteractionJob( &staticInteractions[i] );
+				}
+			}
+		}
+
+		// write the cache before the surfaces are freed by FinishStaticInteraction
+		if ( writeCacheFile != NULL ) {
+			R_WriteStaticInteractionCache( writeCacheFile, staticInteractions, checksums, firstInteraction, lastInteraction );
+		}
+
+		for ( int i = firstInteraction; i < lastInteraction; i++ ) {
+			staticInteractions[i].interaction->FinishStaticInteraction( staticInteractions[i] );
+		}
+
+		session->Pump();
+	}
+
+	if ( jobList != NULL ) {
+		parallelJobManager->FreeJobList( jobList );
+	}
+
+	// a record that matched but could not be read would fail again on the next load
+	if ( cacheReadFailed && writeCacheFile == NULL ) {
+		idStrStatic< MAX_OSPATH > fileName;
+		R_StaticInteractionCacheFileName( m_mapName, fileName );
+		fileSystem->RemoveFile( fileName );
+	}
+
 	int end = Sys_Milliseconds();
 	int	msec = end - start;
 
 	idLib::Printf( "idRenderWorld::GenerateAllInteractions, msec = %i\n", msec );
-	idLib::Printf( "interactionTable size: %i bytes\n", size );
+	idLib::Printf( "%i of %i static interactions read from the cache\n", numCached, staticInteractions.Num() );
+	idLib::Printf( "interactionTable size: %i bytes for %i light / entity pairs\n", (int)m_interactionTable.Allocated(), m_interactionTable.Num() );
 	idLib::Printf( "%i interactions take %i bytes\n", count, count * sizeof( idInteraction ) );
 }
 
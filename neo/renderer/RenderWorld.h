@@ -90,8 +90,164 @@ struct reusableOverlay_t {
 	idRenderModelOverlay *	overlays;
 };
 
+class idInteraction;
+
+/*
+===============================================================================
+
+	Interaction Table
+
+	Sparse lookup of the interaction between a lightDef and an entityDef.
+	Every lightDef has its own open addressed hash table of entityDef indexes,
+	so growing the table of one light never touches any other light and adding
+	lightDefs or entityDefs never copies any interactions.
+
+	Lookups may be done from multiple jobs at the same time as long as the
+	table is not modified.
+
+===============================================================================
+*/
+
+class idInteractionTable {
+public:
+							idInteractionTable();
+							~idInteractionTable();
+
+	// returns NULL if nothing is stored for the light / entity pair
+	idInteraction *			Get( int lightIndex, int entityIndex ) const;
+	// storing NULL removes the light / entity pair
+	void					Set( int lightIndex, int entityIndex, idInteraction * interaction );
+	// frees all memory
+	void					Clear();
+
+	// returns the number of stored light / entity pairs
+	int						Num() const;
+	// returns total size of allocated memory
+	size_t					Allocated() const;
+
+private:
+	struct entry_t {
+		idInteraction *		interaction;			// NULL if the entry is unused
+		int					entityIndex;
+	};
+
+	struct row_t {
+		entry_t *			entries;
+		int					mask;					// number of entries - 1
+		int					num;					// number of used entries
+	};
+
+	static const int		MIN_ROW_ENTRIES = 16;	// rows are kept at most half full
+
+	idList< row_t, TAG_RENDER_INTERACTION >	rows;	// indexed with the lightDef index
+
+	static int				Hash( int entityIndex ) { return (int)( ( (unsigned int)entityIndex * 2654435761U ) >> 8 ); }
+	void					Remove( row_t & row, int entityIndex );
+	void					ResizeRow( row_t & row, int numEntries );
+};
+
+/*
+========================
+idInteractionTable::Get
+========================
+*/
+ID_INLINE idInteraction * idInteractionTable::Get( int lightIndex, int entityIndex ) const {
+	if ( lightIndex >= rows.Num() ) {
+		return NULL;
+	}
+	const row_t & row = rows[lightIndex];
+	if ( row.entries == NULL ) {
+		return NULL;
+	}
+	for ( int i = Hash( entityIndex ) & row.mask; ; i = ( i + 1 ) & row.mask ) {
+		const entry_t & entry = row.entries[i];
+		if ( entry.interaction == NULL || entry.entityIndex == entityIndex ) {
+			return entry.interaction;
+		}
+	}
+}
+
+/*
+===============================================================================
+
+	Entity Bounds Tree
+
+	Dynamic bounding volume hierarchy over the global reference bounds of the
+	linked entityDefs, so a trace can find the entities it passes through
+	without walking the entity references of every area it touches.
+
+	Leaves store the reference bounds expanded by a margin, so an entity that
+	moves a little every frame is only reinserted when it leaves its expanded
+	bounds. Inserts pick the sibling with the lowest surface area cost and
+	the tree is kept height balanced with rotations.
+
+===============================================================================
+*/
+
+class idEntityBoundsTree {
+public:
+	struct node_t {
+		idBounds			bounds;			// expanded reference bounds for leaves
+		int					parent;			// next free node if the node is free
+		int					children[2];	// -1 for leaves
+		int					height;			// 0 for leaves, -1 for free nodes
+		idRenderEntity *	entity;			// NULL for interior nodes
+	};
+
+							idEntityBoundsTree();
+							~idEntityBoundsTree();
+
+	// inserts the entity with its current global reference bounds, or refits it if it is already in the tree
+	void					Update( idRenderEntity * entity );
+	// does nothing if the entity is not in the tree
+	void					Remove( idRenderEntity * entity );
+	// removes all entities and frees all memory
+	void					Clear();
+
+	// returns -1 if the tree is empty
+	int						Root() const { return root; }
+	const node_t &			Node( int nodeNum ) const { return nodes[nodeNum]; }
+
+	// returns the number of entities in the tree
+	int						Num() const { return numLeafs; }
+	int						Height() const { return ( root != -1 ) ? nodes[root].height : 0; }
+	// returns total size of allocated memory
+	size_t					Allocated() const { return nodes.Allocated(); }
+
+private:
+	idList< node_t, TAG_RENDER_ENTITY >	nodes;
+	int						root;
+	int						freeNodes;
+	int						numLeafs;
+
+	int						AllocNode();
+	void					FreeNode( int nodeNum );
+	void					InsertLeaf( int leaf );
+	void					RemoveLeaf( int leaf );
+	void					RefitParents( int nodeNum );
+	int						Balance( int nodeNum );
+	static float			Cost( const idBounds & bounds );
+};
+
 struct portalStack_t;
 
+// an area reached by the view flood through one portal chain, the entity
+// and light references of the area are culled to the portal stack planes
+// of the visit after the flood is complete
+struct areaViewVisit_t {
+	int						areaNum;
+	int						firstPlane;			// index into m_viewAreaPlanes
+	int						numPlanes;
+	idScreenRect			rect;
+};
+
+struct areaViewReference_t {
+	idRenderEntity *		entity;				// NULL for light references
+	idRenderLight *			light;
+	int						visitNum;
+	bool					culled;
+};
+
 class idRenderWorld {
 public:
 							idRenderWorld();
@@ -179,6 +335,11 @@ public:
 	// Traces vs the whole rendered world. FIXME: we need some kind of material flags.
 	bool					Trace( modelTrace_t &trace, const idVec3 &start, const idVec3 &end, const float radius, bool skipDynamic = true, bool skipPlayer = false ) const;
 
+	// Traces a batch of rays vs the whole rendered world. Each ray gets the same result as a Trace,
+	// but the entity bounds tree is only traversed once for all of them, so hit-scan spreads
+	// and other groups of nearby traces are cheaper. Returns the number of rays that hit something.
+	int						TraceBatch( modelTrace_t *traces, const idVec3 *starts, const idVec3 *ends, const int numRays, const float radius, bool skipDynamic = true, bool skipPlayer = false ) const;
+
 	// Traces vs the world model bsp tree.
 	bool					FastWorldTrace( modelTrace_t &trace, const idVec3 &start, const idVec3 &end ) const;
 
@@ -234,18 +395,20 @@ public:
 	//--------------------------
 	// RenderWorld_portals.cpp
 
-	bool					CullEntityByPortals( const idRenderEntity *entity, const portalStack_t *ps );
-	void					AddAreaViewEntities( int areaNum, const portalStack_t *ps );
-	bool					CullLightByPortals( const idRenderLight *light, const portalStack_t *ps );
-	void					AddAreaViewLights( int areaNum, const portalStack_t *ps );
+	static bool				CullEntityByPortals( const idRenderEntity *entity, const idPlane *portalPlanes, int numPortalPlanes );
+	void					AddAreaViewEntities( int visitNum );
+	static bool				CullLightByPortals( const idRenderLight *light, const idPlane *portalPlanes, int numPortalPlanes );
+	void					AddAreaViewLights( int visitNum );
 	void					AddAreaToView( int areaNum, const portalStack_t *ps );
+	void					CullAreaViewReferences( idParallelJobList *jobList );
+	void					AddAreaViewReferences();
 	idScreenRect			ScreenRectFromWinding( const idWinding *w, const float modelMatrix[ 16 ] );
 	bool					PortalIsFoggedOut( const portal_t *p );
 	void					FloodViewThroughArea_r( const idVec3 & origin, int areaNum, const portalStack_t *ps );
 	void					FlowViewThroughPortals( const idVec3 & origin, int numPlanes, const idPlane *planes );
 	void					BuildConnectedAreas_r( int areaNum );
 	void					BuildConnectedAreas();
-	void					FindViewLightsAndEntities();
+	void					FindViewLightsAndEntities( idParallelJobList *jobList );
 
 	void					FloodLightThroughArea_r( idRenderLight *light, int areaNum, const portalStack_t *ps );
 	void					FlowLightThroughPortals( idRenderLight *light );
@@ -273,8 +436,6 @@ public:
 	//--------------------------
 	// RenderWorld.cpp
 
-	void					ResizeInteractionTable();
-
 	void					AddEntityRefToArea( idRenderEntity *def, portalArea_t *area );
 	void					AddLightRefToArea( idRenderLight *light, portalArea_t *area );
 
@@ -324,20 +485,24 @@ public:
 	idList< idRenderLight *, TAG_LIGHT >		m_lightDefs;
 
 	idBlockAlloc< areaReference_t, 1024 >		m_areaReferenceAllocator;
-	idBlockAlloc< idInteraction, 256 >			m_interactionAllocator;
+	idConcurrentBlockAlloc< idInteraction, 256, TAG_RENDER_INTERACTION >	m_interactionAllocator;	// interactions can be created and freed from jobs
 
 	static const int MAX_DECAL_SURFACES = 32;
 
 	idArray< reusableDecal_t, MAX_DECAL_SURFACES >		m_decals;
 	idArray< reusableOverlay_t, MAX_DECAL_SURFACES >	m_overlays;
 
-	// all light / entity interactions are referenced here for fast lookup without
-	// having to crawl the doubly linked lists.  EnntityDefs are sequential for better cache access.
-	// Growing this table is time consuming, so we add a pad value to the number
-	// of entityDefs and lightDefs
-	idInteraction **		m_interactionTable;
-	int						m_interactionTableWidth;		// entityDefs
-	int						m_interactionTableHeight;		// lightDefs
+	// all static light / entity interactions are referenced here for fast lookup
+	// without having to crawl the doubly linked lists
+	idInteractionTable		m_interactionTable;
+
+	// all linked entityDefs by global reference bounds for tracing
+	idEntityBoundsTree		m_entityBoundsTree;
+
+	// area visits of the current view flood and the queued references to cull
+	idList< areaViewVisit_t, TAG_RENDER >		m_viewAreaVisits;
+	idList< idPlane, TAG_RENDER >				m_viewAreaPlanes;
+	idList< areaViewReference_t, TAG_RENDER >	m_viewAreaReferences;
 };
 
 // if an entity / light combination has been evaluated and found to not genrate any surfaces or shadows,
@@ -161,6 +161,7 @@ void idRenderWorld::CreateEntityRefs( idRenderEntity *entity ) {
 
 	// some models, like empty particles, may not need to be added at all
 	if ( entity->localReferenceBounds.IsCleared() ) {
+		m_entityBoundsTree.Remove( entity );
 		return;
 	}
 
@@ -174,6 +175,9 @@ void idRenderWorld::CreateEntityRefs( idRenderEntity *entity ) {
 	// derive entity data
 	DeriveEntityData( entity );
 
+	// refit the entity in the trace tree, this keeps the old leaf if it only moved a little
+	m_entityBoundsTree.Update( entity );
+
 	// bump the view count so we can tell if an
 	// area already has a reference
 	tr.viewCount++;
@@ -681,11 +681,6 @@ dump all the interactions
 =================
 */
 void idRenderWorld::FreeDefs() {
-	if ( m_interactionTable ) {
-		R_StaticFree( m_interactionTable );
-		m_interactionTable = NULL;
-	}
-
 	// free all lightDefs
 	for ( int i = 0; i < m_lightDefs.Num(); i++ ) {
 		idRenderLight * light = m_lightDefs[i];
@@ -704,6 +699,10 @@ void idRenderWorld::FreeDefs() {
 		}
 	}
 
+	// freeing the defs removed all interactions and entity bounds, release the memory
+	m_interactionTable.Clear();
+	m_entityBoundsTree.Clear();
+
 	// Reset decals and overlays
 	for ( int i = 0; i < m_decals.Num(); i++ ) {
 		m_decals[i].entityHandle = -1;
@@ -997,6 +996,7 @@ void idRenderWorld::AddWorldModelEntities() {
 		DeriveEntityData( def );
 
 		AddEntityRefToArea( def, &m_portalAreas[i] );
+		m_entityBoundsTree.Update( def );
 	}
 }
 
@@ -1034,6 +1034,7 @@ void idRenderWorld::ReCreateReferences() {
 		// area, instead of just pushing their bounds into the tree
 		if ( i < m_numPortalAreas ) {
 			AddEntityRefToArea( def, &m_portalAreas[ i ] );
+			m_entityBoundsTree.Update( def );
 		} else {
 			CreateEntityRefs( def );
 		}
@@ -1063,6 +1064,7 @@ void idRenderWorld::FreeDerivedData() {
 			continue;
 		}
 		FreeEntityDefDerivedData( def, false, false );
+		m_entityBoundsTree.Remove( def );
 	}
 
 	for ( int i = 0; i < m_lightDefs.Num(); ++i ) {
@@ -1087,6 +1089,7 @@ void idRenderWorld::CheckForEntityDefsUsingModel( idRenderModel * model ) {
 		}
 		if ( def->parms.hModel == model ) {
 			FreeEntityDefDerivedData( def, false, false );
+			m_entityBoundsTree.Remove( def );
 		}
 	}
 }
\ No newline at end of file
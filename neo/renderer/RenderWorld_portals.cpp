@@ -42,6 +42,14 @@ extern idCVar r_usePortals;
 extern idCVar r_singleArea;
 extern idCVar r_useSilRemap;
 
+idCVar r_useParallelPortalCulling( "r_useParallelPortalCulling", "1", CVAR_RENDERER | CVAR_BOOL, "cull the entities and lights of the visible areas to the portal planes with jobs" );
+idCVar r_parallelPortalCullingMinRefs( "r_parallelPortalCullingMinRefs", "512", CVAR_RENDERER | CVAR_INTEGER, "minimum number of area references in a view before the portal culling is done with jobs" );
+
+// the references queued by the view flood are culled by at most this many jobs,
+// each of which gets at least a reasonable run of references to amortize the job overhead
+const int MAX_PORTAL_CULL_JOBS				= 32;
+const int MIN_PORTAL_CULL_JOB_REFERENCES	= 64;
+
 // if we hit this many planes, we will just stop cropping the
 // view down, which is still correct, just conservative
 const int MAX_PORTAL_PLANES	= 20;
@@ -137,16 +145,17 @@ viewEntity_t *R_SetEntityDefViewEntity( idRenderEntity *def ) {
 ================
 CullEntityByPortals
 
-Return true if the entity reference bounds do not intersect the current portal chain.
+Return true if the entity reference bounds do not intersect the portal stack planes.
+This is called from the portal culling jobs, so nothing may be modified.
 ================
 */
-bool idRenderWorld::CullEntityByPortals( const idRenderEntity *entity, const portalStack_t *ps ) {
+bool idRenderWorld::CullEntityByPortals( const idRenderEntity *entity, const idPlane *portalPlanes, int numPortalPlanes ) {
 	if ( r_useEntityPortalCulling.GetInteger() == 1 ) {
 
 		ALIGNTYPE16 frustumCorners_t corners;
 		idRenderMatrix::GetFrustumCorners( corners, entity->inverseBaseModelProject, bounds_unitCube );
-		for ( int i = 0; i < ps->numPortalPlanes; i++ ) {
-			if ( idRenderMatrix::CullFrustumCornersToPlane( corners, ps->portalPlanes[i] ) == FRUSTUM_CULL_FRONT ) {
+		for ( int i = 0; i < numPortalPlanes; i++ ) {
+			if ( idRenderMatrix::CullFrustumCornersToPlane( corners, portalPlanes[i] ) == FRUSTUM_CULL_FRONT ) {
 				return true;
 			}
 		}
@@ -183,13 +192,13 @@ bool idRenderWorld::CullEntityByPortals( const idRenderEntity *entity, const por
 				continue;
 			}
 
-			assert( ps->numPortalPlanes <= MAX_PORTAL_PLANES );
-			assert( w.GetNumPoints() + ps->numPortalPlanes < MAX_POINTS_ON_WINDING );
+			assert( numPortalPlanes <= MAX_PORTAL_PLANES );
+			assert( w.GetNumPoints() + numPortalPlanes < MAX_POINTS_ON_WINDING );
 
 			// now clip the winding against each of the portalStack planes
 			// skip the last plane which is the last portal itself
-			for ( int j = 0; j < ps->numPortalPlanes - 1; j++ ) {
-				if ( !w.ClipInPlace( -ps->portalPlanes[j], ON_EPSILON ) ) {
+			for ( int j = 0; j < numPortalPlanes - 1; j++ ) {
+				if ( !w.ClipInPlace( -portalPlanes[j], ON_EPSILON ) ) {
 					break;
 				}
 			}
@@ -213,11 +222,11 @@ bool idRenderWorld::CullEntityByPortals( const idRenderEntity *entity, const por
 ===================
 AddAreaViewEntities
 
-Any models that are visible through the current portalStack will have their scissor rect updated.
+Queues the entity references of an area visit for culling to the portal stack planes of the visit.
 ===================
 */
-void idRenderWorld::AddAreaViewEntities( int areaNum, const portalStack_t *ps ) {
-	portalArea_t * area = &m_portalAreas[ areaNum ];
+void idRenderWorld::AddAreaViewEntities( int visitNum ) {
+	portalArea_t * area = &m_portalAreas[ m_viewAreaVisits[ visitNum ].areaNum ];
 
 	for ( areaReference_t * ref = area->entityRefs.areaNext; ref != &area->entityRefs; ref = ref->areaNext ) {
 		idRenderEntity	* entity = ref->entity;
@@ -242,17 +251,11 @@ void idRenderWorld::AddAreaViewEntities( int areaNum, const portalStack_t *ps )
 			}
 		}
 
-		// cull reference bounds
-		if ( CullEntityByPortals( entity, ps ) ) {
-			// we are culled out through this portal chain, but it might
-			// still be visible through others
-			continue;
-		}
-
-		viewEntity_t * vEnt = R_SetEntityDefViewEntity( entity );
-
-		// possibly expand the scissor rect
-		vEnt->scissorRect.Union( ps->rect );
+		areaViewReference_t & vref = m_viewAreaReferences.Alloc();
+		vref.entity = entity;
+		vref.light = NULL;
+		vref.visitNum = visitNum;
+		vref.culled = false;
 	}
 }
 
@@ -260,16 +263,17 @@ void idRenderWorld::AddAreaViewEntities( int areaNum, const portalStack_t *ps )
 ================
 CullLightByPortals
 
-Return true if the light frustum does not intersect the current portal chain.
+Return true if the light frustum does not intersect the portal stack planes.
+This is called from the portal culling jobs, so nothing may be modified.
 ================
 */
-bool idRenderWorld::CullLightByPortals( const idRenderLight *light, const portalStack_t *ps ) {
+bool idRenderWorld::CullLightByPortals( const idRenderLight *light, const idPlane *portalPlanes, int numPortalPlanes ) {
 	if ( r_useLightPortalCulling.GetInteger() == 1 ) {
 
 		ALIGNTYPE16 frustumCorners_t corners;
 		idRenderMatrix::GetFrustumCorners( corners, light->inverseBaseLightProject, bounds_zeroOneCube );
-		for ( int i = 0; i < ps->numPortalPlanes; i++ ) {
-			if ( idRenderMatrix::CullFrustumCornersToPlane( corners, ps->portalPlanes[i] ) == FRUSTUM_CULL_FRONT ) {
+		for ( int i = 0; i < numPortalPlanes; i++ ) {
+			if ( idRenderMatrix::CullFrustumCornersToPlane( corners, portalPlanes[i] ) == FRUSTUM_CULL_FRONT ) {
 				return true;
 			}
 		}
@@ -303,13 +307,13 @@ bool idRenderWorld::CullLightByPortals( const idRenderLight *light, const portal
 				continue;
 			}
 
-			assert( ps->numPortalPlanes <= MAX_PORTAL_PLANES );
-			assert( w.GetNumPoints() + ps->numPortalPlanes < MAX_POINTS_ON_WINDING );
+			assert( numPortalPlanes <= MAX_PORTAL_PLANES );
+			assert( w.GetNumPoints() + numPortalPlanes < MAX_POINTS_ON_WINDING );
 
 			// now clip the winding against each of the portalStack planes
 			// skip the last plane which is the last portal itself
-			for ( int j = 0; j < ps->numPortalPlanes - 1; j++ ) {
-				if ( !w.ClipInPlace( -ps->portalPlanes[j], ON_EPSILON ) ) {
+			for ( int j = 0; j < numPortalPlanes - 1; j++ ) {
+				if ( !w.ClipInPlace( -portalPlanes[j], ON_EPSILON ) ) {
 					break;
 				}
 			}
@@ -332,12 +336,11 @@ bool idRenderWorld::CullLightByPortals( const idRenderLight *light, const portal
 ===================
 AddAreaViewLights
 
-This is the only point where lights get added to the viewLights list.
-Any lights that are visible through the current portalStack will have their scissor rect updated.
+Queues the light references of an area visit for culling to the portal stack planes of the visit.
 ===================
 */
-void idRenderWorld::AddAreaViewLights( int areaNum, const portalStack_t *ps ) {
-	portalArea_t * area = &m_portalAreas[ areaNum ];
+void idRenderWorld::AddAreaViewLights( int visitNum ) {
+	portalArea_t * area = &m_portalAreas[ m_viewAreaVisits[ visitNum ].areaNum ];
 
 	for ( areaReference_t * lref = area->lightRefs.areaNext; lref != &area->lightRefs; lref = lref->areaNext ) {
 		idRenderLight * light = lref->light;
@@ -354,17 +357,11 @@ void idRenderWorld::AddAreaViewLights( int areaNum, const portalStack_t *ps ) {
 			continue;
 		}
 
-		// cull frustum
-		if ( CullLightByPortals( light, ps ) ) {
-			// we are culled out through this portal chain, but it might
-			// still be visible through others
-			continue;
-		}
-
-		viewLight_t * vLight = R_SetLightDefViewLight( light );
-
-		// expand the scissor rect
-		vLight->scissorRect.Union( ps->rect );
+		areaViewReference_t & vref = m_viewAreaReferences.Alloc();
+		vref.entity = NULL;
+		vref.light = light;
+		vref.visitNum = visitNum;
+		vref.culled = false;
 	}
 }
 
@@ -380,9 +377,122 @@ void idRenderWorld::AddAreaToView( int areaNum, const portalStack_t *ps ) {
 	// mark the viewCount, so r_showPortals can display the considered portals
 	m_portalAreas[ areaNum ].viewCount = tr.viewCount;
 
-	// add the models and lights, using more precise culling to the planes
-	AddAreaViewEntities( areaNum, ps );
-	AddAreaViewLights( areaNum, ps );
+	// save the planes of the portal stack, the recursion will overwrite them
+	const int visitNum = m_viewAreaVisits.Num();
+	areaViewVisit_t & visit = m_viewAreaVisits.Alloc();
+	visit.areaNum = areaNum;
+	visit.firstPlane = m_viewAreaPlanes.Num();
+	visit.numPlanes = ps->numPortalPlanes;
+	visit.rect = ps->rect;
+	for ( int i = 0; i < ps->numPortalPlanes; i++ ) {
+		m_viewAreaPlanes.Append( ps->portalPlanes[i] );
+	}
+
+	// queue the models and lights for more precise culling to the planes
+	AddAreaViewEntities( visitNum );
+	AddAreaViewLights( visitNum );
+}
+
+struct areaViewCullJob_t {
+	const areaViewVisit_t *	visits;
+	const idPlane *			planes;
+	areaViewReference_t *	references;
+	int						numReferences;
+};
+
+/*
+===================
+R_CullAreaViewReferences
+===================
+*/
+static void R_CullAreaViewReferences( areaViewCullJob_t * job ) {
+	for ( int i = 0; i < job->numReferences; i++ ) {
+		areaViewReference_t & vref = job->references[i];
+		const areaViewVisit_t & visit = job->visits[ vref.visitNum ];
+		const idPlane * planes = job->planes + visit.firstPlane;
+		if ( vref.entity != NULL ) {
+			vref.culled = idRenderWorld::CullEntityByPortals( vref.entity, planes, visit.numPlanes );
+		} else {
+			vref.culled = idRenderWorld::CullLightByPortals( vref.light, planes, visit.numPlanes );
+		}
+	}
+}
+
+REGISTER_PARALLEL_JOB( R_CullAreaViewReferences, "R_CullAreaViewReferences" );
+
+/*
+===================
+CullAreaViewReferences
+
+Culls all references queued by the flood to the portal stack planes of their
+area visit. The references are independent of each other, so large views are
+split over jobs that each test a contiguous run of references.
+===================
+*/
+void idRenderWorld::CullAreaViewReferences( idParallelJobList *jobList ) {
+	SCOPED_PROFILE_EVENT( "CullAreaViewReferences" );
+
+	const int numReferences = m_viewAreaReferences.Num();
+
+	int numJobs = 1;
+	if ( jobList != NULL && r_useParallelPortalCulling.GetBool() && numReferences >= r_parallelPortalCullingMinRefs.GetInteger() ) {
+		numJobs = Min( MAX_PORTAL_CULL_JOBS, Max( 1, numReferences / MIN_PORTAL_CULL_JOB_REFERENCES ) );
+	}
+	const int referencesPerJob = ( numReferences + numJobs - 1 ) / numJobs;
+
+	areaViewCullJob_t jobs[ MAX_PORTAL_CULL_JOBS ];
+	for ( int i = 0; i < numJobs; i++ ) {
+		const int firstReference = i * referencesPerJob;
+		jobs[i].visits = m_viewAreaVisits.Ptr();
+		jobs[i].planes = m_viewAreaPlanes.Ptr();
+		jobs[i].references = m_viewAreaReferences.Ptr() + firstReference;
+		jobs[i].numReferences = Max( 0, Min( referencesPerJob, numReferences - firstReference ) );
+	}
+
+	if ( numJobs == 1 ) {
+		R_CullAreaViewReferences( &jobs[0] );
+		return;
+	}
+
+	for ( int i = 0; i < numJobs; i++ ) {
+		jobList->AddJob( (jobRun_t)R_CullAreaViewReferences, &jobs[i] );
+	}
+	jobList->Submit();
+	jobList->Wait();
+}
+
+/*
+===================
+AddAreaViewReferences
+
+This is the only point where entities and lights get added to the viewEntitys and viewLights lists.
+The references are walked in the order the flood queued them, so the lists come out the same
+regardless of how the culling was split up. Any references that are visible through the portal
+stack of their area visit will have their scissor rect updated.
+===================
+*/
+void idRenderWorld::AddAreaViewReferences() {
+	for ( int i = 0; i < m_viewAreaReferences.Num(); i++ ) {
+		const areaViewReference_t & vref = m_viewAreaReferences[i];
+		if ( vref.culled ) {
+			// we are culled out through this portal chain, but it might
+			// still be visible through others
+			continue;
+		}
+
+		const idScreenRect & rect = m_viewAreaVisits[ vref.visitNum ].rect;
+		if ( vref.entity != NULL ) {
+			viewEntity_t * vEnt = R_SetEntityDefViewEntity( vref.entity );
+
+			// possibly expand the scissor rect
+			vEnt->scissorRect.Union( rect );
+		} else {
+			viewLight_t * vLight = R_SetLightDefViewLight( vref.light );
+
+			// expand the scissor rect
+			vLight->scissorRect.Union( rect );
+		}
+	}
 }
 
 /*
@@ -673,9 +783,12 @@ they were considered, but not actually visible.
 
 Entities and lights can have cached viewEntities / viewLights that
 will be used if the viewCount variable matches.
+
+The portal flood only queues the references of the areas it reaches,
+they are culled afterwards, possibly with jobs on the given job list.
 =============
 */
-void idRenderWorld::FindViewLightsAndEntities() {
+void idRenderWorld::FindViewLightsAndEntities( idParallelJobList *jobList ) {
 	SCOPED_PROFILE_EVENT( "FindViewLightsAndEntities" );
 
 	// bumping this counter invalidates cached viewLights / viewEntities,
@@ -693,6 +806,10 @@ void idRenderWorld::FindViewLightsAndEntities() {
 		m_areaScreenRect[i].Clear();
 	}
 
+	m_viewAreaVisits.SetNum( 0 );
+	m_viewAreaPlanes.SetNum( 0 );
+	m_viewAreaReferences.SetNum( 0 );
+
 	// find the area to start the portal flooding in
 	if ( !r_usePortals.GetBool() ) {
 		// debug tool to force no portal culling
@@ -731,6 +848,11 @@ void idRenderWorld::FindViewLightsAndEntities() {
 		// may have the viewOrigin in a solid/invalid area
 		FlowViewThroughPortals( tr.m_viewDef->renderView.vieworg, 5, tr.m_viewDef->frustum );
 	}
+
+	// cull the models and lights of all visited areas to the planes
+	// of the portal chains they were seen through and add the survivors
+	CullAreaViewReferences( jobList );
+	AddAreaViewReferences();
 }
 
 /*
@@ -45,7 +45,15 @@ static void ClearGeoBufferSet( geoBufferSet_t &gbs ) {
 	gbs.indexMemUsed.SetValue( 0 );
 	gbs.vertexMemUsed.SetValue( 0 );
 	gbs.jointMemUsed.SetValue( 0 );
-	gbs.allocations = 0;
+	gbs.allocations.SetValue( 0 );
+	gbs.numSkinningJobs.SetValue( 0 );
+
+	if ( gbs.mappedVertexBase != NULL ) {
+		gbs.vertexAllocator.SetMemory( gbs.mappedVertexBase, gbs.vertexBuffer.GetAllocedSize(), VERTEX_CACHE_ALIGN, VERTCACHE_VERTEX_CHUNK_SIZE );
+	}
+	if ( gbs.mappedIndexBase != NULL ) {
+		gbs.indexAllocator.SetMemory( gbs.mappedIndexBase, gbs.indexBuffer.GetAllocedSize(), INDEX_CACHE_ALIGN, VERTCACHE_INDEX_CHUNK_SIZE );
+	}
 }
 
 /*
@@ -91,10 +99,11 @@ AllocGeoBufferSet
 ==============
 */
 static void AllocGeoBufferSet( geoBufferSet_t & gbs, const int vertexBytes, const int indexBytes, const int jointBytes, bufferUsageType_t usage ) {
-	gbs.vertexBuffer.AllocBufferObject( NULL, vertexBytes, usage );
+	// the vertex and joint buffers are bound to the compute skinning pass
+	gbs.vertexBuffer.AllocBufferObject( NULL, vertexBytes, usage, true );
 	gbs.indexBuffer.AllocBufferObject( NULL, indexBytes, usage );
 	if ( jointBytes > 0 ) {
-		gbs.jointBuffer.AllocBufferObject( NULL, jointBytes, usage );
+		gbs.jointBuffer.AllocBufferObject( NULL, jointBytes, usage, true );
 	}
 	
 	ClearGeoBufferSet( gbs );
@@ -114,17 +123,21 @@ void idVertexCache::Init( int uniformBufferOffsetAlignment ) {
 	m_mostUsedVertex = 0;
 	m_mostUsedIndex = 0;
 	m_mostUsedJoint = 0;
+	m_mostReservedVertex = 0;
+	m_mostReservedIndex = 0;
 
+	// the per-frame sets are persistently mapped
 	for ( int i = 0; i < NUM_FRAME_DATA; i++ ) {
 		AllocGeoBufferSet( m_frameData[i], VERTCACHE_VERTEX_MEMORY_PER_FRAME, VERTCACHE_INDEX_MEMORY_PER_FRAME, VERTCACHE_JOINT_MEMORY_PER_FRAME, BU_DYNAMIC );
+		MapGeoBufferSet( m_frameData[i] );
+		ClearGeoBufferSet( m_frameData[i] );
+		m_frameData[i].skinningJobs = (skinningJob_t *)Mem_Alloc( VERTCACHE_MAX_SKINNING_JOBS * sizeof( skinningJob_t ), TAG_RENDER );
 	}
 #if 1
 	AllocGeoBufferSet( m_staticData, STATIC_VERTEX_MEMORY, STATIC_INDEX_MEMORY, 0, BU_STATIC );
 #else
 	AllocGeoBufferSet( m_staticData, STATIC_VERTEX_MEMORY, STATIC_INDEX_MEMORY, 0, BU_DYNAMIC );
 #endif
-
-	MapGeoBufferSet( m_frameData[ m_listNum ] );
 }
 
 /*
@@ -134,9 +147,12 @@ idVertexCache::Shutdown
 */
 void idVertexCache::Shutdown() {
 	for ( int i = 0; i < NUM_FRAME_DATA; i++ ) {
+		UnmapGeoBufferSet( m_frameData[i] );
 		m_frameData[i].vertexBuffer.FreeBufferObject();
 		m_frameData[i].indexBuffer.FreeBufferObject();
 		m_frameData[i].jointBuffer.FreeBufferObject();
+		Mem_Free( m_frameData[i].skinningJobs );
+		m_frameData[i].skinningJobs = NULL;
 	}
 }
 
@@ -162,6 +178,8 @@ void idVertexCache::FreeStaticData() {
 	m_mostUsedVertex = 0;
 	m_mostUsedIndex = 0;
 	m_mostUsedJoint = 0;
+	m_mostReservedVertex = 0;
+	m_mostReservedIndex = 0;
 }
 
 /*
@@ -180,6 +198,33 @@ vertCacheHandle_t idVertexCache::ActuallyAlloc( geoBufferSet_t & vcs, const void
 	int	endPos = 0;
 	int offset = 0;
 
+	if ( r_showVertexCache.GetBool() ) {
+		vcs.allocations.Increment();
+	}
+
+	// per-frame vertexes and indexes are written straight into the mapped buffer
+	if ( &vcs != &m_staticData && type != CACHE_JOINT ) {
+		const bool isVertex = ( type == CACHE_VERTEX );
+		byte * base = isVertex ? vcs.mappedVertexBase : vcs.mappedIndexBase;
+		idFrameAllocator & allocator = isVertex ? vcs.vertexAllocator : vcs.indexAllocator;
+		// the allocator only fails when the bytes don't fit outside the thread chunks either
+		byte * dst = (byte *)allocator.Alloc( bytes );
+		if ( dst == NULL ) {
+			idLib::Error( "Out of %s cache. bytes = %d, allocated = %d, unused in chunks = %d, size = %d", isVertex ? "vertex" : "index",
+				bytes, allocator.GetAllocated(), allocator.GetUnused(), allocator.GetSize() );
+		}
+
+		offset = (int)( dst - base );
+
+		if ( data != NULL ) {
+			CopyBuffer( dst, (const byte *)data, bytes );
+		}
+
+		return	( (uint64)(m_currentFrame & VERTCACHE_FRAME_MASK ) << VERTCACHE_FRAME_SHIFT ) |
+				( (uint64)(offset & VERTCACHE_OFFSET_MASK ) << VERTCACHE_OFFSET_SHIFT ) |
+				( (uint64)(bytes & VERTCACHE_SIZE_MASK ) << VERTCACHE_SIZE_SHIFT );
+	}
+
 	switch( type ) {
 	case CACHE_INDEX: {
 		endPos = vcs.indexMemUsed.Add( bytes );
@@ -236,8 +281,6 @@ vertCacheHandle_t idVertexCache::ActuallyAlloc( geoBufferSet_t & vcs, const void
 		assert( false );
 	}
 
-	vcs.allocations++;
-
 	vertCacheHandle_t handle =	( (uint64)(m_currentFrame & VERTCACHE_FRAME_MASK ) << VERTCACHE_FRAME_SHIFT ) |
 								( (uint64)(offset & VERTCACHE_OFFSET_MASK ) << VERTCACHE_OFFSET_SHIFT ) |
 								( (uint64)(bytes & VERTCACHE_SIZE_MASK ) << VERTCACHE_SIZE_SHIFT );
@@ -274,6 +317,35 @@ vertCacheHandle_t idVertexCache::AllocJoint( const void * data, int num, size_t
 	return ActuallyAlloc( m_frameData[ m_listNum ], data, ALIGN( num * size, m_uniformBufferOffsetAlignment ), CACHE_JOINT );
 }
 
+/*
+==============
+idVertexCache::AllocSkinnedVertex
+
+May be called from the front end jobs.
+==============
+*/
+vertCacheHandle_t idVertexCache::AllocSkinnedVertex( vertCacheHandle_t sourceCache, vertCacheHandle_t jointCache, int numVerts, bool shadowVerts ) {
+	if ( !m_computeSkinningAvailable ) {
+		return 0;
+	}
+
+	geoBufferSet_t & vcs = m_frameData[ m_listNum ];
+
+	const int jobNum = vcs.numSkinningJobs.Increment() - 1;
+	if ( jobNum >= VERTCACHE_MAX_SKINNING_JOBS ) {
+		return 0;
+	}
+
+	skinningJob_t & job = vcs.skinningJobs[ jobNum ];
+	job.sourceCache = sourceCache;
+	job.jointCache = jointCache;
+	job.outputCache = AllocVertex( NULL, numVerts, shadowVerts ? sizeof( idShadowVert ) : sizeof( idDrawVert ) );
+	job.numVerts = numVerts;
+	job.shadowVerts = shadowVerts;
+
+	return job.outputCache;
+}
+
 /*
 ==============
 idVertexCache::AllocStaticVertex
@@ -404,30 +476,54 @@ bool idVertexCache::GetJointBuffer( vertCacheHandle_t handle, idUniformBuffer *
 	return true;
 }
 
+/*
+==============
+idVertexCache::GetSkinningJobs
+==============
+*/
+int idVertexCache::GetSkinningJobs( const skinningJob_t ** jobs ) const {
+	const geoBufferSet_t & vcs = m_frameData[ m_drawListNum ];
+	*jobs = vcs.skinningJobs;
+	return Min( vcs.numSkinningJobs.GetValue(), VERTCACHE_MAX_SKINNING_JOBS );
+}
+
 /*
 ==============
 idVertexCache::BeginBackEnd
 ==============
 */
 void idVertexCache::BeginBackEnd() {
-	m_mostUsedVertex = Max( m_mostUsedVertex, m_frameData[ m_listNum ].vertexMemUsed.GetValue() );
-	m_mostUsedIndex = Max( m_mostUsedIndex, m_frameData[ m_listNum ].indexMemUsed.GetValue() );
-	m_mostUsedJoint = Max( m_mostUsedJoint, m_frameData[ m_listNum ].jointMemUsed.GetValue() );
+	geoBufferSet_t & frame = m_frameData[ m_listNum ];
+
+	// the reserved bytes include the unused tail of every thread chunk, which is
+	// what actually limits how much fits in a frame
+	const int reservedVertex = frame.vertexAllocator.GetAllocated();
+	const int reservedIndex = frame.indexAllocator.GetAllocated();
+	const int usedVertex = reservedVertex - frame.vertexAllocator.GetUnused();
+	const int usedIndex = reservedIndex - frame.indexAllocator.GetUnused();
+
+	m_mostUsedVertex = Max( m_mostUsedVertex, usedVertex );
+	m_mostUsedIndex = Max( m_mostUsedIndex, usedIndex );
+	m_mostUsedJoint = Max( m_mostUsedJoint, frame.jointMemUsed.GetValue() );
+	m_mostReservedVertex = Max( m_mostReservedVertex, reservedVertex );
+	m_mostReservedIndex = Max( m_mostReservedIndex, reservedIndex );
 
 	if ( r_showVertexCache.GetBool() ) {
-		idLib::Printf( "%08d: %d allocations, %dkB vertex, %dkB index, %kB joint : %dkB vertex, %dkB index, %kB joint\n", 
-			m_currentFrame, m_frameData[ m_listNum ].allocations,
-			m_frameData[ m_listNum ].vertexMemUsed.GetValue() / 1024,
-			m_frameData[ m_listNum ].indexMemUsed.GetValue() / 1024,
-			m_frameData[ m_listNum ].jointMemUsed.GetValue() / 1024,
+		idLib::Printf( "%08d: %d allocations, %dkB vertex, %dkB index, %dkB joint : %dkB vertex, %dkB index, %dkB joint : %d%% vertex, %d%% index reserved peak\n", 
+			m_currentFrame, frame.allocations.GetValue(),
+			usedVertex / 1024,
+			usedIndex / 1024,
+			frame.jointMemUsed.GetValue() / 1024,
 			m_mostUsedVertex / 1024,
 			m_mostUsedIndex / 1024,
-			m_mostUsedJoint / 1024 );
+			m_mostUsedJoint / 1024,
+			(int)( (int64)m_mostReservedVertex * 100 / VERTCACHE_VERTEX_MEMORY_PER_FRAME ),
+			(int)( (int64)m_mostReservedIndex * 100 / VERTCACHE_INDEX_MEMORY_PER_FRAME ) );
 	}
 
-	// unmap the current frame so the GPU can read it
+	// the per-frame sets stay persistently mapped, only the static set is unmapped
+	// once it has been written to
 	const int startUnmap = Sys_Milliseconds();
-	UnmapGeoBufferSet( m_frameData[ m_listNum ] );
 	UnmapGeoBufferSet( m_staticData );
 	const int endUnmap = Sys_Milliseconds();
 	if ( endUnmap - startUnmap > 1 ) {
@@ -439,12 +535,6 @@ void idVertexCache::BeginBackEnd() {
 	m_currentFrame++;
 
 	m_listNum = m_currentFrame % NUM_FRAME_DATA;
-	const int startMap = Sys_Milliseconds();
-	MapGeoBufferSet( m_frameData[ m_listNum ] );
-	const int endMap = Sys_Milliseconds();
-	if ( endMap - startMap > 1 ) {
-		idLib::PrintfIf( r_showVertexCacheTimings.GetBool(), "idVertexCache::map took %i msec\n", endMap - startMap );
-	}
 
 	ClearGeoBufferSet( m_frameData[ m_listNum ] );
 }
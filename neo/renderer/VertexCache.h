@@ -51,12 +51,28 @@ const int VERTEX_CACHE_ALIGN		= 32;
 const int INDEX_CACHE_ALIGN			= 16;
 const int JOINT_CACHE_ALIGN			= 16;
 
+// the per-frame vertex and index memory is handed to each thread in chunks of this size
+const int VERTCACHE_VERTEX_CHUNK_SIZE = 256 * 1024;
+const int VERTCACHE_INDEX_CHUNK_SIZE = 64 * 1024;
+
+const int VERTCACHE_MAX_SKINNING_JOBS = 4096;
+
 enum cacheType_t {
 	CACHE_VERTEX,
 	CACHE_INDEX,
 	CACHE_JOINT
 };
 
+// GPU skinned geometry that the back end transforms once per frame with a compute
+// pre-pass, so every pass can draw the output with the unskinned vertex programs
+struct skinningJob_t {
+	vertCacheHandle_t		sourceCache;	// idDrawVert or idShadowVertSkinned
+	vertCacheHandle_t		jointCache;		// idJointMat
+	vertCacheHandle_t		outputCache;	// idDrawVert or idShadowVert
+	int						numVerts;
+	bool					shadowVerts;
+};
+
 struct geoBufferSet_t {
 	idIndexBuffer			indexBuffer;
 	idVertexBuffer			vertexBuffer;
@@ -67,7 +83,16 @@ struct geoBufferSet_t {
 	idSysInterlockedInteger	indexMemUsed;
 	idSysInterlockedInteger	vertexMemUsed;
 	idSysInterlockedInteger	jointMemUsed;
-	int						allocations;	// number of index and vertex allocations combined
+	idSysInterlockedInteger	allocations;	// number of index and vertex allocations combined, only counted with r_showVertexCache
+
+	// The per-frame sets stay mapped and every thread bumps through chunks of its own,
+	// so the front end jobs don't all hit the same atomic offsets. The static set and
+	// the joints, which are few and need uniform buffer alignment, use the offsets above.
+	idFrameAllocator		vertexAllocator;
+	idFrameAllocator		indexAllocator;
+
+	skinningJob_t *			skinningJobs;	// only on the per-frame sets
+	idSysInterlockedInteger	numSkinningJobs;
 };
 
 class idVertexCache {
@@ -80,10 +105,16 @@ public:
 	void			FreeStaticData();
 
 	// this data is only valid for one frame of rendering
+	// pass NULL data and write through MappedVertexBuffer / MappedIndexBuffer to build it in place
 	vertCacheHandle_t	AllocVertex( const void * data, int num, size_t size = sizeof( idDrawVert ) );
 	vertCacheHandle_t	AllocIndex( const void * data, int num, size_t size = sizeof( triIndex_t ) );
 	vertCacheHandle_t	AllocJoint( const void * data, int num, size_t size = sizeof( idJointMat ) );
 
+	// reserves this frame's skinned copy of GPU skinned geometry, which the back end fills in
+	// before drawing, returns 0 when compute skinning is not available or the job list is full
+	vertCacheHandle_t	AllocSkinnedVertex( vertCacheHandle_t sourceCache, vertCacheHandle_t jointCache, int numVerts, bool shadowVerts );
+	void				SetComputeSkinningAvailable( bool available ) { m_computeSkinningAvailable = available; }
+
 	// this data is valid until the next map load
 	vertCacheHandle_t	AllocStaticVertex( const void * data, int bytes );
 	vertCacheHandle_t	AllocStaticIndex( const void * data, int bytes );
@@ -102,6 +133,9 @@ public:
 	bool			GetIndexBuffer( vertCacheHandle_t handle, idIndexBuffer * ib );
 	bool			GetJointBuffer( vertCacheHandle_t handle, idUniformBuffer * jb );
 
+	// skinning jobs of the frame the back end is drawing
+	int				GetSkinningJobs( const skinningJob_t ** jobs ) const;
+
 	void			BeginBackEnd();
 
 public:
@@ -114,10 +148,14 @@ public:
 
 	int				m_uniformBufferOffsetAlignment;
 
-	// High water marks for the per-frame buffers
+	bool			m_computeSkinningAvailable;
+
+	// High water marks for the per-frame buffers, reserved includes the unused tails of the thread chunks
 	int				m_mostUsedVertex;
 	int				m_mostUsedIndex;
 	int				m_mostUsedJoint;
+	int				m_mostReservedVertex;
+	int				m_mostReservedIndex;
 
 	// Try to make room for <bytes> bytes
 	vertCacheHandle_t	ActuallyAlloc( geoBufferSet_t & vcs, const void * data, int bytes, cacheType_t type );
@@ -66,7 +66,7 @@ idVertexBuffer::idVertexBuffer() {
 idVertexBuffer::AllocBufferObject
 ========================
 */
-bool idVertexBuffer::AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage ) {
+bool idVertexBuffer::AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage, bool storage ) {
 	assert( m_apiObject == VK_NULL_HANDLE );
 	assert_16_byte_aligned( data );
 
@@ -86,9 +86,12 @@ bool idVertexBuffer::AllocBufferObject( const void * data, int allocSize, buffer
 	bufferCreateInfo.pNext = NULL;
 	bufferCreateInfo.size = numBytes;
 	bufferCreateInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if ( storage ) {
+		bufferCreateInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	}
 	if ( m_usage == BU_STATIC ) {
 		bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		stagingManager.GetSharingMode( bufferCreateInfo.sharingMode, bufferCreateInfo.queueFamilyIndexCount, bufferCreateInfo.pQueueFamilyIndices );
 	}
 
 #if defined( ID_USE_AMD_ALLOCATOR )
@@ -315,6 +318,7 @@ bool idIndexBuffer::AllocBufferObject( const void * data, int allocSize, bufferU
 	bufferCreateInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 	if ( m_usage == BU_STATIC ) {
 		bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		stagingManager.GetSharingMode( bufferCreateInfo.sharingMode, bufferCreateInfo.queueFamilyIndexCount, bufferCreateInfo.pQueueFamilyIndices );
 	}
 
 #if defined( ID_USE_AMD_ALLOCATOR )
@@ -520,7 +524,7 @@ idUniformBuffer::idUniformBuffer() {
 idUniformBuffer::AllocBufferObject
 ========================
 */
-bool idUniformBuffer::AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage ) {
+bool idUniformBuffer::AllocBufferObject( const void * data, int allocSize, bufferUsageType_t usage, bool storage ) {
 	assert( m_apiObject == VK_NULL_HANDLE );
 	assert_16_byte_aligned( data );
 
@@ -540,8 +544,12 @@ bool idUniformBuffer::AllocBufferObject( const void * data, int allocSize, buffe
 	bufferCreateInfo.pNext = NULL;
 	bufferCreateInfo.size = numBytes;
 	bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	if ( storage ) {
+		bufferCreateInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	}
 	if ( m_usage == BU_STATIC ) {
 		bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		stagingManager.GetSharingMode( bufferCreateInfo.sharingMode, bufferCreateInfo.queueFamilyIndexCount, bufferCreateInfo.pQueueFamilyIndices );
 	}
 
 #if defined( ID_USE_AMD_ALLOCATOR )
@@ -333,7 +333,13 @@ void idImage::AllocImage() {
 	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	imageCreateInfo.usage = usageFlags;
 	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if ( usageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT ) {
+		// only the images that are uploaded through the staging ring are shared with the transfer queue,
+		// concurrent sharing disables framebuffer compression so attachments stay exclusive
+		stagingManager.GetSharingMode( imageCreateInfo.sharingMode, imageCreateInfo.queueFamilyIndexCount, imageCreateInfo.pQueueFamilyIndices );
+	} else {
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
 
 #if defined( ID_USE_AMD_ALLOCATOR )
 	VmaMemoryRequirements vmaReq = {};
@@ -473,8 +479,14 @@ void idImage::SubImageUpload( int mipLevel, int x, int y, int z, int width, int
 	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, NULL, 0, NULL, 1, &barrier );
+	if ( stagingManager.UsesTransferQueue() ) {
+		// graphics stages don't exist on the transfer queue, the frame's semaphore wait makes the copy visible
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &barrier );
+	} else {
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, NULL, 0, NULL, 1, &barrier );
+	}
 
 	m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 }
\ No newline at end of file
@@ -48,8 +48,13 @@ bool CreateGameWindow( gfxImpParms_t parms );
 vulkanContext_t vkcontext;
 
 idCVar r_vkEnableValidationLayers( "r_vkEnableValidationLayers", "0", CVAR_BOOL | CVAR_INIT, "" );
+idCVar r_vkPipelineCache( "r_vkPipelineCache", "1", CVAR_BOOL | CVAR_INIT, "Load and save the Vulkan pipeline cache between runs." );
+idCVar r_vkParallelRecord( "r_vkParallelRecord", "1", CVAR_RENDERER | CVAR_BOOL, "Record interactions and shader passes into secondary command buffers on the job threads." );
+idCVar r_vkRecordCommandsPerJob( "r_vkRecordCommandsPerJob", "128", CVAR_RENDERER | CVAR_INTEGER, "Minimum number of commands recorded by each job when r_vkParallelRecord is set.", 16, 4096 );
 
 extern idCVar r_multiSamples;
+extern idCVar r_showGPUProfile;
+extern idCVar r_vkTransferQueue;
 extern idCVar r_skipRender;
 extern idCVar r_skipShadows;
 extern idCVar r_showShadows;
@@ -527,10 +532,32 @@ void idRenderBackend::SelectSuitablePhysicalDevice() {
 			}
 		}
 
+		// Find a dedicated transfer queue family, usually the DMA engine.
+		// Require a transfer granularity of one texel so any sub image can be copied.
+		int transferIdx = -1;
+		for ( int j = 0; j < gpu.queueFamilyProps.Num() && r_vkTransferQueue.GetBool(); ++j ) {
+			VkQueueFamilyProperties & props = gpu.queueFamilyProps[ j ];
+
+			if ( props.queueCount == 0 ) {
+				continue;
+			}
+
+			if ( ( props.queueFlags & VK_QUEUE_TRANSFER_BIT ) == 0 || ( props.queueFlags & ( VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT ) ) != 0 ) {
+				continue;
+			}
+
+			const VkExtent3D & granularity = props.minImageTransferGranularity;
+			if ( granularity.width == 1 && granularity.height == 1 && granularity.depth == 1 ) {
+				transferIdx = j;
+				break;
+			}
+		}
+
 		// Did we find a device supporting both graphics and present.
 		if ( graphicsIdx >= 0 && presentIdx >= 0 ) {
 			vkcontext.graphicsFamilyIdx = graphicsIdx;
 			vkcontext.presentFamilyIdx = presentIdx;
+			vkcontext.transferFamilyIdx = transferIdx;
 			m_physicalDevice = gpu.device;
 			vkcontext.gpu = gpu;
 
@@ -565,6 +592,9 @@ void idRenderBackend::CreateLogicalDeviceAndQueues() {
 	idList< int > uniqueIdx;
 	uniqueIdx.AddUnique( vkcontext.graphicsFamilyIdx );
 	uniqueIdx.AddUnique( vkcontext.presentFamilyIdx );
+	if ( vkcontext.transferFamilyIdx >= 0 ) {
+		uniqueIdx.AddUnique( vkcontext.transferFamilyIdx );
+	}
 	
 	idList< VkDeviceQueueCreateInfo > devqInfo;
 
@@ -606,6 +636,9 @@ void idRenderBackend::CreateLogicalDeviceAndQueues() {
 
 	vkGetDeviceQueue( vkcontext.device, vkcontext.graphicsFamilyIdx, 0, &vkcontext.graphicsQueue );
 	vkGetDeviceQueue( vkcontext.device, vkcontext.presentFamilyIdx, 0, &vkcontext.presentQueue );
+	if ( vkcontext.transferFamilyIdx >= 0 ) {
+		vkGetDeviceQueue( vkcontext.device, vkcontext.transferFamilyIdx, 0, &vkcontext.transferQueue );
+	}
 }
 
 /*
@@ -776,6 +809,16 @@ void idRenderBackend::CreateCommandPool() {
 	commandPoolCreateInfo.queueFamilyIndex = vkcontext.graphicsFamilyIdx;
 
 	ID_VK_CHECK( vkCreateCommandPool( vkcontext.device, &commandPoolCreateInfo, NULL, &m_commandPool ) );
+
+	// Command pools are externally synchronized, so every job that records
+	// secondary command buffers in parallel needs its own.
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
+		for ( int j = 0; j < MAX_RECORD_JOBS; ++j ) {
+			ID_VK_CHECK( vkCreateCommandPool( vkcontext.device, &commandPoolCreateInfo, NULL, &m_secondaryCommandPools[ i ][ j ] ) );
+		}
+	}
 }
 
 /*
@@ -829,6 +872,11 @@ void idRenderBackend::CreateQueryPool() {
 	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
 		ID_VK_CHECK( vkCreateQueryPool( vkcontext.device, &createInfo, NULL, &m_queryPools[ i ] ) );
 	}
+
+	m_timestampsSupported = vkcontext.gpu.queueFamilyProps[ vkcontext.graphicsFamilyIdx ].timestampValidBits != 0;
+	if ( !m_timestampsSupported ) {
+		idLib::Printf( "Graphics queue doesn't support timestamps, gpu timing is disabled.\n" );
+	}
 }
 
 /*
@@ -974,7 +1022,9 @@ void idRenderBackend::CreateRenderPass() {
 	depthAttachment.format = vkcontext.depthFormat;
 	depthAttachment.samples = vkcontext.sampleCount;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
@@ -1029,6 +1079,92 @@ void idRenderBackend::CreateRenderPass() {
 	renderPassResumeCreateInfo.dependencyCount = 0;
 
 	ID_VK_CHECK(vkCreateRenderPass(vkcontext.device, &renderPassResumeCreateInfo, NULL, &vkcontext.renderPassResume));
+
+	// The render pass is split around every run of secondary command buffers,
+	// so the continue pass has to pick up color, depth and stencil where the
+	// previous instance left them.
+	for ( int i = 0; i < 3; ++i ) {
+		attachments[ i ].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		attachments[ i ].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[ i ].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[ i ].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[ i ].initialLayout = attachments[ i ].finalLayout;
+	}
+	attachments[ 1 ].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[ 1 ].stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+	VkSubpassDependency dependency = {};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | 
+								VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+	VkRenderPassCreateInfo renderPassContinueCreateInfo = {};
+	renderPassContinueCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassContinueCreateInfo.attachmentCount = resolve ? 3 : 2;
+	renderPassContinueCreateInfo.pAttachments = attachments;
+	renderPassContinueCreateInfo.subpassCount = 1;
+	renderPassContinueCreateInfo.pSubpasses = &subpass;
+	renderPassContinueCreateInfo.dependencyCount = 1;
+	renderPassContinueCreateInfo.pDependencies = &dependency;
+
+	ID_VK_CHECK( vkCreateRenderPass( vkcontext.device, &renderPassContinueCreateInfo, NULL, &vkcontext.renderPassContinue ) );
+}
+
+/*
+=============
+GetPipelineCacheFileName
+
+The cache blob is only valid for the device and driver that produced it,
+so it is keyed by the pipelineCacheUUID the driver reports.
+=============
+*/
+static void GetPipelineCacheFileName( idStr & fileName ) {
+	const VkPhysicalDeviceProperties & props = vkcontext.gpu.props;
+
+	fileName = "vkpipelines/";
+	for ( int i = 0; i < VK_UUID_SIZE; ++i ) {
+		fileName += va( "%02x", props.pipelineCacheUUID[ i ] );
+	}
+	fileName += ".bin";
+}
+
+/*
+=============
+IsPipelineCacheDataValid
+
+Checks the VK_PIPELINE_CACHE_HEADER_VERSION_ONE header against the current device.
+Drivers should reject incompatible data themselves, but not all of them do.
+=============
+*/
+static bool IsPipelineCacheDataValid( const byte * data, int size ) {
+	const int headerSize = 4 * sizeof( uint32 ) + VK_UUID_SIZE;
+	if ( size < headerSize ) {
+		return false;
+	}
+
+	// headerSize, headerVersion, vendorID, deviceID
+	uint32 header[ 4 ];
+	memcpy( header, data, sizeof( header ) );
+
+	const VkPhysicalDeviceProperties & props = vkcontext.gpu.props;
+	if ( header[ 0 ] < (uint32)headerSize || header[ 0 ] > (uint32)size ) {
+		return false;
+	}
+	if ( header[ 1 ] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ) {
+		return false;
+	}
+	if ( header[ 2 ] != props.vendorID || header[ 3 ] != props.deviceID ) {
+		return false;
+	}
+	if ( memcmp( data + sizeof( header ), props.pipelineCacheUUID, VK_UUID_SIZE ) != 0 ) {
+		return false;
+	}
+	return true;
 }
 
 /*
@@ -1039,7 +1175,51 @@ CreatePipelineCache
 static void CreatePipelineCache() {
 	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
 	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	void * cacheData = NULL;
+	if ( r_vkPipelineCache.GetBool() ) {
+		idStr fileName;
+		GetPipelineCacheFileName( fileName );
+
+		int cacheSize = fileSystem->ReadFile( fileName.c_str(), &cacheData );
+		if ( cacheSize > 0 && IsPipelineCacheDataValid( (const byte *)cacheData, cacheSize ) ) {
+			pipelineCacheCreateInfo.initialDataSize = cacheSize;
+			pipelineCacheCreateInfo.pInitialData = cacheData;
+			idLib::Printf( "Loaded %d bytes of pipeline cache data from %s\n", cacheSize, fileName.c_str() );
+		} else if ( cacheSize > 0 ) {
+			idLib::Printf( "Discarding pipeline cache %s ( incompatible device or driver )\n", fileName.c_str() );
+		}
+	}
+
 	ID_VK_CHECK( vkCreatePipelineCache( vkcontext.device, &pipelineCacheCreateInfo, NULL, &vkcontext.pipelineCache ) );
+
+	if ( cacheData != NULL ) {
+		fileSystem->FreeFile( cacheData );
+	}
+}
+
+/*
+=============
+SavePipelineCache
+=============
+*/
+static void SavePipelineCache() {
+	if ( !r_vkPipelineCache.GetBool() || vkcontext.pipelineCache == VK_NULL_HANDLE ) {
+		return;
+	}
+
+	size_t cacheSize = 0;
+	ID_VK_CHECK( vkGetPipelineCacheData( vkcontext.device, vkcontext.pipelineCache, &cacheSize, NULL ) );
+	if ( cacheSize == 0 ) {
+		return;
+	}
+
+	idTempArray< byte > cacheData( cacheSize );
+	ID_VK_CHECK( vkGetPipelineCacheData( vkcontext.device, vkcontext.pipelineCache, &cacheSize, cacheData.Ptr() ) );
+
+	idStr fileName;
+	GetPipelineCacheFileName( fileName );
+	fileSystem->WriteFile( fileName.c_str(), cacheData.Ptr(), (int)cacheSize );
 }
 
 /*
@@ -1097,14 +1277,19 @@ ClearContext
 */
 static void ClearContext() {
 	vkcontext.jointCacheHandle = 0;
+	vkcontext.clusterCacheHandle = 0;
 	vkcontext.gpu = GPUInfo_t();
 	vkcontext.device = VK_NULL_HANDLE;
 	vkcontext.graphicsFamilyIdx = -1;
 	vkcontext.presentFamilyIdx = -1;
+	vkcontext.transferFamilyIdx = -1;
 	vkcontext.graphicsQueue = VK_NULL_HANDLE;
 	vkcontext.presentQueue = VK_NULL_HANDLE;
+	vkcontext.transferQueue = VK_NULL_HANDLE;
 	vkcontext.depthFormat = VK_FORMAT_UNDEFINED;
 	vkcontext.renderPass = VK_NULL_HANDLE;
+	vkcontext.renderPassResume = VK_NULL_HANDLE;
+	vkcontext.renderPassContinue = VK_NULL_HANDLE;
 	vkcontext.pipelineCache = VK_NULL_HANDLE;
 	vkcontext.sampleCount = VK_SAMPLE_COUNT_1_BIT;
 	vkcontext.supersampling = false;
@@ -1175,6 +1360,39 @@ void idRenderBackend::Clear() {
 		m_queryResults[ i ].Zero();
 	}
 	m_queryPools.Zero();
+	m_timestampsSupported = false;
+
+	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
+		m_gpuScopes[ i ].Clear();
+	}
+	m_gpuScopeStack.Clear();
+	m_gpuProfile.Clear();
+	m_gpuProfileFrameMicroSec = 0.0f;
+	m_gpuProfileCaptureFrames = 0;
+	m_gpuProfileCaptureFrameNum = 0;
+	m_gpuProfileCaptureStart = 0;
+	m_gpuProfileCSV = NULL;
+	m_gpuProfileTrace = NULL;
+	m_gpuProfileTraceHasEvents = false;
+
+	m_deferCommands = false;
+	m_deferredCommands.Clear();
+	m_dynamicStateValid.Zero();
+	m_deferredDynamicStateValid.Zero();
+
+	m_recordJobList = NULL;
+	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
+		m_secondaryCommandPools[ i ].Zero();
+		for ( int j = 0; j < MAX_RECORD_JOBS; ++j ) {
+			m_secondaryCommandBuffers[ i ][ j ].Clear();
+		}
+	}
+	m_numSecondaryCommandBuffers.Zero();
+
+	m_skinningDescriptorSetLayout = VK_NULL_HANDLE;
+	m_skinningPipelineLayout = VK_NULL_HANDLE;
+	m_skinningPipeline = VK_NULL_HANDLE;
+	m_skinningDescriptorPools.Zero();
 }
 
 /*
@@ -1216,6 +1434,9 @@ void idRenderBackend::Init() {
 	// Create Command Buffer
 	CreateCommandBuffer();
 
+	// Jobs for recording secondary command buffers
+	m_recordJobList = parallelJobManager->AllocJobList( JOBLIST_RENDERER_BACKEND, JOBLIST_PRIORITY_HIGH, MAX_RECORD_JOBS, 0, NULL );
+
 	// Setup the allocator
 #if defined( ID_USE_AMD_ALLOCATOR )
 	extern idCVar r_vkHostVisibleMemoryMB;
@@ -1255,6 +1476,9 @@ void idRenderBackend::Init() {
 
 	// Init Vertex Cache
 	vertexCache.Init( vkcontext.gpu.props.limits.minUniformBufferOffsetAlignment );
+
+	// Create the compute skinning pipeline
+	CreateSkinningPipeline();
 }
 
 /*
@@ -1268,6 +1492,8 @@ void idRenderBackend::Shutdown() {
 
 	renderProgManager.Shutdown();
 
+	DestroySkinningPipeline();
+
 	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
 		idImage::EmptyGarbage();
 	}
@@ -1275,7 +1501,8 @@ void idRenderBackend::Shutdown() {
 	// Detroy Frame Buffers
 	DestroyFrameBuffers();
 
-	// Destroy Pipeline Cache
+	// Save and Destroy Pipeline Cache
+	SavePipelineCache();
 	vkDestroyPipelineCache( vkcontext.device, vkcontext.pipelineCache, NULL );
 
 	// Destroy Render Pass
@@ -1284,6 +1511,9 @@ void idRenderBackend::Shutdown() {
 	// Destroy Render Pass
 	vkDestroyRenderPass(vkcontext.device, vkcontext.renderPassResume, NULL);
 
+	// Destroy Render Pass
+	vkDestroyRenderPass( vkcontext.device, vkcontext.renderPassContinue, NULL );
+
 	// Destroy Render Targets
 	DestroyRenderTargets();
 
@@ -1302,6 +1532,17 @@ void idRenderBackend::Shutdown() {
 	// Destroy Command Pool
 	vkDestroyCommandPool( vkcontext.device, m_commandPool, NULL );
 
+	// Destroy Secondary Command Pools, this frees their command buffers
+	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
+		for ( int j = 0; j < MAX_RECORD_JOBS; ++j ) {
+			vkDestroyCommandPool( vkcontext.device, m_secondaryCommandPools[ i ][ j ], NULL );
+		}
+	}
+
+	parallelJobManager->FreeJobList( m_recordJobList );
+
+	CaptureGPUProfile( 0 );
+
 	// Destroy Query Pools
 	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
 		vkDestroyQueryPool( vkcontext.device, m_queryPools[ i ], NULL );
@@ -1411,6 +1652,9 @@ void idRenderBackend::BlockingSwapBuffers() {
 	ID_VK_CHECK( vkResetFences( vkcontext.device, 1, &m_commandBufferFences[ m_currentFrameData ] ) );
 	m_commandBufferRecorded[ m_currentFrameData ] = false;
 
+	// the uploads this frame waited on can be signaled again
+	stagingManager.RecycleSemaphores( m_currentFrameData );
+
 	//vkDeviceWaitIdle( vkcontext.device );
 }
 
@@ -1485,23 +1729,716 @@ void idRenderBackend::DrawElementsWithCounters( const drawSurf_t * surf ) {
 
 	vkcontext.jointCacheHandle = surf->jointCache;
 
-	VkCommandBuffer commandBuffer = m_commandBuffers[ m_currentFrameData ];
+	if ( prog.usesLightClusters ) {
+		vkcontext.clusterCacheHandle = m_viewDef->clusterCache;
+	}
 
 	PrintState( m_glStateBits );
-	renderProgManager.CommitCurrent( m_glStateBits, commandBuffer );
 
-	{
-		const VkBuffer buffer = indexBuffer->GetAPIObject();
-		const VkDeviceSize offset = indexBuffer->GetOffset();
-		vkCmdBindIndexBuffer( commandBuffer, buffer, offset, VK_INDEX_TYPE_UINT16 );
+	backendCommand_t cmd;
+	cmd.type = BC_DRAW;
+
+	backendDrawCommand_t & draw = cmd.draw;
+	renderProgManager.CommitCurrent( m_glStateBits, draw );
+	draw.indexBuffer = indexBuffer->GetAPIObject();
+	draw.indexBufferOffset = indexBuffer->GetOffset();
+	draw.vertexBuffer = vertexBuffer->GetAPIObject();
+	draw.vertexBufferOffset = vertexBuffer->GetOffset();
+	draw.numIndexes = surf->numIndexes;
+	draw.firstIndex = indexOffset >> 1;
+	draw.baseVertex = vertOffset / sizeof( idDrawVert );
+
+	SubmitCommand( cmd );
+}
+
+/*
+=========================================================================================================
+
+GPU PROFILING
+
+=========================================================================================================
+*/
+
+// the first two queries of every frame bracket the whole command buffer
+static const uint32 QUERY_FRAME_BEGIN = 0;
+static const uint32 QUERY_FRAME_END = 1;
+static const uint32 QUERY_FIRST_SCOPE = 2;
+
+/*
+==================
+idRenderBackend::WriteTimestamp
+
+Goes through the command stream so it lands between the right draws,
+even when they are recorded into secondary command buffers.
+==================
+*/
+void idRenderBackend::WriteTimestamp( uint32 query ) {
+	backendCommand_t cmd;
+	cmd.type = BC_TIMESTAMP;
+	cmd.timestamp.queryPool = m_queryPools[ m_currentFrameData ];
+	cmd.timestamp.query = query;
+
+	SubmitCommand( cmd );
+}
+
+/*
+==================
+idRenderBackend::GPU_BeginScope
+==================
+*/
+void idRenderBackend::GPU_BeginScope( const char * name ) {
+	uint32 & queryIndex = m_queryIndex[ m_currentFrameData ];
+
+	const bool enabled = r_showGPUProfile.GetBool() || m_gpuProfileCaptureFrames > 0;
+	if ( !m_timestampsSupported || !enabled || queryIndex + 2 > NUM_TIMESTAMP_QUERIES ) {
+		m_gpuScopeStack.Append( -1 );
+		return;
 	}
-	{
-		const VkBuffer buffer = vertexBuffer->GetAPIObject();
-		const VkDeviceSize offset = vertexBuffer->GetOffset();
-		vkCmdBindVertexBuffers( commandBuffer, 0, 1, &buffer, &offset );
+
+	gpuProfileScope_t scope;
+	scope.name = name;
+	scope.depth = m_gpuScopeStack.Num();
+	scope.beginQuery = queryIndex++;
+	scope.endQuery = queryIndex++;
+	scope.startMicroSec = 0.0f;
+	scope.durationMicroSec = 0.0f;
+
+	m_gpuScopeStack.Append( m_gpuScopes[ m_currentFrameData ].Append( scope ) );
+
+	WriteTimestamp( scope.beginQuery );
+}
+
+/*
+==================
+idRenderBackend::GPU_EndScope
+==================
+*/
+void idRenderBackend::GPU_EndScope() {
+	assert( m_gpuScopeStack.Num() > 0 );
+
+	const int index = m_gpuScopeStack[ m_gpuScopeStack.Num() - 1 ];
+	m_gpuScopeStack.RemoveIndex( m_gpuScopeStack.Num() - 1 );
+
+	if ( index != -1 ) {
+		WriteTimestamp( m_gpuScopes[ m_currentFrameData ][ index ].endQuery );
+	}
+}
+
+/*
+==================
+idRenderBackend::ResolveGPUProfile
+
+Called once the frame's fence has been waited on, so the queries are available.
+==================
+*/
+void idRenderBackend::ResolveGPUProfile() {
+	const uint32 numQueries = m_queryIndex[ m_currentFrameData ];
+	if ( numQueries == 0 ) {
+		return;
+	}
+	m_queryIndex[ m_currentFrameData ] = 0;
+
+	idArray< uint64, NUM_TIMESTAMP_QUERIES > & results = m_queryResults[ m_currentFrameData ];
+	idList< gpuProfileScope_t, TAG_RENDER > & scopes = m_gpuScopes[ m_currentFrameData ];
+
+	ID_VK_CHECK( vkGetQueryPoolResults( vkcontext.device, m_queryPools[ m_currentFrameData ], 0, numQueries, 
+		numQueries * sizeof( uint64 ), results.Ptr(), sizeof( uint64 ), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT ) );
+
+	// timestamps wrap if the queue has less than 64 valid bits
+	const uint32 validBits = vkcontext.gpu.queueFamilyProps[ vkcontext.graphicsFamilyIdx ].timestampValidBits;
+	const uint64 mask = ( validBits >= 64 ) ? ~0ULL : ( ( 1ULL << validBits ) - 1 );
+	const double microSecPerTick = vkcontext.gpu.props.limits.timestampPeriod / 1000.0;
+
+	const uint64 frameStart = results[ QUERY_FRAME_BEGIN ];
+	const double frameMicroSec = ( ( results[ QUERY_FRAME_END ] - frameStart ) & mask ) * microSecPerTick;
+
+	m_pc.gpuMicroSec = (uint64)frameMicroSec;
+	m_gpuProfileFrameMicroSec = (float)frameMicroSec;
+
+	for ( int i = 0; i < scopes.Num(); ++i ) {
+		gpuProfileScope_t & scope = scopes[ i ];
+		const uint64 begin = results[ scope.beginQuery ];
+		const uint64 end = results[ scope.endQuery ];
+		scope.startMicroSec = (float)( ( ( begin - frameStart ) & mask ) * microSecPerTick );
+		scope.durationMicroSec = (float)( ( ( end - begin ) & mask ) * microSecPerTick );
+	}
+
+	m_gpuProfile = scopes;
+	scopes.SetNum( 0 );
+
+	if ( m_gpuProfileCaptureFrames <= 0 ) {
+		return;
 	}
 
-	vkCmdDrawIndexed( commandBuffer, surf->numIndexes, 1, ( indexOffset >> 1 ), vertOffset / sizeof( idDrawVert ), 0 );
+	if ( m_gpuProfileCaptureFrameNum == 0 ) {
+		m_gpuProfileCaptureStart = frameStart;
+	}
+	const double frameOffset = ( ( frameStart - m_gpuProfileCaptureStart ) & mask ) * microSecPerTick;
+
+	for ( int i = 0; i < m_gpuProfile.Num(); ++i ) {
+		const gpuProfileScope_t & scope = m_gpuProfile[ i ];
+
+		m_gpuProfileCSV->Printf( "%d,%s,%d,%.3f,%.3f\n", m_gpuProfileCaptureFrameNum, scope.name, scope.depth, scope.startMicroSec, scope.durationMicroSec );
+
+		// trace event format, opens in chrome://tracing and Perfetto with one track per nesting depth
+		m_gpuProfileTrace->Printf( "%s{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%d}}",
+			m_gpuProfileTraceHasEvents ? ",\n" : "",
+			scope.name, scope.depth, frameOffset + scope.startMicroSec, scope.durationMicroSec, m_gpuProfileCaptureFrameNum );
+		m_gpuProfileTraceHasEvents = true;
+	}
+
+	m_gpuProfileCaptureFrameNum++;
+	if ( --m_gpuProfileCaptureFrames == 0 ) {
+		CaptureGPUProfile( 0 );
+	}
+}
+
+/*
+==================
+idRenderBackend::CaptureGPUProfile
+
+Zero frames finishes a running capture.
+==================
+*/
+void idRenderBackend::CaptureGPUProfile( int numFrames ) {
+	if ( m_gpuProfileCSV != NULL ) {
+		m_gpuProfileTrace->Printf( "\n]\n" );
+
+		idLib::Printf( "Wrote %d frames to %s and %s\n", m_gpuProfileCaptureFrameNum, m_gpuProfileCSV->GetFullPath(), m_gpuProfileTrace->GetFullPath() );
+
+		fileSystem->CloseFile( m_gpuProfileCSV );
+		fileSystem->CloseFile( m_gpuProfileTrace );
+		m_gpuProfileCSV = NULL;
+		m_gpuProfileTrace = NULL;
+	}
+
+	m_gpuProfileCaptureFrames = 0;
+	m_gpuProfileCaptureFrameNum = 0;
+
+	if ( numFrames <= 0 ) {
+		return;
+	}
+
+	if ( !m_timestampsSupported ) {
+		idLib::Printf( "Timestamps aren't supported on this device.\n" );
+		return;
+	}
+
+	m_gpuProfileCSV = fileSystem->OpenFileWrite( "gpuprofile.csv" );
+	m_gpuProfileTrace = fileSystem->OpenFileWrite( "gpuprofile.json" );
+	if ( m_gpuProfileCSV == NULL || m_gpuProfileTrace == NULL ) {
+		idLib::Warning( "Couldn't open the gpu profile files for writing" );
+		fileSystem->CloseFile( m_gpuProfileCSV );
+		fileSystem->CloseFile( m_gpuProfileTrace );
+		m_gpuProfileCSV = NULL;
+		m_gpuProfileTrace = NULL;
+		return;
+	}
+
+	m_gpuProfileCSV->Printf( "frame,scope,depth,start_us,duration_us\n" );
+	m_gpuProfileTrace->Printf( "[\n" );
+	m_gpuProfileTraceHasEvents = false;
+
+	m_gpuProfileCaptureFrames = numFrames;
+}
+
+/*
+=========================================================================================================
+
+DEFERRED COMMAND RECORDING
+
+=========================================================================================================
+*/
+
+/*
+==================
+ExecuteBackendCommand
+==================
+*/
+static void ExecuteBackendCommand( VkCommandBuffer commandBuffer, const backendCommand_t & cmd ) {
+	switch ( cmd.type ) {
+		case BC_VIEWPORT:
+			vkCmdSetViewport( commandBuffer, 0, 1, &cmd.viewport );
+			break;
+		case BC_SCISSOR:
+			vkCmdSetScissor( commandBuffer, 0, 1, &cmd.scissor );
+			break;
+		case BC_DEPTH_BOUNDS:
+			vkCmdSetDepthBounds( commandBuffer, cmd.depthBounds.zmin, cmd.depthBounds.zmax );
+			break;
+		case BC_DEPTH_BIAS:
+			vkCmdSetDepthBias( commandBuffer, cmd.depthBias.bias, 0.0f, cmd.depthBias.scale );
+			break;
+		case BC_CLEAR:
+			vkCmdClearAttachments( commandBuffer, cmd.clear.numAttachments, cmd.clear.attachments, 1, &cmd.clear.rect );
+			break;
+		case BC_TIMESTAMP:
+			vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, cmd.timestamp.queryPool, cmd.timestamp.query );
+			break;
+		case BC_DRAW: {
+			const backendDrawCommand_t & draw = cmd.draw;
+			vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipelineLayout, 0, 1, &draw.descriptorSet, draw.numDynamicOffsets, draw.dynamicOffsets );
+			vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline );
+			vkCmdBindIndexBuffer( commandBuffer, draw.indexBuffer, draw.indexBufferOffset, VK_INDEX_TYPE_UINT16 );
+			vkCmdBindVertexBuffers( commandBuffer, 0, 1, &draw.vertexBuffer, &draw.vertexBufferOffset );
+			vkCmdDrawIndexed( commandBuffer, draw.numIndexes, 1, draw.firstIndex, draw.baseVertex, 0 );
+			break;
+		}
+	}
+}
+
+/*
+==================
+RecordCommandsJob
+==================
+*/
+struct recordCommandsParms_t {
+	VkCommandBuffer				commandBuffer;
+	VkRenderPass				renderPass;
+	VkFramebuffer				framebuffer;
+	backendCommand_t			dynamicState[ NUM_DYNAMIC_STATE_COMMANDS ];
+	bool						dynamicStateValid[ NUM_DYNAMIC_STATE_COMMANDS ];
+	const backendCommand_t *	commands;
+	int							numCommands;
+};
+
+static void RecordCommandsJob( recordCommandsParms_t * parms ) {
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = parms->renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = parms->framebuffer;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	ID_VK_CHECK( vkBeginCommandBuffer( parms->commandBuffer, &beginInfo ) );
+
+	// secondary command buffers don't inherit any dynamic state
+	for ( int i = 0; i < NUM_DYNAMIC_STATE_COMMANDS; ++i ) {
+		if ( parms->dynamicStateValid[ i ] ) {
+			ExecuteBackendCommand( parms->commandBuffer, parms->dynamicState[ i ] );
+		}
+	}
+
+	for ( int i = 0; i < parms->numCommands; ++i ) {
+		ExecuteBackendCommand( parms->commandBuffer, parms->commands[ i ] );
+	}
+
+	ID_VK_CHECK( vkEndCommandBuffer( parms->commandBuffer ) );
+}
+
+REGISTER_PARALLEL_JOB( RecordCommandsJob, "RecordCommandsJob" );
+
+/*
+==================
+idRenderBackend::SubmitCommand
+==================
+*/
+void idRenderBackend::SubmitCommand( const backendCommand_t & cmd ) {
+	if ( cmd.type < NUM_DYNAMIC_STATE_COMMANDS ) {
+		m_dynamicState[ cmd.type ] = cmd;
+		m_dynamicStateValid[ cmd.type ] = true;
+	}
+
+	if ( m_deferCommands ) {
+		m_deferredCommands.Append( cmd );
+		return;
+	}
+
+	ExecuteBackendCommand( m_commandBuffers[ m_currentFrameData ], cmd );
+}
+
+/*
+==================
+idRenderBackend::BeginDeferredCommands
+==================
+*/
+void idRenderBackend::BeginDeferredCommands() {
+	assert( !m_deferCommands );
+
+	if ( !r_vkParallelRecord.GetBool() ) {
+		return;
+	}
+
+	m_deferCommands = true;
+	m_deferredDynamicState = m_dynamicState;
+	m_deferredDynamicStateValid = m_dynamicStateValid;
+}
+
+/*
+==================
+idRenderBackend::EndDeferredCommands
+==================
+*/
+void idRenderBackend::EndDeferredCommands() {
+	if ( !m_deferCommands ) {
+		return;
+	}
+
+	FlushDeferredCommands();
+
+	m_deferCommands = false;
+}
+
+/*
+==================
+idRenderBackend::AllocSecondaryCommandBuffer
+==================
+*/
+VkCommandBuffer idRenderBackend::AllocSecondaryCommandBuffer( int slot ) {
+	idList< VkCommandBuffer, TAG_RENDER > & commandBuffers = m_secondaryCommandBuffers[ m_currentFrameData ][ slot ];
+
+	if ( m_numSecondaryCommandBuffers[ slot ] == commandBuffers.Num() ) {
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+		commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		commandBufferAllocateInfo.commandPool = m_secondaryCommandPools[ m_currentFrameData ][ slot ];
+		commandBufferAllocateInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		ID_VK_CHECK( vkAllocateCommandBuffers( vkcontext.device, &commandBufferAllocateInfo, &commandBuffer ) );
+		commandBuffers.Append( commandBuffer );
+	}
+
+	return commandBuffers[ m_numSecondaryCommandBuffers[ slot ]++ ];
+}
+
+/*
+==================
+idRenderBackend::FlushDeferredCommands
+
+Short runs are replayed straight into the primary command buffer, because
+executing secondary command buffers means splitting the render pass.
+==================
+*/
+void idRenderBackend::FlushDeferredCommands() {
+	const int numCommands = m_deferredCommands.Num();
+	if ( numCommands == 0 ) {
+		return;
+	}
+
+	VkCommandBuffer commandBuffer = m_commandBuffers[ m_currentFrameData ];
+
+	const int numJobs = Min( MAX_RECORD_JOBS, numCommands / r_vkRecordCommandsPerJob.GetInteger() );
+
+	if ( numJobs < 2 ) {
+		for ( int i = 0; i < numCommands; ++i ) {
+			ExecuteBackendCommand( commandBuffer, m_deferredCommands[ i ] );
+		}
+	} else {
+		recordCommandsParms_t jobParms[ MAX_RECORD_JOBS ];
+		VkCommandBuffer secondaryCommandBuffers[ MAX_RECORD_JOBS ];
+
+		const int commandsPerJob = ( numCommands + numJobs - 1 ) / numJobs;
+
+		// the dynamic state at the start of each job is whatever the previous jobs left behind
+		idArray< backendCommand_t, NUM_DYNAMIC_STATE_COMMANDS > dynamicState = m_deferredDynamicState;
+		idArray< bool, NUM_DYNAMIC_STATE_COMMANDS > dynamicStateValid = m_deferredDynamicStateValid;
+
+		for ( int i = 0; i < numJobs; ++i ) {
+			const int firstCommand = i * commandsPerJob;
+
+			recordCommandsParms_t & parms = jobParms[ i ];
+			parms.commandBuffer = AllocSecondaryCommandBuffer( i );
+			parms.renderPass = vkcontext.renderPassContinue;
+			parms.framebuffer = m_frameBuffers[ m_currentSwapIndex ];
+			parms.commands = m_deferredCommands.Ptr() + firstCommand;
+			parms.numCommands = Min( commandsPerJob, numCommands - firstCommand );
+			memcpy( parms.dynamicState, dynamicState.Ptr(), sizeof( parms.dynamicState ) );
+			memcpy( parms.dynamicStateValid, dynamicStateValid.Ptr(), sizeof( parms.dynamicStateValid ) );
+
+			for ( int j = 0; j < parms.numCommands; ++j ) {
+				const backendCommand_t & cmd = parms.commands[ j ];
+				if ( cmd.type < NUM_DYNAMIC_STATE_COMMANDS ) {
+					dynamicState[ cmd.type ] = cmd;
+					dynamicStateValid[ cmd.type ] = true;
+				}
+			}
+
+			secondaryCommandBuffers[ i ] = parms.commandBuffer;
+
+			m_recordJobList->AddJob( (jobRun_t)RecordCommandsJob, &parms );
+		}
+
+		m_recordJobList->Submit( NULL, JOBLIST_PARALLELISM_MAX_CORES );
+		m_recordJobList->Wait();
+
+		VkRenderPassBeginInfo renderPassBeginInfo = {};
+		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassBeginInfo.renderPass = vkcontext.renderPassContinue;
+		renderPassBeginInfo.framebuffer = m_frameBuffers[ m_currentSwapIndex ];
+		renderPassBeginInfo.renderArea.extent = m_swapchainExtent;
+
+		vkCmdEndRenderPass( commandBuffer );
+		vkCmdBeginRenderPass( commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS );
+		vkCmdExecuteCommands( commandBuffer, numJobs, secondaryCommandBuffers );
+		vkCmdEndRenderPass( commandBuffer );
+		vkCmdBeginRenderPass( commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+		// the primary's dynamic state is undefined after executing secondary command buffers
+		for ( int i = 0; i < NUM_DYNAMIC_STATE_COMMANDS; ++i ) {
+			if ( m_dynamicStateValid[ i ] ) {
+				ExecuteBackendCommand( commandBuffer, m_dynamicState[ i ] );
+			}
+		}
+	}
+
+	m_deferredCommands.SetNum( 0 );
+	m_deferredDynamicState = m_dynamicState;
+	m_deferredDynamicStateValid = m_dynamicStateValid;
+}
+
+/*
+=========================================================================================================
+
+COMPUTE SKINNING
+
+=========================================================================================================
+*/
+
+const int MAX_SKINNING_DESCRIPTOR_SETS = 8;
+const int SKINNING_GROUP_SIZE = 64;	// local_size_x of skinning.comp
+
+struct skinningParms_t {
+	uint32	jointOffset;	// in vec4s
+	uint32	sourceOffset;	// in uints
+	uint32	outputOffset;	// in uints
+	uint32	numVerts;
+	uint32	shadowVerts;
+};
+
+/*
+==================
+idRenderBackend::CreateSkinningPipeline
+
+Compute skinning is optional, the front end falls back to skinning in the
+vertex programs when the queue can't run compute or the shader is missing.
+==================
+*/
+void idRenderBackend::CreateSkinningPipeline() {
+	vertexCache.SetComputeSkinningAvailable( false );
+
+	if ( ( vkcontext.gpu.queueFamilyProps[ vkcontext.graphicsFamilyIdx ].queueFlags & VK_QUEUE_COMPUTE_BIT ) == 0 ) {
+		idLib::Printf( "Compute skinning disabled, the graphics queue does not support compute.\n" );
+		return;
+	}
+
+	void * spirvBuffer = NULL;
+	int spirvLen = fileSystem->ReadFile( "renderprogs\\spirv\\skinning.cspv", &spirvBuffer );
+	if ( spirvLen <= 0 ) {
+		idLib::Warning( "Compute skinning disabled, unable to load renderprogs\\spirv\\skinning.cspv." );
+		return;
+	}
+
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = spirvLen;
+	shaderModuleCreateInfo.pCode = (uint32 *)spirvBuffer;
+
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	ID_VK_CHECK( vkCreateShaderModule( vkcontext.device, &shaderModuleCreateInfo, NULL, &shaderModule ) );
+
+	Mem_Free( spirvBuffer );
+
+	// joints, source vertexes, output vertexes
+	VkDescriptorSetLayoutBinding bindings[ 3 ] = {};
+	for ( int i = 0; i < 3; ++i ) {
+		bindings[ i ].binding = i;
+		bindings[ i ].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[ i ].descriptorCount = 1;
+		bindings[ i ].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.bindingCount = 3;
+	setLayoutCreateInfo.pBindings = bindings;
+
+	ID_VK_CHECK( vkCreateDescriptorSetLayout( vkcontext.device, &setLayoutCreateInfo, NULL, &m_skinningDescriptorSetLayout ) );
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof( skinningParms_t );
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &m_skinningDescriptorSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	ID_VK_CHECK( vkCreatePipelineLayout( vkcontext.device, &pipelineLayoutCreateInfo, NULL, &m_skinningPipelineLayout ) );
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = shaderModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.layout = m_skinningPipelineLayout;
+
+	ID_VK_CHECK( vkCreateComputePipelines( vkcontext.device, vkcontext.pipelineCache, 1, &pipelineCreateInfo, NULL, &m_skinningPipeline ) );
+
+	vkDestroyShaderModule( vkcontext.device, shaderModule, NULL );
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = MAX_SKINNING_DESCRIPTOR_SETS * 3;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = MAX_SKINNING_DESCRIPTOR_SETS;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
+		ID_VK_CHECK( vkCreateDescriptorPool( vkcontext.device, &poolCreateInfo, NULL, &m_skinningDescriptorPools[ i ] ) );
+	}
+
+	vertexCache.SetComputeSkinningAvailable( true );
+}
+
+/*
+==================
+idRenderBackend::DestroySkinningPipeline
+==================
+*/
+void idRenderBackend::DestroySkinningPipeline() {
+	vertexCache.SetComputeSkinningAvailable( false );
+
+	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
+		vkDestroyDescriptorPool( vkcontext.device, m_skinningDescriptorPools[ i ], NULL );
+	}
+	m_skinningDescriptorPools.Zero();
+
+	vkDestroyPipeline( vkcontext.device, m_skinningPipeline, NULL );
+	vkDestroyPipelineLayout( vkcontext.device, m_skinningPipelineLayout, NULL );
+	vkDestroyDescriptorSetLayout( vkcontext.device, m_skinningDescriptorSetLayout, NULL );
+
+	m_skinningPipeline = VK_NULL_HANDLE;
+	m_skinningPipelineLayout = VK_NULL_HANDLE;
+	m_skinningDescriptorSetLayout = VK_NULL_HANDLE;
+}
+
+/*
+==================
+idRenderBackend::DispatchSkinning
+
+Skins everything the front end queued for this frame before the render
+pass begins. The buffers are bound whole and the offsets of each job are
+pushed as constants, so only a couple of descriptor sets are ever needed.
+==================
+*/
+void idRenderBackend::DispatchSkinning( VkCommandBuffer commandBuffer ) {
+	const skinningJob_t * jobs = NULL;
+	const int numJobs = vertexCache.GetSkinningJobs( &jobs );
+	if ( numJobs == 0 || m_skinningPipeline == VK_NULL_HANDLE ) {
+		return;
+	}
+
+	GPU_BeginScope( "Skinning" );
+
+	VkDescriptorPool descriptorPool = m_skinningDescriptorPools[ m_currentFrameData ];
+	ID_VK_CHECK( vkResetDescriptorPool( vkcontext.device, descriptorPool, 0 ) );
+
+	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_skinningPipeline );
+
+	int numSets = 0;
+	VkBuffer setBuffers[ MAX_SKINNING_DESCRIPTOR_SETS ][ 3 ];
+	VkDescriptorSet sets[ MAX_SKINNING_DESCRIPTOR_SETS ];
+	VkDescriptorSet boundSet = VK_NULL_HANDLE;
+
+	for ( int i = 0; i < numJobs; ++i ) {
+		const skinningJob_t & job = jobs[ i ];
+
+		idUniformBuffer jointBuffer;
+		idVertexBuffer sourceBuffer;
+		idVertexBuffer outputBuffer;
+		if ( !vertexCache.GetJointBuffer( job.jointCache, &jointBuffer ) ||
+			!vertexCache.GetVertexBuffer( job.sourceCache, &sourceBuffer ) ||
+			!vertexCache.GetVertexBuffer( job.outputCache, &outputBuffer ) ) {
+			idLib::Warning( "idRenderBackend::DispatchSkinning: stale skinning job" );
+			continue;
+		}
+
+		const VkBuffer buffers[ 3 ] = { jointBuffer.GetAPIObject(), sourceBuffer.GetAPIObject(), outputBuffer.GetAPIObject() };
+
+		int setNum = 0;
+		for ( ; setNum < numSets; ++setNum ) {
+			if ( memcmp( setBuffers[ setNum ], buffers, sizeof( buffers ) ) == 0 ) {
+				break;
+			}
+		}
+
+		if ( setNum == numSets ) {
+			if ( numSets == MAX_SKINNING_DESCRIPTOR_SETS ) {
+				idLib::Error( "idRenderBackend::DispatchSkinning: too many skinning buffer combinations" );
+			}
+
+			VkDescriptorSetAllocateInfo setAllocInfo = {};
+			setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			setAllocInfo.descriptorPool = descriptorPool;
+			setAllocInfo.descriptorSetCount = 1;
+			setAllocInfo.pSetLayouts = &m_skinningDescriptorSetLayout;
+
+			ID_VK_CHECK( vkAllocateDescriptorSets( vkcontext.device, &setAllocInfo, &sets[ setNum ] ) );
+
+			VkDescriptorBufferInfo bufferInfos[ 3 ] = {};
+			VkWriteDescriptorSet writes[ 3 ] = {};
+			for ( int j = 0; j < 3; ++j ) {
+				bufferInfos[ j ].buffer = buffers[ j ];
+				bufferInfos[ j ].offset = 0;
+				bufferInfos[ j ].range = VK_WHOLE_SIZE;
+
+				writes[ j ].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[ j ].dstSet = sets[ setNum ];
+				writes[ j ].dstBinding = j;
+				writes[ j ].descriptorCount = 1;
+				writes[ j ].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				writes[ j ].pBufferInfo = &bufferInfos[ j ];
+			}
+
+			vkUpdateDescriptorSets( vkcontext.device, 3, writes, 0, NULL );
+
+			memcpy( setBuffers[ setNum ], buffers, sizeof( buffers ) );
+			numSets++;
+		}
+
+		if ( sets[ setNum ] != boundSet ) {
+			boundSet = sets[ setNum ];
+			vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_skinningPipelineLayout, 0, 1, &boundSet, 0, NULL );
+		}
+
+		skinningParms_t parms;
+		parms.jointOffset = jointBuffer.GetOffset() / sizeof( idVec4 );
+		parms.sourceOffset = sourceBuffer.GetOffset() / sizeof( uint32 );
+		parms.outputOffset = outputBuffer.GetOffset() / sizeof( uint32 );
+		parms.numVerts = job.numVerts;
+		parms.shadowVerts = job.shadowVerts ? 1 : 0;
+
+		vkCmdPushConstants( commandBuffer, m_skinningPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( parms ), &parms );
+		vkCmdDispatch( commandBuffer, ( job.numVerts + SKINNING_GROUP_SIZE - 1 ) / SKINNING_GROUP_SIZE, 1, 1 );
+
+		m_pc.c_skinningJobs++;
+		m_pc.c_skinnedVerts += job.numVerts;
+	}
+
+	// the skinned vertexes are read as vertex attributes by every pass of the frame
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier( 
+		commandBuffer, 
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
+		0, 1, &barrier, 0, NULL, 0, NULL );
+
+	GPU_EndScope();
 }
 
 /*
@@ -1527,20 +2464,17 @@ void idRenderBackend::GL_StartFrame() {
 	stagingManager.Flush();
 	renderProgManager.StartFrame();
 
-	VkQueryPool queryPool = m_queryPools[ m_currentFrameData ];
-	idArray< uint64, NUM_TIMESTAMP_QUERIES > & results = m_queryResults[ m_currentFrameData ];
+	for ( int i = 0; i < MAX_RECORD_JOBS; ++i ) {
+		ID_VK_CHECK( vkResetCommandPool( vkcontext.device, m_secondaryCommandPools[ m_currentFrameData ][ i ], 0 ) );
+	}
+	m_numSecondaryCommandBuffers.Zero();
 
-	if ( m_queryIndex[ m_currentFrameData ] > 0 ) {
-		vkGetQueryPoolResults( vkcontext.device, queryPool, 0, 2, 
-			results.ByteSize(), results.Ptr(), sizeof( uint64 ), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT );
+	// a new command buffer starts without any dynamic state
+	m_dynamicStateValid.Zero();
 
-		const uint64 gpuStart = results[ 0 ];
-		const uint64 gpuEnd = results[ 1 ];
-		const uint64 tick = ( 1000 * 1000 * 1000 ) / vkcontext.gpu.props.limits.timestampPeriod;
-		m_pc.gpuMicroSec = ( ( gpuEnd - gpuStart ) * 1000 * 1000 ) / tick;
+	ResolveGPUProfile();
 
-		m_queryIndex[ m_currentFrameData ] = 0;
-	}
+	VkQueryPool queryPool = m_queryPools[ m_currentFrameData ];
 
 	VkCommandBuffer commandBuffer = m_commandBuffers[ m_currentFrameData ];
 
@@ -1550,6 +2484,15 @@ void idRenderBackend::GL_StartFrame() {
 
 	vkCmdResetQueryPool( commandBuffer, queryPool, 0, NUM_TIMESTAMP_QUERIES );
 
+	if ( m_timestampsSupported ) {
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, QUERY_FRAME_BEGIN );
+		m_queryIndex[ m_currentFrameData ] = QUERY_FIRST_SCOPE;
+	}
+	m_gpuScopeStack.SetNum( 0 );
+
+	// compute work has to be recorded outside of the render pass
+	DispatchSkinning( commandBuffer );
+
 	VkRenderPassBeginInfo renderPassBeginInfo = {};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassBeginInfo.renderPass = vkcontext.renderPass;
@@ -1557,8 +2500,6 @@ void idRenderBackend::GL_StartFrame() {
 	renderPassBeginInfo.renderArea.extent = m_swapchainExtent;
 
 	vkCmdBeginRenderPass( commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE );
-
-	vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, m_queryIndex[ m_currentFrameData ]++ );
 }
 
 /*
@@ -1567,9 +2508,14 @@ idRenderBackend::GL_EndFrame
 ==================
 */
 void idRenderBackend::GL_EndFrame() {
+	assert( !m_deferCommands );
+
 	VkCommandBuffer commandBuffer = m_commandBuffers[ m_currentFrameData ];
 
-	vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPools[ m_currentFrameData ], m_queryIndex[ m_currentFrameData ]++ );
+	assert( m_gpuScopeStack.Num() == 0 );
+	if ( m_timestampsSupported ) {
+		vkCmdWriteTimestamp( commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPools[ m_currentFrameData ], QUERY_FRAME_END );
+	}
 
 	vkCmdEndRenderPass( commandBuffer );
 
@@ -1604,17 +2550,23 @@ void idRenderBackend::GL_EndFrame() {
 	VkSemaphore * acquire = &m_acquireSemaphores[ m_currentFrameData ];
 	VkSemaphore * finished = &m_renderCompleteSemaphores[ m_currentFrameData ];
 
-	VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	idList< VkSemaphore > waitSemaphores;
+	idList< VkPipelineStageFlags > waitStageMasks;
+	waitSemaphores.Append( *acquire );
+	waitStageMasks.Append( VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT );
+
+	// uploads submitted on the transfer queue
+	stagingManager.GetWaitSemaphores( m_currentFrameData, waitSemaphores, waitStageMasks );
 
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = acquire;
+	submitInfo.waitSemaphoreCount = waitSemaphores.Num();
+	submitInfo.pWaitSemaphores = waitSemaphores.Ptr();
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = finished;
-	submitInfo.pWaitDstStageMask = &dstStageMask;
+	submitInfo.pWaitDstStageMask = waitStageMasks.Ptr();
 
 	ID_VK_CHECK( vkQueueSubmit( vkcontext.graphicsQueue, 1, &submitInfo, m_commandBufferFences[ m_currentFrameData ] ) );
 
@@ -1681,6 +2633,9 @@ idRenderBackend::GL_CopyFrameBuffer
 ====================
 */
 void idRenderBackend::GL_CopyFrameBuffer( idImage * image, int x, int y, int imageWidth, int imageHeight ) {
+	// everything deferred so far has to be in the frame buffer before it is copied
+	FlushDeferredCommands();
+
 	VkCommandBuffer commandBuffer = m_commandBuffers[ m_currentFrameData ];
 
 	vkCmdEndRenderPass( commandBuffer );
@@ -1764,9 +2719,13 @@ void idRenderBackend::GL_Clear( bool color, bool depth, bool stencil, byte stenc
 	RENDERLOG_PRINTF( "GL_Clear( color=%d, depth=%d, stencil=%d, stencil=%d, r=%f, g=%f, b=%f, a=%f )\n", 
 		color, depth, stencil, stencilValue, r, g, b, a );
 
-	uint32 numAttachments = 0;
-	VkClearAttachment attachments[ 2 ];
-	memset( attachments, 0, sizeof( attachments ) );
+	backendCommand_t cmd;
+	cmd.type = BC_CLEAR;
+
+	uint32 & numAttachments = cmd.clear.numAttachments;
+	VkClearAttachment * attachments = cmd.clear.attachments;
+	numAttachments = 0;
+	memset( attachments, 0, sizeof( cmd.clear.attachments ) );
 
 	if ( color ) {
 		VkClearAttachment & attachment = attachments[ numAttachments++ ];
@@ -1791,12 +2750,13 @@ void idRenderBackend::GL_Clear( bool color, bool depth, bool stencil, byte stenc
 		attachment.clearValue.depthStencil.stencil = stencilValue;
 	}
 
-	VkClearRect clearRect = {};
+	VkClearRect & clearRect = cmd.clear.rect;
+	memset( &clearRect, 0, sizeof( clearRect ) );
 	clearRect.baseArrayLayer = 0;
 	clearRect.layerCount = 1;
 	clearRect.rect.extent = m_swapchainExtent;
 
-	vkCmdClearAttachments( m_commandBuffers[ m_currentFrameData ], numAttachments, attachments, 1, &clearRect );
+	SubmitCommand( cmd );
 }
 
 /*
@@ -1813,7 +2773,12 @@ void idRenderBackend::GL_DepthBoundsTest( const float zmin, const float zmax ) {
 		m_glStateBits = m_glStateBits & ~GLS_DEPTH_TEST_MASK;
 	} else {
 		m_glStateBits |= GLS_DEPTH_TEST_MASK;
-		vkCmdSetDepthBounds( m_commandBuffers[ m_currentFrameData ], zmin, zmax );
+
+		backendCommand_t cmd;
+		cmd.type = BC_DEPTH_BOUNDS;
+		cmd.depthBounds.zmin = zmin;
+		cmd.depthBounds.zmax = zmax;
+		SubmitCommand( cmd );
 	}
 
 	RENDERLOG_PRINTF( "GL_DepthBoundsTest( zmin=%f, zmax=%f )\n", zmin, zmax );
@@ -1825,7 +2790,11 @@ idRenderBackend::GL_PolygonOffset
 ====================
 */
 void idRenderBackend::GL_PolygonOffset( float scale, float bias ) {
-	vkCmdSetDepthBias( m_commandBuffers[ m_currentFrameData ], bias, 0.0f, scale );
+	backendCommand_t cmd;
+	cmd.type = BC_DEPTH_BIAS;
+	cmd.depthBias.scale = scale;
+	cmd.depthBias.bias = bias;
+	SubmitCommand( cmd );
 
 	RENDERLOG_PRINTF( "GL_PolygonOffset( scale=%f, bias=%f )\n", scale, bias );
 }
@@ -1836,12 +2805,15 @@ idRenderBackend::GL_Scissor
 ====================
 */
 void idRenderBackend::GL_Scissor( int x /* left*/, int y /* bottom */, int w, int h ) {
-	VkRect2D scissor;
+	backendCommand_t cmd;
+	cmd.type = BC_SCISSOR;
+
+	VkRect2D & scissor = cmd.scissor;
 	scissor.offset.x = x;
 	scissor.offset.y = y;
 	scissor.extent.width = w;
 	scissor.extent.height = h;
-	vkCmdSetScissor( m_commandBuffers[ m_currentFrameData ], 0, 1, &scissor );
+	SubmitCommand( cmd );
 }
 
 /*
@@ -1850,14 +2822,17 @@ idRenderBackend::GL_Viewport
 ====================
 */
 void idRenderBackend::GL_Viewport( int x /* left */, int y /* bottom */, int w, int h ) {
-	VkViewport viewport;
+	backendCommand_t cmd;
+	cmd.type = BC_VIEWPORT;
+
+	VkViewport & viewport = cmd.viewport;
 	viewport.x = x;
 	viewport.y = y;
 	viewport.width = w;
 	viewport.height = h;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport( m_commandBuffers[ m_currentFrameData ], 0, 1, &viewport );
+	SubmitCommand( cmd );
 }
 
 /*
@@ -1922,25 +2897,22 @@ void idRenderBackend::DrawStencilShadowPass( const drawSurf_t * drawSurf, const
 
 	vkcontext.jointCacheHandle = drawSurf->jointCache;
 	
-	VkCommandBuffer commandBuffer = m_commandBuffers[ m_currentFrameData ];
-	
 	PrintState( m_glStateBits );
-	renderProgManager.CommitCurrent( m_glStateBits, commandBuffer );
 
-	{
-		const VkBuffer buffer = indexBuffer->GetAPIObject();
-		const VkDeviceSize offset = indexBuffer->GetOffset();
-		vkCmdBindIndexBuffer( commandBuffer, buffer, offset, VK_INDEX_TYPE_UINT16 );
-	}
-	{
-		const VkBuffer buffer = vertexBuffer->GetAPIObject();
-		const VkDeviceSize offset = vertexBuffer->GetOffset();
-		vkCmdBindVertexBuffers( commandBuffer, 0, 1, &buffer, &offset );
-	}
+	backendCommand_t cmd;
+	cmd.type = BC_DRAW;
 
-	const int baseVertex = vertOffset / ( drawSurf->jointCache ? sizeof( idShadowVertSkinned ) : sizeof( idShadowVert ) );
+	backendDrawCommand_t & draw = cmd.draw;
+	renderProgManager.CommitCurrent( m_glStateBits, draw );
+	draw.indexBuffer = indexBuffer->GetAPIObject();
+	draw.indexBufferOffset = indexBuffer->GetOffset();
+	draw.vertexBuffer = vertexBuffer->GetAPIObject();
+	draw.vertexBufferOffset = vertexBuffer->GetOffset();
+	draw.numIndexes = drawSurf->numIndexes;
+	draw.firstIndex = indexOffset >> 1;
+	draw.baseVertex = vertOffset / ( drawSurf->jointCache ? sizeof( idShadowVertSkinned ) : sizeof( idShadowVert ) );
 
-	vkCmdDrawIndexed( commandBuffer, drawSurf->numIndexes, 1, ( indexOffset >> 1 ), baseVertex, 0 );
+	SubmitCommand( cmd );
 
 	if ( !renderZPass && r_useStencilShadowPreload.GetBool() ) {
 		// render again with Z-pass
@@ -1949,8 +2921,8 @@ void idRenderBackend::DrawStencilShadowPass( const drawSurf_t * drawSurf, const
 		GL_State( m_glStateBits & ~GLS_STENCIL_OP_BITS | stencil );
 
 		PrintState( m_glStateBits );
-		renderProgManager.CommitCurrent( m_glStateBits, commandBuffer );
+		renderProgManager.CommitCurrent( m_glStateBits, draw );
 
-		vkCmdDrawIndexed( commandBuffer, drawSurf->numIndexes, 1, ( indexOffset >> 1 ), baseVertex, 0 );
+		SubmitCommand( cmd );
 	}
 }
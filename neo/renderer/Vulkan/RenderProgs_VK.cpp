@@ -37,6 +37,11 @@ If you have questions concerning this license or the applicable additional terms
 
 void RpPrintState( uint64 stateBits );
 
+idCVar r_vkDescriptorSetCache( "r_vkDescriptorSetCache", "1", CVAR_RENDERER | CVAR_BOOL, "Share descriptor sets between draws that bind the same buffers and images within a frame." );
+idCVar r_vkPrewarmPipelines( "r_vkPrewarmPipelines", "1", CVAR_RENDERER | CVAR_BOOL, "Create previously seen pipelines at startup and level load instead of on first use." );
+
+static const char * PIPELINE_RECORDS_FILE = "vkpipelines/pipelines.txt";
+
 struct vertexLayout_t {
 	VkPipelineVertexInputStateCreateInfo inputState;
 	idList< VkVertexInputBindingDescription > bindingDesc;
@@ -176,7 +181,7 @@ CreateDescriptorPools
 static void CreateDescriptorPools( VkDescriptorPool (&pools)[ NUM_FRAME_DATA ] ) {
 	const int numPools = 2;
 	VkDescriptorPoolSize poolSizes[ numPools ];
-	poolSizes[ 0 ].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[ 0 ].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	poolSizes[ 0 ].descriptorCount = MAX_DESC_UNIFORM_BUFFERS;
 	poolSizes[ 1 ].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	poolSizes[ 1 ].descriptorCount = MAX_DESC_IMAGE_SAMPLERS;
@@ -200,7 +205,7 @@ GetDescriptorType
 */
 static VkDescriptorType GetDescriptorType( rpBinding_t type ) {
 	switch ( type ) {
-	case BINDING_TYPE_UNIFORM_BUFFER: return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	case BINDING_TYPE_UNIFORM_BUFFER: return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	case BINDING_TYPE_SAMPLER: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	default: 
 		idLib::Error( "Unknown rpBinding_t %d", static_cast< int >( type ) );
@@ -559,22 +564,104 @@ renderProg_t::GetPipeline
 ========================
 */
 VkPipeline renderProg_t::GetPipeline( uint64 stateBits, VkShaderModule vertexShader, VkShaderModule fragmentShader ) {
-	for ( int i = 0; i < pipelines.Num(); ++i ) {
-		if ( stateBits == pipelines[ i ].stateBits ) {
+	VkPipeline pipeline = FindPipeline( stateBits );
+	if ( pipeline != VK_NULL_HANDLE ) {
+		return pipeline;
+	}
+
+	pipeline = CreateGraphicsPipeline( vertexLayoutType, vertexShader, fragmentShader, pipelineLayout, stateBits );
+	AddPipeline( stateBits, pipeline );
+
+	return pipeline;
+}
+
+/*
+========================
+PipelineHashKey
+
+The low state bits are mostly blend and depth func, so fold the whole
+64 bits down before idHashIndex masks off the bottom of the key.
+========================
+*/
+static ID_INLINE int PipelineHashKey( uint64 stateBits ) {
+	const uint64 key = stateBits * 0x9E3779B97F4A7C15ULL;
+	return static_cast< int >( key >> 32 );
+}
+
+/*
+========================
+renderProg_t::FindPipeline
+
+The shader modules and vertex layout are fixed per renderProg, so the
+state bits are all that tell the pipelines of a program apart.
+========================
+*/
+VkPipeline renderProg_t::FindPipeline( uint64 stateBits ) const {
+	const int key = PipelineHashKey( stateBits );
+	for ( int i = pipelineHash.First( key ); i != -1; i = pipelineHash.Next( i ) ) {
+		if ( pipelines[ i ].stateBits == stateBits ) {
 			return pipelines[ i ].pipeline;
 		}
 	}
+	return VK_NULL_HANDLE;
+}
 
-	VkPipeline pipeline = CreateGraphicsPipeline( vertexLayoutType, vertexShader, fragmentShader, pipelineLayout, stateBits );
+/*
+========================
+renderProg_t::AddPipeline
+========================
+*/
+void renderProg_t::AddPipeline( uint64 stateBits, VkPipeline pipeline ) {
+	assert( FindPipeline( stateBits ) == VK_NULL_HANDLE );
 
 	pipelineState_t pipelineState;
 	pipelineState.pipeline = pipeline;
 	pipelineState.stateBits = stateBits;
-	pipelines.Append( pipelineState );
+	const int index = pipelines.Append( pipelineState );
 
-	return pipeline;
+	pipelineHash.Add( PipelineHashKey( stateBits ), index );
+}
+
+/*
+========================
+renderProg_t::ClearPipelines
+========================
+*/
+void renderProg_t::ClearPipelines() {
+	for ( int i = 0; i < pipelines.Num(); ++i ) {
+		vkDestroyPipeline( vkcontext.device, pipelines[ i ].pipeline, NULL );
+	}
+	pipelines.Clear();
+	pipelineHash.Clear();
+}
+
+/*
+========================
+PrewarmPipelineJob
+========================
+*/
+struct pipelinePrewarm_t {
+	int					progIndex;
+	vertexLayoutType_t	vertexLayoutType;
+	VkShaderModule		vertexShader;
+	VkShaderModule		fragmentShader;
+	VkPipelineLayout	pipelineLayout;
+	uint64				stateBits;
+	VkPipeline			pipeline;
+};
+
+static void PrewarmPipelineJob( pipelinePrewarm_t * parms ) {
+	// vkCreateGraphicsPipelines is free threaded, and access to the pipeline cache is synchronized by the driver
+	parms->pipeline = CreateGraphicsPipeline( 
+		parms->vertexLayoutType,
+		parms->vertexShader,
+		parms->fragmentShader,
+		parms->pipelineLayout,
+		parms->stateBits );
 }
 
+REGISTER_PARALLEL_JOB( PrewarmPipelineJob, "PrewarmPipelineJob" );
+
 /*
 ========================
 idRenderProgManager::idRenderProgManager
@@ -585,11 +672,33 @@ idRenderProgManager::idRenderProgManager() :
 	m_counter( 0 ),
 	m_currentData( 0 ),
 	m_currentDescSet( 0 ),
-	m_currentParmBufferOffset( 0 ) {
+	m_currentParmBufferOffset( 0 ),
+	m_pipelineRecordsModified( false ),
+	m_pipelineHits( 0 ),
+	m_pipelineMisses( 0 ),
+	m_descriptorSetCacheHash( DESCRIPTOR_SET_CACHE_HASH_SIZE, DESCRIPTOR_SET_CACHE_HASH_SIZE ),
+	m_descriptorSetHits( 0 ),
+	m_descriptorSetMisses( 0 ) {
 	
 	memset( m_parmBuffers, 0, sizeof( m_parmBuffers ) );
 }
 
+/*
+========================
+SpirvFilesExist
+
+Optional builtins are only created when their compiled shaders are present.
+========================
+*/
+static bool SpirvFilesExist( const char * name ) {
+	idStr vertexPath;
+	idStr fragmentPath;
+	vertexPath.Format( "renderprogs\\spirv\\%s.vspv", name );
+	fragmentPath.Format( "renderprogs\\spirv\\%s.fspv", name );
+
+	return fileSystem->ReadFile( vertexPath.c_str(), NULL ) > 0 && fileSystem->ReadFile( fragmentPath.c_str(), NULL ) > 0;
+}
+
 /*
 ========================
 idRenderProgManager::Init
@@ -603,6 +712,7 @@ void idRenderProgManager::Init() {
 		const char * name;
 		rpStage_t stages;
 		vertexLayoutType_t layout;
+		bool optional;
 	} builtins[ MAX_BUILTINS ] = {
 		{ BUILTIN_GUI, "gui", SHADER_STAGE_ALL, LAYOUT_DRAW_VERT },
 		{ BUILTIN_COLOR, "color", SHADER_STAGE_ALL, LAYOUT_DRAW_VERT },
@@ -634,10 +744,18 @@ void idRenderProgManager::Init() {
 		{ BUILTIN_WOBBLESKY, "wobblesky", SHADER_STAGE_ALL, LAYOUT_DRAW_VERT },
 		{ BUILTIN_BINK, "bink", SHADER_STAGE_ALL, LAYOUT_DRAW_VERT },
 		{ BUILTIN_BINK_GUI, "bink_gui", SHADER_STAGE_ALL, LAYOUT_DRAW_VERT },
+
+		{ BUILTIN_INTERACTION_CLUSTERED, "interaction_clustered", SHADER_STAGE_ALL, LAYOUT_DRAW_VERT, true },
 	};
 	m_renderProgs.SetNum( MAX_BUILTINS );
 	
 	for ( int i = 0; i < MAX_BUILTINS; i++ ) {
+
+		if ( builtins[ i ].optional && !SpirvFilesExist( builtins[ i ].name ) ) {
+			idLib::Printf( "Optional render program %s is not available.\n", builtins[ i ].name );
+			m_renderProgs[ i ].name = builtins[ i ].name;
+			continue;
+		}
 		
 		int vIndex = -1;
 		if ( builtins[ i ].stages & SHADER_STAGE_VERTEX ) {
@@ -673,6 +791,8 @@ void idRenderProgManager::Init() {
 	m_renderProgs[ BUILTIN_SHADOW_DEBUG_SKINNED ].usesJoints = true;
 	m_renderProgs[ BUILTIN_FOG_SKINNED ].usesJoints = true;
 
+	m_renderProgs[ BUILTIN_INTERACTION_CLUSTERED ].usesLightClusters = true;
+
 	// Create Vertex Descriptions
 	CreateVertexDescriptions();
 
@@ -686,6 +806,10 @@ void idRenderProgManager::Init() {
 
 	// Placeholder: mainly for optionalSkinning
 	emptyUBO.AllocBufferObject( NULL, sizeof( idVec4 ), BU_DYNAMIC );
+
+	// Create the pipelines for the builtins that were used in previous runs
+	LoadPipelineRecords();
+	PrewarmPipelines();
 }
 
 /*
@@ -694,6 +818,9 @@ idRenderProgManager::Shutdown
 ========================
 */
 void idRenderProgManager::Shutdown() {
+	SavePipelineRecords();
+	m_pipelineRecords.Clear();
+
 	// destroy shaders
 	for ( int i = 0; i < m_shaders.Num(); ++i ) {
 		shader_t & shader = m_shaders[ i ];
@@ -704,11 +831,7 @@ void idRenderProgManager::Shutdown() {
 	// destroy pipelines
 	for ( int i = 0; i < m_renderProgs.Num(); ++i ) {
 		renderProg_t & prog = m_renderProgs[ i ];
-		
-		for ( int j = 0; j < prog.pipelines.Num(); ++j ) {
-			vkDestroyPipeline( vkcontext.device, prog.pipelines[ j ].pipeline, NULL );
-		}
-		prog.pipelines.Clear();
+		prog.ClearPipelines();
 
 		vkDestroyDescriptorSetLayout( vkcontext.device, prog.descriptorSetLayout, NULL );
 		vkDestroyPipelineLayout( vkcontext.device, prog.pipelineLayout, NULL );
@@ -749,6 +872,11 @@ void idRenderProgManager::StartFrame() {
 	m_currentParmBufferOffset = 0;
 
 	vkResetDescriptorPool( vkcontext.device, m_descriptorPools[ m_currentData ], 0 );
+
+	// the cached sets were allocated from the pool that was just reset
+	m_descriptorSetCache.SetNum( 0 );
+	m_descriptorSetCacheKeys.SetNum( 0 );
+	m_descriptorSetCacheHash.Clear();
 }
 
 /*
@@ -787,47 +915,59 @@ void idRenderProgManager::AllocParmBlockBuffer( const idList< int > & parmIndice
 	m_currentParmBufferOffset += bytes;
 }
 
+/*
+========================
+DescriptorSetCacheKey
+========================
+*/
+static int DescriptorSetCacheKey( const uint64 * keys, const int numKeys ) {
+	uint64 hash = 0;
+	for ( int i = 0; i < numKeys; ++i ) {
+		hash = ( hash ^ keys[ i ] ) * 0x100000001B3ULL;
+	}
+	return static_cast< int >( hash ^ ( hash >> 32 ) );
+}
+
 /*
 ========================
 idRenderProgManager::CommitCurrent
+
+Uploads the parms of the current program and finds a descriptor set for it.
+Nothing is recorded, the caller binds the returned pipeline and descriptor set,
+possibly into a secondary command buffer on another thread.
+
+The uniform buffers are bound as dynamic uniform buffers, so a descriptor set only
+depends on the buffers and images bound to it and not on where this draw's parms
+landed in the buffer. Draws that bind the same images with the same program share
+a descriptor set for the rest of the frame.
 ========================
 */
-void idRenderProgManager::CommitCurrent( uint64 stateBits, VkCommandBuffer commandBuffer ) {
+void idRenderProgManager::CommitCurrent( uint64 stateBits, backendDrawCommand_t & draw ) {
 	renderProg_t & prog = m_renderProgs[ m_current ];
 
-	VkPipeline pipeline = prog.GetPipeline( 
+	const int numPipelines = prog.pipelines.Num();
+
+	draw.pipeline = prog.GetPipeline( 
 		stateBits,
 		m_shaders[ prog.vertexShaderIndex ].module,
 		prog.fragmentShaderIndex != -1 ? m_shaders[ prog.fragmentShaderIndex ].module : VK_NULL_HANDLE );
+	draw.pipelineLayout = prog.pipelineLayout;
 
-	VkDescriptorSetAllocateInfo setAllocInfo = {};
-	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.pNext = NULL;
-	setAllocInfo.descriptorPool = m_descriptorPools[ m_currentData ];
-	setAllocInfo.descriptorSetCount = 1;
-	setAllocInfo.pSetLayouts = &prog.descriptorSetLayout;
-
-	ID_VK_CHECK( vkAllocateDescriptorSets( vkcontext.device, &setAllocInfo, &m_descriptorSets[ m_currentData ][ m_currentDescSet ] ) );
-
-	VkDescriptorSet descSet = m_descriptorSets[ m_currentData ][ m_currentDescSet ];
-	m_currentDescSet++;
-
-	int writeIndex = 0;
-	int bufferIndex = 0;
-	int	imageIndex = 0;
-	int bindingIndex = 0;
-	
-	VkWriteDescriptorSet writes[ MAX_DESC_SET_WRITES ];
-	VkDescriptorBufferInfo bufferInfos[ MAX_DESC_SET_WRITES ];
-	VkDescriptorImageInfo imageInfos[ MAX_DESC_SET_WRITES ];
+	if ( prog.pipelines.Num() != numPipelines ) {
+		m_pipelineMisses++;
+		RecordPipeline( prog, stateBits );
+	} else {
+		m_pipelineHits++;
+	}
 
 	int uboIndex = 0;
-	idUniformBuffer * ubos[ 3 ] = { NULL, NULL, NULL };
+	idUniformBuffer * ubos[ MAX_DYNAMIC_UNIFORM_BUFFERS ] = { NULL, NULL, NULL };
 
 	idUniformBuffer vertParms;
 	if ( prog.vertexShaderIndex > -1 && m_shaders[ prog.vertexShaderIndex ].parmIndices.Num() > 0 ) {
 		AllocParmBlockBuffer( m_shaders[ prog.vertexShaderIndex ].parmIndices, vertParms );
 
+		assert( uboIndex < MAX_DYNAMIC_UNIFORM_BUFFERS );
 		ubos[ uboIndex++ ] = &vertParms;
 	}
 
@@ -839,8 +979,10 @@ void idRenderProgManager::CommitCurrent( uint64 stateBits, VkCommandBuffer comma
 		}
 		assert( ( jointBuffer.GetOffset() & ( vkcontext.gpu.props.limits.minUniformBufferOffsetAlignment - 1 ) ) == 0 );
 
+		assert( uboIndex < MAX_DYNAMIC_UNIFORM_BUFFERS );
 		ubos[ uboIndex++ ] = &jointBuffer;
 	} else if ( prog.optionalSkinning ) {
+		assert( uboIndex < MAX_DYNAMIC_UNIFORM_BUFFERS );
 		ubos[ uboIndex++ ] = &emptyUBO;
 	}
 
@@ -848,9 +990,35 @@ void idRenderProgManager::CommitCurrent( uint64 stateBits, VkCommandBuffer comma
 	if ( prog.fragmentShaderIndex > -1 && m_shaders[ prog.fragmentShaderIndex ].parmIndices.Num() > 0 ) {
 		AllocParmBlockBuffer( m_shaders[ prog.fragmentShaderIndex ].parmIndices, fragParms );
 
+		assert( uboIndex < MAX_DYNAMIC_UNIFORM_BUFFERS );
 		ubos[ uboIndex++ ] = &fragParms;
 	}
 
+	// the light clusters of the view are allocated like joints, as a single uniform block
+	idUniformBuffer clusterBuffer;
+	if ( prog.usesLightClusters ) {
+		if ( !vertexCache.GetJointBuffer( vkcontext.clusterCacheHandle, &clusterBuffer ) ) {
+			idLib::Error( "idRenderProgManager::CommitCurrent: clusterBuffer == NULL" );
+			return;
+		}
+
+		assert( uboIndex < MAX_DYNAMIC_UNIFORM_BUFFERS );
+		ubos[ uboIndex++ ] = &clusterBuffer;
+	}
+
+	int bufferIndex = 0;
+	int	imageIndex = 0;
+	
+	VkDescriptorBufferInfo bufferInfos[ MAX_DESC_SET_WRITES ];
+	VkDescriptorImageInfo imageInfos[ MAX_DESC_SET_WRITES ];
+
+	// the key is the layout followed by everything that is written to the set
+	int numKeys = 0;
+	uint64 keys[ 1 + MAX_DESC_SET_WRITES * 3 ];
+	keys[ numKeys++ ] = (uint64)prog.descriptorSetLayout;
+
+	draw.numDynamicOffsets = 0;
+
 	for ( int i = 0; i < prog.bindings.Num(); ++i ) {
 		rpBinding_t binding = prog.bindings[ i ];
 
@@ -861,18 +1029,13 @@ void idRenderProgManager::CommitCurrent( uint64 stateBits, VkCommandBuffer comma
 				VkDescriptorBufferInfo & bufferInfo = bufferInfos[ bufferIndex++ ];
 				memset( &bufferInfo, 0, sizeof( VkDescriptorBufferInfo ) );
 				bufferInfo.buffer = ubo->GetAPIObject();
-				bufferInfo.offset = ubo->GetOffset();
+				bufferInfo.offset = 0;
 				bufferInfo.range = ubo->GetSize();
 
-				VkWriteDescriptorSet & write = writes[ writeIndex++ ];
-				memset( &write, 0, sizeof( VkWriteDescriptorSet ) );
-				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				write.dstSet = descSet;
-				write.dstBinding = bindingIndex++;
-				write.descriptorCount = 1;
-				write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-				write.pBufferInfo = &bufferInfo;
-				
+				draw.dynamicOffsets[ draw.numDynamicOffsets++ ] = ubo->GetOffset();
+
+				keys[ numKeys++ ] = (uint64)bufferInfo.buffer;
+				keys[ numKeys++ ] = bufferInfo.range;
 				break;
 			}
 			case BINDING_TYPE_SAMPLER: {
@@ -886,24 +1049,81 @@ void idRenderProgManager::CommitCurrent( uint64 stateBits, VkCommandBuffer comma
 				
 				assert( image->GetView() != VK_NULL_HANDLE );
 
-				VkWriteDescriptorSet & write = writes[ writeIndex++ ];
-				memset( &write, 0, sizeof( VkWriteDescriptorSet ) );
-				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				write.dstSet = descSet;
-				write.dstBinding = bindingIndex++;
-				write.descriptorCount = 1;
-				write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-				write.pImageInfo = &imageInfo;
-				
+				keys[ numKeys++ ] = (uint64)imageInfo.imageView;
+				keys[ numKeys++ ] = (uint64)imageInfo.sampler;
+				keys[ numKeys++ ] = imageInfo.imageLayout;
 				break;
 			}
 		}
 	}
 
+	const bool useCache = r_vkDescriptorSetCache.GetBool();
+	const int hashKey = DescriptorSetCacheKey( keys, numKeys );
+
+	if ( useCache ) {
+		for ( int i = m_descriptorSetCacheHash.First( hashKey ); i != -1; i = m_descriptorSetCacheHash.Next( i ) ) {
+			const descriptorSetCacheEntry_t & entry = m_descriptorSetCache[ i ];
+			if ( entry.numKeys == numKeys && memcmp( &m_descriptorSetCacheKeys[ entry.firstKey ], keys, numKeys * sizeof( keys[ 0 ] ) ) == 0 ) {
+				m_descriptorSetHits++;
+				draw.descriptorSet = entry.descriptorSet;
+				return;
+			}
+		}
+	}
+
+	m_descriptorSetMisses++;
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.pNext = NULL;
+	setAllocInfo.descriptorPool = m_descriptorPools[ m_currentData ];
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &prog.descriptorSetLayout;
+
+	ID_VK_CHECK( vkAllocateDescriptorSets( vkcontext.device, &setAllocInfo, &m_descriptorSets[ m_currentData ][ m_currentDescSet ] ) );
+
+	VkDescriptorSet descSet = m_descriptorSets[ m_currentData ][ m_currentDescSet ];
+	m_currentDescSet++;
+
+	int writeIndex = 0;
+	int bindingIndex = 0;
+	bufferIndex = 0;
+	imageIndex = 0;
+
+	VkWriteDescriptorSet writes[ MAX_DESC_SET_WRITES ];
+
+	for ( int i = 0; i < prog.bindings.Num(); ++i ) {
+		VkWriteDescriptorSet & write = writes[ writeIndex++ ];
+		memset( &write, 0, sizeof( VkWriteDescriptorSet ) );
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descSet;
+		write.dstBinding = bindingIndex++;
+		write.descriptorCount = 1;
+
+		if ( prog.bindings[ i ] == BINDING_TYPE_UNIFORM_BUFFER ) {
+			write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+			write.pBufferInfo = &bufferInfos[ bufferIndex++ ];
+		} else {
+			write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write.pImageInfo = &imageInfos[ imageIndex++ ];
+		}
+	}
+
 	vkUpdateDescriptorSets( vkcontext.device, writeIndex, writes, 0, NULL );
 
-	vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, prog.pipelineLayout, 0, 1, &descSet, 0, NULL );
-	vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	draw.descriptorSet = descSet;
+
+	if ( useCache ) {
+		descriptorSetCacheEntry_t entry;
+		entry.firstKey = m_descriptorSetCacheKeys.Num();
+		entry.numKeys = numKeys;
+		entry.descriptorSet = descSet;
+		m_descriptorSetCacheHash.Add( hashKey, m_descriptorSetCache.Append( entry ) );
+
+		for ( int i = 0; i < numKeys; ++i ) {
+			m_descriptorSetCacheKeys.Append( keys[ i ] );
+		}
+	}
 }
 
 /*
@@ -1050,14 +1270,196 @@ void idRenderProgManager::LoadShader( shader_t & shader ) {
 	Mem_Free( spirvBuffer );
 }
 
+/*
+========================
+idRenderProgManager::RecordPipeline
+========================
+*/
+void idRenderProgManager::RecordPipeline( const renderProg_t & prog, uint64 stateBits ) {
+	const char * vertexShader = m_shaders[ prog.vertexShaderIndex ].name.c_str();
+	const char * fragmentShader = ( prog.fragmentShaderIndex != -1 ) ? m_shaders[ prog.fragmentShaderIndex ].name.c_str() : "";
+
+	for ( int i = 0; i < m_pipelineRecords.Num(); ++i ) {
+		const pipelineRecord_t & record = m_pipelineRecords[ i ];
+		if ( record.stateBits == stateBits &&
+			 record.vertexLayoutType == prog.vertexLayoutType &&
+			 record.vertexShader.Icmp( vertexShader ) == 0 &&
+			 record.fragmentShader.Icmp( fragmentShader ) == 0 ) {
+			return;
+		}
+	}
+
+	pipelineRecord_t & record = m_pipelineRecords.Alloc();
+	record.vertexShader = vertexShader;
+	record.fragmentShader = fragmentShader;
+	record.vertexLayoutType = prog.vertexLayoutType;
+	record.stateBits = stateBits;
+
+	m_pipelineRecordsModified = true;
+}
+
+/*
+========================
+idRenderProgManager::LoadPipelineRecords
+========================
+*/
+void idRenderProgManager::LoadPipelineRecords() {
+	m_pipelineRecords.Clear();
+	m_pipelineRecordsModified = false;
+
+	void * buffer = NULL;
+	int length = fileSystem->ReadFile( PIPELINE_RECORDS_FILE, &buffer );
+	if ( length <= 0 ) {
+		return;
+	}
+
+	idLexer src( ( const char * )buffer, length, PIPELINE_RECORDS_FILE, LEXFL_NOERRORS | LEXFL_NOSTRINGCONCAT );
+	idToken vertexShader;
+	idToken fragmentShader;
+	idToken token;
+
+	while ( src.ReadToken( &vertexShader ) ) {
+		if ( !src.ReadToken( &fragmentShader ) ) {
+			break;
+		}
+		
+		const int vertexLayoutType = src.ParseInt();
+		
+		unsigned long long stateBits = 0;
+		if ( !src.ReadToken( &token ) || sscanf( token.c_str(), "%llu", &stateBits ) != 1 ) {
+			break;
+		}
+
+		if ( vertexLayoutType < 0 || vertexLayoutType >= NUM_VERTEX_LAYOUTS ) {
+			continue;
+		}
+
+		pipelineRecord_t & record = m_pipelineRecords.Alloc();
+		record.vertexShader = vertexShader;
+		record.fragmentShader = fragmentShader;
+		record.vertexLayoutType = static_cast< vertexLayoutType_t >( vertexLayoutType );
+		record.stateBits = stateBits;
+	}
+
+	fileSystem->FreeFile( buffer );
+
+	idLib::Printf( "Loaded %d pipeline records from %s\n", m_pipelineRecords.Num(), PIPELINE_RECORDS_FILE );
+}
+
+/*
+========================
+idRenderProgManager::SavePipelineRecords
+========================
+*/
+void idRenderProgManager::SavePipelineRecords() {
+	if ( !m_pipelineRecordsModified ) {
+		return;
+	}
+
+	idFile * file = fileSystem->OpenFileWrite( PIPELINE_RECORDS_FILE );
+	if ( file == NULL ) {
+		idLib::Warning( "idRenderProgManager::SavePipelineRecords: couldn't write %s", PIPELINE_RECORDS_FILE );
+		return;
+	}
+
+	file->Printf( "// vertexShader fragmentShader vertexLayout stateBits\n" );
+	for ( int i = 0; i < m_pipelineRecords.Num(); ++i ) {
+		const pipelineRecord_t & record = m_pipelineRecords[ i ];
+		file->Printf( "\"%s\" \"%s\" %d %llu\n",
+			record.vertexShader.c_str(),
+			record.fragmentShader.c_str(),
+			record.vertexLayoutType,
+			record.stateBits );
+	}
+
+	fileSystem->CloseFile( file );
+
+	m_pipelineRecordsModified = false;
+}
+
+/*
+========================
+idRenderProgManager::PrewarmPipelines
+========================
+*/
+void idRenderProgManager::PrewarmPipelines() {
+	if ( !r_vkPrewarmPipelines.GetBool() || m_pipelineRecords.Num() == 0 ) {
+		return;
+	}
+
+	const int startTime = Sys_Milliseconds();
+
+	idList< pipelinePrewarm_t, TAG_RENDER > prewarms;
+
+	for ( int i = 0; i < m_pipelineRecords.Num(); ++i ) {
+		const pipelineRecord_t & record = m_pipelineRecords[ i ];
+
+		// only programs that have already been referenced are created, shaders
+		// that are no longer used by any material should not be loaded again.
+		// Several programs can share the same shaders and vertex layout, so
+		// the pipeline is created for every one of them.
+		for ( int j = 0; j < m_renderProgs.Num(); ++j ) {
+			const renderProg_t & prog = m_renderProgs[ j ];
+			if ( prog.vertexShaderIndex == -1 ) {
+				continue;
+			}
+			if ( prog.vertexLayoutType != record.vertexLayoutType ) {
+				continue;
+			}
+			if ( record.vertexShader.Icmp( m_shaders[ prog.vertexShaderIndex ].name ) != 0 ) {
+				continue;
+			}
+			const char * fragmentShader = ( prog.fragmentShaderIndex != -1 ) ? m_shaders[ prog.fragmentShaderIndex ].name.c_str() : "";
+			if ( record.fragmentShader.Icmp( fragmentShader ) != 0 ) {
+				continue;
+			}
+
+			if ( prog.FindPipeline( record.stateBits ) == VK_NULL_HANDLE ) {
+				pipelinePrewarm_t & prewarm = prewarms.Alloc();
+				prewarm.progIndex = j;
+				prewarm.vertexLayoutType = prog.vertexLayoutType;
+				prewarm.vertexShader = m_shaders[ prog.vertexShaderIndex ].module;
+				prewarm.fragmentShader = ( prog.fragmentShaderIndex != -1 ) ? m_shaders[ prog.fragmentShaderIndex ].module : VK_NULL_HANDLE;
+				prewarm.pipelineLayout = prog.pipelineLayout;
+				prewarm.stateBits = record.stateBits;
+				prewarm.pipeline = VK_NULL_HANDLE;
+			}
+		}
+	}
+
+	if ( prewarms.Num() == 0 ) {
+		return;
+	}
+
+	idParallelJobList * jobList = parallelJobManager->AllocJobList( JOBLIST_UTILITY, JOBLIST_PRIORITY_MEDIUM, prewarms.Num(), 0, NULL );
+	for ( int i = 0; i < prewarms.Num(); ++i ) {
+		jobList->AddJob( (jobRun_t)PrewarmPipelineJob, &prewarms[ i ] );
+	}
+	jobList->Submit( NULL, JOBLIST_PARALLELISM_MAX_CORES );
+	jobList->Wait();
+	parallelJobManager->FreeJobList( jobList );
+
+	for ( int i = 0; i < prewarms.Num(); ++i ) {
+		const pipelinePrewarm_t & prewarm = prewarms[ i ];
+		m_renderProgs[ prewarm.progIndex ].AddPipeline( prewarm.stateBits, prewarm.pipeline );
+	}
+
+	idLib::Printf( "Prewarmed %d pipelines in %d msec\n", prewarms.Num(), Sys_Milliseconds() - startTime );
+}
+
 CONSOLE_COMMAND( Vulkan_ClearPipelines, "Clear all existing pipelines, forcing them to be recreated.", 0 ) {
 	for ( int i = 0; i < renderProgManager.m_renderProgs.Num(); ++i ) {
 		renderProg_t & prog = renderProgManager.m_renderProgs[ i ];
-		for ( int j = 0; j < prog.pipelines.Num(); ++j ) {
-			vkDestroyPipeline( vkcontext.device, prog.pipelines[ j ].pipeline, NULL );
-		}
-		prog.pipelines.Clear();
+		prog.ClearPipelines();
 	}
+	renderProgManager.ClearPipelineCounters();
+}
+
+CONSOLE_COMMAND( Vulkan_PrintDescriptorSetCache, "Print how often descriptor sets were shared between draws.", 0 ) {
+	const int hits = renderProgManager.GetDescriptorSetHits();
+	const int misses = renderProgManager.GetDescriptorSetMisses();
+	const int total = Max( hits + misses, 1 );
+	idLib::Printf( "descriptor sets: %d hits, %d misses ( %.1f%% shared )\n", hits, misses, 100.0f * hits / total );
 }
 
 CONSOLE_COMMAND( Vulkan_PrintNumPipelines, "Print the number of pipelines available.", 0 ) {
@@ -1069,6 +1471,7 @@ CONSOLE_COMMAND( Vulkan_PrintNumPipelines, "Print the number of pipelines availa
 		idLib::Printf( "%s: %d\n", prog.name.c_str(), progPipelines );
 	}
 	idLib::Printf( "TOTAL: %d\n", totalPipelines );
+	idLib::Printf( "lookups: %d hits, %d misses\n", renderProgManager.GetPipelineHits(), renderProgManager.GetPipelineMisses() );
 }
 
 CONSOLE_COMMAND( Vulkan_PrintPipelineStates, "Print the GLState bits associated with each pipeline.", 0 ) {
@@ -32,7 +32,9 @@ If you have questions concerning this license or the applicable additional terms
 #include "../RenderBackend.h"
 #include "Staging_VK.h"
 
-idCVar r_vkUploadBufferSizeMB( "r_vkUploadBufferSizeMB", "64", CVAR_INTEGER | CVAR_INIT, "Size of gpu upload buffer." );
+idCVar r_vkUploadBufferSizeMB( "r_vkUploadBufferSizeMB", "128", CVAR_INTEGER | CVAR_INIT, "Size of gpu upload ring buffer." );
+idCVar r_vkUploadBatchSizeMB( "r_vkUploadBatchSizeMB", "8", CVAR_INTEGER, "Uploads are submitted once this many MB have been staged, so the copies start while more data is loaded.", 1, 1024 );
+idCVar r_vkTransferQueue( "r_vkTransferQueue", "1", CVAR_BOOL | CVAR_INIT, "Submit uploads on a dedicated transfer queue when the device has one." );
 
 /*
 ===========================================================================
@@ -50,11 +52,17 @@ idVulkanStagingManager::idVulkanStagingManager
 =============
 */
 idVulkanStagingManager::idVulkanStagingManager() :
-	m_maxBufferSize( 0 ),
-	m_currentBuffer( 0 ),
+	m_ringSize( 0 ),
+	m_batchSize( 0 ),
+	m_head( 0 ),
+	m_usedBytes( 0 ),
 	m_mappedData( NULL ),
+	m_buffer( VK_NULL_HANDLE ),
 	m_memory( VK_NULL_HANDLE ),
-	m_commandPool( VK_NULL_HANDLE ) {
+	m_commandPool( VK_NULL_HANDLE ),
+	m_queue( VK_NULL_HANDLE ),
+	m_useTransferQueue( false ),
+	m_currentBatch( 0 ) {
 	
 }
 
@@ -73,42 +81,38 @@ idVulkanStagingManager::Init
 =============
 */
 void idVulkanStagingManager::Init() {
-	m_maxBufferSize = (size_t)( r_vkUploadBufferSizeMB.GetInteger() * 1024 * 1024 );
+	m_ringSize = (VkDeviceSize)r_vkUploadBufferSizeMB.GetInteger() * 1024 * 1024;
+	m_head = 0;
+	m_usedBytes = 0;
+
+	m_useTransferQueue = vkcontext.transferQueue != VK_NULL_HANDLE;
+	m_queue = m_useTransferQueue ? vkcontext.transferQueue : vkcontext.graphicsQueue;
+	m_queueFamilyIndices[ 0 ] = vkcontext.graphicsFamilyIdx;
+	m_queueFamilyIndices[ 1 ] = m_useTransferQueue ? vkcontext.transferFamilyIdx : vkcontext.graphicsFamilyIdx;
 
 	VkBufferCreateInfo bufferCreateInfo = {};
 	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferCreateInfo.size = m_maxBufferSize;
+	bufferCreateInfo.size = m_ringSize;
 	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
-	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
-		m_buffers[ i ].offset = 0;
-
-		ID_VK_CHECK( vkCreateBuffer( vkcontext.device, &bufferCreateInfo, NULL, &m_buffers[ i ].buffer ) );
-	}
+	ID_VK_CHECK( vkCreateBuffer( vkcontext.device, &bufferCreateInfo, NULL, &m_buffer ) );
 
 	VkMemoryRequirements memoryRequirements;
-	vkGetBufferMemoryRequirements( vkcontext.device, m_buffers[ 0 ].buffer, &memoryRequirements );
-
-	const VkDeviceSize alignMod = memoryRequirements.size % memoryRequirements.alignment;
-	const VkDeviceSize alignedSize = ( alignMod == 0 ) ? memoryRequirements.size : ( memoryRequirements.size + memoryRequirements.alignment - alignMod );
+	vkGetBufferMemoryRequirements( vkcontext.device, m_buffer, &memoryRequirements );
 
 	VkMemoryAllocateInfo memoryAllocateInfo = {};
 	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memoryAllocateInfo.allocationSize = alignedSize * NUM_FRAME_DATA;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
 	memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex( memoryRequirements.memoryTypeBits, VULKAN_MEMORY_USAGE_CPU_TO_GPU );
 
 	ID_VK_CHECK( vkAllocateMemory( vkcontext.device, &memoryAllocateInfo, NULL, &m_memory ) );
-
-	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
-		ID_VK_CHECK( vkBindBufferMemory( vkcontext.device, m_buffers[ i ].buffer, m_memory, i * alignedSize ) );
-	}
-
-	ID_VK_CHECK( vkMapMemory( vkcontext.device, m_memory, 0, alignedSize * NUM_FRAME_DATA, 0, reinterpret_cast< void ** >( &m_mappedData ) ) );
+	ID_VK_CHECK( vkBindBufferMemory( vkcontext.device, m_buffer, m_memory, 0 ) );
+	ID_VK_CHECK( vkMapMemory( vkcontext.device, m_memory, 0, m_ringSize, 0, reinterpret_cast< void ** >( &m_mappedData ) ) );
 
 	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
 	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	commandPoolCreateInfo.queueFamilyIndex = vkcontext.graphicsFamilyIdx;
+	commandPoolCreateInfo.queueFamilyIndex = m_queueFamilyIndices[ 1 ];
 	ID_VK_CHECK( vkCreateCommandPool( vkcontext.device, &commandPoolCreateInfo, NULL, &m_commandPool ) );
 
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
@@ -121,13 +125,21 @@ void idVulkanStagingManager::Init() {
 
 	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
 	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
-		ID_VK_CHECK( vkAllocateCommandBuffers( vkcontext.device, &commandBufferAllocateInfo, &m_buffers[ i ].commandBuffer ) );
-		ID_VK_CHECK( vkCreateFence( vkcontext.device, &fenceCreateInfo, NULL, &m_buffers[ i ].fence ) );
-		ID_VK_CHECK( vkBeginCommandBuffer( m_buffers[ i ].commandBuffer, &commandBufferBeginInfo ) );
+	for ( int i = 0; i < MAX_STAGING_BATCHES; ++i ) {
+		ID_VK_CHECK( vkAllocateCommandBuffers( vkcontext.device, &commandBufferAllocateInfo, &m_batches[ i ].commandBuffer ) );
+		ID_VK_CHECK( vkCreateFence( vkcontext.device, &fenceCreateInfo, NULL, &m_batches[ i ].fence ) );
+		ID_VK_CHECK( vkBeginCommandBuffer( m_batches[ i ].commandBuffer, &commandBufferBeginInfo ) );
+
+		m_batches[ i ].submitted = false;
+		m_batches[ i ].size = 0;
+	}
+
+	m_currentBatch = 0;
 
-		m_buffers[ i ].data = (byte *)m_mappedData + (i * alignedSize);
+	if ( m_useTransferQueue ) {
+		idLib::Printf( "Staging uploads on transfer queue family %d\n", vkcontext.transferFamilyIdx );
 	}
 }
 
@@ -137,19 +149,65 @@ idVulkanStagingManager::Shutdown
 =============
 */
 void idVulkanStagingManager::Shutdown() {
+	for ( int i = 0; i < MAX_STAGING_BATCHES; ++i ) {
+		if ( m_batches[ i ].submitted ) {
+			ID_VK_CHECK( vkWaitForFences( vkcontext.device, 1, &m_batches[ i ].fence, VK_TRUE, UINT64_MAX ) );
+		}
+	}
+
 	vkUnmapMemory( vkcontext.device, m_memory );
-	m_memory = VK_NULL_HANDLE;
 	m_mappedData = NULL;
 
+	for ( int i = 0; i < MAX_STAGING_BATCHES; ++i ) {
+		vkDestroyFence( vkcontext.device, m_batches[ i ].fence, NULL );
+		vkFreeCommandBuffers( vkcontext.device, m_commandPool, 1, &m_batches[ i ].commandBuffer );
+		m_batches[ i ] = stagingBatch_t();
+	}
+
+	vkDestroyCommandPool( vkcontext.device, m_commandPool, NULL );
+	m_commandPool = VK_NULL_HANDLE;
+
+	vkDestroyBuffer( vkcontext.device, m_buffer, NULL );
+	m_buffer = VK_NULL_HANDLE;
+
+	vkFreeMemory( vkcontext.device, m_memory, NULL );
+	m_memory = VK_NULL_HANDLE;
+
+	// the device is idle by now, so every semaphore can go
 	for ( int i = 0; i < NUM_FRAME_DATA; ++i ) {
-		vkDestroyFence( vkcontext.device, m_buffers[ i ].fence, NULL );
-		vkDestroyBuffer( vkcontext.device, m_buffers[ i ].buffer, NULL );
-		vkFreeCommandBuffers( vkcontext.device, m_commandPool, 1, &m_buffers[ i ].commandBuffer );
+		RecycleSemaphores( i );
 	}
-	memset( m_buffers, 0, sizeof( m_buffers ) );
+	m_freeSemaphores.Append( m_pendingSemaphores );
+	for ( int i = 0; i < m_freeSemaphores.Num(); ++i ) {
+		vkDestroySemaphore( vkcontext.device, m_freeSemaphores[ i ], NULL );
+	}
+	m_freeSemaphores.Clear();
+	m_pendingSemaphores.Clear();
+
+	m_ringSize = 0;
+	m_head = 0;
+	m_usedBytes = 0;
+	m_currentBatch = 0;
+	m_queue = VK_NULL_HANDLE;
+	m_useTransferQueue = false;
+}
 
-	m_maxBufferSize = 0;
-	m_currentBuffer = 0;
+/*
+=============
+idVulkanStagingManager::GetSharingMode
+=============
+*/
+void idVulkanStagingManager::GetSharingMode( VkSharingMode & sharingMode, uint32 & queueFamilyIndexCount, const uint32 * & queueFamilyIndices ) const {
+	if ( m_useTransferQueue ) {
+		// concurrent sharing saves us the queue family ownership transfers
+		sharingMode = VK_SHARING_MODE_CONCURRENT;
+		queueFamilyIndexCount = 2;
+		queueFamilyIndices = m_queueFamilyIndices;
+	} else {
+		sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		queueFamilyIndexCount = 0;
+		queueFamilyIndices = NULL;
+	}
 }
 
 /*
@@ -158,31 +216,55 @@ idVulkanStagingManager::Stage
 =============
 */
 byte * idVulkanStagingManager::Stage( const int size, const int alignment, VkCommandBuffer & commandBuffer, VkBuffer & buffer, int & bufferOffset ) {
-	if ( size > m_maxBufferSize ) {
+	if ( (VkDeviceSize)size > m_ringSize ) {
 		idLib::FatalError( "Can't allocate %d MB in gpu transfer buffer", (int)( size / 1024 / 1024 ) );
 	}
 
-	stagingBuffer_t * stage = &m_buffers[ m_currentBuffer ];
-	const int alignMod = stage->offset % alignment;
-	stage->offset = ( ( stage->offset % alignment ) == 0 ) ? stage->offset : ( stage->offset + alignment - alignMod );
-
-	if ( ( stage->offset + size ) >= ( m_maxBufferSize ) && !stage->submitted ) {
+	// hand a full batch to the gpu before we start on the next upload
+	m_batchSize = (VkDeviceSize)r_vkUploadBatchSizeMB.GetInteger() * 1024 * 1024;
+	if ( m_batches[ m_currentBatch ].size >= m_batchSize ) {
 		Flush();
 	}
 
-	stage = &m_buffers[ m_currentBuffer ];
-	if ( stage->submitted ) {
-		Wait( *stage );
+	VkDeviceSize offset;
+	VkDeviceSize padding;
+	for ( ;; ) {
+		if ( m_usedBytes == 0 ) {
+			m_head = 0;
+		}
+
+		const VkDeviceSize alignMod = m_head % alignment;
+		offset = ( alignMod == 0 ) ? m_head : ( m_head + alignment - alignMod );
+		padding = offset - m_head;
+
+		if ( offset + size > m_ringSize ) {
+			// skip the tail of the ring and start over at the beginning
+			padding = m_ringSize - m_head;
+			offset = 0;
+		}
+
+		if ( m_usedBytes + padding + size <= m_ringSize ) {
+			break;
+		}
+
+		// out of room, retire the oldest batch or submit the current one so it can be retired
+		if ( !WaitOldest() ) {
+			Flush();
+		}
 	}
 
-	commandBuffer = stage->commandBuffer;
-	buffer = stage->buffer;
-	bufferOffset = stage->offset;
+	stagingBatch_t & batch = m_batches[ m_currentBatch ];
+	assert( !batch.submitted );
 
-	byte * data = stage->data + stage->offset;
-	stage->offset += size;
+	batch.size += padding + size;
+	m_usedBytes += padding + size;
+	m_head = offset + size;
 
-	return data;
+	commandBuffer = batch.commandBuffer;
+	buffer = m_buffer;
+	bufferOffset = (int)offset;
+
+	return m_mappedData + offset;
 }
 
 /*
@@ -191,22 +273,26 @@ idVulkanStagingManager::Flush
 =============
 */
 void idVulkanStagingManager::Flush() {
-	stagingBuffer_t & stage = m_buffers[ m_currentBuffer ];
-	if ( stage.submitted || stage.offset == 0 ) {
+	RetireCompleted();
+
+	stagingBatch_t & batch = m_batches[ m_currentBatch ];
+	if ( batch.submitted || batch.size == 0 ) {
 		return;
 	}
 
-	VkMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
-	vkCmdPipelineBarrier( 
-		stage.commandBuffer, 
-		VK_PIPELINE_STAGE_TRANSFER_BIT, 
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
-		0, 1, &barrier, 0, NULL, 0, NULL );
+	if ( !m_useTransferQueue ) {
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;	// compute skinning reads static vertexes
+		vkCmdPipelineBarrier( 
+			batch.commandBuffer, 
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+			0, 1, &barrier, 0, NULL, 0, NULL );
+	}
 
-	vkEndCommandBuffer( stage.commandBuffer );
+	vkEndCommandBuffer( batch.commandBuffer );
 
 	VkMappedMemoryRange memoryRange = {};
 	memoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
@@ -217,13 +303,58 @@ void idVulkanStagingManager::Flush() {
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &stage.commandBuffer;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	// the transfer queue is not ordered with the graphics queue, the next frame waits on this
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	if ( m_useTransferQueue ) {
+		if ( m_freeSemaphores.Num() > 0 ) {
+			semaphore = m_freeSemaphores[ m_freeSemaphores.Num() - 1 ];
+			m_freeSemaphores.RemoveIndex( m_freeSemaphores.Num() - 1 );
+		} else {
+			VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+			semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			ID_VK_CHECK( vkCreateSemaphore( vkcontext.device, &semaphoreCreateInfo, NULL, &semaphore ) );
+		}
+		m_pendingSemaphores.Append( semaphore );
+
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &semaphore;
+	}
 
-	vkQueueSubmit( vkcontext.graphicsQueue, 1, &submitInfo, stage.fence );
+	ID_VK_CHECK( vkQueueSubmit( m_queue, 1, &submitInfo, batch.fence ) );
 
-	stage.submitted = true;
+	batch.submitted = true;
 
-	m_currentBuffer = ( m_currentBuffer + 1 ) % NUM_FRAME_DATA;
+	m_currentBatch = ( m_currentBatch + 1 ) % MAX_STAGING_BATCHES;
+
+	// only block when every batch is in flight
+	Wait( m_batches[ m_currentBatch ] );
+}
+
+/*
+=============
+idVulkanStagingManager::GetWaitSemaphores
+=============
+*/
+void idVulkanStagingManager::GetWaitSemaphores( const int frame, idList< VkSemaphore > & semaphores, idList< VkPipelineStageFlags > & stageMasks ) {
+	for ( int i = 0; i < m_pendingSemaphores.Num(); ++i ) {
+		semaphores.Append( m_pendingSemaphores[ i ] );
+		stageMasks.Append( VK_PIPELINE_STAGE_ALL_COMMANDS_BIT );
+	}
+
+	m_waitingSemaphores[ frame ].Append( m_pendingSemaphores );
+	m_pendingSemaphores.SetNum( 0 );
+}
+
+/*
+=============
+idVulkanStagingManager::RecycleSemaphores
+=============
+*/
+void idVulkanStagingManager::RecycleSemaphores( const int frame ) {
+	m_freeSemaphores.Append( m_waitingSemaphores[ frame ] );
+	m_waitingSemaphores[ frame ].SetNum( 0 );
 }
 
 /*
@@ -231,19 +362,62 @@ void idVulkanStagingManager::Flush() {
 idVulkanStagingManager::Wait
 =============
 */
-void idVulkanStagingManager::Wait( stagingBuffer_t & stage ) {
-	if ( stage.submitted == false ) {
+void idVulkanStagingManager::Wait( stagingBatch_t & batch ) {
+	if ( batch.submitted == false ) {
 		return;
 	}
 
-	ID_VK_CHECK( vkWaitForFences( vkcontext.device, 1, &stage.fence, VK_TRUE, UINT64_MAX ) );
-	ID_VK_CHECK( vkResetFences( vkcontext.device, 1, &stage.fence ) );
+	ID_VK_CHECK( vkWaitForFences( vkcontext.device, 1, &batch.fence, VK_TRUE, UINT64_MAX ) );
+	ID_VK_CHECK( vkResetFences( vkcontext.device, 1, &batch.fence ) );
 
-	stage.offset = 0;
-	stage.submitted = false;
+	assert( m_usedBytes >= batch.size );
+	m_usedBytes -= batch.size;
+
+	batch.size = 0;
+	batch.submitted = false;
 
 	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
 	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	ID_VK_CHECK( vkBeginCommandBuffer( stage.commandBuffer, &commandBufferBeginInfo ) );
-}
\ No newline at end of file
+	ID_VK_CHECK( vkBeginCommandBuffer( batch.commandBuffer, &commandBufferBeginInfo ) );
+}
+
+/*
+=============
+idVulkanStagingManager::WaitOldest
+
+Batches are submitted in ring order, so the oldest one in flight is the first
+submitted batch after the current one. Returns false if nothing is in flight.
+=============
+*/
+bool idVulkanStagingManager::WaitOldest() {
+	for ( int i = 1; i < MAX_STAGING_BATCHES; ++i ) {
+		stagingBatch_t & batch = m_batches[ ( m_currentBatch + i ) % MAX_STAGING_BATCHES ];
+		if ( batch.submitted ) {
+			Wait( batch );
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+=============
+idVulkanStagingManager::RetireCompleted
+
+Releases the ring space of every batch the gpu has finished with, without blocking.
+=============
+*/
+void idVulkanStagingManager::RetireCompleted() {
+	for ( int i = 1; i < MAX_STAGING_BATCHES; ++i ) {
+		stagingBatch_t & batch = m_batches[ ( m_currentBatch + i ) % MAX_STAGING_BATCHES ];
+		if ( !batch.submitted ) {
+			continue;
+		}
+		if ( vkGetFenceStatus( vkcontext.device, batch.fence ) != VK_SUCCESS ) {
+			break;
+		}
+		Wait( batch );
+	}
+}
@@ -37,23 +37,31 @@ idVulkanStagingManager
 ===========================================================================
 */
 
-struct stagingBuffer_t {
-	stagingBuffer_t() :
+static const int MAX_STAGING_BATCHES = 8;
+
+/*
+A batch is the run of uploads recorded into one command buffer between two flushes.
+Its bytes stay reserved in the ring until the fence says the copies have completed.
+*/
+struct stagingBatch_t {
+	stagingBatch_t() :
 		submitted( false ),
 		commandBuffer( VK_NULL_HANDLE ),
-		buffer( VK_NULL_HANDLE ),
 		fence( VK_NULL_HANDLE ),
-		offset( 0 ),
-		data( NULL ) {}
+		size( 0 ) {}
 
 	bool				submitted;
 	VkCommandBuffer		commandBuffer;
-	VkBuffer			buffer;
 	VkFence				fence;
-	VkDeviceSize		offset;
-	byte *				data;
+	VkDeviceSize		size;			// ring bytes consumed by this batch, including alignment and wrap padding
 };
 
+/*
+Uploads are carved out of a single persistently mapped ring buffer. Stage() only blocks
+when the ring or every batch is still in flight. When the device exposes a dedicated
+transfer queue the batches are submitted there and the next frame waits on a semaphore,
+so image and static geometry uploads overlap rendering instead of queueing behind it.
+*/
 class idVulkanStagingManager {
 public:
 	idVulkanStagingManager();
@@ -65,17 +73,41 @@ public:
 	byte *			Stage( const int size, const int alignment, VkCommandBuffer & commandBuffer, VkBuffer & buffer, int & bufferOffset );
 	void			Flush();
 
+	// true when uploads are executed on a dedicated transfer queue
+	bool			UsesTransferQueue() const { return m_useTransferQueue; }
+
+	// Resources written through Stage() have to be shared with the transfer queue.
+	void			GetSharingMode( VkSharingMode & sharingMode, uint32 & queueFamilyIndexCount, const uint32 * & queueFamilyIndices ) const;
+
+	// Moves the semaphores of the flushed batches to the frame that is about to be submitted.
+	// They are reused once that frame's fence has been waited on.
+	void			GetWaitSemaphores( const int frame, idList< VkSemaphore > & semaphores, idList< VkPipelineStageFlags > & stageMasks );
+	void			RecycleSemaphores( const int frame );
+
 private:
-	void			Wait( stagingBuffer_t & stage );
+	void			Wait( stagingBatch_t & batch );
+	bool			WaitOldest();
+	void			RetireCompleted();
 
 private:
-	int				m_maxBufferSize;
-	int				m_currentBuffer;
+	VkDeviceSize	m_ringSize;
+	VkDeviceSize	m_batchSize;
+	VkDeviceSize	m_head;
+	VkDeviceSize	m_usedBytes;
 	byte *			m_mappedData;
+	VkBuffer		m_buffer;
 	VkDeviceMemory	m_memory;
 	VkCommandPool	m_commandPool;
+	VkQueue			m_queue;
+	bool			m_useTransferQueue;
+	uint32			m_queueFamilyIndices[ 2 ];
+
+	int				m_currentBatch;
+	stagingBatch_t	m_batches[ MAX_STAGING_BATCHES ];
 
-	stagingBuffer_t m_buffers[ NUM_FRAME_DATA ];
+	idList< VkSemaphore >	m_freeSemaphores;
+	idList< VkSemaphore >	m_pendingSemaphores;
+	idList< VkSemaphore >	m_waitingSemaphores[ NUM_FRAME_DATA ];
 };
 
 extern idVulkanStagingManager stagingManager;
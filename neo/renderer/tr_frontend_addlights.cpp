@@ -44,9 +44,11 @@ extern idCVar r_skipPrelightShadows;
 extern idCVar r_znear;
 extern idCVar r_useShadowDepthBounds;
 extern idCVar r_showLightScissors;
+extern idCVar r_lightScale;
 
 idCVar r_useAreasConnectedForShadowCulling( "r_useAreasConnectedForShadowCulling", "2", CVAR_RENDERER | CVAR_INTEGER, "cull entities cut off by doors" );
 idCVar r_useParallelAddLights( "r_useParallelAddLights", "1", CVAR_RENDERER | CVAR_BOOL, "aadd all lights in parallel with jobs" );
+idCVar r_useClusteredLighting( "r_useClusteredLighting", "0", CVAR_RENDERER | CVAR_BOOL, "draw the opaque interactions of lights without shadows with a single clustered pass per surface" );
 
 /*
 ============================
@@ -247,7 +249,7 @@ static void R_AddSingleLight( viewLight_t * vLight ) {
 	vLight->entityInteractionState = (byte *)renderSystem->ClearedFrameAlloc( light->world->m_entityDefs.Num() * sizeof( vLight->entityInteractionState[0] ), FRAME_ALLOC_INTERACTION_STATE );
 
 	const bool lightCastsShadows = light->LightCastsShadows();
-	idInteraction * * const interactionTableRow = light->world->m_interactionTable + light->index * light->world->m_interactionTableWidth;
+	const idInteractionTable & interactionTable = light->world->m_interactionTable;
 
 	for ( areaReference_t * lref = light->references; lref != NULL; lref = lref->ownerNext ) {
 		portalArea_t *area = lref->area;
@@ -272,7 +274,7 @@ static void R_AddSingleLight( viewLight_t * vLight ) {
 			vLight->entityInteractionState[ edef->index ] = viewLight_t::INTERACTION_NO;
 
 			// The table is updated at interaction::AllocAndLink() and interaction::UnlinkAndFree()
-			const idInteraction * inter = interactionTableRow[ edef->index ];
+			const idInteraction * inter = interactionTable.Get( light->index, edef->index );
 
 			const renderEntity_t & eParms = edef->parms;
 			const idRenderModel * eModel = eParms.hModel;
@@ -533,3 +535,216 @@ void idRenderSystemLocal::AddLights() {
 		m_backend.m_pc.shadowMicroSec += end - start;
 	}
 }
+
+/*
+=================
+R_ClusteredLightStage
+
+Returns the stage a light is drawn with by the clustered interaction pass, or
+NULL if the light has to be drawn with its own interaction passes.
+=================
+*/
+static const shaderStage_t * R_ClusteredLightStage( const viewLight_t * vLight ) {
+	const idMaterial * lightShader = vLight->lightShader;
+
+	if ( vLight->scissorRect.IsEmpty() ) {
+		return NULL;
+	}
+
+	// shadows need the stencil test of a pass for the light alone
+	if ( vLight->lightDef->LightCastsShadows() ) {
+		return NULL;
+	}
+
+	if ( lightShader->IsFogLight() || lightShader->IsBlendLight() || lightShader->IsAmbientLight() ) {
+		return NULL;
+	}
+
+	// "invisible ink" lights only light surfaces with the same spectrum
+	if ( lightShader->Spectrum() != 0 ) {
+		return NULL;
+	}
+
+	// the rare lights with multiple stages or a texture matrix keep the general path
+	if ( lightShader->GetNumStages() != 1 ) {
+		return NULL;
+	}
+
+	const shaderStage_t * lightStage = lightShader->GetStage( 0 );
+	if ( !vLight->shaderRegisters[ lightStage->conditionRegister ] || lightStage->texture.hasMatrix ) {
+		return NULL;
+	}
+
+	return lightStage;
+}
+
+/*
+=================
+R_ClusterDepthSlice
+=================
+*/
+static int R_ClusterDepthSlice( const float depth, const float zNear, const float sliceScale ) {
+	if ( depth <= zNear ) {
+		return 0;
+	}
+	return Min( idMath::Ftoi( idMath::Log( depth / zNear ) * sliceScale ), CLUSTER_DEPTH_SLICES - 1 );
+}
+
+/*
+=================
+idRenderSystemLocal::AddClusteredLights
+
+Picks the lights that are drawn by the clustered interaction pass and bins them into
+the view's clusters, using the light scissor rect for the screen tiles and the light
+bounds for the depth slices. AddModels links the opaque surfaces that these lights
+touch to viewDef->clusteredInteractions a single time instead of to every light.
+=================
+*/
+void idRenderSystemLocal::AddClusteredLights() {
+	SCOPED_PROFILE_EVENT( "R_AddClusteredLights" );
+
+	m_viewDef->numClusteredLights = 0;
+	m_viewDef->clusterCache = 0;
+	m_viewDef->clusterZNear = 0.0f;
+	m_viewDef->clusterFalloffImage = NULL;
+	m_viewDef->clusterProjectionImage = NULL;
+	m_viewDef->clusteredInteractions = NULL;
+
+	if ( !r_useClusteredLighting.GetBool() || !renderProgManager.IsProgramAvailable( BUILTIN_INTERACTION_CLUSTERED ) ) {
+		return;
+	}
+
+	//-------------------------------------------------
+	// the clustered program samples a single falloff and projection image,
+	// so only the lights that share the most common pair are clustered
+	//-------------------------------------------------
+
+	struct lightImages_t {
+		idImage *	falloffImage;
+		idImage *	projectionImage;
+		int			numLights;
+	};
+	static const int MAX_LIGHT_IMAGE_PAIRS = 16;
+	lightImages_t imagePairs[MAX_LIGHT_IMAGE_PAIRS];
+	int numImagePairs = 0;
+	int bestImagePair = -1;
+
+	for ( const viewLight_t * vLight = m_viewDef->viewLights; vLight != NULL; vLight = vLight->next ) {
+		const shaderStage_t * lightStage = R_ClusteredLightStage( vLight );
+		if ( lightStage == NULL ) {
+			continue;
+		}
+
+		int pair = 0;
+		for ( ; pair < numImagePairs; pair++ ) {
+			if ( imagePairs[pair].falloffImage == vLight->falloffImage && imagePairs[pair].projectionImage == lightStage->texture.image ) {
+				break;
+			}
+		}
+		if ( pair == numImagePairs ) {
+			if ( numImagePairs == MAX_LIGHT_IMAGE_PAIRS ) {
+				continue;
+			}
+			imagePairs[pair].falloffImage = vLight->falloffImage;
+			imagePairs[pair].projectionImage = lightStage->texture.image;
+			imagePairs[pair].numLights = 0;
+			numImagePairs++;
+		}
+
+		imagePairs[pair].numLights++;
+		if ( bestImagePair == -1 || imagePairs[pair].numLights > imagePairs[bestImagePair].numLights ) {
+			bestImagePair = pair;
+		}
+	}
+
+	if ( bestImagePair == -1 ) {
+		return;
+	}
+
+	//-------------------------------------------------
+	// bin the lights
+	//-------------------------------------------------
+
+	lightClusters_t * clusters = (lightClusters_t *)ClearedFrameAlloc( sizeof( *clusters ) );
+
+	const idVec3 & viewOrigin = m_viewDef->renderView.vieworg;
+	const idVec3 & viewForward = m_viewDef->renderView.viewaxis[0];
+	const float zNear = ( m_viewDef->renderView.cramZNear ) ? ( r_znear.GetFloat() * 0.25f ) : r_znear.GetFloat();
+	const float sliceScale = CLUSTER_DEPTH_SLICES / idMath::Log( CLUSTER_DEPTH_FAR / zNear );
+	const float tilesPerPixelX = CLUSTER_TILES_X / (float)( m_viewDef->viewport.x2 + 1 - m_viewDef->viewport.x1 );
+	const float tilesPerPixelY = CLUSTER_TILES_Y / (float)( m_viewDef->viewport.y2 + 1 - m_viewDef->viewport.y1 );
+	const float lightScale = r_lightScale.GetFloat();
+
+	int numLights = 0;
+	for ( viewLight_t * vLight = m_viewDef->viewLights; vLight != NULL && numLights < MAX_CLUSTERED_LIGHTS; vLight = vLight->next ) {
+		const shaderStage_t * lightStage = R_ClusteredLightStage( vLight );
+		if ( lightStage == NULL ) {
+			continue;
+		}
+		if ( vLight->falloffImage != imagePairs[bestImagePair].falloffImage || lightStage->texture.image != imagePairs[bestImagePair].projectionImage ) {
+			continue;
+		}
+
+		// the depth range of the light volume along the view direction
+		float minDepth;
+		float maxDepth;
+		vLight->lightDef->globalLightBounds.AxisProjection( viewForward, minDepth, maxDepth );
+		minDepth -= viewForward * viewOrigin;
+		maxDepth -= viewForward * viewOrigin;
+		if ( maxDepth < zNear ) {
+			continue;
+		}
+
+		const float * lightRegs = vLight->shaderRegisters;
+
+		clusteredLight_t & light = clusters->lights[numLights];
+		light.origin.Set( vLight->globalLightOrigin.x, vLight->globalLightOrigin.y, vLight->globalLightOrigin.z, 1.0f );
+		for ( int i = 0; i < 4; i++ ) {
+			light.lightProject[i] = vLight->lightProject[i];
+		}
+		light.color.Set(
+			lightScale * lightRegs[ lightStage->color.registers[0] ],
+			lightScale * lightRegs[ lightStage->color.registers[1] ],
+			lightScale * lightRegs[ lightStage->color.registers[2] ],
+			lightRegs[ lightStage->color.registers[3] ] );
+
+		// the scissor rect is local inside the viewport, like the tiles
+		const int x1 = idMath::ClampInt( 0, CLUSTER_TILES_X - 1, idMath::Ftoi( vLight->scissorRect.x1 * tilesPerPixelX ) );
+		const int x2 = idMath::ClampInt( 0, CLUSTER_TILES_X - 1, idMath::Ftoi( vLight->scissorRect.x2 * tilesPerPixelX ) );
+		const int y1 = idMath::ClampInt( 0, CLUSTER_TILES_Y - 1, idMath::Ftoi( vLight->scissorRect.y1 * tilesPerPixelY ) );
+		const int y2 = idMath::ClampInt( 0, CLUSTER_TILES_Y - 1, idMath::Ftoi( vLight->scissorRect.y2 * tilesPerPixelY ) );
+		const int z1 = R_ClusterDepthSlice( minDepth, zNear, sliceScale );
+		const int z2 = R_ClusterDepthSlice( maxDepth, zNear, sliceScale );
+
+		const uint32 lightBit = BIT( numLights );
+		for ( int z = z1; z <= z2; z++ ) {
+			for ( int y = y1; y <= y2; y++ ) {
+				uint32 * masks = &clusters->masks[ ( z * CLUSTER_TILES_Y + y ) * CLUSTER_TILES_X ];
+				for ( int x = x1; x <= x2; x++ ) {
+					masks[x] |= lightBit;
+				}
+			}
+		}
+
+		vLight->clustered = true;
+		numLights++;
+	}
+
+	if ( numLights == 0 ) {
+		return;
+	}
+
+	m_viewDef->clusterCache = vertexCache.AllocJoint( clusters, 1, sizeof( *clusters ) );
+	if ( m_viewDef->clusterCache == 0 ) {
+		// out of joint memory, draw the lights the regular way
+		for ( viewLight_t * vLight = m_viewDef->viewLights; vLight != NULL; vLight = vLight->next ) {
+			vLight->clustered = false;
+		}
+		return;
+	}
+
+	m_viewDef->numClusteredLights = numLights;
+	m_viewDef->clusterZNear = zNear;
+	m_viewDef->clusterFalloffImage = imagePairs[bestImagePair].falloffImage;
+	m_viewDef->clusterProjectionImage = imagePairs[bestImagePair].projectionImage;
+}
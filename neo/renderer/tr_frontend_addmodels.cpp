@@ -47,8 +47,10 @@ idCVar r_useShadowPreciseInsideTest( "r_useShadowPreciseInsideTest", "1", CVAR_R
 idCVar r_cullDynamicShadowTriangles( "r_cullDynamicShadowTriangles", "1", CVAR_RENDERER | CVAR_BOOL, "cull occluder triangles that are outside the light frustum so they do not contribute to the dynamic shadow volume" );
 idCVar r_cullDynamicLightTriangles( "r_cullDynamicLightTriangles", "1", CVAR_RENDERER | CVAR_BOOL, "cull surface triangles that are outside the light frustum so they do not get rendered for interactions" );
 idCVar r_forceShadowCaps( "r_forceShadowCaps", "0", CVAR_RENDERER | CVAR_BOOL, "0 = skip rendering shadow caps if view is outside shadow volume, 1 = always render shadow caps" );
+idCVar r_useComputeSkinning( "r_useComputeSkinning", "1", CVAR_RENDERER | CVAR_BOOL, "skin GPU skinned surfaces once per frame in a compute pre-pass instead of in every vertex program that draws them" );
 
 extern idCVar r_znear;
+extern idCVar r_lightAllBackFaces;
 extern idCVar r_skipOverlays;
 extern idCVar r_skipPrelightShadows;
 extern idCVar r_skipDecals;
@@ -302,9 +304,17 @@ void R_SetupDrawSurfShader( drawSurf_t * drawSurf, const idMaterial * shader, co
 /*
 ===================
 R_SetupDrawSurfJoints
+
+The ambient or shadow cache of the drawSurf must already be set.
+With compute skinning the surface is skinned once for all the
+passes that draw it this frame, and the drawSurf is pointed at
+the skinned copy so the unskinned vertex programs are used.
+Ambient caches are only compute skinned for rigid surfaces,
+because the unskinned programs derive the bitangent from the
+skinned normal and tangent.
 ===================
 */
-void R_SetupDrawSurfJoints( drawSurf_t * drawSurf, const srfTriangles_t * tri, const idMaterial * shader ) {
+void R_SetupDrawSurfJoints( drawSurf_t * drawSurf, srfTriangles_t * tri, const idMaterial * shader ) {
 	if ( tri->staticModelWithJoints == NULL || !r_useGPUSkinning.GetBool() ) {
 		drawSurf->jointCache = 0;
 		return;
@@ -317,6 +327,88 @@ void R_SetupDrawSurfJoints( drawSurf_t * drawSurf, const srfTriangles_t * tri, c
 		model->jointsInvertedBuffer = vertexCache.AllocJoint( model->jointsInverted, model->numInvertedJoints );
 	}
 	drawSurf->jointCache = model->jointsInvertedBuffer;
+
+	if ( !r_useComputeSkinning.GetBool() ) {
+		return;
+	}
+
+	if ( drawSurf->ambientCache != 0 ) {
+		if ( !tri->rigidSkinning ) {
+			return;
+		}
+		if ( !vertexCache.CacheIsCurrent( tri->skinnedAmbientCache ) ) {
+			tri->skinnedAmbientCache = vertexCache.AllocSkinnedVertex( drawSurf->ambientCache, drawSurf->jointCache, tri->numVerts, false );
+		}
+		if ( tri->skinnedAmbientCache != 0 ) {
+			drawSurf->ambientCache = tri->skinnedAmbientCache;
+			drawSurf->jointCache = 0;
+		}
+	} else if ( drawSurf->shadowCache != 0 ) {
+		if ( !vertexCache.CacheIsCurrent( tri->skinnedShadowCache ) ) {
+			tri->skinnedShadowCache = vertexCache.AllocSkinnedVertex( drawSurf->shadowCache, drawSurf->jointCache, tri->numVerts * 2, true );
+		}
+		if ( tri->skinnedShadowCache != 0 ) {
+			drawSurf->shadowCache = tri->skinnedShadowCache;
+			drawSurf->jointCache = 0;
+		}
+	}
+}
+
+/*
+===================
+R_SurfaceCanBeClustered
+
+The clustered interaction pass rejects the lights behind a triangle in the fragment
+program, where R_CreateInteractionLightTris culls those triangles for each light. It
+finds the triangle plane from the view, so only front sided surfaces can be drawn with
+it, and surfaces that light their back faces keep the per-light interaction passes.
+===================
+*/
+static bool R_SurfaceCanBeClustered( const idRenderEntity * entityDef, const idMaterial * shader ) {
+	if ( shader->Coverage() == MC_TRANSLUCENT || shader->GetCullType() != CT_FRONT_SIDED ) {
+		return false;
+	}
+	if ( r_lightAllBackFaces.GetBool() || shader->ReceivesLightingOnBackSides() || entityDef->parms.noSelfShadow || entityDef->parms.noShadow ) {
+		return false;
+	}
+	return true;
+}
+
+/*
+===================
+R_ClusteredInteractionDrawSurf
+
+Creates the interaction surface the clustered interaction pass draws a single time for
+all the clustered lights that touch a surface. The whole surface is drawn, because
+each of the lights may touch different triangles. Surfaces that still need the skinned
+vertex programs are not linked and keep the per-light interaction passes.
+===================
+*/
+static drawSurf_t * R_ClusteredInteractionDrawSurf( viewEntity_t * vEntity, srfTriangles_t * tri, const idMaterial * shader, const float * shaderRegisters ) {
+	drawSurf_t * drawSurf = (drawSurf_t *)renderSystem->FrameAlloc( sizeof( *drawSurf ), FRAME_ALLOC_DRAW_SURFACE );
+	drawSurf->frontEndGeo = tri;
+	drawSurf->numIndexes = tri->numIndexes;
+	drawSurf->indexCache = tri->indexCache;
+	drawSurf->ambientCache = tri->ambientCache;
+	drawSurf->shadowCache = 0;
+	drawSurf->space = vEntity;
+	drawSurf->material = shader;
+	drawSurf->extraGLState = 0;
+	drawSurf->sort = 0.0f;
+	drawSurf->shaderRegisters = shaderRegisters;
+	drawSurf->scissorRect = vEntity->scissorRect;
+	drawSurf->renderZFail = 0;
+	drawSurf->shadowVolumeState = SHADOWVOLUME_DONE;
+
+	R_SetupDrawSurfJoints( drawSurf, tri, shader );
+
+	if ( drawSurf->jointCache == 0 ) {
+		drawSurf->linkChain = &tr.m_viewDef->clusteredInteractions;
+		drawSurf->nextOnLight = vEntity->drawSurfs;
+		vEntity->drawSurfs = drawSurf;
+	}
+
+	return drawSurf;
 }
 
 /*
@@ -390,7 +482,7 @@ void R_AddSingleModel( viewEntity_t * vEntity ) {
 				// new code path, everything was done in AddLight
 				if ( vLight->entityInteractionState[entityIndex] == viewLight_t::INTERACTION_YES ) {
 					contactedLights[numContactedLights] = vLight;
-					staticInteractions[numContactedLights] = world->m_interactionTable[vLight->lightDef->index * world->m_interactionTableWidth + entityIndex];
+					staticInteractions[numContactedLights] = world->m_interactionTable.Get( vLight->lightDef->index, entityIndex );
 					if ( ++numContactedLights == MAX_CONTACTED_LIGHTS ) {
 						break;
 					}
@@ -437,7 +529,7 @@ void R_AddSingleModel( viewEntity_t * vEntity ) {
 				}
 			}
 			contactedLights[numContactedLights] = vLight;
-			staticInteractions[numContactedLights] = world->m_interactionTable[vLight->lightDef->index * world->m_interactionTableWidth + entityIndex];
+			staticInteractions[numContactedLights] = world->m_interactionTable.Get( vLight->lightDef->index, entityIndex );
 			if ( ++numContactedLights == MAX_CONTACTED_LIGHTS ) {
 				break;
 			}
@@ -653,13 +745,13 @@ void R_AddSingleModel( viewEntity_t * vEntity ) {
 					tri->indexCache = vertexCache.AllocIndex( tri->indexes, tri->numIndexes );
 				}
 
-				R_SetupDrawSurfJoints( baseDrawSurf, tri, shader );
-
 				baseDrawSurf->numIndexes = tri->numIndexes;
 				baseDrawSurf->ambientCache = tri->ambientCache;
 				baseDrawSurf->indexCache = tri->indexCache;
 				baseDrawSurf->shadowCache = 0;
 
+				R_SetupDrawSurfJoints( baseDrawSurf, tri, shader );
+
 				baseDrawSurf->linkChain = NULL;		// link to the view
 				baseDrawSurf->nextOnLight = vEntity->drawSurfs;
 				vEntity->drawSurfs = baseDrawSurf;
@@ -669,6 +761,7 @@ void R_AddSingleModel( viewEntity_t * vEntity ) {
 		//----------------------------------------
 		// add all light interactions
 		//----------------------------------------
+		drawSurf_t * clusteredDrawSurf = NULL;
 		for ( int contactedLight = 0; contactedLight < numContactedLights; contactedLight++ ) {
 			viewLight_t * vLight = contactedLights[contactedLight];
 			const idRenderLight * lightDef = vLight->lightDef;
@@ -703,7 +796,18 @@ void R_AddSingleModel( viewEntity_t * vEntity ) {
 
 			dynamicShadowVolumeParms_t * dynamicShadowParms = NULL;
 
-			if ( addInteractions && surfaceDirectlyVisible && shader->ReceivesLighting() ) {
+			// opaque surfaces lit by clustered lights are drawn once for all of them
+			bool clusteredInteraction = false;
+			if ( addInteractions && surfaceDirectlyVisible && shader->ReceivesLighting() && vLight->clustered && R_SurfaceCanBeClustered( entityDef, shader ) ) {
+				if ( surfInter == NULL || surfInter->lightTrisIndexCache > 0 ) {
+					if ( clusteredDrawSurf == NULL ) {
+						clusteredDrawSurf = R_ClusteredInteractionDrawSurf( vEntity, tri, shader, baseDrawSurf->shaderRegisters );
+					}
+					clusteredInteraction = ( clusteredDrawSurf->jointCache == 0 );
+				}
+			}
+
+			if ( addInteractions && surfaceDirectlyVisible && shader->ReceivesLighting() && !clusteredInteraction ) {
 				// static interactions can commonly find that no triangles from a surface
 				// contact the light, even when the total model does
 				if ( surfInter == NULL || surfInter->lightTrisIndexCache > 0 ) {
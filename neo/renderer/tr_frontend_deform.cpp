@@ -850,10 +850,12 @@ static drawSurf_t * R_ParticleDeform( drawSurf_t *surf, bool useArea ) {
 		return NULL;
 	}
 
-	idTempArray<byte> tempVerts( ALIGN( maxQuads * 4 * sizeof( idDrawVert ), 16 ) );
-	idDrawVert *newVerts = (idDrawVert *) tempVerts.Ptr();
-	idTempArray<byte> tempIndex( ALIGN( maxQuads * 6 * sizeof( triIndex_t ), 16 ) );
-	triIndex_t *newIndexes = (triIndex_t *) tempIndex.Ptr();
+	// the scratch buffers are reused by every call on this thread instead of being allocated from the heap
+	const int vertBytes = ALIGN( maxQuads * 4 * sizeof( idDrawVert ), 16 );
+	const int indexBytes = ALIGN( maxQuads * 6 * sizeof( triIndex_t ), 16 );
+	byte * scratch = (byte *) Mem_ThreadScratch( vertBytes + indexBytes );
+	idDrawVert *newVerts = (idDrawVert *) scratch;
+	triIndex_t *newIndexes = (triIndex_t *) ( scratch + vertBytes );
 
 	drawSurf_t * drawSurfList = NULL;
 
@@ -88,46 +88,285 @@ void R_StaticFree( void *data ) {
 /*
 ==========================================================================================
 
-FONT-END RENDERING
+DRAW SURFACE SORTING
+
+The draw surfs are sorted based on:
+1. sort value (largest first)
+2. depth (smallest first)
+3. index (largest first)
+
+The sort value and depth are packed into a 48-bit key that is stored inverted, so an
+ascending stable LSD radix sort on the keys results in the same order as the original
+descending quicksort on the keys packed together with the surface index. The index
+does not have to be part of the key, which lifts the old 65535 draw surface limit.
+
+Large lists are sorted with jobs. Each pass counts the digits per chunk of keys, turns
+the counts into write offsets for each chunk, and then every chunk scatters its keys.
+Passes for which all keys have the same digit are skipped.
 
 ==========================================================================================
 */
 
+idCVar r_useRadixSort( "r_useRadixSort", "1", CVAR_RENDERER | CVAR_BOOL, "sort draw surfaces with a radix sort instead of a quicksort that is limited to 65535 surfaces" );
+idCVar r_parallelSortMinDrawSurfs( "r_parallelSortMinDrawSurfs", "4096", CVAR_RENDERER | CVAR_INTEGER, "sort draw surfaces with jobs when there are at least this many, 0 = never" );
+
+static const int	SORT_KEY_BITS			= 48;
+static const uint64	SORT_KEY_MASK			= ( 1ULL << SORT_KEY_BITS ) - 1;
+static const int	RADIX_BITS				= 8;
+static const int	RADIX_SIZE				= 1 << RADIX_BITS;
+static const int	RADIX_PASSES			= SORT_KEY_BITS / RADIX_BITS;
+static const int	MAX_SORT_CHUNKS			= 16;
+static const int	MIN_SORT_CHUNK_KEYS		= 2048;
+
+struct radixSort_t {
+	drawSurf_t **		drawSurfs;							// keys are built from these, NULL if the keys are already set
+	uint64 *			keys[2];
+	int *				indices[2];
+	int					numKeys;
+	int					numChunks;
+	int					current;							// buffer that holds the keys sorted by the passes done so far
+	int					passSource[RADIX_PASSES];			// buffer read by each pass, -1 if the pass was skipped
+	int					counts[MAX_SORT_CHUNKS][RADIX_SIZE];	// digit counts per chunk, turned into write offsets
+};
+
+struct radixSortJob_t {
+	radixSort_t *		sort;
+	int					chunk;
+	int					pass;
+};
+
 /*
 =================
-R_SortDrawSurfs
+R_DrawSurfSortKey
 =================
 */
-static void R_SortDrawSurfs( drawSurf_t ** drawSurfs, const int numDrawSurfs ) {
-	uint64 * indices = (uint64 *) _alloca16( numDrawSurfs * sizeof( indices[0] ) );
-
-	// sort the draw surfs based on:
-	// 1. sort value (largest first)
-	// 2. depth (smallest first)
-	// 3. index (largest first)
-	assert( numDrawSurfs <= 0xFFFF );
-	for ( int i = 0; i < numDrawSurfs; i++ ) {
-		float sort = SS_POST_PROCESS - drawSurfs[i]->sort;
-		assert( sort >= 0.0f );
-
-		uint64 dist = 0;
-		if ( drawSurfs[i]->frontEndGeo != NULL ) {
-			float min = 0.0f;
-			float max = 1.0f;
-			idRenderMatrix::DepthBoundsForBounds( min, max, drawSurfs[i]->space->mvp, drawSurfs[i]->frontEndGeo->bounds );
-			dist = idMath::Ftoui16( min * 0xFFFF );
+static uint64 R_DrawSurfSortKey( const drawSurf_t * drawSurf ) {
+	float sort = SS_POST_PROCESS - drawSurf->sort;
+	assert( sort >= 0.0f );
+
+	uint64 dist = 0;
+	if ( drawSurf->frontEndGeo != NULL ) {
+		float min = 0.0f;
+		float max = 1.0f;
+		idRenderMatrix::DepthBoundsForBounds( min, max, drawSurf->space->mvp, drawSurf->frontEndGeo->bounds );
+		dist = idMath::Ftoui16( min * 0xFFFF );
+	}
+
+	return ~( dist | ( (uint64) ( *(uint32 *)&sort ) << 16 ) ) & SORT_KEY_MASK;
+}
+
+/*
+=================
+R_RadixSortChunk
+=================
+*/
+static void R_RadixSortChunk( const radixSort_t * sort, int chunk, int & start, int & end ) {
+	start = (int)( (int64)sort->numKeys * chunk / sort->numChunks );
+	end = (int)( (int64)sort->numKeys * ( chunk + 1 ) / sort->numChunks );
+}
+
+/*
+=================
+R_RadixSortInitJob
+=================
+*/
+static void R_RadixSortInitJob( radixSortJob_t * job ) {
+	radixSort_t * sort = job->sort;
+
+	int start, end;
+	R_RadixSortChunk( sort, job->chunk, start, end );
+
+	uint64 * keys = sort->keys[0];
+	int * indices = sort->indices[0];
+	if ( sort->drawSurfs != NULL ) {
+		for ( int i = start; i < end; i++ ) {
+			keys[i] = R_DrawSurfSortKey( sort->drawSurfs[i] );
+		}
+	}
+	for ( int i = start; i < end; i++ ) {
+		indices[i] = i;
+	}
+}
+
+REGISTER_PARALLEL_JOB( R_RadixSortInitJob, "R_RadixSortInitJob" );
+
+/*
+=================
+R_RadixSortCountJob
+=================
+*/
+static void R_RadixSortCountJob( radixSortJob_t * job ) {
+	radixSort_t * sort = job->sort;
+
+	int start, end;
+	R_RadixSortChunk( sort, job->chunk, start, end );
+
+	const uint64 * keys = sort->keys[sort->current];
+	const int shift = job->pass * RADIX_BITS;
+
+	int * counts = sort->counts[job->chunk];
+	memset( counts, 0, RADIX_SIZE * sizeof( counts[0] ) );
+	for ( int i = start; i < end; i++ ) {
+		counts[( keys[i] >> shift ) & ( RADIX_SIZE - 1 )]++;
+	}
+}
+
+REGISTER_PARALLEL_JOB( R_RadixSortCountJob, "R_RadixSortCountJob" );
+
+/*
+=================
+R_RadixSortOffsetsJob
+=================
+*/
+static void R_RadixSortOffsetsJob( radixSortJob_t * job ) {
+	radixSort_t * sort = job->sort;
+
+	// skip the pass if all keys have the same digit
+	for ( int digit = 0; digit < RADIX_SIZE; digit++ ) {
+		int total = 0;
+		for ( int chunk = 0; chunk < sort->numChunks; chunk++ ) {
+			total += sort->counts[chunk][digit];
 		}
-		
-		indices[i] = ( ( numDrawSurfs - i ) & 0xFFFF ) | ( dist << 16 ) | ( (uint64) ( *(uint32 *)&sort ) << 32 );
+		if ( total == sort->numKeys ) {
+			sort->passSource[job->pass] = -1;
+			return;
+		}
+		if ( total != 0 ) {
+			break;
+		}
+	}
+
+	// each chunk writes the keys with the same digit after those of the previous chunks
+	int offset = 0;
+	for ( int digit = 0; digit < RADIX_SIZE; digit++ ) {
+		for ( int chunk = 0; chunk < sort->numChunks; chunk++ ) {
+			const int count = sort->counts[chunk][digit];
+			sort->counts[chunk][digit] = offset;
+			offset += count;
+		}
+	}
+
+	sort->passSource[job->pass] = sort->current;
+	sort->current ^= 1;
+}
+
+REGISTER_PARALLEL_JOB( R_RadixSortOffsetsJob, "R_RadixSortOffsetsJob" );
+
+/*
+=================
+R_RadixSortScatterJob
+=================
+*/
+static void R_RadixSortScatterJob( radixSortJob_t * job ) {
+	radixSort_t * sort = job->sort;
+
+	const int source = sort->passSource[job->pass];
+	if ( source < 0 ) {
+		return;
+	}
+
+	int start, end;
+	R_RadixSortChunk( sort, job->chunk, start, end );
+
+	const uint64 * srcKeys = sort->keys[source];
+	const int * srcIndices = sort->indices[source];
+	uint64 * dstKeys = sort->keys[source ^ 1];
+	int * dstIndices = sort->indices[source ^ 1];
+	const int shift = job->pass * RADIX_BITS;
+
+	int * offsets = sort->counts[job->chunk];
+	for ( int i = start; i < end; i++ ) {
+		const uint64 key = srcKeys[i];
+		const int offset = offsets[( key >> shift ) & ( RADIX_SIZE - 1 )]++;
+		dstKeys[offset] = key;
+		dstIndices[offset] = srcIndices[i];
+	}
+}
+
+REGISTER_PARALLEL_JOB( R_RadixSortScatterJob, "R_RadixSortScatterJob" );
+
+/*
+=================
+R_RadixSort
+
+Returns the indices of the keys in sorted order. The keys are sorted with jobs if
+a job list is given and there are enough keys to split them into multiple chunks.
+=================
+*/
+static const int * R_RadixSort( radixSort_t & sort, idParallelJobList * jobList ) {
+	radixSortJob_t jobs[RADIX_PASSES][MAX_SORT_CHUNKS];
+
+	sort.numChunks = 1;
+	if ( jobList != NULL ) {
+		sort.numChunks = idMath::ClampInt( 1, MAX_SORT_CHUNKS, sort.numKeys / MIN_SORT_CHUNK_KEYS );
+	}
+	sort.current = 0;
+
+	for ( int pass = 0; pass < RADIX_PASSES; pass++ ) {
+		for ( int chunk = 0; chunk < sort.numChunks; chunk++ ) {
+			jobs[pass][chunk].sort = &sort;
+			jobs[pass][chunk].chunk = chunk;
+			jobs[pass][chunk].pass = pass;
+		}
+	}
+
+	if ( sort.numChunks == 1 ) {
+		R_RadixSortInitJob( &jobs[0][0] );
+		for ( int pass = 0; pass < RADIX_PASSES; pass++ ) {
+			R_RadixSortCountJob( &jobs[pass][0] );
+			R_RadixSortOffsetsJob( &jobs[pass][0] );
+			R_RadixSortScatterJob( &jobs[pass][0] );
+		}
+		return sort.indices[sort.current];
+	}
+
+	// the passes are chained with job dependencies so the whole sort is a single submit
+	jobHandle_t initJobs[MAX_SORT_CHUNKS];
+	jobHandle_t scatterJobs[MAX_SORT_CHUNKS];
+	for ( int chunk = 0; chunk < sort.numChunks; chunk++ ) {
+		initJobs[chunk] = jobList->AddJob( (jobRun_t)R_RadixSortInitJob, &jobs[0][chunk] );
 	}
+	for ( int pass = 0; pass < RADIX_PASSES; pass++ ) {
+		jobHandle_t countJobs[MAX_SORT_CHUNKS];
+		for ( int chunk = 0; chunk < sort.numChunks; chunk++ ) {
+			countJobs[chunk] = jobList->AddJob( (jobRun_t)R_RadixSortCountJob, &jobs[pass][chunk] );
+			if ( pass == 0 ) {
+				jobList->AddDependency( countJobs[chunk], initJobs[chunk] );
+			} else {
+				for ( int i = 0; i < sort.numChunks; i++ ) {
+					jobList->AddDependency( countJobs[chunk], scatterJobs[i] );
+				}
+			}
+		}
+		const jobHandle_t offsetsJob = jobList->AddJob( (jobRun_t)R_RadixSortOffsetsJob, &jobs[pass][0] );
+		for ( int chunk = 0; chunk < sort.numChunks; chunk++ ) {
+			jobList->AddDependency( offsetsJob, countJobs[chunk] );
+		}
+		for ( int chunk = 0; chunk < sort.numChunks; chunk++ ) {
+			scatterJobs[chunk] = jobList->AddContinuation( offsetsJob, (jobRun_t)R_RadixSortScatterJob, &jobs[pass][chunk] );
+		}
+	}
+	jobList->Submit();
+	jobList->Wait();
+
+	return sort.indices[sort.current];
+}
+
+/*
+=================
+R_QuickSortKeys
 
+Sorts keys that have the surface index packed in the lowest 16 bits in descending order.
+=================
+*/
+static void R_QuickSortKeys( uint64 * indices, const int numIndices ) {
 	const int64 MAX_LEVELS = 128;
 	int64 lo[MAX_LEVELS];
 	int64 hi[MAX_LEVELS];
 
 	// Keep the top of the stack in registers to avoid load-hit-stores.
 	register int64 st_lo = 0;
-	register int64 st_hi = numDrawSurfs - 1;
+	register int64 st_hi = numIndices - 1;
 	register int64 level = 0;
 
 	for ( ; ; ) {
@@ -168,14 +407,206 @@ static void R_SortDrawSurfs( drawSurf_t ** drawSurfs, const int numDrawSurfs ) {
 			st_hi = hi[level];
 		}
 	}
+}
+
+/*
+=================
+R_PackQuickSortKey
+=================
+*/
+static ID_INLINE uint64 R_PackQuickSortKey( const uint64 key, const int index, const int numKeys ) {
+	return ( ( numKeys - index ) & 0xFFFF ) | ( ( key ^ SORT_KEY_MASK ) << 16 );
+}
+
+static idList< idList< uint64, TAG_RENDER >, TAG_RENDER >	sortKeyCaptures;
+static int													sortKeyCaptureFrame = -1;	// -1 = no capture requested, 0 = capture the next frame
+
+/*
+=================
+R_CaptureSortKeys
+=================
+*/
+static void R_CaptureSortKeys( drawSurf_t ** drawSurfs, const int numDrawSurfs ) {
+	if ( sortKeyCaptureFrame == 0 ) {
+		sortKeyCaptureFrame = tr.frameCount;
+	}
+	if ( sortKeyCaptureFrame != tr.frameCount ) {
+		sortKeyCaptureFrame = -1;
+		return;
+	}
+	if ( numDrawSurfs == 0 ) {
+		return;
+	}
+
+	idList< uint64, TAG_RENDER > & keys = sortKeyCaptures.Alloc();
+	keys.SetNum( numDrawSurfs );
+	for ( int i = 0; i < numDrawSurfs; i++ ) {
+		keys[i] = R_DrawSurfSortKey( drawSurfs[i] );
+	}
+}
+
+/*
+=================
+R_SortDrawSurfs
+=================
+*/
+static void R_SortDrawSurfs( drawSurf_t ** drawSurfs, const int numDrawSurfs, idParallelJobList * jobList ) {
+	if ( sortKeyCaptureFrame >= 0 ) {
+		R_CaptureSortKeys( drawSurfs, numDrawSurfs );
+	}
+
+	if ( !r_useRadixSort.GetBool() && numDrawSurfs <= 0xFFFF ) {
+		uint64 * indices = (uint64 *) _alloca16( numDrawSurfs * sizeof( indices[0] ) );
+
+		for ( int i = 0; i < numDrawSurfs; i++ ) {
+			indices[i] = R_PackQuickSortKey( R_DrawSurfSortKey( drawSurfs[i] ), i, numDrawSurfs );
+		}
+
+		R_QuickSortKeys( indices, numDrawSurfs );
+
+		drawSurf_t ** newDrawSurfs = (drawSurf_t **) indices;
+		for ( int i = 0; i < numDrawSurfs; i++ ) {
+			newDrawSurfs[i] = drawSurfs[numDrawSurfs - ( indices[i] & 0xFFFF )];
+		}
+		memcpy( drawSurfs, newDrawSurfs, numDrawSurfs * sizeof( drawSurfs[0] ) );
+		return;
+	}
+
+	if ( numDrawSurfs <= 1 ) {
+		return;
+	}
+
+	const int minParallel = r_parallelSortMinDrawSurfs.GetInteger();
+	if ( minParallel <= 0 || numDrawSurfs < minParallel ) {
+		jobList = NULL;
+	}
+
+	radixSort_t sort;
+	sort.drawSurfs = drawSurfs;
+	sort.keys[0] = (uint64 *)tr.FrameAlloc( numDrawSurfs * sizeof( uint64 ), FRAME_ALLOC_UNKNOWN );
+	sort.keys[1] = (uint64 *)tr.FrameAlloc( numDrawSurfs * sizeof( uint64 ), FRAME_ALLOC_UNKNOWN );
+	sort.indices[0] = (int *)tr.FrameAlloc( numDrawSurfs * sizeof( int ), FRAME_ALLOC_UNKNOWN );
+	sort.indices[1] = (int *)tr.FrameAlloc( numDrawSurfs * sizeof( int ), FRAME_ALLOC_UNKNOWN );
+	sort.numKeys = numDrawSurfs;
+
+	const int * indices = R_RadixSort( sort, jobList );
 
-	drawSurf_t ** newDrawSurfs = (drawSurf_t **) indices;
+	// the keys are no longer needed so the key buffer doubles as the reordered surface list
+	compile_time_assert( sizeof( uint64 ) >= sizeof( drawSurf_t * ) );
+	drawSurf_t ** newDrawSurfs = (drawSurf_t **) sort.keys[sort.current ^ 1];
 	for ( int i = 0; i < numDrawSurfs; i++ ) {
-		newDrawSurfs[i] = drawSurfs[numDrawSurfs - ( indices[i] & 0xFFFF )];
+		newDrawSurfs[i] = drawSurfs[indices[i]];
 	}
 	memcpy( drawSurfs, newDrawSurfs, numDrawSurfs * sizeof( drawSurfs[0] ) );
 }
 
+/*
+=================
+captureSortKeys
+=================
+*/
+CONSOLE_COMMAND( captureSortKeys, "captures the draw surface sort keys of all views of the next frame for benchmarkSortDrawSurfs", NULL ) {
+	sortKeyCaptures.Clear();
+	sortKeyCaptureFrame = 0;
+	idLib::Printf( "capturing the draw surface sort keys of the next frame\n" );
+}
+
+/*
+=================
+benchmarkSortDrawSurfs
+
+Sorts the captured key sets with the quicksort and with the serial and parallel radix
+sort, and checks that all of them produce the same order.
+=================
+*/
+CONSOLE_COMMAND( benchmarkSortDrawSurfs, "compares the draw surface sorts on the keys captured with captureSortKeys", NULL ) {
+	if ( sortKeyCaptures.Num() == 0 ) {
+		idLib::Printf( "no sort keys captured, use captureSortKeys first\n" );
+		return;
+	}
+	const int iterations = ( args.Argc() > 1 ) ? Max( 1, atoi( args.Argv( 1 ) ) ) : 100;
+
+	idParallelJobList * jobList = parallelJobManager->AllocJobList( JOBLIST_UTILITY, JOBLIST_PRIORITY_MEDIUM, 1 + RADIX_PASSES * ( 2 * MAX_SORT_CHUNKS + 1 ) + MAX_SORT_CHUNKS, 0, NULL );
+
+	idLib::Printf( "sorting %d captured key sets %d times:\n", sortKeyCaptures.Num(), iterations );
+	for ( int s = 0; s < sortKeyCaptures.Num(); s++ ) {
+		const idList< uint64, TAG_RENDER > & captured = sortKeyCaptures[s];
+		const int numKeys = captured.Num();
+
+		idList< uint64, TAG_RENDER > packed;
+		idList< uint64, TAG_RENDER > keys[2];
+		idList< int, TAG_RENDER > indices[2];
+		packed.SetNum( numKeys );
+		keys[0].SetNum( numKeys );
+		keys[1].SetNum( numKeys );
+		indices[0].SetNum( numKeys );
+		indices[1].SetNum( numKeys );
+
+		// quicksort, which can only handle up to 65535 keys
+		const bool quickSort = ( numKeys <= 0xFFFF );
+		uint64 quickMicroSec = 0;
+		if ( quickSort ) {
+			for ( int i = 0; i < iterations; i++ ) {
+				for ( int j = 0; j < numKeys; j++ ) {
+					packed[j] = R_PackQuickSortKey( captured[j], j, numKeys );
+				}
+				const uint64 start = Sys_Microseconds();
+				R_QuickSortKeys( packed.Ptr(), numKeys );
+				quickMicroSec += Sys_Microseconds() - start;
+			}
+		}
+
+		// serial and parallel radix sort
+		uint64 radixMicroSec[2] = { 0, 0 };
+		bool identical = true;
+		for ( int parallel = 0; parallel < 2; parallel++ ) {
+			radixSort_t sort;
+			const int * sorted = NULL;
+			for ( int i = 0; i < iterations; i++ ) {
+				memcpy( keys[0].Ptr(), captured.Ptr(), numKeys * sizeof( uint64 ) );
+				sort.drawSurfs = NULL;
+				sort.keys[0] = keys[0].Ptr();
+				sort.keys[1] = keys[1].Ptr();
+				sort.indices[0] = indices[0].Ptr();
+				sort.indices[1] = indices[1].Ptr();
+				sort.numKeys = numKeys;
+
+				const uint64 start = Sys_Microseconds();
+				sorted = R_RadixSort( sort, parallel ? jobList : NULL );
+				radixMicroSec[parallel] += Sys_Microseconds() - start;
+			}
+			for ( int j = 0; j < numKeys; j++ ) {
+				if ( quickSort && sorted[j] != numKeys - (int)( packed[j] & 0xFFFF ) ) {
+					identical = false;
+				}
+				if ( j > 0 && captured[sorted[j - 1]] > captured[sorted[j]] ) {
+					identical = false;
+				}
+			}
+		}
+
+		if ( quickSort ) {
+			idLib::Printf( "%6d keys: quick %7.1f us, radix %7.1f us, parallel radix %7.1f us%s\n", numKeys,
+				(float)quickMicroSec / iterations, (float)radixMicroSec[0] / iterations, (float)radixMicroSec[1] / iterations,
+				identical ? "" : " (MISMATCH)" );
+		} else {
+			idLib::Printf( "%6d keys: quick     n/a    , radix %7.1f us, parallel radix %7.1f us%s\n", numKeys,
+				(float)radixMicroSec[0] / iterations, (float)radixMicroSec[1] / iterations,
+				identical ? "" : " (MISMATCH)" );
+		}
+	}
+
+	parallelJobManager->FreeJobList( jobList );
+}
+
+/*
+==========================================================================================
+
+FONT-END RENDERING
+
+==========================================================================================
+*/
+
 /*
 =====================
 R_OptimizeViewLightsList
@@ -395,7 +826,7 @@ void idRenderSystemLocal::RenderView( viewDef_t * parms ) {
 
 	// identify all the visible portal areas, and create view lights and view entities
 	// for all the the entityDefs and lightDefs that are in the visible portal areas
-	parms->renderWorld->FindViewLightsAndEntities();
+	parms->renderWorld->FindViewLightsAndEntities( m_portalCullJobList );
 
 	// wait for any shadow volume jobs from the previous frame to finish
 	m_frontEndJobList->Wait();
@@ -404,6 +835,10 @@ void idRenderSystemLocal::RenderView( viewDef_t * parms ) {
 	// add any pre-generated light shadows, and calculate the light shader values
 	AddLights();
 
+	// pick the lights that are drawn by the clustered interaction pass and bin them,
+	// this must happen before AddModels links the interaction surfaces
+	AddClusteredLights();
+
 	// adds ambient surfaces and create any necessary interaction surfaces to add to the light lists
 	AddModels();
 
@@ -414,7 +849,7 @@ void idRenderSystemLocal::RenderView( viewDef_t * parms ) {
 	R_OptimizeViewLightsList( &m_viewDef->viewLights );
 
 	// sort all the ambient surfaces for translucency ordering
-	R_SortDrawSurfs( m_viewDef->drawSurfs, m_viewDef->numDrawSurfs );
+	R_SortDrawSurfs( m_viewDef->drawSurfs, m_viewDef->numDrawSurfs, m_frontEndJobList );
 
 	// generate any subviews (mirrors, cameras, etc) before adding this view
 	if ( GenerateSubViews( m_viewDef->drawSurfs, m_viewDef->numDrawSurfs ) ) {
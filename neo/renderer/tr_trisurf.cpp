@@ -179,6 +179,8 @@ void R_FreeStaticTriSurfVertexCaches( srfTriangles_t * tri ) {
 	tri->ambientCache = 0;
 	tri->indexCache = 0;
 	tri->shadowCache = 0;
+	tri->skinnedAmbientCache = 0;
+	tri->skinnedShadowCache = 0;
 }
 
 /*
@@ -1951,6 +1953,8 @@ void R_CreateStaticBuffersForTri( srfTriangles_t & tri ) {
 	tri.indexCache = 0;
 	tri.ambientCache = 0;
 	tri.shadowCache = 0;
+	tri.skinnedAmbientCache = 0;
+	tri.skinnedShadowCache = 0;
 
 	// index cache
 	if ( tri.indexes != NULL ) {
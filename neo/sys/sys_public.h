@@ -57,7 +57,9 @@ enum cpuid_t {
 	CPUID_FTZ							= 0x04000,	// Flush-To-Zero mode (denormal results are flushed to zero)
 	CPUID_DAZ							= 0x08000,	// Denormals-Are-Zero mode (denormal source operands are set to zero)
 	CPUID_XENON							= 0x10000,	// Xbox 360
-	CPUID_CELL							= 0x20000	// PS3
+	CPUID_CELL							= 0x20000,	// PS3
+	CPUID_AVX2							= 0x40000,	// Advanced Vector Extensions 2 and FMA3 with OS support for the YMM state
+	CPUID_AVX512						= 0x80000	// AVX-512 Foundation with OS support for the ZMM state
 };
 
 enum fpuExceptions_t {
@@ -337,6 +337,88 @@ static bool HasSSE3() {
 	return false;
 }
 
+/*
+================
+HasOSXSAVE
+
+Checks that the CPU supports XGETBV and that the OS saves all the
+register state in the given XCR0 mask on a context switch.
+================
+*/
+static bool HasOSXSAVE( unsigned __int64 stateMask ) {
+	unsigned regs[4];
+
+	// get CPU feature bits
+	CPUID( 1, regs );
+
+	// bit 27 of ECX denotes OSXSAVE existence
+	if ( !( regs[_REG_ECX] & ( 1 << 27 ) ) ) {
+		return false;
+	}
+	return ( _xgetbv( 0 ) & stateMask ) == stateMask;
+}
+
+/*
+================
+HasAVX2
+================
+*/
+static bool HasAVX2() {
+	unsigned regs[4];
+	int extRegs[4];
+
+	// get CPU feature bits
+	CPUID( 1, regs );
+
+	// bit 28 of ECX denotes AVX existence, bit 12 of ECX denotes FMA3 existence
+	if ( !( regs[_REG_ECX] & ( 1 << 28 ) ) || !( regs[_REG_ECX] & ( 1 << 12 ) ) ) {
+		return false;
+	}
+
+	// the OS has to save the XMM and YMM state
+	if ( !HasOSXSAVE( 0x06 ) ) {
+		return false;
+	}
+
+	// check the maximum standard function before querying the extended features
+	CPUID( 0, regs );
+	if ( regs[_REG_EAX] < 7 ) {
+		return false;
+	}
+
+	// bit 5 of EBX from function 7 sub-leaf 0 denotes AVX2 existence
+	__cpuidex( extRegs, 7, 0 );
+	if ( extRegs[_REG_EBX] & ( 1 << 5 ) ) {
+		return true;
+	}
+	return false;
+}
+
+/*
+================
+HasAVX512
+================
+*/
+static bool HasAVX512() {
+	int extRegs[4];
+
+	if ( !HasAVX2() ) {
+		return false;
+	}
+
+	// the OS has to save the XMM, YMM, opmask and ZMM state
+	if ( !HasOSXSAVE( 0xE6 ) ) {
+		return false;
+	}
+
+	// bit 16 of EBX from function 7 sub-leaf 0 denotes AVX-512 Foundation existence
+	__cpuidex( extRegs, 7, 0 );
+	if ( extRegs[_REG_EBX] & ( 1 << 16 ) ) {
+		return true;
+	}
+	return false;
+}
+
 /*
 ================
 LogicalProcPerPhysicalProc
@@ -746,6 +828,16 @@ cpuid_t Sys_GetCPUId() {
 		flags |= CPUID_SSE3;
 	}
 
+	// check for Advanced Vector Extensions 2 and FMA3
+	if ( HasAVX2() ) {
+		flags |= CPUID_AVX2;
+	}
+
+	// check for AVX-512 Foundation
+	if ( HasAVX512() ) {
+		flags |= CPUID_AVX512;
+	}
+
 	// check for Hyper-Threading Technology
 	if ( HasHTT() ) {
 		flags |= CPUID_HTT;
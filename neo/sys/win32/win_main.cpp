@@ -1133,6 +1133,12 @@ void Sys_Init() {
 		if ( win32.cpuid & CPUID_SSE3 ) {
 			string += "SSE3 & ";
 		}
+		if ( win32.cpuid & CPUID_AVX2 ) {
+			string += "AVX2 & ";
+		}
+		if ( win32.cpuid & CPUID_AVX512 ) {
+			string += "AVX-512 & ";
+		}
 		if ( win32.cpuid & CPUID_HTT ) {
 			string += "HTT & ";
 		}
@@ -1162,6 +1168,10 @@ void Sys_Init() {
 				id |= CPUID_SSE2;
 			} else if ( token.Icmp( "sse3" ) == 0 ) {
 				id |= CPUID_SSE3;
+			} else if ( token.Icmp( "avx2" ) == 0 ) {
+				id |= CPUID_AVX2;
+			} else if ( token.Icmp( "avx512" ) == 0 ) {
+				id |= CPUID_AVX512;
 			} else if ( token.Icmp( "htt" ) == 0 ) {
 				id |= CPUID_HTT;
 			}
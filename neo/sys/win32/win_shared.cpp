@@ -276,8 +276,6 @@ char *Sys_GetCurrentUser() {
 */
 
 
-#define PROLOGUE_SIGNATURE 0x00EC8B55
-
 #include <dbghelp.h>
 
 const int UNDECORATE_FLAGS =	UNDNAME_NO_MS_KEYWORDS |
@@ -654,78 +652,26 @@ void Sym_GetFuncInfo( long addr, idStr &module, idStr &funcName ) {
 
 #endif
 
-/*
-==================
-GetFuncAddr
-==================
-*/
-address_t GetFuncAddr( address_t midPtPtr ) {
-	long temp;
-	do {
-		temp = (long)(*(long*)midPtPtr);
-		if ( (temp&0x00FFFFFF) == PROLOGUE_SIGNATURE ) {
-			break;
-		}
-		midPtPtr--;
-	} while(true);
-
-	return midPtPtr;
-}
-
-/*
-==================
-GetCallerAddr
-==================
-*/
-address_t GetCallerAddr( long _ebp ) {
-	long midPtPtr;
-	long res = 0;
-
-	__asm {
-		mov		eax, _ebp
-		mov		ecx, [eax]		// check for end of stack frames list
-		test	ecx, ecx		// check for zero stack frame
-		jz		label
-		mov		eax, [eax+4]	// get the ret address
-		test	eax, eax		// check for zero return address
-		jz		label
-		mov		midPtPtr, eax
-	}
-	res = GetFuncAddr( midPtPtr );
-label:
-	return res;
-}
-
 /*
 ==================
 Sys_GetCallStack
 
- use /Oy option
+Walking the ebp chain by hand reads garbage when the frame pointers are omitted with /Oy,
+which /O2 does in release builds. CaptureStackBackTrace checks every frame against the
+stack limits and stops at the first one it can't follow, so the callstack is at worst short.
+The entries are return addresses, which Sym_GetFuncInfo resolves to their functions.
 ==================
 */
 void Sys_GetCallStack( address_t *callStack, const int callStackSize ) {
-#if 1 //def _DEBUG
-	int i;
-	long m_ebp;
-
-	__asm {
-		mov eax, ebp
-		mov m_ebp, eax
-	}
-	// skip last two functions
-	m_ebp = *((long*)m_ebp);
-	m_ebp = *((long*)m_ebp);
-	// list functions
-	for ( i = 0; i < callStackSize; i++ ) {
-		callStack[i] = GetCallerAddr( m_ebp );
-		if ( callStack[i] == 0 ) {
-			break;
-		}
-		m_ebp = *((long*)m_ebp);
+	// CaptureStackBackTrace takes fewer than 63 frames on Windows XP
+	static const int MAX_CAPTURED_FRAMES = 62;
+	void * frames[MAX_CAPTURED_FRAMES];
+
+	// skip this function and the idSys::GetCallStack that calls it
+	int i = CaptureStackBackTrace( 2, Min( callStackSize, MAX_CAPTURED_FRAMES ), frames, NULL );
+	for ( int j = 0; j < i; j++ ) {
+		callStack[j] = (address_t)frames[j];
 	}
-#else
-	int i = 0;
-#endif
 	while( i < callStackSize ) {
 		callStack[i++] = 0;
 	}
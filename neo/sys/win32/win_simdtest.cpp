@@ -0,0 +1,281 @@
+/*
+===========================================================================
+
+Doom 3 BFG Edition GPL Source Code
+Copyright (C) 1993-2012 id Software LLC, a ZeniMax Media company. 
+
+This file is part of the Doom 3 BFG Edition GPL Source Code ("Doom 3 BFG Edition Source Code").  
+
+Doom 3 BFG Edition Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 BFG Edition Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 BFG Edition Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 BFG Edition Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 BFG Edition Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#include "../../idlib/precompiled.h"
+
+#include <windows.h>
+#include <stdio.h>
+
+/*
+================================================================================================
+
+	Standalone SIMD test
+
+	Runs the same tests and benchmarks as the testSIMD console command without starting the
+	engine, so the SIMD code can be checked from a build script. Only idLib and the CPU
+	detection are linked in, the system and common interfaces are minimal console versions.
+
+	simdtest [SSE|AVX2|all]
+
+	Returns 0 when all tests passed.
+
+================================================================================================
+*/
+
+idSys *				sys = NULL;
+idCommon *			common = NULL;
+idCmdSystem *		cmdSystem = NULL;
+idCVarSystem *		cvarSystem = NULL;
+idFileSystem *		fileSystem = NULL;
+idCVar *			idCVar::staticVars = NULL;
+
+/*
+========================
+Sys_Milliseconds
+========================
+*/
+int Sys_Milliseconds() {
+	static DWORD sys_timeBase = timeGetTime();
+	return timeGetTime() - sys_timeBase;
+}
+
+/*
+========================
+Sys_Microseconds
+========================
+*/
+uint64 Sys_Microseconds() {
+	static uint64 ticksPerMicrosecondTimes1024 = 0;
+
+	if ( ticksPerMicrosecondTimes1024 == 0 ) {
+		ticksPerMicrosecondTimes1024 = ( (uint64)Sys_ClockTicksPerSecond() << 10 ) / 1000000;
+		assert( ticksPerMicrosecondTimes1024 > 0 );
+	}
+
+	return ((uint64)( (int64)Sys_GetClockTicks() << 10 )) / ticksPerMicrosecondTimes1024;
+}
+
+cpuid_t Sys_GetCPUId();
+
+/*
+================================================
+idSysSimdTest
+================================================
+*/
+class idSysSimdTest : public idSys {
+public:
+							idSysSimdTest() : cpuid( Sys_GetCPUId() ) {}
+
+	virtual void			DebugPrintf( const char *fmt, ... ) {}
+	virtual void			DebugVPrintf( const char *fmt, va_list arg ) {}
+
+	virtual double			GetClockTicks() { return Sys_GetClockTicks(); }
+	virtual double			ClockTicksPerSecond() { return Sys_ClockTicksPerSecond(); }
+	virtual cpuid_t			GetProcessorId() { return cpuid; }
+	virtual const char *	GetProcessorString() { return ""; }
+	virtual const char *	FPU_GetState() { return Sys_FPU_GetState(); }
+	virtual bool			FPU_StackIsEmpty() { return Sys_FPU_StackIsEmpty(); }
+	virtual void			FPU_SetFTZ( bool enable ) { Sys_FPU_SetFTZ( enable ); }
+	virtual void			FPU_SetDAZ( bool enable ) { Sys_FPU_SetDAZ( enable ); }
+
+	virtual void			FPU_EnableExceptions( int exceptions ) { Sys_FPU_EnableExceptions( exceptions ); }
+
+	virtual bool			LockMemory( void *ptr, int bytes ) { return false; }
+	virtual bool			UnlockMemory( void *ptr, int bytes ) { return false; }
+
+	virtual void			GetCallStack( address_t *callStack, const int callStackSize ) { memset( callStack, 0, callStackSize * sizeof( callStack[0] ) ); }
+	virtual const char *	GetCallStackStr( const address_t *callStack, const int callStackSize ) { return ""; }
+	virtual const char *	GetCallStackCurStr( int depth ) { return ""; }
+	virtual void			ShutdownSymbols() {}
+
+	virtual int				DLL_Load( const char *dllName ) { return 0; }
+	virtual void *			DLL_GetProcAddress( int dllHandle, const char *procName ) { return NULL; }
+	virtual void			DLL_Unload( int dllHandle ) {}
+	virtual void			DLL_GetFileName( const char *baseName, char *dllName, int maxLength ) { idStr::Copynz( dllName, baseName, maxLength ); }
+
+	virtual sysEvent_t		GenerateMouseButtonEvent( int button, bool down ) { sysEvent_t ev = {}; return ev; }
+	virtual sysEvent_t		GenerateMouseMoveEvent( int deltax, int deltay ) { sysEvent_t ev = {}; return ev; }
+
+	virtual void			OpenURL( const char *url, bool quit ) {}
+	virtual void			StartProcess( const char *exePath, bool quit ) {}
+
+private:
+	cpuid_t					cpuid;
+};
+
+/*
+================================================
+idCommonSimdTest
+
+Prints to the console window, everything that needs the engine is unavailable.
+================================================
+*/
+class idCommonSimdTest : public idCommon {
+public:
+	virtual void				Init( int argc, const char * const * argv, const char *cmdline ) {}
+	virtual void				Shutdown() {}
+	virtual bool				IsShuttingDown() const { return false; }
+	virtual	void				CreateMainMenu() {}
+	virtual void				Quit() { exit( 0 ); }
+	virtual bool				IsInitialized() const { return true; }
+	virtual void				Frame() {}
+	virtual void				UpdateScreen() {}
+	virtual void				UpdateLevelLoadPacifier() {}
+
+	virtual void				StartupVariable( const char * match ) {}
+	virtual void				BeginRedirect( char *buffer, int buffersize, void (*flush)( const char * ) ) {}
+	virtual void				EndRedirect() {}
+	virtual void				SetRefreshOnPrint( bool set ) {}
+
+	virtual void				Printf( const char *fmt, ... ) {
+		va_list argptr;
+		va_start( argptr, fmt );
+		VPrintf( fmt, argptr );
+		va_end( argptr );
+	}
+	virtual void				VPrintf( const char *fmt, va_list arg ) {
+		char msg[MAX_STRING_CHARS];
+		idStr::vsnPrintf( msg, sizeof( msg ), fmt, arg );
+		idStr::RemoveColors( msg );
+		fputs( msg, stdout );
+		fflush( stdout );
+	}
+	virtual void				DPrintf( const char *fmt, ... ) {}
+	virtual void				Warning( const char *fmt, ... ) {
+		char msg[MAX_STRING_CHARS];
+		va_list argptr;
+		va_start( argptr, fmt );
+		idStr::vsnPrintf( msg, sizeof( msg ), fmt, argptr );
+		va_end( argptr );
+		Printf( "WARNING: %s\n", msg );
+	}
+	virtual void				DWarning( const char *fmt, ...) {}
+	virtual void				PrintWarnings() {}
+	virtual void				ClearWarnings( const char *reason ) {}
+	virtual void				Error( const char *fmt, ... ) {
+		char msg[MAX_STRING_CHARS];
+		va_list argptr;
+		va_start( argptr, fmt );
+		idStr::vsnPrintf( msg, sizeof( msg ), fmt, argptr );
+		va_end( argptr );
+		Printf( "ERROR: %s\n", msg );
+		exit( 1 );
+	}
+	virtual void				FatalError( const char *fmt, ... ) {
+		char msg[MAX_STRING_CHARS];
+		va_list argptr;
+		va_start( argptr, fmt );
+		idStr::vsnPrintf( msg, sizeof( msg ), fmt, argptr );
+		va_end( argptr );
+		Printf( "FATAL ERROR: %s\n", msg );
+		exit( 1 );
+	}
+
+	virtual const char *		KeysFromBinding( const char *bind ) { return ""; }
+	virtual const char *		BindingFromKey( const char *key ) { return ""; }
+	virtual int					ButtonState( int key ) { return 0; }
+	virtual int					KeyState( int key ) { return 0; }
+
+	virtual bool				IsMultiplayer() { return false; }
+	virtual bool				IsServer() { return false; }
+	virtual bool				IsClient() { return false; }
+	virtual bool				GetConsoleUsed() { return false; }
+	virtual int					GetSnapRate() { return 0; }
+	virtual void				NetReceiveReliable( int peer, int type, idBitMsg & msg ) {}
+	virtual void				NetReceiveSnapshot( class idSnapShot & ss ) {}
+	virtual void				NetReceiveUsercmds( int peer, idBitMsg & msg ) {}
+
+	virtual	bool				ProcessEvent( const sysEvent_t * event ) { return false; }
+	virtual bool				LoadGame( const char * saveName ) { return false; }
+	virtual bool				SaveGame( const char * saveName ) { return false; }
+
+	virtual idGame *			Game() { return NULL; }
+	virtual idRenderWorld *		RW() { return NULL; }
+	virtual idSoundWorld *		SW() { return NULL; }
+	virtual idSoundWorld *		MenuSW() { return NULL; }
+	virtual idSession *			Session() { return NULL; }
+	virtual idCommonDialog &	Dialog() { FatalError( "no common dialog in the SIMD test" ); return *(idCommonDialog *)NULL; }
+
+	virtual void				OnSaveCompleted( idSaveLoadParms & parms ) {}
+	virtual void				OnLoadCompleted( idSaveLoadParms & parms ) {}
+	virtual void				OnLoadFilesCompleted( idSaveLoadParms & parms ) {}
+	virtual void				OnEnumerationCompleted( idSaveLoadParms & parms ) {}
+	virtual void				OnDeleteCompleted( idSaveLoadParms & parms ) {}
+	virtual void				TriggerScreenWipe( const char * _wipeMaterial, bool hold ) {}
+	virtual void				OnStartHosting( idMatchParameters & parms ) {}
+	virtual int					GetGameFrame() { return 0; }
+	virtual void				LaunchExternalTitle( int titleIndex, int device, const lobbyConnectInfo_t * const connectInfo ) {}
+	virtual void				InitializeMPMapsModes() {}
+	virtual const idStrList &			GetModeList() const { return emptyStrList; }
+	virtual const idStrList &			GetModeDisplayList() const { return emptyStrList; }
+	virtual const idList<mpMap_t> &		GetMapList() const { return emptyMapList; }
+	virtual void				ResetPlayerInput( int playerIndex ) {}
+	virtual bool				JapaneseCensorship() const { return false; }
+	virtual void				QueueShowShell() {}
+	virtual currentGame_t		GetCurrentGame() const { return DOOM3_BFG; }
+	virtual void				SwitchToGame( currentGame_t newGame ) {}
+
+private:
+	idStrList					emptyStrList;
+	idList<mpMap_t>				emptyMapList;
+};
+
+/*
+==================
+main
+==================
+*/
+int main( int argc, char ** argv ) {
+	if ( argc > 2 || ( argc == 2 && ( idStr::Icmp( argv[1], "-h" ) == 0 || idStr::Icmp( argv[1], "/?" ) == 0 ) ) ) {
+		printf( "usage: simdtest [SSE|AVX2|all]\n" );
+		return 2;
+	}
+
+	idSysSimdTest		sysSimdTest;
+	idCommonSimdTest	commonSimdTest;
+
+	sys = &sysSimdTest;
+	common = &commonSimdTest;
+
+	idLib::sys			= sys;
+	idLib::common		= common;
+	idLib::cvarSystem	= NULL;
+	idLib::fileSystem	= NULL;
+
+	idLib::Init();
+	idSIMD::InitProcessor( "simdtest", false );
+
+	const int failedTests = idSIMD::Test( ( argc == 2 ) ? argv[1] : "" );
+	if ( failedTests > 0 ) {
+		idLib::Printf( "simdtest: %d tests failed\n", failedTests );
+	}
+
+	idLib::ShutDown();
+
+	return ( failedTests == 0 ) ? 0 : 1;
+}